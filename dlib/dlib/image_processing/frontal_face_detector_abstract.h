@@ -17,6 +17,27 @@ namespace dlib
         ensures
             - returns an object_detector that is configured to find human faces that are
               looking more or less towards the camera.
+            - Its filter banks have the cascades of get_frontal_face_cascades(), so
+              turning on get_scanner().set_cascade_scoring() scores them in stages.
+            - It has 5 filters.  By weight_index they find faces looking to the
+              front, to the left, to the right, to the front but rotated left and to
+              the front but rotated right.  set_enabled_detectors() runs only some of
+              these poses.
+    !*/
+
+    std::vector<fhog_cascade> get_frontal_face_cascades(
+    );
+    /*!
+        ensures
+            - returns a cascade for each of the 5 filters of get_frontal_face_detector(),
+              calibrated with calibrate_fhog_cascades() on the images of
+              examples/faces.
+            - These bounds are examples only.  They come from the 12 faces of
+              examples/faces, the same images TestCascade checks them on, and the
+              bound of the tilted right filter from 9 windows.  An application that
+              turns on cascade scoring should calibrate its own cascades, on images
+              disjoint from the ones it tests them on, and set them with
+              set_fhog_cascades().
     !*/
 
 }
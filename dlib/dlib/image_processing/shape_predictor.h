@@ -11,6 +11,13 @@
 #include "../pixel.h"
 #include "../console_progress_indicator.h"
 #include "../statistics.h"
+#include "../uintn.h"
+#include "../image_transforms/separable_filter_bank.h"
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <new>
+#include <string>
 #include <utility>
 
 namespace dlib
@@ -101,6 +108,395 @@ namespace dlib
             }
         };
 
+    // ------------------------------------------------------------------------------------
+
+        template <typename T, unsigned long alignment>
+        class aligned_allocator
+        {
+            /*!
+                REQUIREMENTS ON alignment
+                    A power of 2 no smaller than sizeof(void*).
+
+                WHAT THIS OBJECT REPRESENTS
+                    A standard allocator whose blocks start on alignment byte
+                    boundaries.  The address operator new returned is kept in the
+                    pointer right before each block.
+            !*/
+        public:
+            typedef T value_type;
+            template <typename U> struct rebind { typedef aligned_allocator<U,alignment> other; };
+
+            aligned_allocator () {}
+            template <typename U> aligned_allocator (const aligned_allocator<U,alignment>&) {}
+
+            T* allocate (
+                std::size_t n
+            )
+            {
+                if (n > (std::numeric_limits<std::size_t>::max() - alignment - sizeof(void*))/sizeof(T))
+                    throw std::bad_alloc();
+                char* raw = static_cast<char*>(::operator new(n*sizeof(T) + alignment + sizeof(void*)));
+                char* p = raw + sizeof(void*);
+                p += (alignment - reinterpret_cast<std::uintptr_t>(p)%alignment)%alignment;
+                reinterpret_cast<void**>(p)[-1] = raw;
+                return reinterpret_cast<T*>(p);
+            }
+
+            void deallocate (
+                T* p,
+                std::size_t
+            ) { ::operator delete(reinterpret_cast<void**>(p)[-1]); }
+
+            template <typename U> bool operator== (const aligned_allocator<U,alignment>&) const { return true; }
+            template <typename U> bool operator!= (const aligned_allocator<U,alignment>&) const { return false; }
+        };
+
+    // ------------------------------------------------------------------------------------
+
+        class flat_forest
+        {
+            /*!
+                WHAT THIS OBJECT REPRESENTS
+                    The regression trees of one cascade level of a shape_predictor, laid
+                    out for inference.  The splits of all the trees are in three flat
+                    arrays and the leaves of all the trees are the rows of one float
+                    buffer, 64 byte aligned, each row padded to a multiple of 8 floats.  A tree is then
+                    two offsets into those instead of two vectors of small heap blocks.
+
+                    The arrays are either held by this object, when the trees are added
+                    with add_tree(), or are in memory it only points to, e.g. a mapped
+                    file, which a shared_ptr keeps alive.
+            !*/
+        public:
+
+            // A cache line, the alignment of a mapped file's sections, so no row of 8
+            // floats straddles two.
+            static const unsigned long leaf_alignment = 64;
+            typedef std::vector<float,aligned_allocator<float,leaf_alignment> > leaf_vector;
+
+            flat_forest (
+            ) : num_values(0), leaf_stride(0) { clear_arrays(); }
+
+            flat_forest (
+                unsigned long num_shape_values
+            ) : num_values(num_shape_values), leaf_stride(padded_size(num_shape_values)) { clear_arrays(); }
+            /*!
+                ensures
+                    - #num_trees() == 0
+                    - the trees added to this object have leaves of num_shape_values
+                      floats
+            !*/
+
+            flat_forest (
+                unsigned long num_shape_values,
+                unsigned long num_trees,
+                const uint32* split_begin_,
+                const uint32* leaf_begin_,
+                const uint32* idx1_,
+                const uint32* idx2_,
+                const float* thresh_,
+                const float* leaves_,
+                const std::shared_ptr<const void>& storage_
+            ) : num_values(num_shape_values), leaf_stride(padded_size(num_shape_values)), trees(num_trees),
+                split_begin(split_begin_), leaf_begin(leaf_begin_), idx1(idx1_), idx2(idx2_),
+                thresh(thresh_), leaves(leaves_), storage(storage_)
+            /*!
+                requires
+                    - the arrays are laid out like the ones returned by get_split_begin()
+                      and the rest, and live as long as storage
+                ensures
+                    - #num_trees() == num_trees
+                    - runs the trees in the arrays without copying them.  No trees can
+                      be added.
+            !*/
+            {}
+
+            flat_forest (
+                const flat_forest& item
+            ) { *this = item; }
+
+            flat_forest& operator= (
+                const flat_forest& item
+            )
+            {
+                num_values = item.num_values;
+                leaf_stride = item.leaf_stride;
+                trees = item.trees;
+                split_begin_data = item.split_begin_data;
+                leaf_begin_data = item.leaf_begin_data;
+                idx1_data = item.idx1_data;
+                idx2_data = item.idx2_data;
+                thresh_data = item.thresh_data;
+                leaves_data = item.leaves_data;
+                storage = item.storage;
+                if (storage)
+                {
+                    split_begin = item.split_begin;
+                    leaf_begin = item.leaf_begin;
+                    idx1 = item.idx1;
+                    idx2 = item.idx2;
+                    thresh = item.thresh;
+                    leaves = item.leaves;
+                }
+                else
+                {
+                    bind_arrays();
+                }
+                return *this;
+            }
+
+            static unsigned long padded_size (
+                unsigned long num_shape_values
+            ) { return (num_shape_values+7)/8*8; }
+
+            unsigned long num_trees (
+            ) const { return trees; }
+
+            unsigned long num_leaves (
+                unsigned long tree
+            ) const { return leaf_begin[tree+1] - leaf_begin[tree]; }
+
+            unsigned long get_num_values (
+            ) const { return num_values; }
+
+            unsigned long get_leaf_stride (
+            ) const { return leaf_stride; }
+
+            // The arrays the trees are run from.  Tree t has the splits
+            // [split_begin[t], split_begin[t+1]) of idx1, idx2 and thresh, and the
+            // leaves [leaf_begin[t], leaf_begin[t+1]), which are rows of leaf_stride
+            // floats in leaves.
+            const uint32* get_split_begin () const { return split_begin; }
+            const uint32* get_leaf_begin () const { return leaf_begin; }
+            const uint32* get_idx1 () const { return idx1; }
+            const uint32* get_idx2 () const { return idx2; }
+            const float* get_thresh () const { return thresh; }
+            const float* get_leaves () const { return leaves; }
+
+            void reserve (
+                unsigned long num_trees,
+                unsigned long leaves_per_tree
+            )
+            /*!
+                ensures
+                    - makes room for that many more trees, so adding them doesn't
+                      reallocate the leaves
+            !*/
+            {
+                const unsigned long splits = num_trees*(leaves_per_tree-1);
+                idx1_data.reserve(idx1_data.size() + splits);
+                idx2_data.reserve(idx2_data.size() + splits);
+                thresh_data.reserve(thresh_data.size() + splits);
+                split_begin_data.reserve(split_begin_data.size() + num_trees);
+                leaf_begin_data.reserve(leaf_begin_data.size() + num_trees);
+                leaves_data.reserve(leaves_data.size() + num_trees*leaves_per_tree*leaf_stride);
+            }
+
+            void add_tree (
+                const regression_tree& tree
+            )
+            /*!
+                requires
+                    - this object wasn't made from arrays it doesn't hold
+                    - tree.leaf_values.size() == tree.splits.size()+1
+                    - all the leaves of tree have the size given to the constructor
+                ensures
+                    - #num_trees() == num_trees() + 1
+            !*/
+            {
+                DLIB_ASSERT(!storage, "");
+                for (unsigned long i = 0; i < tree.splits.size(); ++i)
+                {
+                    idx1_data.push_back(tree.splits[i].idx1);
+                    idx2_data.push_back(tree.splits[i].idx2);
+                    thresh_data.push_back(tree.splits[i].thresh);
+                }
+                split_begin_data.push_back(idx1_data.size());
+                for (unsigned long i = 0; i < tree.leaf_values.size(); ++i)
+                {
+                    DLIB_ASSERT(tree.leaf_values[i].size() == (long)num_values, "");
+                    const unsigned long row = leaves_data.size();
+                    leaves_data.resize(row + leaf_stride, 0);
+                    std::copy(tree.leaf_values[i].begin(), tree.leaf_values[i].end(), leaves_data.begin()+row);
+                }
+                leaf_begin_data.push_back(leaf_begin_data.back() + tree.leaf_values.size());
+                ++trees;
+                bind_arrays();
+            }
+
+            regression_tree get_tree (
+                unsigned long tree
+            ) const
+            /*!
+                ensures
+                    - returns the tree-th tree, as a regression_tree
+            !*/
+            {
+                regression_tree temp;
+                for (unsigned long i = split_begin[tree]; i < split_begin[tree+1]; ++i)
+                {
+                    split_feature split;
+                    split.idx1 = idx1[i];
+                    split.idx2 = idx2[i];
+                    split.thresh = thresh[i];
+                    temp.splits.push_back(split);
+                }
+                temp.leaf_values.resize(num_leaves(tree));
+                for (unsigned long i = 0; i < temp.leaf_values.size(); ++i)
+                {
+                    const float* row = leaves + (leaf_begin[tree]+i)*leaf_stride;
+                    temp.leaf_values[i].set_size(num_values);
+                    std::copy(row, row+num_values, temp.leaf_values[i].begin());
+                }
+                return temp;
+            }
+
+            void find_leaves (
+                const std::vector<float>& feature_pixel_values,
+                std::vector<unsigned long>& leaf_idx
+            ) const
+            /*!
+                ensures
+                    - #leaf_idx.size() == num_trees()
+                    - #leaf_idx[t] == the leaf get_tree(t) ends up in for
+                      feature_pixel_values, as regression_tree::operator() returns it
+            !*/
+            {
+                leaf_idx.resize(num_trees());
+                const float* values = feature_pixel_values.data();
+                for (unsigned long t = 0; t < leaf_idx.size(); ++t)
+                {
+                    const unsigned long num_splits = split_begin[t+1] - split_begin[t];
+                    const uint32* a = idx1 + split_begin[t];
+                    const uint32* b = idx2 + split_begin[t];
+                    const float* th = thresh + split_begin[t];
+                    unsigned long i = 0;
+                    while (i < num_splits)
+                        i = values[a[i]] - values[b[i]] > th[i] ? left_child(i) : right_child(i);
+                    leaf_idx[t] = i - num_splits;
+                }
+            }
+
+            void add_leaves (
+                const std::vector<unsigned long>& leaf_idx,
+                matrix<float,0,1>& shape
+            ) const
+            /*!
+                requires
+                    - leaf_idx.size() == num_trees()
+                    - shape.size() is the size given to the constructor
+                ensures
+                    - adds the leaf leaf_idx[t] of every tree t to shape.  Every value is
+                      summed in tree order, the same as adding the leaves one tree at a
+                      time, so the result is the same to the bit.
+            !*/
+            {
+                if (num_values == 0)
+                    return;
+                // the shape, padded to the rows of the leaves
+                float padded[max_padded_values];
+                float* acc = num_values <= max_padded_values ? padded : 0;
+                std::vector<float> big;
+                if (!acc)
+                {
+                    big.resize(leaf_stride);
+                    acc = &big[0];
+                }
+                std::copy(shape.begin(), shape.end(), acc);
+                std::fill(acc+num_values, acc+leaf_stride, 0);
+
+                // Four lanes of 8 floats are summed at once, so the adds of one don't
+                // wait on the last add of the same lanes.
+                unsigned long c = 0;
+                for (; c+32 <= leaf_stride; c += 32)
+                {
+                    filter_lanes s0, s1, s2, s3, v;
+                    s0.load(acc+c); s1.load(acc+c+8); s2.load(acc+c+16); s3.load(acc+c+24);
+                    for (unsigned long t = 0; t < leaf_idx.size(); ++t)
+                    {
+                        const float* row = leaves + (leaf_begin[t]+leaf_idx[t])*leaf_stride + c;
+                        v.load(row);    s0 += v;
+                        v.load(row+8);  s1 += v;
+                        v.load(row+16); s2 += v;
+                        v.load(row+24); s3 += v;
+                    }
+                    s0.store(acc+c); s1.store(acc+c+8); s2.store(acc+c+16); s3.store(acc+c+24);
+                }
+                for (; c < leaf_stride; c += 8)
+                {
+                    filter_lanes s0, v;
+                    s0.load(acc+c);
+                    for (unsigned long t = 0; t < leaf_idx.size(); ++t)
+                    {
+                        v.load(leaves + (leaf_begin[t]+leaf_idx[t])*leaf_stride + c);
+                        s0 += v;
+                    }
+                    s0.store(acc+c);
+                }
+                std::copy(acc, acc+num_values, shape.begin());
+            }
+
+            unsigned long capacity_bytes (
+            ) const
+            /*!
+                ensures
+                    - returns the bytes of the arrays this object holds, so not those of
+                      a mapped file
+            !*/
+            {
+                return (split_begin_data.capacity() + leaf_begin_data.capacity() +
+                        idx1_data.capacity() + idx2_data.capacity())*sizeof(uint32) +
+                    (thresh_data.capacity() + leaves_data.capacity())*sizeof(float);
+            }
+
+        private:
+
+            void clear_arrays (
+            )
+            {
+                trees = 0;
+                split_begin_data.assign(1, 0);
+                leaf_begin_data.assign(1, 0);
+                bind_arrays();
+            }
+
+            void bind_arrays (
+            )
+            {
+                split_begin = split_begin_data.data();
+                leaf_begin = leaf_begin_data.data();
+                idx1 = idx1_data.data();
+                idx2 = idx2_data.data();
+                thresh = thresh_data.data();
+                leaves = leaves_data.data();
+            }
+
+            // enough for 128 landmarks without a heap buffer
+            static const unsigned long max_padded_values = 256;
+
+            unsigned long num_values;
+            unsigned long leaf_stride;
+            unsigned long trees;
+
+            // what add_tree() fills in, when the arrays are held here
+            std::vector<uint32> split_begin_data;
+            std::vector<uint32> leaf_begin_data;
+            std::vector<uint32> idx1_data;
+            std::vector<uint32> idx2_data;
+            std::vector<float> thresh_data;
+            leaf_vector leaves_data;
+
+            // the arrays the trees are run from, the ones above or memory kept alive
+            // by storage
+            const uint32* split_begin;
+            const uint32* leaf_begin;
+            const uint32* idx1;
+            const uint32* idx2;
+            const float* thresh;
+            const float* leaves;
+            std::shared_ptr<const void> storage;
+        };
+
     // ------------------------------------------------------------------------------------
 
         inline vector<float,2> location (
@@ -197,6 +593,35 @@ namespace dlib
             return find_similarity_transform(from_points, to_points);
         }
 
+        inline point_transform_affine find_tform_between_shapes (
+            const matrix<float,0,1>& from_shape,
+            const matrix<float,0,1>& to_shape,
+            const std::vector<unsigned long>& idx
+        )
+        /*!
+            requires
+                - from_shape.size() == to_shape.size()
+                - max(mat(idx)) < from_shape.size()/2
+            ensures
+                - returns the transform between the points idx of the two shapes, or
+                  between all their points if idx is empty.
+        !*/
+        {
+            if (idx.size() == 0)
+                return find_tform_between_shapes(from_shape, to_shape);
+            if (idx.size() == 1)
+                return point_transform_affine();
+            std::vector<vector<float,2> > from_points, to_points;
+            from_points.reserve(idx.size());
+            to_points.reserve(idx.size());
+            for (unsigned long i = 0; i < idx.size(); ++i)
+            {
+                from_points.push_back(location(from_shape,idx[i]));
+                to_points.push_back(location(to_shape,idx[i]));
+            }
+            return find_similarity_transform(from_points, to_points);
+        }
+
     // ------------------------------------------------------------------------------------
 
         inline point_transform_affine normalizing_tform (
@@ -235,6 +660,96 @@ namespace dlib
 
     // ------------------------------------------------------------------------------------
 
+        template <typename image_type>
+        void find_feature_pixels (
+            const image_type& img,
+            const point_transform_affine& tform_to_img,
+            const matrix<float,0,1>& current_shape,
+            const matrix<float,0,1>& reference_shape,
+            const std::vector<unsigned long>& reference_pixel_anchor_idx,
+            const std::vector<dlib::vector<float,2> >& reference_pixel_deltas,
+            const std::vector<unsigned long>& tform_idx,
+            std::vector<long>& pixel_offsets
+        )
+        /*!
+            requires
+                - image_type == an image object that implements the interface defined in
+                  dlib/image_processing/generic_image.h 
+                - reference_pixel_anchor_idx.size() == reference_pixel_deltas.size()
+                - current_shape.size() == reference_shape.size()
+                - reference_shape.size()%2 == 0
+                - max(mat(reference_pixel_anchor_idx)) < reference_shape.size()/2
+            ensures
+                - #pixel_offsets.size() == reference_pixel_deltas.size()
+                - for all valid i:
+                    - #pixel_offsets[i] == the byte offset from image_data(img) of the
+                      pixel identified by reference_pixel_anchor_idx[i] and
+                      reference_pixel_deltas[i] when the pixel is located relative to
+                      current_shape rather than reference_shape, and mapped to img by
+                      tform_to_img.  It is -1 if the pixel is outside img.
+                - current_shape is aligned to reference_shape by its points tform_idx,
+                  or all its points if tform_idx is empty.
+        !*/
+        {
+            typedef typename image_traits<image_type>::pixel_type pixel_type;
+            const matrix<float,2,2> tform = matrix_cast<float>(find_tform_between_shapes(reference_shape, current_shape, tform_idx).get_m());
+            const float t00 = tform(0,0), t01 = tform(0,1), t10 = tform(1,0), t11 = tform(1,1);
+            const matrix<double,2,2>& m = tform_to_img.get_m();
+            const double m00 = m(0,0), m01 = m(0,1), m10 = m(1,0), m11 = m(1,1);
+            const double b0 = tform_to_img.get_b().x(), b1 = tform_to_img.get_b().y();
+            const long nr = num_rows(img), nc = num_columns(img), step = width_step(img);
+
+            // Only arithmetic, no image reads, so the points of all the pixels are
+            // found in one tight loop.  These are the float and then double operations
+            // of tform_to_img(tform*delta + location(current_shape,anchor)) in the same
+            // order, so the points are the same to the bit.
+            const float* shape = &current_shape(0);
+            const unsigned long* anchors = reference_pixel_anchor_idx.data();
+            const dlib::vector<float,2>* deltas = reference_pixel_deltas.data();
+            pixel_offsets.resize(reference_pixel_deltas.size());
+            for (unsigned long i = 0; i < pixel_offsets.size(); ++i)
+            {
+                const float dx = deltas[i].x(), dy = deltas[i].y();
+                const double qx = (t00*dx + t01*dy) + shape[anchors[i]*2];
+                const double qy = (t10*dx + t11*dy) + shape[anchors[i]*2+1];
+                const long x = static_cast<long>(std::floor((m00*qx + m01*qy) + b0 + 0.5));
+                const long y = static_cast<long>(std::floor((m10*qx + m11*qy) + b1 + 0.5));
+                if (x >= 0 && x < nc && y >= 0 && y < nr)
+                    pixel_offsets[i] = y*step + x*(long)sizeof(pixel_type);
+                else
+                    pixel_offsets[i] = -1;
+            }
+        }
+
+        template <typename image_type, typename feature_type>
+        void read_feature_pixels (
+            const image_type& img,
+            const std::vector<long>& pixel_offsets,
+            std::vector<feature_type>& feature_pixel_values
+        )
+        /*!
+            requires
+                - pixel_offsets came from find_feature_pixels() for img
+            ensures
+                - #feature_pixel_values.size() == pixel_offsets.size()
+                - #feature_pixel_values[i] == the intensity of the pixel at
+                  pixel_offsets[i], or 0 if it is -1.  An 8 bit luminance image, e.g. a
+                  camera's Y plane, is read with no conversion at all.
+        !*/
+        {
+            typedef typename image_traits<image_type>::pixel_type pixel_type;
+            const char* data = static_cast<const char*>(image_data(img));
+            feature_pixel_values.resize(pixel_offsets.size());
+            for (unsigned long i = 0; i < pixel_offsets.size(); ++i)
+            {
+                const long offset = pixel_offsets[i];
+                if (offset >= 0)
+                    feature_pixel_values[i] = get_pixel_intensity(*reinterpret_cast<const pixel_type*>(data + offset));
+                else
+                    feature_pixel_values[i] = 0;
+            }
+        }
+
         template <typename image_type, typename feature_type>
         void extract_feature_pixel_values (
             const image_type& img_,
@@ -243,7 +758,8 @@ namespace dlib
             const matrix<float,0,1>& reference_shape,
             const std::vector<unsigned long>& reference_pixel_anchor_idx,
             const std::vector<dlib::vector<float,2> >& reference_pixel_deltas,
-            std::vector<feature_type>& feature_pixel_values
+            std::vector<feature_type>& feature_pixel_values,
+            const std::vector<unsigned long>& tform_idx
         )
         /*!
             requires
@@ -260,25 +776,31 @@ namespace dlib
                       corresponds to the pixel identified by reference_pixel_anchor_idx[i]
                       and reference_pixel_deltas[i] when the pixel is located relative to
                       current_shape rather than reference_shape.
+                - current_shape is aligned to reference_shape by its points tform_idx,
+                  or all its points if tform_idx is empty.
         !*/
         {
-            const matrix<float,2,2> tform = matrix_cast<float>(find_tform_between_shapes(reference_shape, current_shape).get_m());
-            const point_transform_affine tform_to_img = unnormalizing_tform(rect);
-
-            const rectangle area = get_rect(img_);
+            std::vector<long> pixel_offsets;
+            find_feature_pixels(img_, unnormalizing_tform(rect), current_shape, reference_shape,
+                                reference_pixel_anchor_idx, reference_pixel_deltas, tform_idx,
+                                pixel_offsets);
+            read_feature_pixels(img_, pixel_offsets, feature_pixel_values);
+        }
 
-            const_image_view<image_type> img(img_);
-            feature_pixel_values.resize(reference_pixel_deltas.size());
-            for (unsigned long i = 0; i < feature_pixel_values.size(); ++i)
-            {
-                // Compute the point in the current shape corresponding to the i-th pixel and
-                // then map it from the normalized shape space into pixel space.
-                point p = tform_to_img(tform*reference_pixel_deltas[i] + location(current_shape, reference_pixel_anchor_idx[i]));
-                if (area.contains(p))
-                    feature_pixel_values[i] = get_pixel_intensity(img[p.y()][p.x()]);
-                else
-                    feature_pixel_values[i] = 0;
-            }
+        template <typename image_type, typename feature_type>
+        void extract_feature_pixel_values (
+            const image_type& img_,
+            const rectangle& rect,
+            const matrix<float,0,1>& current_shape,
+            const matrix<float,0,1>& reference_shape,
+            const std::vector<unsigned long>& reference_pixel_anchor_idx,
+            const std::vector<dlib::vector<float,2> >& reference_pixel_deltas,
+            std::vector<feature_type>& feature_pixel_values
+        )
+        {
+            extract_feature_pixel_values(img_, rect, current_shape, reference_shape,
+                                         reference_pixel_anchor_idx, reference_pixel_deltas,
+                                         feature_pixel_values, std::vector<unsigned long>());
         }
 
     } // end namespace impl
@@ -298,7 +820,7 @@ namespace dlib
             const matrix<float,0,1>& initial_shape_,
             const std::vector<std::vector<impl::regression_tree> >& forests_,
             const std::vector<std::vector<dlib::vector<float,2> > >& pixel_coordinates
-        ) : initial_shape(initial_shape_), forests(forests_)
+        ) : initial_shape(initial_shape_)
         /*!
             requires
                 - initial_shape.size()%2 == 0
@@ -312,6 +834,15 @@ namespace dlib
                       (i.e. there need to be the right number of leaves given the number of splits in the tree)
         !*/
         {
+            // the trees are kept packed for inference, see impl::flat_forest
+            forests.resize(forests_.size(), impl::flat_forest(initial_shape.size()));
+            for (unsigned long i = 0; i < forests_.size(); ++i)
+            {
+                if (forests_[i].size() != 0)
+                    forests[i].reserve(forests_[i].size(), forests_[i][0].num_leaves());
+                for (unsigned long j = 0; j < forests_[i].size(); ++j)
+                    forests[i].add_tree(forests_[i][j]);
+            }
             anchor_idx.resize(pixel_coordinates.size());
             deltas.resize(pixel_coordinates.size());
             // Each cascade uses a different set of pixels for its features.  We compute
@@ -322,17 +853,142 @@ namespace dlib
 
         unsigned long num_parts (
         ) const
+        {
+            return part_slot.size() != 0 ? part_slot.size() : initial_shape.size()/2;
+        }
+
+        unsigned long num_cascade_levels (
+        ) const
+        {
+            return forests.size();
+        }
+
+        unsigned long num_found_parts (
+        ) const
+        /*!
+            ensures
+                - returns how many parts operator() locates, which is num_parts() unless
+                  this object came from select_parts()
+        !*/
         {
             return initial_shape.size()/2;
         }
 
+        shape_predictor select_parts (
+            const std::vector<unsigned long>& parts,
+            const std::vector<unsigned long>& tform_parts
+        ) const
+        /*!
+            requires
+                - num_found_parts() == num_parts()
+                - all the values in parts and tform_parts are < num_parts()
+            ensures
+                - returns a shape_predictor that only locates parts and tform_parts.
+                  Its leaves are this model's leaves cut down to those parts, so each
+                  tree adds fewer values to the shape.  Every feature pixel is anchored
+                  to the nearest part kept, and the shape is aligned to the initial shape
+                  by tform_parts only, or by all the parts kept if tform_parts is empty.
+                  That makes it an approximation of this model: a pixel anchored to a
+                  part left out moves with another part now, so the kept parts come out
+                  near, not at, where this model puts them.
+                - #num_parts() == num_parts(), and the detections of the returned object
+                  have OBJECT_PART_NOT_PRESENT for the parts left out.
+                - the returned object can't be serialized, so select the parts after
+                  loading the full model.
+        !*/
+        {
+            DLIB_CASSERT(part_slot.size() == 0,
+                "\t shape_predictor shape_predictor::select_parts()"
+                << "\n\t The parts of a shape_predictor can only be selected once.");
+            std::vector<long> slot(num_parts(), -1);
+            for (unsigned long i = 0; i < parts.size() + tform_parts.size(); ++i)
+            {
+                const unsigned long part = i < parts.size() ? parts[i] : tform_parts[i-parts.size()];
+                DLIB_CASSERT(part < num_parts(),
+                    "\t shape_predictor shape_predictor::select_parts()"
+                    << "\n\t Invalid inputs were given to this function. "
+                    << "\n\t part:        " << part
+                    << "\n\t num_parts(): " << num_parts());
+                slot[part] = 0;
+            }
+
+            // the kept parts keep the order they have in this model
+            shape_predictor temp;
+            unsigned long num_kept = 0;
+            for (unsigned long i = 0; i < slot.size(); ++i)
+            {
+                if (slot[i] == 0)
+                    slot[i] = num_kept++;
+                else
+                    slot[i] = -1;
+            }
+            temp.initial_shape.set_size(num_kept*2);
+            for (unsigned long i = 0; i < slot.size(); ++i)
+            {
+                if (slot[i] >= 0)
+                {
+                    temp.initial_shape(slot[i]*2) = initial_shape(i*2);
+                    temp.initial_shape(slot[i]*2+1) = initial_shape(i*2+1);
+                }
+            }
+            temp.part_slot = slot;
+            for (unsigned long i = 0; i < tform_parts.size(); ++i)
+                temp.tform_idx.push_back(slot[tform_parts[i]]);
+
+            temp.forests.assign(forests.size(), impl::flat_forest(num_kept*2));
+            for (unsigned long i = 0; i < forests.size(); ++i)
+            {
+                for (unsigned long j = 0; j < forests[i].num_trees(); ++j)
+                {
+                    impl::regression_tree tree = forests[i].get_tree(j);
+                    if (j == 0)
+                        temp.forests[i].reserve(forests[i].num_trees(), tree.num_leaves());
+                    for (unsigned long k = 0; k < tree.leaf_values.size(); ++k)
+                    {
+                        matrix<float,0,1> leaf(num_kept*2);
+                        for (unsigned long p = 0; p < slot.size(); ++p)
+                        {
+                            if (slot[p] >= 0)
+                            {
+                                leaf(slot[p]*2) = tree.leaf_values[k](p*2);
+                                leaf(slot[p]*2+1) = tree.leaf_values[k](p*2+1);
+                            }
+                        }
+                        tree.leaf_values[k].swap(leaf);
+                    }
+                    temp.forests[i].add_tree(tree);
+                }
+            }
+
+            // A pixel anchored to a kept part stays as it is.  The others are anchored
+            // to the kept part nearest to where they are on the initial shape.
+            temp.anchor_idx = anchor_idx;
+            temp.deltas = deltas;
+            for (unsigned long i = 0; i < anchor_idx.size(); ++i)
+            {
+                for (unsigned long j = 0; j < anchor_idx[i].size(); ++j)
+                {
+                    const unsigned long anchor = anchor_idx[i][j];
+                    if (slot[anchor] >= 0)
+                    {
+                        temp.anchor_idx[i][j] = slot[anchor];
+                        continue;
+                    }
+                    const dlib::vector<float,2> p = impl::location(initial_shape, anchor) + deltas[i][j];
+                    temp.anchor_idx[i][j] = impl::nearest_shape_point(temp.initial_shape, p);
+                    temp.deltas[i][j] = p - impl::location(temp.initial_shape, temp.anchor_idx[i][j]);
+                }
+            }
+            return temp;
+        }
+
         unsigned long num_features (
         ) const
         {
             unsigned long num = 0;
             for (unsigned long iter = 0; iter < forests.size(); ++iter)
-                for (unsigned long i = 0; i < forests[iter].size(); ++i)
-                    num += forests[iter][i].num_leaves();
+                for (unsigned long i = 0; i < forests[iter].num_trees(); ++i)
+                    num += forests[iter].num_leaves(i);
             return num;
         }
 
@@ -344,23 +1000,21 @@ namespace dlib
         {
             using namespace impl;
             matrix<float,0,1> current_shape = initial_shape;
+            const point_transform_affine tform_to_img = unnormalizing_tform(rect);
+            std::vector<long> pixel_offsets;
             std::vector<float> feature_pixel_values;
+            std::vector<unsigned long> leaf_idx;
             for (unsigned long iter = 0; iter < forests.size(); ++iter)
             {
-                extract_feature_pixel_values(img, rect, current_shape, initial_shape,
-                                             anchor_idx[iter], deltas[iter], feature_pixel_values);
-                unsigned long leaf_idx;
+                find_feature_pixels(img, tform_to_img, current_shape, initial_shape,
+                                    anchor_idx[iter], deltas[iter], tform_idx, pixel_offsets);
+                read_feature_pixels(img, pixel_offsets, feature_pixel_values);
                 // evaluate all the trees at this level of the cascade.
-                for (unsigned long i = 0; i < forests[iter].size(); ++i)
-                    current_shape += forests[iter][i](feature_pixel_values, leaf_idx);
+                forests[iter].find_leaves(feature_pixel_values, leaf_idx);
+                forests[iter].add_leaves(leaf_idx, current_shape);
             }
 
-            // convert the current_shape into a full_object_detection
-            const point_transform_affine tform_to_img = unnormalizing_tform(rect);
-            std::vector<point> parts(current_shape.size()/2);
-            for (unsigned long i = 0; i < parts.size(); ++i)
-                parts[i] = tform_to_img(location(current_shape, i));
-            return full_object_detection(rect, parts);
+            return to_detection(rect, tform_to_img, current_shape);
         }
 
         template <typename image_type, typename T, typename U>
@@ -373,48 +1027,170 @@ namespace dlib
             feats.clear();
             using namespace impl;
             matrix<float,0,1> current_shape = initial_shape;
+            const point_transform_affine tform_to_img = unnormalizing_tform(rect);
+            std::vector<long> pixel_offsets;
             std::vector<float> feature_pixel_values;
+            std::vector<unsigned long> leaf_idx;
             unsigned long feat_offset = 0;
             for (unsigned long iter = 0; iter < forests.size(); ++iter)
             {
-                extract_feature_pixel_values(img, rect, current_shape, initial_shape,
-                                             anchor_idx[iter], deltas[iter], feature_pixel_values);
+                find_feature_pixels(img, tform_to_img, current_shape, initial_shape,
+                                    anchor_idx[iter], deltas[iter], tform_idx, pixel_offsets);
+                read_feature_pixels(img, pixel_offsets, feature_pixel_values);
                 // evaluate all the trees at this level of the cascade.
-                for (unsigned long i = 0; i < forests[iter].size(); ++i)
+                forests[iter].find_leaves(feature_pixel_values, leaf_idx);
+                forests[iter].add_leaves(leaf_idx, current_shape);
+                for (unsigned long i = 0; i < leaf_idx.size(); ++i)
                 {
-                    unsigned long leaf_idx;
-                    current_shape += forests[iter][i](feature_pixel_values, leaf_idx);
-
-                    feats.push_back(std::make_pair(feat_offset+leaf_idx, 1));
-                    feat_offset += forests[iter][i].num_leaves();
+                    feats.push_back(std::make_pair(feat_offset+leaf_idx[i], 1));
+                    feat_offset += forests[iter].num_leaves(i);
                 }
             }
 
-            // convert the current_shape into a full_object_detection
+            return to_detection(rect, tform_to_img, current_shape);
+        }
+
+        template <typename image_type>
+        full_object_detection operator()(
+            const image_type& img,
+            const rectangle& rect,
+            const full_object_detection& previous,
+            unsigned long num_levels
+        ) const
+        /*!
+            ensures
+                - For video: finds the parts in rect starting from previous, the
+                  detection of the same face in the frame before, instead of from the
+                  mean shape.  previous is moved along with its box onto rect, and only
+                  the last num_levels levels of the cascade are run from there.  Those
+                  levels learned to correct the small errors left by the levels before
+                  them, which is about how far the shape of a face that barely moved is
+                  off.  The more the box moved, the more levels are needed, see
+                  warm_start_levels().
+                - runs the whole cascade from the mean shape, as operator()(img,rect)
+                  does, if num_levels >= num_cascade_levels() or previous doesn't have
+                  the parts this object finds.
+        !*/
+        {
+            using namespace impl;
+            if (num_levels >= forests.size() || previous.num_parts() != num_parts())
+                return (*this)(img, rect);
+
+            // the parts of previous, relative to its box, are the start in rect
+            const point_transform_affine tform_from_img = normalizing_tform(previous.get_rect());
+            matrix<float,0,1> current_shape(initial_shape.size());
+            for (unsigned long i = 0; i < num_parts(); ++i)
+            {
+                const long slot = part_slot.size() == 0 ? (long)i : part_slot[i];
+                if (slot < 0)
+                    continue;
+                if (previous.part(i) == OBJECT_PART_NOT_PRESENT)
+                    return (*this)(img, rect);
+                const dlib::vector<float,2> p = tform_from_img(previous.part(i));
+                current_shape(slot*2) = p.x();
+                current_shape(slot*2+1) = p.y();
+            }
+
             const point_transform_affine tform_to_img = unnormalizing_tform(rect);
-            std::vector<point> parts(current_shape.size()/2);
-            for (unsigned long i = 0; i < parts.size(); ++i)
-                parts[i] = tform_to_img(location(current_shape, i));
-            return full_object_detection(rect, parts);
+            std::vector<long> pixel_offsets;
+            std::vector<float> feature_pixel_values;
+            std::vector<unsigned long> leaf_idx;
+            for (unsigned long iter = forests.size()-num_levels; iter < forests.size(); ++iter)
+            {
+                find_feature_pixels(img, tform_to_img, current_shape, initial_shape,
+                                    anchor_idx[iter], deltas[iter], tform_idx, pixel_offsets);
+                read_feature_pixels(img, pixel_offsets, feature_pixel_values);
+                forests[iter].find_leaves(feature_pixel_values, leaf_idx);
+                forests[iter].add_leaves(leaf_idx, current_shape);
+            }
+            return to_detection(rect, tform_to_img, current_shape);
+        }
+
+        unsigned long warm_start_levels (
+            const rectangle& previous_rect,
+            const rectangle& rect,
+            unsigned long min_levels,
+            double max_motion
+        ) const
+        /*!
+            ensures
+                - returns how many cascade levels to run from the shape found in
+                  previous_rect to find it in rect, for the operator() above.  The
+                  motion of the box is how far its center moved, in widths of
+                  previous_rect, plus how much it grew or shrank, as |log| of the ratio
+                  of the widths.  A box that didn't move gets min_levels, and more are
+                  run the more it moved, up to num_cascade_levels(), the whole cascade
+                  from the mean shape, once the motion reaches max_motion.
+        !*/
+        {
+            const double width = std::max<double>(previous_rect.width(), 1);
+            const double motion = length(dcenter(rect) - dcenter(previous_rect))/width +
+                std::abs(std::log(std::max<double>(rect.width(), 1)/width));
+            if (motion >= max_motion)
+                return forests.size();
+            const unsigned long levels = std::min<unsigned long>(min_levels, forests.size());
+            return levels + (unsigned long)std::ceil((forests.size()-levels)*motion/max_motion);
         }
 
         friend void serialize (const shape_predictor& item, std::ostream& out);
 
         friend void deserialize (shape_predictor& item, std::istream& in);
 
+        // see shape_predictor_mapped.h
+        friend void save_mapped_shape_predictor (const shape_predictor& item, const std::string& filename, bool float16_leaves);
+        friend void load_mapped_shape_predictor (shape_predictor& item, const std::string& filename);
+
     private:
+
+        full_object_detection to_detection (
+            const rectangle& rect,
+            const point_transform_affine& tform_to_img,
+            const matrix<float,0,1>& current_shape
+        ) const
+        {
+            // convert the current_shape into a full_object_detection
+            std::vector<point> parts(num_parts());
+            for (unsigned long i = 0; i < parts.size(); ++i)
+            {
+                if (part_slot.size() == 0)
+                    parts[i] = tform_to_img(impl::location(current_shape, i));
+                else if (part_slot[i] >= 0)
+                    parts[i] = tform_to_img(impl::location(current_shape, part_slot[i]));
+                else
+                    parts[i] = OBJECT_PART_NOT_PRESENT;
+            }
+            return full_object_detection(rect, parts);
+        }
+
         matrix<float,0,1> initial_shape;
-        std::vector<std::vector<impl::regression_tree> > forests;
+        std::vector<impl::flat_forest> forests;
         std::vector<std::vector<unsigned long> > anchor_idx; 
         std::vector<std::vector<dlib::vector<float,2> > > deltas;
+
+        // After select_parts(), the index in initial_shape of each part of the full
+        // model, or -1 if it was left out, and the parts the shape is aligned by.
+        // Both are empty for a full model.
+        std::vector<long> part_slot;
+        std::vector<unsigned long> tform_idx;
     };
 
     inline void serialize (const shape_predictor& item, std::ostream& out)
     {
+        if (item.part_slot.size() != 0)
+            throw serialization_error("A shape_predictor made by select_parts() can't be serialized.");
         int version = 1;
         dlib::serialize(version, out);
         dlib::serialize(item.initial_shape, out);
-        dlib::serialize(item.forests, out);
+        // the same bytes as a std::vector<std::vector<impl::regression_tree> >
+        const unsigned long num_levels = item.forests.size();
+        dlib::serialize(num_levels, out);
+        for (unsigned long i = 0; i < num_levels; ++i)
+        {
+            const unsigned long num_trees = item.forests[i].num_trees();
+            dlib::serialize(num_trees, out);
+            for (unsigned long j = 0; j < item.forests[i].num_trees(); ++j)
+                serialize(item.forests[i].get_tree(j), out);
+        }
         dlib::serialize(item.anchor_idx, out);
         dlib::serialize(item.deltas, out);
     }
@@ -426,9 +1202,60 @@ namespace dlib
         if (version != 1)
             throw serialization_error("Unexpected version found while deserializing dlib::shape_predictor.");
         dlib::deserialize(item.initial_shape, in);
-        dlib::deserialize(item.forests, in);
+        // Read as a std::vector<std::vector<impl::regression_tree> >, one tree at a
+        // time, so the model is never in memory twice.
+        unsigned long num_levels;
+        dlib::deserialize(num_levels, in);
+        item.forests.assign(num_levels, impl::flat_forest(item.initial_shape.size()));
+        impl::regression_tree tree;
+        for (unsigned long i = 0; i < num_levels; ++i)
+        {
+            unsigned long num_trees;
+            dlib::deserialize(num_trees, in);
+            unsigned long num_leaves = 0;
+            for (unsigned long j = 0; j < num_trees; ++j)
+            {
+                deserialize(tree, in);
+                // add_tree() only asserts these, so a malformed file must not get to it
+                if (j == 0)
+                    num_leaves = tree.num_leaves();
+                if (tree.num_leaves() != num_leaves || tree.splits.size()+1 != num_leaves ||
+                    (num_leaves & (num_leaves-1)) != 0)
+                    throw serialization_error("A tree of a dlib::shape_predictor is malformed.");
+                for (unsigned long k = 0; k < tree.leaf_values.size(); ++k)
+                {
+                    if (tree.leaf_values[k].size() != item.initial_shape.size())
+                        throw serialization_error("The leaves of a dlib::shape_predictor have the wrong size.");
+                }
+                if (j == 0)
+                    item.forests[i].reserve(num_trees, num_leaves);
+                item.forests[i].add_tree(tree);
+            }
+        }
         dlib::deserialize(item.anchor_idx, in);
         dlib::deserialize(item.deltas, in);
+        if (item.anchor_idx.size() != num_levels || item.deltas.size() != num_levels)
+            throw serialization_error("The feature pixels of a dlib::shape_predictor are malformed.");
+        for (unsigned long i = 0; i < num_levels; ++i)
+        {
+            const impl::flat_forest& forest = item.forests[i];
+            const unsigned long num_pixels = item.anchor_idx[i].size();
+            const unsigned long num_splits = forest.get_split_begin()[forest.num_trees()];
+            if (item.deltas[i].size() != num_pixels)
+                throw serialization_error("The feature pixels of a dlib::shape_predictor are malformed.");
+            for (unsigned long k = 0; k < num_splits; ++k)
+            {
+                if (forest.get_idx1()[k] >= num_pixels || forest.get_idx2()[k] >= num_pixels)
+                    throw serialization_error("A split of a dlib::shape_predictor is out of range.");
+            }
+            for (unsigned long k = 0; k < num_pixels; ++k)
+            {
+                if (item.anchor_idx[i][k] >= (unsigned long)(item.initial_shape.size()/2))
+                    throw serialization_error("A feature pixel of a dlib::shape_predictor is out of range.");
+            }
+        }
+        item.part_slot.clear();
+        item.tform_idx.clear();
     }
 // ----------------------------------------------------------------------------------------
 
@@ -0,0 +1,572 @@
+// License: Boost Software License   See LICENSE.txt for the full license.
+#ifndef DLIB_SHAPE_PREDICTOR_MAPPEd_H_
+#define DLIB_SHAPE_PREDICTOR_MAPPEd_H_
+
+#include "shape_predictor.h"
+#include "../byte_orderer.h"
+#include "../serialize.h"
+#include "../uintn.h"
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define DLIB_SHAPE_PREDICTOR_MMAP
+#endif
+
+namespace dlib
+{
+
+/*
+    The mapped shape predictor format.  Everything is little-endian and every section
+    starts at a multiple of 64 bytes from the start of the file.
+
+        header, 48 bytes:
+            char   magic[8]          "DLIBSPM\0"
+            uint32 version           1
+            uint32 flags             1 when the leaves are float16
+            uint32 num_values        the size of the initial shape, 2 per part
+            uint32 leaf_stride       num_values rounded up to a multiple of 8
+            uint32 num_levels        the levels of the cascade
+            uint32 reserved          0
+            uint64 initial_shape     offset of num_values floats
+            uint64 levels            offset of the level table
+
+        level table, 12 uint64 per level:
+            num_trees, num_splits, num_leaf_rows, num_pixels, then the offsets of
+            split_begin   uint32[num_trees+1]
+            leaf_begin    uint32[num_trees+1]
+            idx1, idx2    uint32[num_splits]
+            thresh        float[num_splits]
+            leaves        float or float16[num_leaf_rows*leaf_stride]
+            anchor_idx    uint32[num_pixels]
+            deltas        float[2*num_pixels]
+
+    The arrays of a level are the ones of impl::flat_forest, so float leaves are run
+    straight from the mapped file.
+*/
+
+// ----------------------------------------------------------------------------------------
+
+    namespace impl
+    {
+        const char mapped_shape_predictor_magic[8] = {'D','L','I','B','S','P','M','\0'};
+        const uint32 mapped_shape_predictor_version = 1;
+        const uint32 mapped_float16_leaves = 1;
+        const uint64 mapped_section_alignment = 64;
+        const unsigned long mapped_header_size = 48;
+        const unsigned long mapped_level_fields = 12;
+
+        inline uint16 float_to_half (
+            float f
+        )
+        /*!
+            ensures
+                - returns f as an IEEE half float, rounded to the nearest one, ties to
+                  even
+        !*/
+        {
+            uint32 x;
+            std::memcpy(&x, &f, sizeof(x));
+            const uint32 sign = (x >> 16) & 0x8000;
+            const uint32 bits = x & 0x7fffffff;
+            if (bits >= 0x7f800000)
+                return sign | 0x7c00 | (bits > 0x7f800000 ? 0x200 : 0);
+            // 65520 and up round to infinity
+            if (bits >= 0x477ff000)
+                return sign | 0x7c00;
+            if (bits < 0x38800000)
+            {
+                // below 2^-14 the half is subnormal, in steps of 2^-24
+                float a;
+                std::memcpy(&a, &bits, sizeof(a));
+                const float steps = a*16777216.0f;
+                uint32 n = (uint32)steps;
+                const float rest = steps - n;
+                if (rest > 0.5f || (rest == 0.5f && (n&1)))
+                    ++n;
+                return sign | n;
+            }
+            // rebias the exponent from 127 to 15 and round away the 13 low bits
+            const uint32 rounded = bits + 0xfff + ((bits >> 13) & 1);
+            return sign | ((rounded - 0x38000000) >> 13);
+        }
+
+        inline float half_to_float (
+            uint16 h
+        )
+        {
+            const uint32 sign = (uint32)(h & 0x8000) << 16;
+            const uint32 exponent = (h >> 10) & 0x1f;
+            const uint32 mantissa = h & 0x3ff;
+            uint32 x;
+            if (exponent == 0)
+            {
+                const float a = mantissa/16777216.0f;
+                std::memcpy(&x, &a, sizeof(x));
+                x |= sign;
+            }
+            else if (exponent == 31)
+            {
+                x = sign | 0x7f800000 | (mantissa << 13);
+            }
+            else
+            {
+                x = sign | ((exponent + 112) << 23) | (mantissa << 13);
+            }
+            float f;
+            std::memcpy(&f, &x, sizeof(f));
+            return f;
+        }
+
+    // ------------------------------------------------------------------------------------
+
+        class mapped_file_writer
+        {
+            /*!
+                WHAT THIS OBJECT REPRESENTS
+                    A file written in little-endian sections, each starting at a
+                    multiple of mapped_section_alignment.
+            !*/
+        public:
+
+            mapped_file_writer (
+                const std::string& filename
+            ) : out(filename.c_str(), std::ios::binary), pos(0)
+            {
+                if (!out)
+                    throw serialization_error("Unable to open " + filename + " for writing.");
+            }
+
+            uint64 position (
+            ) const { return pos; }
+
+            void align (
+            )
+            {
+                static const char zeros[mapped_section_alignment] = {};
+                const uint64 pad = (mapped_section_alignment - pos%mapped_section_alignment)%mapped_section_alignment;
+                write_bytes(zeros, pad);
+            }
+
+            template <typename T>
+            uint64 write_section (
+                const T* data,
+                unsigned long num
+            )
+            /*!
+                ensures
+                    - aligns, writes num values of data and returns where they start
+            !*/
+            {
+                align();
+                const uint64 start = pos;
+                write(data, num);
+                return start;
+            }
+
+            template <typename T>
+            void write (
+                const T* data,
+                unsigned long num
+            )
+            {
+                if (bo.host_is_little_endian())
+                {
+                    write_bytes(data, num*sizeof(T));
+                    return;
+                }
+                for (unsigned long i = 0; i < num; ++i)
+                {
+                    T temp = data[i];
+                    bo.host_to_little(temp);
+                    write_bytes(&temp, sizeof(T));
+                }
+            }
+
+            template <typename T>
+            void write (
+                const T& value
+            ) { write(&value, 1); }
+
+            void seek (
+                uint64 where
+            )
+            {
+                out.seekp(where);
+                pos = where;
+            }
+
+            void finish (
+            )
+            {
+                out.flush();
+                if (!out)
+                    throw serialization_error("Error writing a mapped shape_predictor.");
+            }
+
+        private:
+
+            void write_bytes (
+                const void* data,
+                uint64 num
+            )
+            {
+                out.write((const char*)data, num);
+                pos += num;
+            }
+
+            std::ofstream out;
+            uint64 pos;
+            byte_orderer bo;
+        };
+
+    // ------------------------------------------------------------------------------------
+
+        class mapped_shape_predictor_file
+        {
+            /*!
+                WHAT THIS OBJECT REPRESENTS
+                    A read-only view of a whole file: mapped with mmap where there is
+                    one, otherwise read into memory.  The flat_forests of a shape_predictor
+                    loaded from it keep it alive, with the float16 leaves converted to
+                    float.
+            !*/
+        public:
+
+            explicit mapped_shape_predictor_file (
+                const std::string& filename
+            ) : bytes(0), num_bytes(0)
+            {
+#ifdef DLIB_SHAPE_PREDICTOR_MMAP
+                const int fd = open(filename.c_str(), O_RDONLY);
+                if (fd < 0)
+                    throw serialization_error("Unable to open " + filename + " for reading.");
+                struct stat st;
+                if (fstat(fd, &st) != 0)
+                {
+                    close(fd);
+                    throw serialization_error("Unable to read the size of " + filename + ".");
+                }
+                num_bytes = st.st_size;
+                if (num_bytes != 0)
+                {
+                    void* ptr = mmap(0, num_bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+                    if (ptr == MAP_FAILED)
+                    {
+                        close(fd);
+                        throw serialization_error("Unable to map " + filename + ".");
+                    }
+                    bytes = (const char*)ptr;
+                }
+                close(fd);
+#else
+                std::ifstream in(filename.c_str(), std::ios::binary);
+                if (!in)
+                    throw serialization_error("Unable to open " + filename + " for reading.");
+                in.seekg(0, std::ios::end);
+                num_bytes = in.tellg();
+                in.seekg(0, std::ios::beg);
+                // uint64 keeps the sections as aligned as the floats in them need
+                buffer.resize((num_bytes+7)/8);
+                if (num_bytes != 0)
+                    in.read((char*)&buffer[0], num_bytes);
+                bytes = (const char*)&buffer[0];
+#endif
+            }
+
+            ~mapped_shape_predictor_file (
+            )
+            {
+#ifdef DLIB_SHAPE_PREDICTOR_MMAP
+                if (bytes)
+                    munmap((void*)bytes, num_bytes);
+#endif
+            }
+
+            uint64 size (
+            ) const { return num_bytes; }
+
+            template <typename T>
+            const T* section (
+                uint64 offset,
+                uint64 num
+            ) const
+            /*!
+                ensures
+                    - returns the num values of type T at offset, or throws
+                      serialization_error if they aren't all in the file
+            !*/
+            {
+                if (offset%sizeof(T) != 0 || offset > num_bytes || num > (num_bytes-offset)/sizeof(T))
+                    throw serialization_error("A section of a mapped shape_predictor is outside the file.");
+                return (const T*)(bytes + offset);
+            }
+
+            template <typename T>
+            T read (
+                uint64 offset
+            ) const
+            {
+                T value;
+                std::memcpy(&value, section<char>(offset, sizeof(T)), sizeof(T));
+                return value;
+            }
+
+            // the leaves of each level, when the file has them as float16
+            std::vector<flat_forest::leaf_vector> converted_leaves;
+
+        private:
+            mapped_shape_predictor_file(const mapped_shape_predictor_file&);
+            mapped_shape_predictor_file& operator=(const mapped_shape_predictor_file&);
+
+            const char* bytes;
+            uint64 num_bytes;
+#ifndef DLIB_SHAPE_PREDICTOR_MMAP
+            std::vector<uint64> buffer;
+#endif
+        };
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    inline void save_mapped_shape_predictor (
+        const shape_predictor& item,
+        const std::string& filename,
+        bool float16_leaves = false
+    )
+    /*!
+        requires
+            - item.num_parts() > 0
+        ensures
+            - Writes item to filename in the mapped format described at the top of this
+              file, which load_mapped_shape_predictor() reads without parsing.  With
+              float16_leaves the leaves, nearly all of the file, are stored as IEEE half
+              floats: the file is half the size, but they are converted to float when
+              loaded and the landmarks move by the rounding.  A rounded leaf can move a
+              feature pixel by one pixel and send the trees after it another way.  On
+              a model trained on examples/faces the landmarks move 0.002 pixels on
+              average and 1 pixel at most, with the same error against the labels.
+              TestMappedShapePredictor allows 0.05 on average and 2 at most.
+            - throws serialization_error if the file can't be written, or if item was
+              made by shape_predictor::select_parts().
+    !*/
+    {
+        using namespace impl;
+        if (item.part_slot.size() != 0)
+            throw serialization_error("A shape_predictor made by select_parts() can't be serialized.");
+        mapped_file_writer out(filename);
+        const uint32 num_values = item.initial_shape.size();
+        const uint32 num_levels = item.forests.size();
+        out.write(mapped_shape_predictor_magic, 8);
+        out.write(mapped_shape_predictor_version);
+        out.write(float16_leaves ? mapped_float16_leaves : (uint32)0);
+        out.write(num_values);
+        out.write((uint32)flat_forest::padded_size(num_values));
+        out.write(num_levels);
+        out.write((uint32)0);
+        const uint64 offsets_pos = out.position();
+        out.write((uint64)0);
+        out.write((uint64)0);
+
+        const uint64 initial_shape_pos = out.write_section(&item.initial_shape(0), num_values);
+        // the table is filled in once the sections are written
+        std::vector<uint64> table(num_levels*mapped_level_fields, 0);
+        const uint64 table_pos = out.write_section(table.empty() ? 0 : &table[0], table.size());
+
+        for (unsigned long l = 0; l < num_levels; ++l)
+        {
+            const flat_forest& forest = item.forests[l];
+            const unsigned long num_trees = forest.num_trees();
+            const unsigned long num_splits = forest.get_split_begin()[num_trees];
+            const unsigned long num_leaf_rows = forest.get_leaf_begin()[num_trees];
+            const unsigned long num_leaf_values = num_leaf_rows*forest.get_leaf_stride();
+            const unsigned long num_pixels = item.anchor_idx[l].size();
+            uint64* fields = &table[l*mapped_level_fields];
+            fields[0] = num_trees;
+            fields[1] = num_splits;
+            fields[2] = num_leaf_rows;
+            fields[3] = num_pixels;
+            fields[4] = out.write_section(forest.get_split_begin(), num_trees+1);
+            fields[5] = out.write_section(forest.get_leaf_begin(), num_trees+1);
+            fields[6] = out.write_section(forest.get_idx1(), num_splits);
+            fields[7] = out.write_section(forest.get_idx2(), num_splits);
+            fields[8] = out.write_section(forest.get_thresh(), num_splits);
+            if (float16_leaves)
+            {
+                std::vector<uint16> halves(num_leaf_values);
+                for (unsigned long i = 0; i < halves.size(); ++i)
+                    halves[i] = float_to_half(forest.get_leaves()[i]);
+                fields[9] = out.write_section(halves.empty() ? 0 : &halves[0], halves.size());
+            }
+            else
+            {
+                fields[9] = out.write_section(forest.get_leaves(), num_leaf_values);
+            }
+            std::vector<uint32> anchors(item.anchor_idx[l].begin(), item.anchor_idx[l].end());
+            fields[10] = out.write_section(anchors.empty() ? 0 : &anchors[0], anchors.size());
+            std::vector<float> deltas(2*num_pixels);
+            for (unsigned long i = 0; i < num_pixels; ++i)
+            {
+                deltas[2*i] = item.deltas[l][i].x();
+                deltas[2*i+1] = item.deltas[l][i].y();
+            }
+            fields[11] = out.write_section(deltas.empty() ? 0 : &deltas[0], deltas.size());
+        }
+        out.align();
+
+        out.seek(offsets_pos);
+        out.write(initial_shape_pos);
+        out.write(table_pos);
+        out.seek(table_pos);
+        out.write(table.empty() ? 0 : &table[0], table.size());
+        out.finish();
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    inline bool is_mapped_shape_predictor (
+        const std::string& filename
+    )
+    /*!
+        ensures
+            - returns true if filename starts like a file of save_mapped_shape_predictor()
+    !*/
+    {
+        std::ifstream in(filename.c_str(), std::ios::binary);
+        char magic[sizeof(impl::mapped_shape_predictor_magic)];
+        if (!in.read(magic, sizeof(magic)))
+            return false;
+        return std::memcmp(magic, impl::mapped_shape_predictor_magic, sizeof(magic)) == 0;
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    inline void load_mapped_shape_predictor (
+        shape_predictor& item,
+        const std::string& filename
+    )
+    /*!
+        ensures
+            - Loads into item a file written by save_mapped_shape_predictor().  The file
+              is mapped and the trees are run from it, only checked and not copied,
+              unless its leaves are float16.  Where there is no mmap it is read whole.
+            - throws serialization_error if the file can't be read or isn't valid.
+    !*/
+    {
+        using namespace impl;
+        if (!byte_orderer().host_is_little_endian())
+            throw serialization_error("Mapped shape_predictor files are little-endian and can't be mapped on this host.");
+
+        std::shared_ptr<mapped_shape_predictor_file> file(new mapped_shape_predictor_file(filename));
+        const mapped_shape_predictor_file& f = *file;
+        if (f.size() < mapped_header_size ||
+            std::memcmp(f.section<char>(0, 8), mapped_shape_predictor_magic, 8) != 0)
+            throw serialization_error(filename + " isn't a mapped shape_predictor.");
+        if (f.read<uint32>(8) != mapped_shape_predictor_version)
+            throw serialization_error("Unexpected version found while loading a mapped shape_predictor.");
+        const bool float16_leaves = (f.read<uint32>(12) & mapped_float16_leaves) != 0;
+        const uint32 num_values = f.read<uint32>(16);
+        const uint32 leaf_stride = f.read<uint32>(20);
+        const uint32 num_levels = f.read<uint32>(24);
+        if (leaf_stride != flat_forest::padded_size(num_values))
+            throw serialization_error("The leaves of a mapped shape_predictor have the wrong size.");
+        const float* initial_shape = f.section<float>(f.read<uint64>(32), num_values);
+        const uint64* table = f.section<uint64>(f.read<uint64>(40), (uint64)num_levels*mapped_level_fields);
+
+        shape_predictor temp;
+        temp.initial_shape.set_size(num_values);
+        std::copy(initial_shape, initial_shape + num_values, temp.initial_shape.begin());
+        temp.anchor_idx.resize(num_levels);
+        temp.deltas.resize(num_levels);
+        file->converted_leaves.resize(float16_leaves ? num_levels : 0);
+        // the arrays of each level are used where they are in the file, after
+        // checking that the trees only index into them
+        std::vector<const uint32*> split_begin(num_levels), leaf_begin(num_levels), idx1(num_levels), idx2(num_levels);
+        std::vector<const float*> thresh(num_levels), leaves(num_levels);
+        for (unsigned long l = 0; l < num_levels; ++l)
+        {
+            const uint64* fields = table + l*mapped_level_fields;
+            const uint64 num_trees = fields[0];
+            const uint64 num_splits = fields[1];
+            const uint64 num_leaf_rows = fields[2];
+            const uint64 num_pixels = fields[3];
+            // Each count must fit in the file before any size is worked out from it,
+            // so none of the sizes below can overflow.
+            const uint64 file_words = f.size()/sizeof(uint32);
+            const uint64 leaf_bytes = float16_leaves ? sizeof(uint16) : sizeof(float);
+            if (num_trees >= file_words || num_splits > file_words || num_pixels > file_words/2 ||
+                (leaf_stride != 0 && num_leaf_rows > f.size()/leaf_bytes/leaf_stride))
+                throw serialization_error("A level of a mapped shape_predictor is bigger than the file.");
+            split_begin[l] = f.section<uint32>(fields[4], num_trees+1);
+            leaf_begin[l] = f.section<uint32>(fields[5], num_trees+1);
+            idx1[l] = f.section<uint32>(fields[6], num_splits);
+            idx2[l] = f.section<uint32>(fields[7], num_splits);
+            thresh[l] = f.section<float>(fields[8], num_splits);
+            for (uint64 t = 0; t < num_trees; ++t)
+            {
+                const uint64 splits = split_begin[l][t+1] - (uint64)split_begin[l][t];
+                if (split_begin[l][t+1] < split_begin[l][t] || leaf_begin[l][t+1] < leaf_begin[l][t] ||
+                    leaf_begin[l][t+1] - (uint64)leaf_begin[l][t] != splits+1)
+                    throw serialization_error("A tree of a mapped shape_predictor is malformed.");
+            }
+            if (split_begin[l][0] != 0 || split_begin[l][num_trees] != num_splits ||
+                leaf_begin[l][0] != 0 || leaf_begin[l][num_trees] != num_leaf_rows)
+                throw serialization_error("A tree of a mapped shape_predictor is malformed.");
+            for (uint64 i = 0; i < num_splits; ++i)
+            {
+                if (idx1[l][i] >= num_pixels || idx2[l][i] >= num_pixels)
+                    throw serialization_error("A split of a mapped shape_predictor is out of range.");
+            }
+
+            const uint64 num_leaf_values = num_leaf_rows*leaf_stride;
+            if (float16_leaves)
+            {
+                const uint16* halves = f.section<uint16>(fields[9], num_leaf_values);
+                flat_forest::leaf_vector& converted = file->converted_leaves[l];
+                converted.resize(num_leaf_values);
+                for (uint64 i = 0; i < num_leaf_values; ++i)
+                    converted[i] = half_to_float(halves[i]);
+                leaves[l] = converted.data();
+            }
+            else
+            {
+                leaves[l] = f.section<float>(fields[9], num_leaf_values);
+            }
+
+            const uint32* anchors = f.section<uint32>(fields[10], num_pixels);
+            const float* deltas = f.section<float>(fields[11], 2*num_pixels);
+            temp.anchor_idx[l].assign(anchors, anchors + num_pixels);
+            temp.deltas[l].resize(num_pixels);
+            for (uint64 i = 0; i < num_pixels; ++i)
+            {
+                if (anchors[i] >= num_values/2)
+                    throw serialization_error("A feature pixel of a mapped shape_predictor is out of range.");
+                temp.deltas[l][i] = dlib::vector<float,2>(deltas[2*i], deltas[2*i+1]);
+            }
+        }
+
+        // the file lives as long as the forests that point into it
+        const std::shared_ptr<const void> storage(file);
+        temp.forests.reserve(num_levels);
+        for (unsigned long l = 0; l < num_levels; ++l)
+        {
+            const uint64* fields = table + l*mapped_level_fields;
+            temp.forests.push_back(flat_forest(num_values, fields[0], split_begin[l], leaf_begin[l],
+                                               idx1[l], idx2[l], thresh[l], leaves[l], storage));
+        }
+        item = temp;
+    }
+
+// ----------------------------------------------------------------------------------------
+
+}
+
+#endif // DLIB_SHAPE_PREDICTOR_MAPPEd_H_
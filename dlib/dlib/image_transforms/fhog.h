@@ -19,6 +19,39 @@
 namespace dlib
 {
 
+// ----------------------------------------------------------------------------------------
+
+    struct fhog_scratch
+    {
+        /*!
+            WHAT THIS OBJECT REPRESENTS
+                The gradient histograms and norms extract_fhog_feature_rows() fills
+                before it writes the features.  Handing the same fhog_scratch to each
+                call, from one thread at a time, keeps them from being allocated again
+                every time.
+        !*/
+
+        fhog_scratch() { hist.set_grow_only(true); norm.set_grow_only(true); }
+
+        void reserve (
+            long img_nc,
+            long num_rows,
+            int cell_size
+        )
+        {
+            // the sizes impl_extract_fhog_rows() gives them
+            const long cells_nc = (long)((float)img_nc/(float)cell_size + 0.5);
+            hist.set_size(num_rows+4, cells_nc+2);
+            norm.set_size(num_rows+2, cells_nc);
+        }
+
+        unsigned long capacity_bytes (
+        ) const { return hist.capacity()*sizeof(matrix<float,18,1>) + norm.capacity()*sizeof(float); }
+
+        array2d<matrix<float,18,1> > hist;
+        array2d<float> norm;
+    };
+
 // ----------------------------------------------------------------------------------------
 
     namespace impl_fhog
@@ -702,7 +735,7 @@ namespace dlib
             typename image_type, 
             typename out_type
             >
-        void impl_extract_fhog_features(
+        int impl_init_fhog_features(
             const image_type& img_, 
             out_type& hog, 
             int cell_size,
@@ -711,59 +744,44 @@ namespace dlib
         ) 
         {
             const_image_view<image_type> img(img_);
-            // make sure requires clause is not broken
-            DLIB_ASSERT( cell_size > 0 &&
-                         filter_rows_padding > 0 &&
-                         filter_cols_padding > 0 ,
-                "\t void extract_fhog_features()"
-                << "\n\t Invalid inputs were given to this function. "
-                << "\n\t cell_size: " << cell_size 
-                << "\n\t filter_rows_padding: " << filter_rows_padding 
-                << "\n\t filter_cols_padding: " << filter_cols_padding 
-                );
-
-            /*
-                This function implements the HOG feature extraction method described in 
-                the paper:
-                    P. Felzenszwalb, R. Girshick, D. McAllester, D. Ramanan
-                    Object Detection with Discriminatively Trained Part Based Models
-                    IEEE Transactions on Pattern Analysis and Machine Intelligence, Vol. 32, No. 9, Sep. 2010
-
-                Moreover, this function is derived from the HOG feature extraction code
-                from the features.cc file in the voc-releaseX code (see
-                http://people.cs.uchicago.edu/~rbg/latent/) which is has the following
-                license (note that the code has been modified to work with grayscale and
-                color as well as planar and interlaced input and output formats):
-
-                Copyright (C) 2011, 2012 Ross Girshick, Pedro Felzenszwalb
-                Copyright (C) 2008, 2009, 2010 Pedro Felzenszwalb, Ross Girshick
-                Copyright (C) 2007 Pedro Felzenszwalb, Deva Ramanan
+            const int cells_nr = (int)((float)img.nr()/(float)cell_size + 0.5);
+            const int cells_nc = (int)((float)img.nc()/(float)cell_size + 0.5);
 
-                Permission is hereby granted, free of charge, to any person obtaining
-                a copy of this software and associated documentation files (the
-                "Software"), to deal in the Software without restriction, including
-                without limitation the rights to use, copy, modify, merge, publish,
-                distribute, sublicense, and/or sell copies of the Software, and to
-                permit persons to whom the Software is furnished to do so, subject to
-                the following conditions:
+            // memory for HOG features
+            const int hog_nr = std::max(cells_nr-2, 0);
+            const int hog_nc = std::max(cells_nc-2, 0);
+            if (hog_nr == 0 || hog_nc == 0)
+            {
+                hog.clear();
+                return 0;
+            }
+            init_hog(hog, hog_nr, hog_nc, filter_rows_padding, filter_cols_padding);
+            return hog_nr;
+        }
 
-                The above copyright notice and this permission notice shall be
-                included in all copies or substantial portions of the Software.
+    // ------------------------------------------------------------------------------------
 
-                THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
-                EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
-                MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
-                NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
-                LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
-                OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
-                WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+        template <
+            typename image_type, 
+            typename out_type
+            >
+        void impl_extract_fhog_rows(
+            const image_type& img_, 
+            out_type& hog, 
+            int cell_size,
+            int filter_rows_padding,
+            int filter_cols_padding,
+            int first_row,
+            int last_row,
+            fhog_scratch* scratch = 0
+        ) 
+        {
+            /*
+                Fills feature rows [first_row, last_row) of a hog sized by
+                impl_init_fhog_features().  Calls for disjoint row ranges only write their
+                own rows, so they can run at the same time, each with its own scratch.
             */
-
-            if (cell_size == 1)
-            {
-                impl_extract_fhog_features_cell_size_1(img_,hog,filter_rows_padding,filter_cols_padding);
-                return;
-            }
+            const_image_view<image_type> img(img_);
 
             // unit vectors used to compute gradient orientation
             matrix<float,2,1> directions[9];
@@ -779,21 +797,27 @@ namespace dlib
 
 
 
-            // First we allocate memory for caching orientation histograms & their norms.
             const int cells_nr = (int)((float)img.nr()/(float)cell_size + 0.5);
             const int cells_nc = (int)((float)img.nc()/(float)cell_size + 0.5);
+            const int hog_nc = cells_nc-2;
+            const int padding_rows_offset = (filter_rows_padding-1)/2;
+            const int padding_cols_offset = (filter_cols_padding-1)/2;
 
-            if (cells_nr == 0 || cells_nc == 0)
-            {
-                hog.clear();
-                return;
-            }
+            // Feature row y is normalized over cell rows y to y+2, so the band needs
+            // the histograms of cell rows first_row to last_row+1.  Each pixel row votes
+            // into two cell rows, and the ones that don't vote into the band are skipped.
+            // So every cell of the band gets the same votes, in the same order, as when
+            // the whole image is done at once.
+            const int band_nr = last_row - first_row + 2;
 
             // We give hist extra padding around the edges (1 cell all the way around the
             // edge) so we can avoid needing to do boundary checks when indexing into it
             // later on.  So some statements assign to the boundary but those values are
             // never used.
-            array2d<matrix<float,18,1> > hist(cells_nr+2, cells_nc+2);
+            fhog_scratch local_scratch;
+            fhog_scratch& buf = scratch ? *scratch : local_scratch;
+            array2d<matrix<float,18,1> >& hist = buf.hist;
+            hist.set_size(band_nr+2, cells_nc+2);
             for (long r = 0; r < hist.nr(); ++r)
             {
                 for (long c = 0; c < hist.nc(); ++c)
@@ -802,30 +826,24 @@ namespace dlib
                 }
             }
 
-            array2d<float> norm(cells_nr, cells_nc);
+            array2d<float>& norm = buf.norm;
+            norm.set_size(band_nr, cells_nc);
             assign_all_pixels(norm, 0);
-			
 
-            // memory for HOG features
-            const int hog_nr = std::max(cells_nr-2, 0);
-            const int hog_nc = std::max(cells_nc-2, 0);
-            if (hog_nr == 0 || hog_nc == 0)
-            {
-                hog.clear();
-                return;
-            }
-            const int padding_rows_offset = (filter_rows_padding-1)/2;
-            const int padding_cols_offset = (filter_cols_padding-1)/2;
-            init_hog(hog, hog_nr, hog_nc, filter_rows_padding, filter_cols_padding);
-			
             const int visible_nr = std::min((long)cells_nr*cell_size,img.nr())-1;
             const int visible_nc = std::min((long)cells_nc*cell_size,img.nc())-1;
             // First populate the gradient histograms
-            for (int y = 1; y < visible_nr; y++) 
+            const int first_y = std::max(1, (first_row-1)*cell_size);
+            const int last_y = std::min(visible_nr, (first_row+band_nr+1)*cell_size);
+            for (int y = first_y; y < last_y; y++) 
             {
                 const float yp = ((float)y+0.5)/(float)cell_size - 0.5;
-                const int iyp = (int)std::floor(yp);
-                const float vy0 = yp - iyp;
+                const int cell_y = (int)std::floor(yp);
+                // the cell row above this pixel, counted from the top of the band
+                const int iyp = cell_y - first_row;
+                if (iyp < -1 || iyp >= band_nr)
+                    continue;
+                const float vy0 = yp - cell_y;
                 const float vy1 = 1.0 - vy0;
                 int x;
                 for (x = 1; x < visible_nc - 7; x += 8)
@@ -958,7 +976,7 @@ namespace dlib
                 }
             }
             // compute energy in each block by summing over orientations
-            for (int r = 0; r < cells_nr; ++r)
+            for (int r = 0; r < band_nr; ++r)
             {
                 for (int c = 0; c < cells_nc; ++c)
                 {
@@ -971,9 +989,10 @@ namespace dlib
 
             const float eps = 0.0001;
             // compute features
-            for (int y = 0; y < hog_nr; y++) 
+            for (int row = first_row; row < last_row; row++) 
             {
-                const int yy = y+padding_rows_offset; 
+                const int y = row-first_row;
+                const int yy = row+padding_rows_offset; 
                 for (int x = 0; x < hog_nc; x++) 
                 {
                     const simd4f z1(norm[y+1][x+1],
@@ -1047,6 +1066,79 @@ namespace dlib
             }
         }
 
+    // ------------------------------------------------------------------------------------
+
+        template <
+            typename image_type, 
+            typename out_type
+            >
+        void impl_extract_fhog_features(
+            const image_type& img_, 
+            out_type& hog, 
+            int cell_size,
+            int filter_rows_padding,
+            int filter_cols_padding
+        ) 
+        {
+            // make sure requires clause is not broken
+            DLIB_ASSERT( cell_size > 0 &&
+                         filter_rows_padding > 0 &&
+                         filter_cols_padding > 0 ,
+                "\t void extract_fhog_features()"
+                << "\n\t Invalid inputs were given to this function. "
+                << "\n\t cell_size: " << cell_size 
+                << "\n\t filter_rows_padding: " << filter_rows_padding 
+                << "\n\t filter_cols_padding: " << filter_cols_padding 
+                );
+
+            /*
+                This function implements the HOG feature extraction method described in 
+                the paper:
+                    P. Felzenszwalb, R. Girshick, D. McAllester, D. Ramanan
+                    Object Detection with Discriminatively Trained Part Based Models
+                    IEEE Transactions on Pattern Analysis and Machine Intelligence, Vol. 32, No. 9, Sep. 2010
+
+                Moreover, this function is derived from the HOG feature extraction code
+                from the features.cc file in the voc-releaseX code (see
+                http://people.cs.uchicago.edu/~rbg/latent/) which is has the following
+                license (note that the code has been modified to work with grayscale and
+                color as well as planar and interlaced input and output formats):
+
+                Copyright (C) 2011, 2012 Ross Girshick, Pedro Felzenszwalb
+                Copyright (C) 2008, 2009, 2010 Pedro Felzenszwalb, Ross Girshick
+                Copyright (C) 2007 Pedro Felzenszwalb, Deva Ramanan
+
+                Permission is hereby granted, free of charge, to any person obtaining
+                a copy of this software and associated documentation files (the
+                "Software"), to deal in the Software without restriction, including
+                without limitation the rights to use, copy, modify, merge, publish,
+                distribute, sublicense, and/or sell copies of the Software, and to
+                permit persons to whom the Software is furnished to do so, subject to
+                the following conditions:
+
+                The above copyright notice and this permission notice shall be
+                included in all copies or substantial portions of the Software.
+
+                THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+                EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+                MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+                NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+                LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+                OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+                WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+            */
+
+            if (cell_size == 1)
+            {
+                impl_extract_fhog_features_cell_size_1(img_,hog,filter_rows_padding,filter_cols_padding);
+                return;
+            }
+
+            const int hog_nr = impl_init_fhog_features(img_, hog, cell_size, filter_rows_padding, filter_cols_padding);
+            if (hog_nr > 0)
+                impl_extract_fhog_rows(img_, hog, cell_size, filter_rows_padding, filter_cols_padding, 0, hog_nr);
+        }
+
     // ------------------------------------------------------------------------------------
 
         inline void create_fhog_bar_images (
@@ -1114,6 +1206,75 @@ namespace dlib
         impl_fhog::impl_extract_fhog_features(img, hog, cell_size, filter_rows_padding, filter_cols_padding);
     }
 
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename image_type, 
+        typename T, 
+        typename mm1, 
+        typename mm2
+        >
+    int init_fhog_features(
+        const image_type& img, 
+        dlib::array<array2d<T,mm1>,mm2>& hog, 
+        int cell_size = 8,
+        int filter_rows_padding = 1,
+        int filter_cols_padding = 1
+    ) 
+    {
+        // make sure requires clause is not broken
+        DLIB_ASSERT( cell_size > 1 &&
+                     filter_rows_padding > 0 &&
+                     filter_cols_padding > 0 ,
+            "\t int init_fhog_features()"
+            << "\n\t Invalid inputs were given to this function. "
+            << "\n\t cell_size: " << cell_size 
+            << "\n\t filter_rows_padding: " << filter_rows_padding 
+            << "\n\t filter_cols_padding: " << filter_cols_padding 
+            );
+
+        const int rows = impl_fhog::impl_init_fhog_features(img, hog, cell_size, filter_rows_padding, filter_cols_padding);
+        if (hog.size() == 0)
+            hog.resize(31);
+        return rows;
+    }
+
+    template <
+        typename image_type, 
+        typename T, 
+        typename mm1, 
+        typename mm2
+        >
+    void extract_fhog_feature_rows(
+        const image_type& img, 
+        dlib::array<array2d<T,mm1>,mm2>& hog, 
+        int first_row,
+        int last_row,
+        int cell_size = 8,
+        int filter_rows_padding = 1,
+        int filter_cols_padding = 1,
+        fhog_scratch* scratch = 0
+    ) 
+    {
+        // make sure requires clause is not broken
+        DLIB_ASSERT( cell_size > 1 &&
+                     filter_rows_padding > 0 &&
+                     filter_cols_padding > 0 &&
+                     0 <= first_row && first_row <= last_row &&
+                     hog.size() == 31 &&
+                     last_row <= hog[0].nr() - filter_rows_padding + 1,
+            "\t void extract_fhog_feature_rows()"
+            << "\n\t Invalid inputs were given to this function. "
+            << "\n\t cell_size: " << cell_size 
+            << "\n\t first_row: " << first_row 
+            << "\n\t last_row:  " << last_row 
+            << "\n\t hog.size(): " << hog.size() 
+            );
+
+        if (first_row < last_row)
+            impl_fhog::impl_extract_fhog_rows(img, hog, cell_size, filter_rows_padding, filter_cols_padding, first_row, last_row, scratch);
+    }
+
 // ----------------------------------------------------------------------------------------
 
     template <
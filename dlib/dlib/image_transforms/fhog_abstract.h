@@ -110,6 +110,105 @@ namespace dlib
                 - #hog[i].nc() == hog[0].nc()
     !*/
 
+// ----------------------------------------------------------------------------------------
+
+    struct fhog_scratch
+    {
+        /*!
+            WHAT THIS OBJECT REPRESENTS
+                The gradient histograms and norms extract_fhog_feature_rows() fills
+                before it writes the features.  Its buffers are grow-only (see
+                array2d::set_grow_only()), so handing the same fhog_scratch to each call,
+                from one thread at a time, keeps them from being allocated again every
+                time.
+        !*/
+
+        void reserve (
+            long img_nc,
+            long num_rows,
+            int cell_size
+        );
+        /*!
+            ensures
+                - makes the buffers big enough that extract_fhog_feature_rows() of up to
+                  num_rows rows of an image up to img_nc columns wide doesn't allocate
+        !*/
+
+        unsigned long capacity_bytes (
+        ) const;
+        /*!
+            ensures
+                - returns the memory the buffers hold
+        !*/
+    };
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename image_type,
+        typename T, 
+        typename mm1, 
+        typename mm2
+        >
+    int init_fhog_features(
+        const image_type& img, 
+        dlib::array<array2d<T,mm1>,mm2>& hog, 
+        int cell_size = 8,
+        int filter_rows_padding = 1,
+        int filter_cols_padding = 1
+    );
+    /*!
+        requires
+            - cell_size > 1
+            - filter_rows_padding > 0
+            - filter_cols_padding > 0
+            - image_type == an image object that implements the interface defined in
+              dlib/image_processing/generic_image.h 
+            - T should be float or double
+        ensures
+            - Sizes #hog the way the planar extract_fhog_features() would for img, and
+              zeros its padding, but doesn't compute any features.  Fill it in with
+              extract_fhog_feature_rows().
+            - #hog.size() == 31
+            - returns the number of feature rows to fill in.  This is
+              #hog[0].nr()-filter_rows_padding+1, or 0 when img is too small to give
+              any features.
+    !*/
+
+    template <
+        typename image_type,
+        typename T, 
+        typename mm1, 
+        typename mm2
+        >
+    void extract_fhog_feature_rows(
+        const image_type& img, 
+        dlib::array<array2d<T,mm1>,mm2>& hog, 
+        int first_row,
+        int last_row,
+        int cell_size = 8,
+        int filter_rows_padding = 1,
+        int filter_cols_padding = 1,
+        fhog_scratch* scratch = 0
+    );
+    /*!
+        requires
+            - hog was sized by init_fhog_features(img,hog,cell_size,filter_rows_padding,filter_cols_padding)
+            - no other call uses *scratch at the same time
+            - 0 <= first_row <= last_row <= the number of rows init_fhog_features() returned
+        ensures
+            - Computes the features of rows first_row to last_row-1, not counting the
+              padding, and leaves the other rows of hog untouched.  Only the image rows
+              those features depend on are read.
+            - Filling every row this way, in any number of pieces, gives results
+              bit-identical to the planar extract_fhog_features().
+            - Calls for rows that don't overlap may run at the same time on the same
+              hog.
+            - If scratch != 0 the gradient histograms are built in it, and it only
+              allocates when the rows are wider or more than it has seen before.
+              Otherwise they are allocated for this call.
+    !*/
+
 // ----------------------------------------------------------------------------------------
 
     template <
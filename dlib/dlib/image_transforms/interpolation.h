@@ -10,7 +10,7 @@
 #include "image_pyramid.h"
 #include "../simd.h"
 #include "../image_processing/full_object_detection.h"
-#include <pthread.h>
+#include "../threads/pool_tasks.h"
 
 namespace dlib
 {
@@ -474,8 +474,6 @@ namespace dlib
 
         const_image_view<image_type1> imgv(in_img);
         image_view<image_type2> out_imgv(out_img);
-		std::cout << " area.top() = " << area.top() << " area.bottom() = " << area.bottom() << std::endl;
-		std::cout << " area.left() = " << area.left() << " area.right() = " << area.right() << std::endl;
         for (long r = area.top(); r <= area.bottom(); ++r)
         {
             for (long c = area.left(); c <= area.right(); ++c)
@@ -648,7 +646,6 @@ namespace dlib
 
         const double x_scale = (num_columns(in_img)-1)/(double)std::max<long>((num_columns(out_img)-1),1);
         const double y_scale = (num_rows(in_img)-1)/(double)std::max<long>((num_rows(out_img)-1),1);
-		std::cout << __FUNCTION__ << std::endl;
         transform_image(in_img, out_img, interp, 
                         dlib::impl::helper_resize_image(x_scale,y_scale));
     }
@@ -752,29 +749,31 @@ namespace dlib
 
 // ----------------------------------------------------------------------------------------
 	template <
-		typename image_type
+		typename image_type,
+		typename out_image_type = image_type
 		>
 	struct param_for_resize_image
 	{
 		param_for_resize_image(){}
 	
 		const image_type* in_img_;
-		image_type* out_img_;
+		out_image_type* out_img_;
 		long sr;
 		long er;
 	};
 
     template <
-        typename image_type
+        typename image_type,
+        typename out_image_type
         >
     typename enable_if<is_grayscale_image<image_type>, void * >::type do_resize_image (
 		void* ptr
     )
     {
-		param_for_resize_image<image_type>* p = (param_for_resize_image<image_type>*)ptr;
+		param_for_resize_image<image_type,out_image_type>* p = (param_for_resize_image<image_type,out_image_type>*)ptr;
 
 		const_image_view<image_type> in_img((*p->in_img_));
-        image_view<image_type> out_img((*p->out_img_));
+        image_view<out_image_type> out_img((*p->out_img_));
 
         if (out_img.nr() <= 1 || out_img.nc() <= 1)
         {
@@ -782,7 +781,7 @@ namespace dlib
             return NULL;
         }
 
-        typedef typename image_traits<image_type>::pixel_type T;
+        typedef typename image_traits<out_image_type>::pixel_type T;
         const double x_scale = (in_img.nc()-1)/(double)std::max<long>((out_img.nc()-1),1);
         const double y_scale = (in_img.nr()-1)/(double)std::max<long>((out_img.nr()-1),1);
         double y = y_scale * (p->sr - 1);
@@ -864,12 +863,14 @@ namespace dlib
     }
 
     template <
-        typename image_type
+        typename image_type,
+        typename out_image_type
         >
-    typename enable_if<is_grayscale_image<image_type> >::type resize_image (
+    typename enable_if_c<is_grayscale_image<image_type>::value && is_grayscale_image<out_image_type>::value>::type resize_image (
         const image_type& in_img_,
-        image_type& out_img_,
-        interpolate_bilinear
+        out_image_type& out_img_,
+        interpolate_bilinear,
+        thread_pool* pool
     )
     {
 		//long long t0 = currentTimeInMilliseconds();
@@ -880,36 +881,27 @@ namespace dlib
             << "\n\t is_same_object(in_img_, out_img_):  " << is_same_object(in_img_, out_img_)
             );
 #if 1
-		const int num_of_threads = 3;
-		param_for_resize_image<image_type> param[num_of_threads];
-		pthread_t do_resize_image_thread[num_of_threads];
+		// The rows are always cut into the same bands, whatever the size of the pool,
+		// so the output doesn't depend on how many threads run the bands.
+		const int num_of_bands = 3;
+		param_for_resize_image<image_type,out_image_type> param[num_of_bands];
 
-		for(int i=0;i<num_of_threads;i++)
+		for(int i=0;i<num_of_bands;i++)
 		{
 			param[i].in_img_ = &in_img_;
 			param[i].out_img_ = &out_img_;
-			param[i].sr = (out_img_.nr() / num_of_threads) * i;
-			param[i].er = param[i].sr + (out_img_.nr() / num_of_threads) - 1;
-			if(i == num_of_threads - 1)
+			param[i].sr = (out_img_.nr() / num_of_bands) * i;
+			param[i].er = param[i].sr + (out_img_.nr() / num_of_bands) - 1;
+			if(i == num_of_bands - 1)
 				param[i].er = out_img_.nr()  - 1;
 		}
-		//do_resize_image<image_type>(&param[0]);
-#if 1		
-		for(int i=0;i<num_of_threads;i++)
-		{
-			pthread_create(&do_resize_image_thread[i], NULL, &do_resize_image<image_type>, (void*)&param[i]);
-		}
-		for(int i=0;i<num_of_threads;i++)
-		{	
-			pthread_join(do_resize_image_thread[i], NULL);
-		}
-#endif
+		run_tasks_on_pool(pool, num_of_bands, [&param](long i) { do_resize_image<image_type,out_image_type>(&param[i]); });
 		//long long t1 = currentTimeInMilliseconds();
 		//std::cout << "total rows = " << out_img_.nr() << " takes " << t1-t0 << " ms" << std::endl;
 #else
 
         const_image_view<image_type> in_img(in_img_);
-        image_view<image_type> out_img(out_img_);
+        image_view<out_image_type> out_img(out_img_);
 
         if (out_img.nr() <= 1 || out_img.nc() <= 1)
         {
@@ -918,7 +910,7 @@ namespace dlib
         }
 
 	
-        typedef typename image_traits<image_type>::pixel_type T;
+        typedef typename image_traits<out_image_type>::pixel_type T;
         const double x_scale = (in_img.nc()-1)/(double)std::max<long>((out_img.nc()-1),1);
         const double y_scale = (in_img.nr()-1)/(double)std::max<long>((out_img.nr()-1),1);
         double y = -y_scale;
@@ -994,14 +986,28 @@ namespace dlib
 #endif		
     }
 
+    template <
+        typename image_type,
+        typename out_image_type
+        >
+    typename enable_if_c<is_grayscale_image<image_type>::value && is_grayscale_image<out_image_type>::value>::type resize_image (
+        const image_type& in_img_,
+        out_image_type& out_img_,
+        interpolate_bilinear
+    )
+    {
+        resize_image(in_img_, out_img_, interpolate_bilinear(), 0);
+    }
+
 // ----------------------------------------------------------------------------------------
 
     template <
-        typename image_type
+        typename image_type,
+        typename out_image_type
         >
-    typename enable_if<is_rgb_image<image_type> >::type resize_image (
+    typename enable_if_c<is_rgb_image<image_type>::value && is_rgb_image<out_image_type>::value>::type resize_image (
         const image_type& in_img_,
-        image_type& out_img_,
+        out_image_type& out_img_,
         interpolate_bilinear
     )
     {
@@ -1013,7 +1019,7 @@ namespace dlib
             );
 
         const_image_view<image_type> in_img(in_img_);
-        image_view<image_type> out_img(out_img_);
+        image_view<out_image_type> out_img(out_img_);
 
         if (out_img.nr() <= 1 || out_img.nc() <= 1)
         {
@@ -1120,6 +1126,23 @@ namespace dlib
         }
     }
 
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename image_type,
+        typename out_image_type
+        >
+    typename disable_if_c<is_grayscale_image<image_type>::value && is_grayscale_image<out_image_type>::value>::type resize_image (
+        const image_type& in_img_,
+        out_image_type& out_img_,
+        interpolate_bilinear,
+        thread_pool* 
+    )
+    {
+        // Only the grayscale path is banded, everything else runs on the calling thread.
+        resize_image(in_img_, out_img_, interpolate_bilinear());
+    }
+
 // ----------------------------------------------------------------------------------------
 
     template <
@@ -0,0 +1,53 @@
+// License: Boost Software License   See LICENSE.txt for the full license.
+#ifndef DLIB_POOL_TASKs_Hh_
+#define DLIB_POOL_TASKs_Hh_
+
+#include "thread_pool_extension.h"
+#include "parallel_for_extension.h"
+
+namespace dlib
+{
+
+// ----------------------------------------------------------------------------------------
+
+    template <typename T>
+    void run_tasks_on_pool (
+        thread_pool* pool,
+        long num_tasks,
+        const T& funct
+    )
+    /*!
+        requires
+            - num_tasks >= 0
+            - funct(long) is a valid expression
+        ensures
+            - Calls funct(i) for all i in the range [0, num_tasks).  Every index is
+              submitted to the pool as its own task so big and small pieces of work
+              balance across the workers, and this function returns once they are all
+              done.
+            - If pool == 0 or the pool has no threads then the calls are made in order on
+              the calling thread.  The split of the work into tasks is decided by the
+              caller, not by the pool, so both ways give bit-identical results.
+            - Like parallel_for(), this function waits with wait_for_all_tasks(), which
+              only waits on the tasks submitted by the calling thread.  Tasks other
+              threads put on the same pool are not waited on, so this is no barrier.
+    !*/
+    {
+        if (pool == 0 || pool->num_threads_in_pool() == 0)
+        {
+            for (long i = 0; i < num_tasks; ++i)
+                funct(i);
+            return;
+        }
+
+        impl::helper_parallel_for_funct<T> helper(funct);
+        for (long i = 0; i < num_tasks; ++i)
+            pool->add_task(helper, &impl::helper_parallel_for_funct<T>::run, i);
+        pool->wait_for_all_tasks();
+    }
+
+// ----------------------------------------------------------------------------------------
+
+}
+
+#endif // DLIB_POOL_TASKs_Hh_
@@ -11,7 +11,9 @@ LOCAL_SRC_FILES += \
                 ../$(LOCAL_PATH)/../dlib/dlib/entropy_decoder/entropy_decoder_kernel_2.cpp \
                 ../$(LOCAL_PATH)/../dlib/dlib/base64/base64_kernel_1.cpp \
                 ../$(LOCAL_PATH)/../dlib/dlib/threads/threads_kernel_1.cpp \
-                ../$(LOCAL_PATH)/../dlib/dlib/threads/threads_kernel_2.cpp
+                ../$(LOCAL_PATH)/../dlib/dlib/threads/threads_kernel_2.cpp \
+                ../$(LOCAL_PATH)/../dlib/dlib/threads/multithreaded_object_extension.cpp \
+                ../$(LOCAL_PATH)/../dlib/dlib/threads/thread_pool_extension.cpp
 
 LOCAL_EXPORT_C_INCLUDES := $(LOCAL_C_INCLUDES)
 include $(BUILD_STATIC_LIBRARY)
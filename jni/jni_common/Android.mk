@@ -26,6 +26,14 @@ all_cpp_files_recursively = \
 
 LOCAL_SRC_FILES  := $(call all_cpp_files_recursively, $(LOCAL_PATH))
 
+# The SIMD converters use the same NEON build as android_dlib
+ifeq ($(TARGET_ARCH_ABI), armeabi-v7a)
+LOCAL_ARM_NEON := true
+endif
+
+# dlib's thread_pool for the banded converters
+LOCAL_STATIC_LIBRARIES += dlib
+
 ifeq ($(MINIGLOG_LIB_TYPE),SHARED)
     LOCAL_SHARED_LIBRARIES += miniglog
 else
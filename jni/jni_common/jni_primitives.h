@@ -121,6 +121,12 @@ public:
   {
     jclass detRetClass = env->FindClass(CLASSNAME_VISION_DET_RET);
     CHECK_NOTNULL(detRetClass);
+    // Keep the class and its constructor so making a result per face doesn't
+    // look them up again
+    jClass_detRet =
+        reinterpret_cast<jclass>(env->NewGlobalRef(detRetClass));
+    jMethodID_init =
+        env->GetMethodID(detRetClass, "<init>", CONSTSIG_VISION_DET_RET);
     jID_label = env->GetFieldID(detRetClass, "mLabel", "Ljava/lang/String;");
     jID_confidence = env->GetFieldID(detRetClass, "mConfidence", "F");
     jID_left = env->GetFieldID(detRetClass, "mLeft", "I");
@@ -181,21 +187,19 @@ public:
     env->CallBooleanMethod(jDetRet, jMethodID_addLandmark, x, y);
   }
 
-  static jobject createJObject(JNIEnv *env)
+  jobject createJObject(JNIEnv *env)
   {
-    jclass detRetClass = env->FindClass(CLASSNAME_VISION_DET_RET);
-    jmethodID mid =
-        env->GetMethodID(detRetClass, "<init>", CONSTSIG_VISION_DET_RET);
-    return env->NewObject(detRetClass, mid);
+    return env->NewObject(jClass_detRet, jMethodID_init);
   }
 
-  static jobjectArray createJObjectArray(JNIEnv *env, const int &size)
+  jobjectArray createJObjectArray(JNIEnv *env, const int &size)
   {
-    jclass detRetClass = env->FindClass(CLASSNAME_VISION_DET_RET);
-    return (jobjectArray)env->NewObjectArray(size, detRetClass, NULL);
+    return (jobjectArray)env->NewObjectArray(size, jClass_detRet, NULL);
   }
 
 private:
+  jclass jClass_detRet;
+  jmethodID jMethodID_init;
   jfieldID jID_label;
   jfieldID jID_confidence;
   jfieldID jID_left;
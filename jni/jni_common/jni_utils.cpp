@@ -9,6 +9,7 @@
 #include <glog/logging.h>
 #include <sstream>
 #include <unistd.h>
+#include <vector>
 
 // Java Integer/Float
 
@@ -20,6 +21,13 @@ JNI_VisionDetRet *g_pJNI_VisionDetRet;
 
 JavaVM *g_javaVM = NULL;
 
+// Built up by static initializers, so it must exist before the first of them
+static std::vector<jniutils::NativeRegistrar> &nativeRegistrars()
+{
+  static std::vector<jniutils::NativeRegistrar> registrars;
+  return registrars;
+}
+
 JNIEXPORT jint JNI_OnLoad(JavaVM *vm, void *reserved)
 {
   DLOG(INFO) << "JNI_OnLoad enter";
@@ -32,6 +40,8 @@ JNIEXPORT jint JNI_OnLoad(JavaVM *vm, void *reserved)
   g_pJniFloat = new JNI_Float(env);
   g_pJniPointF = new JNI_PointF(env);
   g_pJNI_VisionDetRet = new JNI_VisionDetRet(env);
+  for (jniutils::NativeRegistrar registrar : nativeRegistrars())
+    registrar(env);
 
   DLOG(INFO) << "JNI_OnLoad exit";
   return JNI_VERSION_1_6;
@@ -95,6 +105,12 @@ InnerPoint convertJPointToPointF(JNIEnv *env, jobject lPoint)
   return InnerPoint{.x = pointf.x, .y = pointf.y};
 }
 
+bool addNativeRegistrar(NativeRegistrar registrar)
+{
+  nativeRegistrars().push_back(registrar);
+  return true;
+}
+
 JNIEnv *vm2env(JavaVM *vm)
 {
   JNIEnv *env = NULL;
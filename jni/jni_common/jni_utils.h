@@ -25,6 +25,12 @@ InnerPoint convertJPointToPointF(JNIEnv *env, jobject lPoint);
 
 JNIEnv *vm2env(JavaVM *vm);
 
+// Binds natives that aren't found by their Java_ symbol names. A module adds
+// its registrar from a static initializer and JNI_OnLoad calls each one, so
+// jni_common doesn't need to know the modules built on it.
+typedef jint (*NativeRegistrar)(JNIEnv *env);
+bool addNativeRegistrar(NativeRegistrar registrar);
+
 } // end jniutils
 
 #endif /* JNI_UTILS_H */
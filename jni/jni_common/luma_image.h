@@ -0,0 +1,72 @@
+/*
+ * luma_image.h using google-style
+ *
+ *  Created on: May 24, 2016
+ *      Author: Nanyun
+ *
+ *  Copyright (c) 2016 Nanyun. All rights reserved.
+ */
+
+#pragma once
+
+#include <dlib/image_processing/generic_image.h>
+#include <jni_common/types.h>
+
+namespace jnicommon
+{
+
+// A read-only view of an 8 bit luminance plane, e.g. the Y plane of a
+// YUV_420_888 camera frame. The pixels are not copied or owned, so the plane
+// must stay alive and unchanged while the view is used. Rows may be padded:
+// rowStride is the distance in bytes between the starts of two rows.
+class LumaImageView
+{
+public:
+  LumaImageView() : mData(0), mWidth(0), mHeight(0), mRowStride(0) {}
+
+  LumaImageView(const uint8 *data, int width, int height, int rowStride)
+      : mData(data), mWidth(width), mHeight(height), mRowStride(rowStride) {}
+
+  inline const uint8 *data() const { return mData; }
+  inline int width() const { return mWidth; }
+  inline int height() const { return mHeight; }
+  inline int rowStride() const { return mRowStride; }
+  inline bool empty() const { return mData == 0 || mWidth <= 0 || mHeight <= 0; }
+
+  // The number of bytes a buffer must hold to back a width x height plane
+  // with the given row stride. The last row doesn't need its padding.
+  static inline long requiredCapacity(int width, int height, int rowStride)
+  {
+    if (width <= 0 || height <= 0)
+      return 0;
+    return (long)rowStride * (height - 1) + width;
+  }
+
+private:
+  const uint8 *mData;
+  int mWidth;
+  int mHeight;
+  int mRowStride;
+};
+
+// dlib's generic image interface, so the view can go straight into the
+// detector and the shape predictor
+inline long num_rows(const LumaImageView &img) { return img.height(); }
+inline long num_columns(const LumaImageView &img) { return img.width(); }
+inline void *image_data(LumaImageView &img)
+{
+  return const_cast<uint8 *>(img.data());
+}
+inline const void *image_data(const LumaImageView &img) { return img.data(); }
+inline long width_step(const LumaImageView &img) { return img.rowStride(); }
+
+} // end jnicommon
+
+namespace dlib
+{
+template <>
+struct image_traits<jnicommon::LumaImageView>
+{
+  typedef unsigned char pixel_type;
+};
+}
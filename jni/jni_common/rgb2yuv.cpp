@@ -8,6 +8,19 @@
  */
 
 #include <jni_common/rgb2yuv.h>
+#include <jni_common/simd_dispatch.h>
+
+#include <dlib/threads/pool_tasks.h>
+
+#if defined(JNICOMMON_HAVE_SSE2)
+#include <emmintrin.h>
+#endif
+#if defined(JNICOMMON_HAVE_AVX2)
+#include <immintrin.h>
+#endif
+#if defined(JNICOMMON_HAVE_NEON)
+#include <arm_neon.h>
+#endif
 
 namespace jnicommon
 {
@@ -47,6 +60,22 @@ static inline void WriteYUV(const int x, const int y, const int width,
   pUV[offset + u_offset] += ((-38 * r8 - 74 * g8 + 112 * b8 + 128) >> 10) + 32;
 }
 
+static inline void WriteARGB(const int x, const int y, const int width,
+                             const uint32 rgb, uint8 *const pY,
+                             uint8 *const pUV)
+{
+#ifdef __APPLE__
+  const int nB = (rgb >> 8) & 0xFF;
+  const int nG = (rgb >> 16) & 0xFF;
+  const int nR = (rgb >> 24) & 0xFF;
+#else
+  const int nR = (rgb >> 16) & 0xFF;
+  const int nG = (rgb >> 8) & 0xFF;
+  const int nB = rgb & 0xFF;
+#endif
+  WriteYUV(x, y, width, nR, nG, nB, pY, pUV);
+}
+
 void ConvertARGB8888ToYUV420SP(const uint32 *const input, uint8 *const output,
                                int width, int height)
 {
@@ -58,17 +87,7 @@ void ConvertARGB8888ToYUV420SP(const uint32 *const input, uint8 *const output,
   {
     for (int x = 0; x < width; x++)
     {
-      const uint32 rgb = *in++;
-#ifdef __APPLE__
-      const int nB = (rgb >> 8) & 0xFF;
-      const int nG = (rgb >> 16) & 0xFF;
-      const int nR = (rgb >> 24) & 0xFF;
-#else
-      const int nR = (rgb >> 16) & 0xFF;
-      const int nG = (rgb >> 8) & 0xFF;
-      const int nB = rgb & 0xFF;
-#endif
-      WriteYUV(x, y, width, nR, nG, nB, pY++, pUV);
+      WriteARGB(x, y, width, *in++, pY++, pUV);
     }
   }
 }
@@ -100,4 +119,266 @@ void ConvertRGB565ToYUV420SP(const uint16 *const input, uint8 *const output,
     }
   }
 }
+
+// ---------------------------------------------------------------------------
+// Vectorized ARGB to NV21. A kernel converts two rows at once, so each UV
+// byte is the sum of the four chroma terms of its block, the same value the
+// += in WriteYUV() builds up. A term is 4..60, so the sum never wraps. A
+// kernel returns how many pixels of the row pair it did; the rest goes
+// through WriteYUV().
+
+#if defined(JNICOMMON_HAVE_SSE2)
+// (kr * r + kg * g + kb * b + 128) >> shift for 4 ARGB pixels, with r and g
+// paired up for madd as r | g << 16, and b as b | 1 << 16
+static inline __m128i Weigh_SSE2(__m128i rg, __m128i b1, int kr, int kg,
+                                 int kb, int shift)
+{
+  const __m128i kRG =
+      _mm_set1_epi32((int)((uint32)(uint16)kg << 16 | (uint16)kr));
+  const __m128i kB1 = _mm_set1_epi32((int)(128u << 16 | (uint16)kb));
+  return _mm_sra_epi32(
+      _mm_add_epi32(_mm_madd_epi16(rg, kRG), _mm_madd_epi16(b1, kB1)),
+      _mm_cvtsi32_si128(shift));
+}
+
+static inline void SplitARGB_SSE2(const uint32 *in, __m128i &rg, __m128i &b1)
+{
+  const __m128i p = _mm_loadu_si128((const __m128i *)in);
+  const __m128i mask = _mm_set1_epi32(0xff);
+  const __m128i g = _mm_and_si128(p, _mm_set1_epi32(0xff00));
+  rg = _mm_or_si128(_mm_and_si128(_mm_srli_epi32(p, 16), mask),
+                    _mm_slli_epi32(g, 8));
+  b1 = _mm_or_si128(_mm_and_si128(p, mask), _mm_set1_epi32(0x10000));
+}
+
+// Y, and the V and U terms without the + 32, of 4 pixels in 32 bit lanes
+static inline void ARGBToYUV_SSE2(const uint32 *in, __m128i &y, __m128i &v,
+                                  __m128i &u)
+{
+  __m128i rg, b1;
+  SplitARGB_SSE2(in, rg, b1);
+  y = Weigh_SSE2(rg, b1, 66, 129, 25, 8);
+  v = Weigh_SSE2(rg, b1, 112, -94, -18, 10);
+  u = Weigh_SSE2(rg, b1, -38, -74, 112, 10);
+}
+
+static int ARGBRows_SSE2(const uint32 *in0, const uint32 *in1, uint8 *pY0,
+                         uint8 *pY1, uint8 *pUV, int width)
+{
+  const int end = width / 8 * 8;
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i one = _mm_set1_epi16(1);
+  const __m128i k16 = _mm_set1_epi16(16);
+  const __m128i k128 = _mm_set1_epi32(4 * 32);
+  for (int x = 0; x < end; x += 8)
+  {
+    __m128i y0a, v0a, u0a, y0b, v0b, u0b, y1a, v1a, u1a, y1b, v1b, u1b;
+    ARGBToYUV_SSE2(in0 + x, y0a, v0a, u0a);
+    ARGBToYUV_SSE2(in0 + x + 4, y0b, v0b, u0b);
+    ARGBToYUV_SSE2(in1 + x, y1a, v1a, u1a);
+    ARGBToYUV_SSE2(in1 + x + 4, y1b, v1b, u1b);
+
+    const __m128i y0 = _mm_add_epi16(_mm_packs_epi32(y0a, y0b), k16);
+    const __m128i y1 = _mm_add_epi16(_mm_packs_epi32(y1a, y1b), k16);
+    _mm_storel_epi64((__m128i *)(pY0 + x), _mm_packus_epi16(y0, y0));
+    _mm_storel_epi64((__m128i *)(pY1 + x), _mm_packus_epi16(y1, y1));
+
+    // Sum the two rows, then the neighbouring columns
+    __m128i v =
+        _mm_packs_epi32(_mm_add_epi32(v0a, v1a), _mm_add_epi32(v0b, v1b));
+    __m128i u =
+        _mm_packs_epi32(_mm_add_epi32(u0a, u1a), _mm_add_epi32(u0b, u1b));
+    v = _mm_add_epi32(_mm_madd_epi16(v, one), k128);
+    u = _mm_add_epi32(_mm_madd_epi16(u, one), k128);
+    u = _mm_slli_epi16(_mm_packs_epi32(u, zero), 8);
+    const __m128i vu = _mm_or_si128(_mm_packs_epi32(v, zero), u);
+    _mm_storel_epi64((__m128i *)(pUV + x), vu);
+  }
+  return end;
+}
+#endif
+
+#if defined(JNICOMMON_HAVE_AVX2)
+JNICOMMON_TARGET_AVX2
+static inline __m256i Weigh_AVX2(__m256i rg, __m256i b1, int kr, int kg,
+                                 int kb, int shift)
+{
+  const __m256i kRG =
+      _mm256_set1_epi32((int)((uint32)(uint16)kg << 16 | (uint16)kr));
+  const __m256i kB1 = _mm256_set1_epi32((int)(128u << 16 | (uint16)kb));
+  return _mm256_sra_epi32(_mm256_add_epi32(_mm256_madd_epi16(rg, kRG),
+                                           _mm256_madd_epi16(b1, kB1)),
+                          _mm_cvtsi32_si128(shift));
+}
+
+// Y, and the V and U terms without the + 32, of 8 pixels in 32 bit lanes
+JNICOMMON_TARGET_AVX2
+static inline void ARGBToYUV_AVX2(const uint32 *in, __m256i &y, __m256i &v,
+                                  __m256i &u)
+{
+  const __m256i p = _mm256_loadu_si256((const __m256i *)in);
+  const __m256i mask = _mm256_set1_epi32(0xff);
+  const __m256i rg = _mm256_or_si256(
+      _mm256_and_si256(_mm256_srli_epi32(p, 16), mask),
+      _mm256_slli_epi32(_mm256_and_si256(p, _mm256_set1_epi32(0xff00)), 8));
+  const __m256i b1 =
+      _mm256_or_si256(_mm256_and_si256(p, mask), _mm256_set1_epi32(0x10000));
+  y = Weigh_AVX2(rg, b1, 66, 129, 25, 8);
+  v = Weigh_AVX2(rg, b1, 112, -94, -18, 10);
+  u = Weigh_AVX2(rg, b1, -38, -74, 112, 10);
+}
+
+// 16 Y values of two 8 pixel registers. pack works within 128 bit lanes, so
+// the 64 bit quarters come out as pixels 0-3, 8-11, 4-7, 12-15.
+JNICOMMON_TARGET_AVX2
+static inline void StoreLuma_AVX2(uint8 *out, __m256i a, __m256i b)
+{
+  __m256i y = _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), 0xd8);
+  y = _mm256_add_epi16(y, _mm256_set1_epi16(16));
+  y = _mm256_permute4x64_epi64(_mm256_packus_epi16(y, y), 0x08);
+  _mm_storeu_si128((__m128i *)out, _mm256_castsi256_si128(y));
+}
+
+JNICOMMON_TARGET_AVX2
+static int ARGBRows_AVX2(const uint32 *in0, const uint32 *in1, uint8 *pY0,
+                         uint8 *pY1, uint8 *pUV, int width)
+{
+  const int end = width / 16 * 16;
+  const __m256i k128 = _mm256_set1_epi32(4 * 32);
+  for (int x = 0; x < end; x += 16)
+  {
+    __m256i y0a, v0a, u0a, y0b, v0b, u0b, y1a, v1a, u1a, y1b, v1b, u1b;
+    ARGBToYUV_AVX2(in0 + x, y0a, v0a, u0a);
+    ARGBToYUV_AVX2(in0 + x + 8, y0b, v0b, u0b);
+    ARGBToYUV_AVX2(in1 + x, y1a, v1a, u1a);
+    ARGBToYUV_AVX2(in1 + x + 8, y1b, v1b, u1b);
+    StoreLuma_AVX2(pY0 + x, y0a, y0b);
+    StoreLuma_AVX2(pY1 + x, y1a, y1b);
+
+    // hadd pairs the columns within 128 bit lanes, which leaves the blocks
+    // as 0 1 4 5 2 3 6 7
+    __m256i v = _mm256_hadd_epi32(_mm256_add_epi32(v0a, v1a),
+                                  _mm256_add_epi32(v0b, v1b));
+    __m256i u = _mm256_hadd_epi32(_mm256_add_epi32(u0a, u1a),
+                                  _mm256_add_epi32(u0b, u1b));
+    v = _mm256_permute4x64_epi64(_mm256_add_epi32(v, k128), 0xd8);
+    u = _mm256_permute4x64_epi64(_mm256_add_epi32(u, k128), 0xd8);
+    __m256i vu = _mm256_or_si256(v, _mm256_slli_epi32(u, 8));
+    vu = _mm256_permute4x64_epi64(_mm256_packus_epi32(vu, vu), 0x08);
+    _mm_storeu_si128((__m128i *)(pUV + x), _mm256_castsi256_si128(vu));
+  }
+  return end;
+}
+#endif
+
+#if defined(JNICOMMON_HAVE_NEON)
+// The V or U term of 8 pixels without the + 32
+static inline int16x8_t ChromaTerm_NEON(const uint8x8x4_t &bgra, int16 kr,
+                                        int16 kg, int16 kb)
+{
+  int16x8_t t = vmulq_n_s16(vreinterpretq_s16_u16(vmovl_u8(bgra.val[2])), kr);
+  t = vmlaq_n_s16(t, vreinterpretq_s16_u16(vmovl_u8(bgra.val[1])), kg);
+  t = vmlaq_n_s16(t, vreinterpretq_s16_u16(vmovl_u8(bgra.val[0])), kb);
+  return vshrq_n_s16(vaddq_s16(t, vdupq_n_s16(128)), 10);
+}
+
+static inline uint8x8_t Luma_NEON(const uint8x8x4_t &bgra)
+{
+  uint16x8_t y = vmull_u8(bgra.val[2], vdup_n_u8(66));
+  y = vmlal_u8(y, bgra.val[1], vdup_n_u8(129));
+  y = vmlal_u8(y, bgra.val[0], vdup_n_u8(25));
+  y = vaddq_u16(y, vdupq_n_u16(128));
+  return vadd_u8(vshrn_n_u16(y, 8), vdup_n_u8(16));
+}
+
+static int ARGBRows_NEON(const uint32 *in0, const uint32 *in1, uint8 *pY0,
+                         uint8 *pY1, uint8 *pUV, int width)
+{
+  const int end = width / 8 * 8;
+  for (int x = 0; x < end; x += 8)
+  {
+    const uint8x8x4_t p0 = vld4_u8((const uint8_t *)(in0 + x));
+    const uint8x8x4_t p1 = vld4_u8((const uint8_t *)(in1 + x));
+    vst1_u8(pY0 + x, Luma_NEON(p0));
+    vst1_u8(pY1 + x, Luma_NEON(p1));
+
+    const int16x8_t v = vaddq_s16(ChromaTerm_NEON(p0, 112, -94, -18),
+                                  ChromaTerm_NEON(p1, 112, -94, -18));
+    const int16x8_t u = vaddq_s16(ChromaTerm_NEON(p0, -38, -74, 112),
+                                  ChromaTerm_NEON(p1, -38, -74, 112));
+    const uint16x4_t vSum = vreinterpret_u16_s16(
+        vadd_s16(vmovn_s32(vpaddlq_s16(v)), vdup_n_s16(4 * 32)));
+    const uint16x4_t uSum = vreinterpret_u16_s16(
+        vadd_s16(vmovn_s32(vpaddlq_s16(u)), vdup_n_s16(4 * 32)));
+    vst1_u8(pUV + x, vreinterpret_u8_u16(vorr_u16(vSum, vshl_n_u16(uSum, 8))));
+  }
+  return end;
+}
+#endif
+
+static int ARGBRows_C(const uint32 *, const uint32 *, uint8 *, uint8 *,
+                      uint8 *, int)
+{
+  return 0;
+}
+
+typedef int (*ARGBRowsFunc)(const uint32 *in0, const uint32 *in1, uint8 *pY0,
+                            uint8 *pY1, uint8 *pUV, int width);
+
+static ARGBRowsFunc GetARGBRowsFunc()
+{
+  switch (GetSimdLevel())
+  {
+#if defined(JNICOMMON_HAVE_AVX2)
+  case SIMD_AVX2:
+    return ARGBRows_AVX2;
+#endif
+#if defined(JNICOMMON_HAVE_SSE2)
+  case SIMD_SSE2:
+    return ARGBRows_SSE2;
+#endif
+#if defined(JNICOMMON_HAVE_NEON)
+  case SIMD_NEON:
+    return ARGBRows_NEON;
+#endif
+  default:
+    return ARGBRows_C;
+  }
+}
+
+void ConvertARGB8888ToYUV420SPFast(const uint32 *const input,
+                                   uint8 *const output, int width, int height,
+                                   dlib::thread_pool *pool)
+{
+  if (GetSimdLevel() == SIMD_NONE && pool == 0)
+  {
+    ConvertARGB8888ToYUV420SP(input, output, width, height);
+    return;
+  }
+  uint8 *pY = output;
+  uint8 *pUV = output + (width * height);
+  const int blocks_per_row = (width + 1) / 2;
+  const ARGBRowsFunc rowsFunc = GetARGBRowsFunc();
+
+  // Bands of whole row pairs, so no two threads share a UV block
+  const int numPairs = (height + 1) / 2;
+  const long numBands = NumRowBands(pool, numPairs);
+  dlib::run_tasks_on_pool(pool, numBands, [&](long band) {
+    const int pairBegin = (int)(numPairs * band / numBands);
+    const int pairEnd = (int)(numPairs * (band + 1) / numBands);
+    for (int pair = pairBegin; pair < pairEnd; pair++)
+    {
+      const int y = 2 * pair;
+      int done = 0;
+      if (y + 1 < height)
+        done = rowsFunc(input + width * y, input + width * (y + 1),
+                        pY + width * y, pY + width * (y + 1),
+                        pUV + 2 * pair * blocks_per_row, width);
+      for (int row = y; row < y + 2 && row < height; row++)
+        for (int x = done; x < width; x++)
+          WriteARGB(x, row, width, input[width * row + x],
+                    pY + width * row + x, pUV);
+    }
+  });
+}
 }
@@ -9,6 +9,12 @@
 
 #pragma once
 #include <jni_common/types.h>
+
+namespace dlib
+{
+class thread_pool;
+}
+
 namespace jnicommon
 {
 
@@ -21,6 +27,15 @@ void ConvertARGB8888ToYUV420SP(const uint32 *const input, uint8 *const output,
 
 void ConvertRGB565ToYUV420SP(const uint16 *const input, uint8 *const output,
                              const int width, const int height);
+
+// The same as ConvertARGB8888ToYUV420SP() with SSE2, AVX2 or NEON, whichever
+// GetSimdLevel() returns, and bit-exact with it. If pool is not null the rows
+// are split into one band per pool thread, with or without SIMD. Without SIMD
+// or a pool it calls ConvertARGB8888ToYUV420SP(), which is faster than the
+// generic row loop on one thread.
+void ConvertARGB8888ToYUV420SPFast(const uint32 *const input,
+                                   uint8 *const output, int width, int height,
+                                   dlib::thread_pool *pool = 0);
 #ifdef __cplusplus
 } // end jnicommon
 }
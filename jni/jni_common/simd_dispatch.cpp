@@ -0,0 +1,114 @@
+/*
+ * simd_dispatch.cpp using google-style
+ *
+ *  Created on: May 24, 2016
+ *      Author: Nanyun
+ *
+ *  Copyright (c) 2016 Nanyun. All rights reserved.
+ */
+
+#include <jni_common/simd_dispatch.h>
+
+#include <dlib/threads/thread_pool_extension.h>
+
+#include <atomic>
+
+#if defined(JNICOMMON_HAVE_AVX2)
+#include <cpuid.h>
+#endif
+
+namespace jnicommon
+{
+
+#if defined(JNICOMMON_HAVE_AVX2)
+static bool CpuHasAVX2()
+{
+  unsigned int eax, ebx, ecx, edx;
+  if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+    return false;
+  // The OS must save the YMM registers: OSXSAVE, then XCR0 bits 1 and 2
+  const unsigned int kOSXSAVE = 1u << 27;
+  const unsigned int kAVX = 1u << 28;
+  if ((ecx & (kOSXSAVE | kAVX)) != (kOSXSAVE | kAVX))
+    return false;
+  unsigned int xcr0Lo, xcr0Hi;
+  __asm__ __volatile__("xgetbv" : "=a"(xcr0Lo), "=d"(xcr0Hi) : "c"(0));
+  if ((xcr0Lo & 6) != 6)
+    return false;
+  if (__get_cpuid_max(0, 0) < 7)
+    return false;
+  __cpuid_count(7, 0, eax, ebx, ecx, edx);
+  return (ebx & (1u << 5)) != 0;
+}
+#endif
+
+static SimdLevel DetectSimdLevel()
+{
+#if defined(JNICOMMON_HAVE_NEON)
+  return SIMD_NEON;
+#elif defined(JNICOMMON_HAVE_AVX2)
+  return CpuHasAVX2() ? SIMD_AVX2 : SIMD_SSE2;
+#elif defined(JNICOMMON_HAVE_SSE2)
+  return SIMD_SSE2;
+#else
+  return SIMD_NONE;
+#endif
+}
+
+// -1 until the first call detects the level
+static std::atomic<int> gSimdLevel(-1);
+
+SimdLevel GetSupportedSimdLevel()
+{
+  static const SimdLevel supported = DetectSimdLevel();
+  return supported;
+}
+
+SimdLevel GetSimdLevel()
+{
+  int level = gSimdLevel.load(std::memory_order_relaxed);
+  if (level < 0)
+  {
+    level = GetSupportedSimdLevel();
+    gSimdLevel.store(level, std::memory_order_relaxed);
+  }
+  return static_cast<SimdLevel>(level);
+}
+
+bool SetSimdLevel(SimdLevel level)
+{
+  const SimdLevel supported = GetSupportedSimdLevel();
+  bool runs = level == SIMD_NONE || level == supported;
+  // AVX2 machines run the SSE2 kernels as well
+  if (level == SIMD_SSE2 && supported == SIMD_AVX2)
+    runs = true;
+  if (!runs)
+    return false;
+  gSimdLevel.store(level, std::memory_order_relaxed);
+  return true;
+}
+
+const char *SimdLevelName(SimdLevel level)
+{
+  switch (level)
+  {
+  case SIMD_SSE2:
+    return "sse2";
+  case SIMD_AVX2:
+    return "avx2";
+  case SIMD_NEON:
+    return "neon";
+  default:
+    return "none";
+  }
+}
+
+long NumRowBands(dlib::thread_pool *pool, long rows)
+{
+  long bands = pool ? (long)pool->num_threads_in_pool() : 1;
+  if (bands > rows)
+    bands = rows;
+  return bands < 1 ? 1 : bands;
+}
+
+} // end jnicommon
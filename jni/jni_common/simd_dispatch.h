@@ -0,0 +1,62 @@
+/*
+ * simd_dispatch.h using google-style
+ *
+ *  Created on: May 24, 2016
+ *      Author: Nanyun
+ *
+ *  Copyright (c) 2016 Nanyun. All rights reserved.
+ */
+
+#pragma once
+
+// x86 and x86_64 Android ABIs always have SSE2. AVX2 is only compiled into
+// single functions and picked at run time.
+#if defined(__SSE2__) && !defined(__APPLE__)
+#define JNICOMMON_HAVE_SSE2 1
+#if defined(__GNUC__)
+#define JNICOMMON_HAVE_AVX2 1
+#define JNICOMMON_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+// arm64-v8a always has NEON. armeabi-v7a gets it from LOCAL_ARM_NEON, which
+// android_dlib already requires.
+#if (defined(__ARM_NEON) || defined(__ARM_NEON__)) && !defined(__APPLE__)
+#define JNICOMMON_HAVE_NEON 1
+#endif
+
+namespace dlib
+{
+class thread_pool;
+}
+
+namespace jnicommon
+{
+
+enum SimdLevel
+{
+  SIMD_NONE = 0,
+  SIMD_SSE2,
+  SIMD_AVX2,
+  SIMD_NEON
+};
+
+// The best level this CPU runs that was also compiled in. Detected once.
+SimdLevel GetSupportedSimdLevel();
+
+// The level the image converters use, GetSupportedSimdLevel() unless it was
+// overridden with SetSimdLevel().
+SimdLevel GetSimdLevel();
+
+// Makes the converters use the given level, e.g. SIMD_NONE to compare with
+// the scalar code. Returns false and keeps the current level if the CPU
+// doesn't run it.
+bool SetSimdLevel(SimdLevel level);
+
+const char *SimdLevelName(SimdLevel level);
+
+// How many row bands a converter splits rows into: one per pool thread, since
+// the calling thread only waits, and 1 without a pool.
+long NumRowBands(dlib::thread_pool *pool, long rows);
+
+} // end jnicommon
@@ -0,0 +1,18 @@
+/*
+ * thread_count.h using google-style
+ *
+ *  Created on: May 24, 2016
+ *      Author: Nanyun
+ *
+ *  Copyright (c) 2016 Nanyun. All rights reserved.
+ */
+
+#pragma once
+
+namespace jnicommon
+{
+
+// The threads of the HOG detector's pool, unless its constructor is given
+// another count, and of the converters' pool until ImageUtils.setNumThreads()
+static const int DEFAULT_NUM_THREADS = 3;
+}
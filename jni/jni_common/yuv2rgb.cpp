@@ -6,8 +6,22 @@
  *
  *  Copyright (c) 2016 Nanyun. All rights reserved.
  */
+#include <jni_common/simd_dispatch.h>
 #include <jni_common/yuv2rgb.h>
 
+#include <dlib/threads/pool_tasks.h>
+#include <string.h>
+
+#if defined(JNICOMMON_HAVE_SSE2)
+#include <emmintrin.h>
+#endif
+#if defined(JNICOMMON_HAVE_AVX2)
+#include <immintrin.h>
+#endif
+#if defined(JNICOMMON_HAVE_NEON)
+#include <arm_neon.h>
+#endif
+
 namespace jnicommon
 {
 
@@ -206,4 +220,434 @@ void ConvertYUV420SPToRGB565(const uint8 *const input, uint16 *const output,
     }
   }
 }
+
+// ---------------------------------------------------------------------------
+// Vectorized converters. Every kernel computes exactly what YUV2RGB() does:
+// the clamp to kMaxChannelValue followed by >> 10 is the same as >> 10 and a
+// clamp to 0..255, which is what the saturating packs do. A kernel converts
+// whole blocks of one row and returns how many pixels it did; the rest of the
+// row goes through the scalar code.
+
+static inline uint16 YUV2RGB565(int nY, int nU, int nV)
+{
+  const uint32 argb = YUV2RGB(nY, nU, nV);
+  return ((argb >> 19) & 0x1f) << 11 | ((argb >> 10) & 0x3f) << 5 |
+         ((argb >> 3) & 0x1f);
+}
+
+static inline void StoreScalar(uint32 *out, int nY, int nU, int nV)
+{
+  *out = YUV2RGB(nY, nU, nV);
+}
+
+static inline void StoreScalar(uint16 *out, int nY, int nU, int nV)
+{
+  *out = YUV2RGB565(nY, nU, nV);
+}
+
+// Chroma samples are read in groups of block / 2. With a pixel stride of 2 a
+// group covers block bytes, and the last U or V sample of an Android plane
+// has no byte after it, so such rows stop one block earlier.
+static inline int VectorWidth(int width, int uvStep, int block)
+{
+  if (uvStep == 1)
+    return width / block * block;
+  if (uvStep == 2)
+    return (width - 1) / block * block;
+  return 0;
+}
+
+#if defined(JNICOMMON_HAVE_SSE2)
+// 8 pixels in 16 bit lanes
+static inline void YUVToRGB_SSE2(__m128i y16, __m128i u16, __m128i v16,
+                                 __m128i &r, __m128i &g, __m128i &b)
+{
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i max = _mm_set1_epi16(255);
+  const __m128i nY =
+      _mm_max_epi16(_mm_sub_epi16(y16, _mm_set1_epi16(16)), zero);
+  const __m128i nU = _mm_sub_epi16(u16, _mm_set1_epi16(128));
+  const __m128i nV = _mm_sub_epi16(v16, _mm_set1_epi16(128));
+  const __m128i yvLo = _mm_unpacklo_epi16(nY, nV);
+  const __m128i yvHi = _mm_unpackhi_epi16(nY, nV);
+  const __m128i yuLo = _mm_unpacklo_epi16(nY, nU);
+  const __m128i yuHi = _mm_unpackhi_epi16(nY, nU);
+  // Coefficient pairs for madd, the Y one in the low half
+  const __m128i kR = _mm_set1_epi32((1634 << 16) | 1192);
+  const __m128i kGv = _mm_set1_epi32((int)(0xfcbfu << 16) | 1192);
+  const __m128i kGu = _mm_set1_epi32((int)(0xfe70u << 16));
+  const __m128i kB = _mm_set1_epi32((2066 << 16) | 1192);
+
+  __m128i lo = _mm_srai_epi32(_mm_madd_epi16(yvLo, kR), 10);
+  __m128i hi = _mm_srai_epi32(_mm_madd_epi16(yvHi, kR), 10);
+  r = _mm_min_epi16(_mm_max_epi16(_mm_packs_epi32(lo, hi), zero), max);
+  lo = _mm_add_epi32(_mm_madd_epi16(yvLo, kGv), _mm_madd_epi16(yuLo, kGu));
+  hi = _mm_add_epi32(_mm_madd_epi16(yvHi, kGv), _mm_madd_epi16(yuHi, kGu));
+  lo = _mm_srai_epi32(lo, 10);
+  hi = _mm_srai_epi32(hi, 10);
+  g = _mm_min_epi16(_mm_max_epi16(_mm_packs_epi32(lo, hi), zero), max);
+  lo = _mm_srai_epi32(_mm_madd_epi16(yuLo, kB), 10);
+  hi = _mm_srai_epi32(_mm_madd_epi16(yuHi, kB), 10);
+  b = _mm_min_epi16(_mm_max_epi16(_mm_packs_epi32(lo, hi), zero), max);
+}
+
+// The 4 chroma samples of 8 pixels, each twice, in 16 bit lanes
+static inline __m128i LoadChroma_SSE2(const uint8 *p, int uvStep)
+{
+  __m128i c;
+  if (uvStep == 1)
+  {
+    int32 bytes;
+    memcpy(&bytes, p, 4);
+    c = _mm_unpacklo_epi8(_mm_cvtsi32_si128(bytes), _mm_setzero_si128());
+  }
+  else
+  {
+    c = _mm_and_si128(_mm_loadl_epi64((const __m128i *)p),
+                      _mm_set1_epi16(0xff));
+  }
+  return _mm_unpacklo_epi16(c, c);
+}
+
+static inline void StoreRGB_SSE2(uint32 *out, __m128i r, __m128i g, __m128i b)
+{
+  const __m128i bg = _mm_or_si128(b, _mm_slli_epi16(g, 8));
+  const __m128i ra = _mm_or_si128(r, _mm_set1_epi16((short)0xff00));
+  _mm_storeu_si128((__m128i *)out, _mm_unpacklo_epi16(bg, ra));
+  _mm_storeu_si128((__m128i *)(out + 4), _mm_unpackhi_epi16(bg, ra));
+}
+
+static inline void StoreRGB_SSE2(uint16 *out, __m128i r, __m128i g, __m128i b)
+{
+  __m128i rgb = _mm_slli_epi16(_mm_srli_epi16(r, 3), 11);
+  rgb = _mm_or_si128(rgb, _mm_slli_epi16(_mm_srli_epi16(g, 2), 5));
+  rgb = _mm_or_si128(rgb, _mm_srli_epi16(b, 3));
+  _mm_storeu_si128((__m128i *)out, rgb);
+}
+
+template <typename pixel_type>
+static int YUVRow_SSE2(const uint8 *pY, const uint8 *pU, const uint8 *pV,
+                       int uvStep, pixel_type *out, int width)
+{
+  const int end = VectorWidth(width, uvStep, 8);
+  const int shift = uvStep == 1 ? 1 : 0;
+  const __m128i zero = _mm_setzero_si128();
+  for (int x = 0; x < end; x += 8)
+  {
+    const __m128i y16 =
+        _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *)(pY + x)), zero);
+    const __m128i u16 = LoadChroma_SSE2(pU + (x >> shift), uvStep);
+    const __m128i v16 = LoadChroma_SSE2(pV + (x >> shift), uvStep);
+    __m128i r, g, b;
+    YUVToRGB_SSE2(y16, u16, v16, r, g, b);
+    StoreRGB_SSE2(out + x, r, g, b);
+  }
+  return end;
+}
+#endif
+
+#if defined(JNICOMMON_HAVE_AVX2)
+// 16 pixels in 16 bit lanes
+JNICOMMON_TARGET_AVX2
+static inline void YUVToRGB_AVX2(__m256i y16, __m256i u16, __m256i v16,
+                                 __m256i &r, __m256i &g, __m256i &b)
+{
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i max = _mm256_set1_epi16(255);
+  const __m256i nY =
+      _mm256_max_epi16(_mm256_sub_epi16(y16, _mm256_set1_epi16(16)), zero);
+  const __m256i nU = _mm256_sub_epi16(u16, _mm256_set1_epi16(128));
+  const __m256i nV = _mm256_sub_epi16(v16, _mm256_set1_epi16(128));
+  const __m256i yvLo = _mm256_unpacklo_epi16(nY, nV);
+  const __m256i yvHi = _mm256_unpackhi_epi16(nY, nV);
+  const __m256i yuLo = _mm256_unpacklo_epi16(nY, nU);
+  const __m256i yuHi = _mm256_unpackhi_epi16(nY, nU);
+  const __m256i kR = _mm256_set1_epi32((1634 << 16) | 1192);
+  const __m256i kGv = _mm256_set1_epi32((int)(0xfcbfu << 16) | 1192);
+  const __m256i kGu = _mm256_set1_epi32((int)(0xfe70u << 16));
+  const __m256i kB = _mm256_set1_epi32((2066 << 16) | 1192);
+
+  // unpack and pack both work within 128 bit lanes, so the pixel order
+  // comes back unchanged
+  __m256i lo = _mm256_srai_epi32(_mm256_madd_epi16(yvLo, kR), 10);
+  __m256i hi = _mm256_srai_epi32(_mm256_madd_epi16(yvHi, kR), 10);
+  r = _mm256_min_epi16(_mm256_max_epi16(_mm256_packs_epi32(lo, hi), zero), max);
+  lo = _mm256_add_epi32(_mm256_madd_epi16(yvLo, kGv),
+                        _mm256_madd_epi16(yuLo, kGu));
+  hi = _mm256_add_epi32(_mm256_madd_epi16(yvHi, kGv),
+                        _mm256_madd_epi16(yuHi, kGu));
+  lo = _mm256_srai_epi32(lo, 10);
+  hi = _mm256_srai_epi32(hi, 10);
+  g = _mm256_min_epi16(_mm256_max_epi16(_mm256_packs_epi32(lo, hi), zero), max);
+  lo = _mm256_srai_epi32(_mm256_madd_epi16(yuLo, kB), 10);
+  hi = _mm256_srai_epi32(_mm256_madd_epi16(yuHi, kB), 10);
+  b = _mm256_min_epi16(_mm256_max_epi16(_mm256_packs_epi32(lo, hi), zero), max);
+}
+
+// The 8 chroma samples of 16 pixels, each twice, in 16 bit lanes
+JNICOMMON_TARGET_AVX2
+static inline __m256i LoadChroma_AVX2(const uint8 *p, int uvStep)
+{
+  __m128i c;
+  if (uvStep == 1)
+    c = _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i *)p));
+  else
+    c = _mm_and_si128(_mm_loadu_si128((const __m128i *)p),
+                      _mm_set1_epi16(0xff));
+  return _mm256_inserti128_si256(
+      _mm256_castsi128_si256(_mm_unpacklo_epi16(c, c)),
+      _mm_unpackhi_epi16(c, c), 1);
+}
+
+JNICOMMON_TARGET_AVX2
+static inline void StoreRGB_AVX2(uint32 *out, __m256i r, __m256i g, __m256i b)
+{
+  const __m256i bg = _mm256_or_si256(b, _mm256_slli_epi16(g, 8));
+  const __m256i ra = _mm256_or_si256(r, _mm256_set1_epi16((short)0xff00));
+  const __m256i lo = _mm256_unpacklo_epi16(bg, ra);
+  const __m256i hi = _mm256_unpackhi_epi16(bg, ra);
+  _mm256_storeu_si256((__m256i *)out, _mm256_permute2x128_si256(lo, hi, 0x20));
+  _mm256_storeu_si256((__m256i *)(out + 8),
+                      _mm256_permute2x128_si256(lo, hi, 0x31));
+}
+
+JNICOMMON_TARGET_AVX2
+static inline void StoreRGB_AVX2(uint16 *out, __m256i r, __m256i g, __m256i b)
+{
+  __m256i rgb = _mm256_slli_epi16(_mm256_srli_epi16(r, 3), 11);
+  rgb = _mm256_or_si256(rgb, _mm256_slli_epi16(_mm256_srli_epi16(g, 2), 5));
+  rgb = _mm256_or_si256(rgb, _mm256_srli_epi16(b, 3));
+  _mm256_storeu_si256((__m256i *)out, rgb);
+}
+
+template <typename pixel_type>
+JNICOMMON_TARGET_AVX2
+static int YUVRow_AVX2(const uint8 *pY, const uint8 *pU, const uint8 *pV,
+                       int uvStep, pixel_type *out, int width)
+{
+  const int end = VectorWidth(width, uvStep, 16);
+  const int shift = uvStep == 1 ? 1 : 0;
+  for (int x = 0; x < end; x += 16)
+  {
+    const __m256i y16 =
+        _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)(pY + x)));
+    const __m256i u16 = LoadChroma_AVX2(pU + (x >> shift), uvStep);
+    const __m256i v16 = LoadChroma_AVX2(pV + (x >> shift), uvStep);
+    __m256i r, g, b;
+    YUVToRGB_AVX2(y16, u16, v16, r, g, b);
+    StoreRGB_AVX2(out + x, r, g, b);
+  }
+  return end;
+}
+#endif
+
+#if defined(JNICOMMON_HAVE_NEON)
+// The 4 chroma samples of 8 pixels, each twice
+static inline uint8x8_t LoadChroma_NEON(const uint8 *p, int uvStep)
+{
+  uint8x8_t c;
+  if (uvStep == 1)
+  {
+    uint32 bytes;
+    memcpy(&bytes, p, 4);
+    c = vcreate_u8(bytes);
+  }
+  else
+  {
+    const uint8x8_t both = vld1_u8(p);
+    c = vuzp_u8(both, both).val[0];
+  }
+  return vzip_u8(c, c).val[0];
+}
+
+static inline void YUVToRGB_NEON(uint8x8_t y8, uint8x8_t u8, uint8x8_t v8,
+                                 uint8x8_t &r, uint8x8_t &g, uint8x8_t &b)
+{
+  const int16x8_t nY = vmaxq_s16(
+      vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(y8)), vdupq_n_s16(16)),
+      vdupq_n_s16(0));
+  const int16x8_t nU =
+      vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(u8)), vdupq_n_s16(128));
+  const int16x8_t nV =
+      vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(v8)), vdupq_n_s16(128));
+  const int32x4_t yLo = vmull_n_s16(vget_low_s16(nY), 1192);
+  const int32x4_t yHi = vmull_n_s16(vget_high_s16(nY), 1192);
+
+  int32x4_t lo = vmlal_n_s16(yLo, vget_low_s16(nV), 1634);
+  int32x4_t hi = vmlal_n_s16(yHi, vget_high_s16(nV), 1634);
+  r = vqmovun_s16(vcombine_s16(vqshrn_n_s32(lo, 10), vqshrn_n_s32(hi, 10)));
+  lo = vmlsl_n_s16(yLo, vget_low_s16(nV), 833);
+  hi = vmlsl_n_s16(yHi, vget_high_s16(nV), 833);
+  lo = vmlsl_n_s16(lo, vget_low_s16(nU), 400);
+  hi = vmlsl_n_s16(hi, vget_high_s16(nU), 400);
+  g = vqmovun_s16(vcombine_s16(vqshrn_n_s32(lo, 10), vqshrn_n_s32(hi, 10)));
+  lo = vmlal_n_s16(yLo, vget_low_s16(nU), 2066);
+  hi = vmlal_n_s16(yHi, vget_high_s16(nU), 2066);
+  b = vqmovun_s16(vcombine_s16(vqshrn_n_s32(lo, 10), vqshrn_n_s32(hi, 10)));
+}
+
+static inline void StoreRGB_NEON(uint32 *out, uint8x8_t r, uint8x8_t g,
+                                 uint8x8_t b)
+{
+  uint8x8x4_t bgra;
+  bgra.val[0] = b;
+  bgra.val[1] = g;
+  bgra.val[2] = r;
+  bgra.val[3] = vdup_n_u8(0xff);
+  vst4_u8((uint8_t *)out, bgra);
+}
+
+static inline void StoreRGB_NEON(uint16 *out, uint8x8_t r, uint8x8_t g,
+                                 uint8x8_t b)
+{
+  uint16x8_t rgb = vshlq_n_u16(vmovl_u8(vshr_n_u8(r, 3)), 11);
+  rgb = vorrq_u16(rgb, vshlq_n_u16(vmovl_u8(vshr_n_u8(g, 2)), 5));
+  rgb = vorrq_u16(rgb, vmovl_u8(vshr_n_u8(b, 3)));
+  vst1q_u16(out, rgb);
+}
+
+template <typename pixel_type>
+static int YUVRow_NEON(const uint8 *pY, const uint8 *pU, const uint8 *pV,
+                       int uvStep, pixel_type *out, int width)
+{
+  const int end = VectorWidth(width, uvStep, 8);
+  const int shift = uvStep == 1 ? 1 : 0;
+  for (int x = 0; x < end; x += 8)
+  {
+    uint8x8_t r, g, b;
+    YUVToRGB_NEON(vld1_u8(pY + x), LoadChroma_NEON(pU + (x >> shift), uvStep),
+                  LoadChroma_NEON(pV + (x >> shift), uvStep), r, g, b);
+    StoreRGB_NEON(out + x, r, g, b);
+  }
+  return end;
+}
+#endif
+
+template <typename pixel_type>
+static int YUVRow_C(const uint8 *, const uint8 *, const uint8 *, int,
+                    pixel_type *, int)
+{
+  return 0;
+}
+
+template <typename pixel_type>
+struct YUVRowFunc
+{
+  typedef int (*type)(const uint8 *pY, const uint8 *pU, const uint8 *pV,
+                      int uvStep, pixel_type *out, int width);
+};
+
+template <typename pixel_type>
+static typename YUVRowFunc<pixel_type>::type GetYUVRowFunc()
+{
+  switch (GetSimdLevel())
+  {
+#if defined(JNICOMMON_HAVE_AVX2)
+  case SIMD_AVX2:
+    return YUVRow_AVX2<pixel_type>;
+#endif
+#if defined(JNICOMMON_HAVE_SSE2)
+  case SIMD_SSE2:
+    return YUVRow_SSE2<pixel_type>;
+#endif
+#if defined(JNICOMMON_HAVE_NEON)
+  case SIMD_NEON:
+    return YUVRow_NEON<pixel_type>;
+#endif
+  default:
+    return YUVRow_C<pixel_type>;
+  }
+}
+
+template <typename pixel_type>
+static void ConvertYUV420Rows(const uint8 *const yData,
+                              const uint8 *const uData,
+                              const uint8 *const vData,
+                              pixel_type *const output, const int width,
+                              const int height, const int y_row_stride,
+                              const int uv_row_stride,
+                              const int uv_pixel_stride,
+                              dlib::thread_pool *pool)
+{
+  const typename YUVRowFunc<pixel_type>::type rowFunc =
+      GetYUVRowFunc<pixel_type>();
+  const long numBands = NumRowBands(pool, height);
+  dlib::run_tasks_on_pool(pool, numBands, [&](long band) {
+    const int yBegin = (int)(height * band / numBands);
+    const int yEnd = (int)(height * (band + 1) / numBands);
+    for (int y = yBegin; y < yEnd; y++)
+    {
+      const uint8 *pY = yData + y_row_stride * y;
+      const int uv_row_start = uv_row_stride * (y >> 1);
+      const uint8 *pU = uData + uv_row_start;
+      const uint8 *pV = vData + uv_row_start;
+      pixel_type *out = output + width * y;
+
+      for (int x = rowFunc(pY, pU, pV, uv_pixel_stride, out, width); x < width;
+           x++)
+      {
+        const int uv_offset = (x >> 1) * uv_pixel_stride;
+        StoreScalar(out + x, pY[x], pU[uv_offset], pV[uv_offset]);
+      }
+    }
+  });
+}
+
+void ConvertYUV420ToARGB8888Fast(const uint8 *const yData,
+                                 const uint8 *const uData,
+                                 const uint8 *const vData, uint32 *const output,
+                                 const int width, const int height,
+                                 const int y_row_stride,
+                                 const int uv_row_stride,
+                                 const int uv_pixel_stride,
+                                 dlib::thread_pool *pool)
+{
+  if (GetSimdLevel() == SIMD_NONE && pool == 0)
+  {
+    ConvertYUV420ToARGB8888(yData, uData, vData, output, width, height,
+                            y_row_stride, uv_row_stride, uv_pixel_stride);
+    return;
+  }
+  ConvertYUV420Rows(yData, uData, vData, output, width, height, y_row_stride,
+                    uv_row_stride, uv_pixel_stride, pool);
+}
+
+// The interleaved plane is a U and a V plane with a pixel stride of 2
+void ConvertYUV420SPToARGB8888Fast(const uint8 *const pY,
+                                   const uint8 *const pUV, uint32 *const output,
+                                   const int width, const int height,
+                                   dlib::thread_pool *pool)
+{
+  if (GetSimdLevel() == SIMD_NONE && pool == 0)
+  {
+    ConvertYUV420SPToARGB8888(pY, pUV, output, width, height);
+    return;
+  }
+#ifdef __APPLE__
+  ConvertYUV420Rows(pY, pUV, pUV + 1, output, width, height, width, width, 2,
+                    pool);
+#else
+  ConvertYUV420Rows(pY, pUV + 1, pUV, output, width, height, width, width, 2,
+                    pool);
+#endif
+}
+
+void ConvertYUV420SPToRGB565Fast(const uint8 *const input, uint16 *const output,
+                                 const int width, const int height,
+                                 dlib::thread_pool *pool)
+{
+  if (GetSimdLevel() == SIMD_NONE && pool == 0)
+  {
+    ConvertYUV420SPToRGB565(input, output, width, height);
+    return;
+  }
+  const uint8 *pUV = input + (width * height);
+#ifdef __APPLE__
+  ConvertYUV420Rows(input, pUV, pUV + 1, output, width, height, width, width,
+                    2, pool);
+#else
+  ConvertYUV420Rows(input, pUV + 1, pUV, output, width, height, width, width,
+                    2, pool);
+#endif
+}
 }
@@ -10,6 +10,11 @@
 #pragma once
 #include <jni_common/types.h>
 
+namespace dlib
+{
+class thread_pool;
+}
+
 namespace jnicommon
 {
 
@@ -41,6 +46,29 @@ void ConvertYUV420SPToARGB8888HalfSize(const uint8 *const input,
 void ConvertYUV420SPToRGB565(const uint8 *const input, uint16 *const output,
                              const int width, const int height);
 
+// The same conversions with SSE2, AVX2 or NEON, whichever GetSimdLevel()
+// returns, and bit-exact with the scalar versions above. If pool is not null
+// the rows are split into one band per pool thread, with or without SIMD.
+// Without SIMD or a pool they call the scalar versions, which are faster than
+// the generic row loop on one thread.
+void ConvertYUV420ToARGB8888Fast(const uint8 *const yData,
+                                 const uint8 *const uData,
+                                 const uint8 *const vData, uint32 *const output,
+                                 const int width, const int height,
+                                 const int y_row_stride,
+                                 const int uv_row_stride,
+                                 const int uv_pixel_stride,
+                                 dlib::thread_pool *pool = 0);
+
+void ConvertYUV420SPToARGB8888Fast(const uint8 *const pY,
+                                   const uint8 *const pUV, uint32 *const output,
+                                   const int width, const int height,
+                                   dlib::thread_pool *pool = 0);
+
+void ConvertYUV420SPToRGB565Fast(const uint8 *const input, uint16 *const output,
+                                 const int width, const int height,
+                                 dlib::thread_pool *pool = 0);
+
 #ifdef __cplusplus
 }
 } // end jnicommon
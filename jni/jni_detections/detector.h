@@ -10,15 +10,23 @@
 #pragma once
 
 #include <jni_common/jni_fileutils.h>
+#include <jni_common/luma_image.h>
+#include <jni_common/thread_count.h>
+#include <frame_pipeline.h>
+#include <liveness.h>
+#include <luma_preprocess.h>
 #include <dlib/image_loader/load_image.h>
 #include <dlib/image_processing.h>
 #include <dlib/image_processing/frontal_face_detector.h>
 #include <dlib/image_processing/render_face_detections.h>
+#include <dlib/image_processing/shape_predictor_mapped.h>
 #include <dlib/opencv/cv_image.h>
+#include <dlib/threads/thread_pool_extension.h>
 #include <dlib/image_loader/load_image.h>
 #include <glog/logging.h>
 #include <jni.h>
 #include <memory>
+#include <mutex>
 #include <opencv2/core/core.hpp>
 #include <opencv2/highgui/highgui.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
@@ -144,7 +152,7 @@ public:
     return mRets.size();
   }
 
-  inline std::vector<dlib::rectangle> getResult() { return mRets; }
+  inline std::vector<dlib::rectangle> &getResult() { return mRets; }
 
   virtual ~DLibHOGDetector() {}
 
@@ -163,13 +171,61 @@ class DLibHOGFaceDetector : public DLibHOGDetector
 private:
   std::string mLandMarkModel;
   dlib::shape_predictor msp;
+  // msp cut down to the liveness landmarks, see setLandmarkSubset()
+  dlib::shape_predictor mSubsetSp;
+  bool mUseSubset;
+  // Landmarks start from the last frame's, see setWarmStart()
+  std::vector<dlib::full_object_detection> mPrevShapes;
+  int mWarmStartLevels;
+  double mMaxMotion;
   std::unordered_map<int, dlib::full_object_detection> mFaceShapeMap;
+  std::vector<dlib::rect_detection> mDets;
+  std::vector<double> mScores;
+  std::vector<int> mPoses;
+  LivenessSession mLiveness;
+  LumaPreprocessor mPreprocessor;
   dlib::frontal_face_detector mFaceDetector;
+  // Detect-then-track state, see setTracking()
+  dlib::correlation_tracker mTracker;
+  int mDetectInterval;
+  double mMinPsr;
+  bool mTracking;
+  bool mRegionScan;
+  int mFramesSinceDetect;
+  double mTrackedScore;
+  int mTrackedPose;
+  int mLastPath;
+  double mLastPsr;
+  long mPathCounts[4];
+  // Owned by the detector so the pyramid, FHOG and filter stages reuse the same
+  // workers on every frame instead of creating threads per call
+  std::unique_ptr<dlib::thread_pool> mThreadPool;
+  // Held by the pipeline worker for each frame, see getLock()
+  std::mutex mLock;
+  // Swapped under mPipelineLock. The natives work on a copy of the pointer,
+  // so stopping the pipeline never frees one they are still using.
+  std::mutex mPipelineLock;
+  std::shared_ptr<FramePipeline> mPipeline;
 
-  inline void init()
+  inline void init(int numThreads)
   {
-    LOG(INFO) << "Init mFaceDetector";
+    mDetectInterval = 1;
+    mMinPsr = DEFAULT_MIN_PSR;
+    mTracking = false;
+    mRegionScan = true;
+    mFramesSinceDetect = 0;
+    mTrackedScore = 0;
+    mTrackedPose = POSE_FRONTAL;
+    mLastPath = PATH_DETECT;
+    mLastPsr = 0;
+    mUseSubset = false;
+    mWarmStartLevels = 0;
+    mMaxMotion = DEFAULT_MAX_MOTION;
+    resetPathCounts();
+    LOG(INFO) << "Init mFaceDetector with " << numThreads << " threads";
     mFaceDetector = dlib::get_frontal_face_detector();
+    mThreadPool.reset(new dlib::thread_pool(numThreads));
+    mFaceDetector.get_scanner().set_thread_pool(mThreadPool.get());
   }
   inline void resizeRet(int img_width, int img_height)
   {
@@ -215,20 +271,212 @@ private:
     }
   }
 
+  // The landmarks of a face, started from those of the face of the last frame
+  // whose box moved the least to rect when the warm start is on
+  template <typename image_type>
+  inline dlib::full_object_detection landmarks(const dlib::shape_predictor &sp,
+                                               const image_type &img,
+                                               const dlib::rectangle &rect)
+  {
+    unsigned long levels = sp.num_cascade_levels();
+    const dlib::full_object_detection *previous = nullptr;
+    for (const dlib::full_object_detection &shape : mPrevShapes)
+    {
+      if (mWarmStartLevels <= 0)
+        break;
+      const unsigned long l = sp.warm_start_levels(
+          shape.get_rect(), rect, mWarmStartLevels, mMaxMotion);
+      if (l < levels)
+      {
+        levels = l;
+        previous = &shape;
+      }
+    }
+    return previous ? sp(img, rect, *previous, levels) : sp(img, rect);
+  }
+
+  // Moves the tracked face to this frame. Returns false if the tracker lost
+  // it: the peak to sidelobe ratio fell below mMinPsr or the box left the
+  // image.
+  template <typename image_type>
+  inline bool trackImage(const image_type &img)
+  {
+    mLastPsr = mTracker.update(img);
+    const dlib::rectangle box = mTracker.get_position();
+    const dlib::rectangle inside = box.intersect(
+        dlib::rectangle(0, 0, num_columns(img) - 1, num_rows(img) - 1));
+    if (mLastPsr < mMinPsr || inside.area() * 2 < box.area())
+      return false;
+    mRets.assign(1, box);
+    mScores.assign(1, mTrackedScore);
+    mPoses.assign(1, mTrackedPose);
+    return true;
+  }
+
+  // Face detection, landmarks and the result rectangles for any dlib image
+  template <typename image_type>
+  inline int detImage(const image_type &img)
+  {
+    mLastPath = PATH_DETECT;
+    mLastPsr = 0;
+    if (mTracking && mFramesSinceDetect + 1 < mDetectInterval)
+    {
+      if (trackImage(img))
+      {
+        mLastPath = PATH_TRACK;
+        ++mFramesSinceDetect;
+      }
+      else
+      {
+        mLastPath = PATH_REDETECT;
+      }
+    }
+
+    if (mLastPath == PATH_DETECT && mTracking && mRegionScan)
+    {
+      // A scheduled scan while the face is still tracked only looks around
+      // the tracked box, for faces of about its size
+      const dlib::rectangle box = mTracker.get_position();
+      const unsigned long size = box.width();
+      mFaceDetector.detect_in_region(img, dlib::grow_rect(box, size / 2),
+                                     size * 7 / 10, size * 14 / 10, mDets);
+      if (!mDets.empty())
+        mLastPath = PATH_REGION;
+    }
+    ++mPathCounts[mLastPath];
+
+    if (mLastPath != PATH_TRACK)
+    {
+      if (mLastPath != PATH_REGION)
+        mFaceDetector(img, mDets);
+      mRets.resize(mDets.size());
+      mScores.resize(mDets.size());
+      mPoses.resize(mDets.size());
+      for (unsigned long j = 0; j < mDets.size(); ++j)
+      {
+        mRets[j] = mDets[j].rect;
+        mScores[j] = mDets[j].detection_confidence;
+        mPoses[j] = mDets[j].weight_index;
+      }
+      LOG(INFO) << "Dlib HOG face det size : " << mRets.size();
+
+      // Track the biggest face, the one the liveness history follows
+      mTracking = false;
+      if (mDetectInterval > 1 && !mRets.empty())
+      {
+        unsigned long biggest = 0;
+        for (unsigned long j = 1; j < mRets.size(); ++j)
+        {
+          if (mRets[j].area() > mRets[biggest].area())
+            biggest = j;
+        }
+        mTracker.start_track(img, mRets[biggest]);
+        mTrackedScore = mScores[biggest];
+        mTrackedPose = mPoses[biggest];
+        mTracking = true;
+        mFramesSinceDetect = 0;
+      }
+    }
+    mPrevShapes.clear();
+    for (const auto &it : mFaceShapeMap)
+      mPrevShapes.push_back(it.second);
+    mFaceShapeMap.clear();
+    // Process shape
+    if (mRets.size() != 0 && mLandMarkModel.empty() == false)
+    {
+      const dlib::shape_predictor &sp = mUseSubset ? mSubsetSp : msp;
+      for (unsigned long j = 0; j < mRets.size(); ++j)
+      {
+        dlib::full_object_detection shape = landmarks(sp, img, mRets[j]);
+        LOG(INFO) << "face index:" << j
+                  << "number of parts: " << shape.num_parts();
+        mFaceShapeMap[j] = shape;
+      }
+      // The liveness history follows the biggest face
+      unsigned long biggest = 0;
+      for (unsigned long j = 1; j < mRets.size(); ++j)
+      {
+        if (mRets[j].area() > mRets[biggest].area())
+          biggest = j;
+      }
+      mLiveness.push(mFaceShapeMap[biggest]);
+    }
+    int img_width = num_columns(img);
+    int img_height = num_rows(img);
+    resizeRet(img_width, img_height);
+    return mRets.size();
+  }
+
 public:
-  DLibHOGFaceDetector() { init(); }
+  static const int DEFAULT_NUM_THREADS = jnicommon::DEFAULT_NUM_THREADS;
+
+  // Which way det() found the faces of the last frame
+  enum DetectPath
+  {
+    // The full HOG scan over every pyramid level
+    PATH_DETECT = 0,
+    // The correlation tracker moved the last box, only landmarks were run
+    PATH_TRACK = 1,
+    // The tracker lost the face, so the full scan ran instead
+    PATH_REDETECT = 2,
+    // A scheduled scan found the tracked face again around its last box,
+    // see object_detector::detect_in_region()
+    PATH_REGION = 3
+  };
+
+  // The filters of the frontal face model, by the pose of the faces they find.
+  // A face found with tracking keeps the pose it was detected with.
+  enum FacePose
+  {
+    POSE_FRONTAL = 0,
+    POSE_LEFT = 1,
+    POSE_RIGHT = 2,
+    POSE_TILTED_LEFT = 3,
+    POSE_TILTED_RIGHT = 4,
+    NUM_POSES = 5
+  };
+  static const int ALL_POSES = (1 << NUM_POSES) - 1;
+
+  // A peak to sidelobe ratio below this usually means the tracker has
+  // drifted off the face
+  static constexpr double DEFAULT_MIN_PSR = 7.0;
+
+  // A face box that moved by this much, in box widths, since the last frame
+  // gets its landmarks from scratch
+  static constexpr double DEFAULT_MAX_MOTION = 0.2;
 
-  DLibHOGFaceDetector(const std::string &landmarkmodel)
+  // numThreads == 0 runs every stage on the calling thread. The work is split
+  // the same way for any numThreads, so the results are bit-identical.
+  // minFaceSize and maxFaceSize are passed to setFaceSizeRange().
+  explicit DLibHOGFaceDetector(int numThreads = DEFAULT_NUM_THREADS,
+                               int minFaceSize = 0, int maxFaceSize = 0)
+  {
+    init(numThreads);
+    setFaceSizeRange(minFaceSize, maxFaceSize);
+  }
+
+  DLibHOGFaceDetector(const std::string &landmarkmodel,
+                      int numThreads = DEFAULT_NUM_THREADS,
+                      int minFaceSize = 0, int maxFaceSize = 0)
       : mLandMarkModel(landmarkmodel)
   {
-    init();
+    init(numThreads);
+    setFaceSizeRange(minFaceSize, maxFaceSize);
     if (!mLandMarkModel.empty() && jniutils::fileExists(mLandMarkModel))
     {
-      dlib::deserialize(mLandMarkModel) >> msp;
+      // a model converted by ConvertShapePredictor is mapped, not parsed
+      if (dlib::is_mapped_shape_predictor(mLandMarkModel))
+        dlib::load_mapped_shape_predictor(msp, mLandMarkModel);
+      else
+        dlib::deserialize(mLandMarkModel) >> msp;
       LOG(INFO) << "Load landmarkmodel from " << mLandMarkModel;
     }
   }
 
+  // Stops the pipeline first, so its worker is out of det() before anything
+  // it uses goes away
+  virtual ~DLibHOGFaceDetector() { stopPipeline(); }
+
   virtual inline int det(const std::string &path)
   {
     LOG(INFO) << "Read path from " << path;
@@ -236,7 +484,8 @@ public:
     return det(src_img);
   }
 
-  // The format of mat should be BGR or Gray
+  // The format of mat should be BGR or Gray. Gray is faster since the
+  // gradients come from one channel instead of the strongest of three.
   // If converting 4 channels to 3 channls because the format could be BGRA or
   // ARGB
   virtual inline int det(const cv::Mat &image)
@@ -246,34 +495,353 @@ public:
     LOG(INFO) << "com_nanyun_dlib_PeopleDet go to det(mat)";
     if (image.channels() == 1)
     {
-      cv::cvtColor(image, image, CV_GRAY2BGR);
+      // Gray input stays single channel through the pyramid, the FHOG
+      // gradients and the shape predictor's pixel sampling
+      dlib::cv_image<unsigned char> img(image);
+      return detImage(img);
     }
     CHECK(image.channels() == 3);
-    // TODO : Convert to gray image to speed up detection
-    // It's unnecessary to use color image for face/landmark detection
     dlib::cv_image<dlib::bgr_pixel> img(image);
-    mRets = mFaceDetector(img);
-    LOG(INFO) << "Dlib HOG face det size : " << mRets.size();
-    mFaceShapeMap.clear();
-    // Process shape
-    if (mRets.size() != 0 && mLandMarkModel.empty() == false)
+    return detImage(img);
+  }
+
+  // Detects straight on a luminance plane, e.g. the Y plane of a camera frame,
+  // without copying or converting it. The rectangles and landmarks are in the
+  // plane's pixel coordinates.
+  inline int det(const jnicommon::LumaImageView &image)
+  {
+    if (image.empty())
+      return 0;
+    return detImage(image);
+  }
+
+  // The results of the last det() in one array:
+  //   [0] number of faces
+  //   [1] number of landmarks per face
+  // followed by one record per face
+  //   left, top, right, bottom, score, x0, y0, x1, y1, ...
+  // A face without landmarks has its landmark slots set to -1.
+  static const int PACKED_HEADER_SIZE = 2;
+  static const int PACKED_RECT_SIZE = 5;
+
+  inline void getPackedResult(int size, std::vector<float> &packed)
+  {
+    const int numLandmarks = getNumLandmarks();
+    const int recordSize = PACKED_RECT_SIZE + 2 * numLandmarks;
+    packed.resize(PACKED_HEADER_SIZE + size * recordSize);
+    packed[0] = size;
+    packed[1] = numLandmarks;
+    for (int i = 0; i < size; i++)
     {
-      for (unsigned long j = 0; j < mRets.size(); ++j)
+      float *record = &packed[PACKED_HEADER_SIZE + i * recordSize];
+      record[0] = mRets[i].left();
+      record[1] = mRets[i].top();
+      record[2] = mRets[i].right();
+      record[3] = mRets[i].bottom();
+      record[4] = mScores[i];
+      float *points = record + PACKED_RECT_SIZE;
+      auto it = mFaceShapeMap.find(i);
+      for (int j = 0; j < numLandmarks; j++)
       {
-        dlib::full_object_detection shape = msp(img, mRets[j]);
-        LOG(INFO) << "face index:" << j
-                  << "number of parts: " << shape.num_parts();
-        mFaceShapeMap[j] = shape;
+        if (it != mFaceShapeMap.end() &&
+            (unsigned long)j < it->second.num_parts() &&
+            it->second.part(j) != dlib::OBJECT_PART_NOT_PRESENT)
+        {
+          points[2 * j] = it->second.part(j).x();
+          points[2 * j + 1] = it->second.part(j).y();
+        }
+        else
+        {
+          points[2 * j] = -1;
+          points[2 * j + 1] = -1;
+        }
       }
     }
-    int img_width = image.cols;
-    int img_height = image.rows;
-    resizeRet(img_width, img_height);
-    return mRets.size();
   }
 
+  // The pipeline worker holds this for each frame, from det() to the packed
+  // result. Any other thread must hold it around calls that read or change
+  // the detector while a pipeline may run: det(), the results, the liveness
+  // session and the setters. It must not be held around startPipeline() or
+  // stopPipeline(), which wait for the worker.
+  inline std::mutex &getLock() { return mLock; }
+
+  // Starts detecting on a worker thread, replacing any running pipeline.
+  // Frames of frameWidth x frameHeight go in with getPipeline()->submit() and
+  // packed results come out of poll(). With outWidth > 0 each frame first goes
+  // through getPreprocessor(). Returns false for a preprocessing geometry
+  // LumaPreprocessor refuses.
+  inline bool startPipeline(int numSlots, FramePipeline::DropPolicy policy,
+                            int frameWidth, int frameHeight, int rotation,
+                            int outWidth, int outHeight)
+  {
+    stopPipeline();
+    if (outWidth > 0 &&
+        !LumaPreprocessor().configure(1, 1, rotation, outWidth, outHeight))
+      return false;
+    std::shared_ptr<FramePipeline> pipeline = std::make_shared<FramePipeline>(
+        numSlots, policy,
+        [this, rotation, outWidth, outHeight](
+            const jnicommon::LumaImageView &frame, std::vector<float> &packed) {
+          std::lock_guard<std::mutex> lock(mLock);
+          int size;
+          if (outWidth > 0)
+            size = det(mPreprocessor.process(frame, rotation, outWidth,
+                                             outHeight));
+          else
+            size = det(frame);
+          getPackedResult(size, packed);
+        },
+        frameWidth, frameHeight);
+    {
+      std::lock_guard<std::mutex> lock(mPipelineLock);
+      mPipeline.swap(pipeline);
+    }
+    // another thread started one in between
+    if (pipeline)
+      pipeline->stop();
+    return true;
+  }
+
+  // Stops the worker after its current frame and waits for it
+  inline void stopPipeline()
+  {
+    std::shared_ptr<FramePipeline> pipeline;
+    {
+      std::lock_guard<std::mutex> lock(mPipelineLock);
+      mPipeline.swap(pipeline);
+    }
+    if (pipeline)
+      pipeline->stop();
+  }
+
+  // Empty unless startPipeline() was called. A pipeline stopped while the
+  // copy is held refuses frames.
+  inline std::shared_ptr<FramePipeline> getPipeline()
+  {
+    std::lock_guard<std::mutex> lock(mPipelineLock);
+    return mPipeline;
+  }
+
+  // With detectInterval > 1, det() runs the full HOG scan only on every
+  // detectInterval-th frame. In between it moves the box of the biggest face
+  // with a correlation tracker and runs only the shape predictor on it. A frame
+  // whose tracker confidence falls below minPsr gets the full scan at once.
+  // While tracking, det() reports only that one face, with the score it was
+  // detected with. detectInterval <= 1 runs the full scan on every frame.
+  //
+  // With regionScan, the scan every detectInterval-th frame first only looks
+  // around the tracked box, at the one to three pyramid levels of its size.
+  // That costs about the same at any camera resolution. The full scan runs
+  // only if it finds nothing there, so new faces are picked up once the
+  // tracked one is lost.
+  inline void setTracking(int detectInterval, double minPsr = DEFAULT_MIN_PSR,
+                          bool regionScan = true)
+  {
+    mDetectInterval = detectInterval < 1 ? 1 : detectInterval;
+    mMinPsr = minPsr;
+    mRegionScan = regionScan;
+    mTracking = false;
+  }
+
+  inline int getDetectInterval() const { return mDetectInterval; }
+
+  // The path the last det() took and, unless the tracker didn't run, its
+  // peak to sidelobe ratio on that frame
+  inline DetectPath getLastPath() const { return (DetectPath)mLastPath; }
+  inline double getLastPsr() const { return mLastPsr; }
+
+  // How many frames took each path since the last resetPathCounts()
+  inline long getPathCount(DetectPath path) const { return mPathCounts[path]; }
+  inline void resetPathCounts()
+  {
+    mPathCounts[PATH_DETECT] = 0;
+    mPathCounts[PATH_TRACK] = 0;
+    mPathCounts[PATH_REDETECT] = 0;
+    mPathCounts[PATH_REGION] = 0;
+  }
+
+  // Crops, rotates and scales camera frames for det(), reusing its buffer
+  inline LumaPreprocessor &getPreprocessor() { return mPreprocessor; }
+
   std::unordered_map<int, dlib::full_object_detection> &getFaceShapeMap()
   {
     return mFaceShapeMap;
   }
+
+  // The landmarks of the biggest face of the last frames, for the liveness
+  // challenges
+  inline LivenessSession &getLivenessSession() { return mLiveness; }
+
+  // The detection confidence of each face in getResult()
+  inline const std::vector<double> &getScores() const { return mScores; }
+
+  // The FacePose of each face of the last det()
+  inline const std::vector<int> &getPoses() const { return mPoses; }
+
+  inline int getNumLandmarks() const
+  {
+    return mLandMarkModel.empty() ? 0 : msp.num_parts();
+  }
+
+  // Only finds the landmarks the liveness checks read, 30 and 36 to 54, with
+  // the landmark model cut down to them at about 3/4 of the time per face.
+  // The shape is aligned by the nose and eye corners only. The kept landmarks
+  // move by 0.05 pixels on average, see TestLandmarkSubset; the others come out
+  // as -1. Off by default.
+  inline void setLandmarkSubset(bool subset)
+  {
+    if (subset && mSubsetSp.num_parts() == 0 &&
+        msp.num_parts() == (unsigned long)LivenessSession::NUM_LANDMARKS)
+    {
+      std::vector<unsigned long> parts(1, 30);
+      for (unsigned long j = 36; j <= 54; ++j)
+        parts.push_back(j);
+      const unsigned long rigid[] = {27, 28, 29, 30, 31, 33, 35, 36, 39, 42, 45};
+      mSubsetSp = msp.select_parts(
+          parts, std::vector<unsigned long>(rigid, rigid + 11));
+    }
+    mUseSubset = subset && mSubsetSp.num_parts() != 0;
+  }
+
+  inline bool getLandmarkSubset() const { return mUseSubset; }
+
+  // Starts the landmarks of each face from those of the face of the last frame
+  // whose box it is nearest, moved along with the box, and runs only the last
+  // levels of the cascade: minLevels when the box is still, more the more it
+  // moved. Once it moved by maxMotion, in box widths, the whole cascade runs.
+  // The landmarks then cost about a third as much on a steady face, see
+  // TestWarmStart. 0 turns it off, the default.
+  inline void setWarmStart(int minLevels, double maxMotion = DEFAULT_MAX_MOTION)
+  {
+    mWarmStartLevels = minLevels > 0 ? minLevels : 0;
+    mMaxMotion = maxMotion;
+  }
+
+  // Only looks for faces about minFaceSize to maxFaceSize pixels wide, in the
+  // coordinates of the image given to det(). The pyramid levels for smaller
+  // faces are never built: the image is scaled straight to the first useful
+  // level. 0 means no limit on that side.
+  inline void setFaceSizeRange(int minFaceSize, int maxFaceSize)
+  {
+    mFaceDetector.get_scanner().set_box_size_range(
+        minFaceSize > 0 ? minFaceSize : 0, maxFaceSize > 0 ? maxFaceSize : 0);
+  }
+
+  inline int getMinFaceSize() const
+  {
+    return mFaceDetector.get_scanner().get_min_box_size();
+  }
+
+  inline int getMaxFaceSize() const
+  {
+    return mFaceDetector.get_scanner().get_max_box_size();
+  }
+
+  inline int getNumThreads() const
+  {
+    return mThreadPool->num_threads_in_pool();
+  }
+
+  // Builds each pyramid level right before its features and drops it right
+  // after, so about half the pixel memory is held at once on big frames. The
+  // faces are the same either way.
+  inline void setStreamingPyramid(bool stream)
+  {
+    mFaceDetector.get_scanner().set_streaming_pyramid(stream);
+  }
+
+  // Applies all the separable HOG filters to a block of rows before moving on
+  // to the next, with NEON on ARM. Off by default, which applies one filter at
+  // a time over the whole level.
+  inline void setFusedFilterBank(bool fused)
+  {
+    mFaceDetector.get_scanner().set_fused_filter_bank(fused);
+  }
+
+  // Scores the 16 strongest separable HOG filters of each detector everywhere
+  // and the rest only where the face score can still reach the threshold. The
+  // bounds come from dlib::get_frontal_face_cascades(), which are calibrated on
+  // only 12 example faces, so they are examples only. Off by default.
+  inline void setCascadeScoring(bool cascade)
+  {
+    mFaceDetector.get_scanner().set_cascade_scoring(cascade);
+  }
+
+  // Suppresses the overlapping windows of each pyramid level once its bands of
+  // rows are merged, with the detector's own overlap test. Only worth it with very low
+  // thresholds, where the faces can then differ a little. Off by default.
+  inline void setLevelSuppression(bool suppress)
+  {
+    mFaceDetector.get_scanner().set_level_suppression(
+        suppress, mFaceDetector.get_overlap_tester());
+  }
+
+  // Runs the filters over int16 features and taps, for the NEON builds. The
+  // faces are the same to about 1e-4 of their scores. Off by default.
+  inline void setFixedPoint(bool fixed)
+  {
+    mFaceDetector.get_scanner().set_fixed_point(fixed);
+  }
+
+  // How many windows reached each stage of the cascade in the last full scan
+  inline const dlib::fhog_cascade_stats &getCascadeStats() const
+  {
+    return mFaceDetector.get_scanner().get_cascade_stats();
+  }
+
+  // Only runs the filters of the poses in poseMask, one bit per FacePose, e.g.
+  // (1 << POSE_FRONTAL) | (1 << POSE_LEFT) while a turn-left challenge is on.
+  // Each filter left out saves about a fifth of the filter time of a scan.
+  inline void setEnabledPoses(int poseMask)
+  {
+    if ((poseMask & ALL_POSES) == ALL_POSES)
+    {
+      mFaceDetector.enable_all_detectors();
+      return;
+    }
+    std::vector<unsigned long> poses;
+    for (int pose = 0; pose < NUM_POSES; ++pose)
+    {
+      if (poseMask & (1 << pose))
+        poses.push_back(pose);
+    }
+    mFaceDetector.set_enabled_detectors(poses);
+  }
+
+  inline int getEnabledPoses() const
+  {
+    int poseMask = 0;
+    for (int pose = 0; pose < NUM_POSES; ++pose)
+    {
+      if (mFaceDetector.is_detector_enabled(pose))
+        poseMask |= 1 << pose;
+    }
+    return poseMask;
+  }
+
+  // The time and the windows over threshold of each pose filter, by FacePose,
+  // since the last resetPoseStats()
+  inline const std::vector<dlib::detector_filter_stats> &getPoseStats() const
+  {
+    return mFaceDetector.get_filter_stats();
+  }
+
+  inline void resetPoseStats() { mFaceDetector.reset_filter_stats(); }
+
+  // How the feature extraction of the last full scan was spread over the
+  // threads: big pyramid levels are cut into bands of rows, small ones go
+  // whole.
+  inline const dlib::fhog_thread_stats &getFhogThreadStats() const
+  {
+    return mFaceDetector.get_scanner().get_thread_stats();
+  }
+
+  // The HOG scanner keeps its pyramid, histogram and filter buffers from frame
+  // to frame, sized by the biggest frame so far. Once num_grows stops going up
+  // a detection doesn't allocate.
+  inline const dlib::fhog_workspace_stats &getWorkspaceStats() const
+  {
+    return mFaceDetector.get_scanner().get_workspace_stats();
+  }
 };
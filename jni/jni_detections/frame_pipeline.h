@@ -0,0 +1,329 @@
+/*
+ * frame_pipeline.h using google-style
+ *
+ *  Created on: May 24, 2016
+ *      Author: Nanyun
+ *
+ *  Copyright (c) 2016 Nanyun. All rights reserved.
+ */
+
+#pragma once
+
+#include <jni_common/luma_image.h>
+#include <jni_common/types.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// One writer publishes, one reader takes the latest, and neither ever waits
+// for the other. The writer fills back(), publish() swaps it with the middle
+// buffer, and the reader's update() swaps the middle buffer with front() if
+// something new was published since.
+template <typename T>
+class TripleBuffer
+{
+public:
+  TripleBuffer() : mMiddle(1), mBack(0), mFront(2) {}
+
+  inline T &back() { return mBuffers[mBack]; }
+
+  inline void publish()
+  {
+    mBack = mMiddle.exchange(mBack | kFresh, std::memory_order_acq_rel) &
+            kIndex;
+  }
+
+  // Returns false if nothing was published since the last update()
+  inline bool update()
+  {
+    if (!(mMiddle.load(std::memory_order_acquire) & kFresh))
+      return false;
+    mFront = mMiddle.exchange(mFront, std::memory_order_acq_rel) & kIndex;
+    return true;
+  }
+
+  inline const T &front() const { return mBuffers[mFront]; }
+
+private:
+  static const int kIndex = 3;
+  static const int kFresh = 4;
+  T mBuffers[3];
+  std::atomic<int> mMiddle;
+  int mBack;
+  int mFront;
+};
+
+// Runs detection on a worker thread so the camera thread only pays for a copy.
+// submit() copies a Y plane into one of a fixed set of slots, allocated for
+// the frame size given to the constructor, and returns at once. The worker
+// runs the work function on the slots and publishes each result through a
+// TripleBuffer, where poll() picks up the newest without locking.
+//
+// The slot bookkeeping takes a mutex for a few instructions, never during a
+// copy or a detection. When every slot is taken the drop policy decides which
+// frame goes: DROP_OLDEST replaces the oldest waiting frame, and the worker
+// skips straight to the newest one, so results stay as fresh as possible.
+// DROP_NEWEST refuses the new frame, and the worker takes frames in order.
+class FramePipeline
+{
+public:
+  enum DropPolicy
+  {
+    DROP_OLDEST = 0,
+    DROP_NEWEST = 1
+  };
+
+  struct Result
+  {
+    Result() : frameId(-1) {}
+    long frameId;
+    std::vector<float> values;
+  };
+
+  struct Stats
+  {
+    long submitted;
+    long dropped;
+    long processed;
+  };
+
+  // Called on the worker thread, one frame at a time
+  typedef std::function<void(const jnicommon::LumaImageView &frame,
+                             std::vector<float> &values)>
+      Work;
+
+  static const int MIN_SLOTS = 2;
+
+  // Each slot holds a frameWidth x frameHeight plane from the start, so
+  // submit() only allocates for a bigger frame
+  FramePipeline(int numSlots, DropPolicy policy, const Work &work,
+                int frameWidth = 0, int frameHeight = 0)
+      : mSlots(numSlots < MIN_SLOTS ? MIN_SLOTS : numSlots), mPolicy(policy),
+        mWork(work), mNextFrameId(0), mSubmitted(0), mDropped(0),
+        mProcessed(0), mStop(false)
+  {
+    if (frameWidth > 0 && frameHeight > 0)
+      for (Slot &slot : mSlots)
+        slot.pixels.resize((size_t)frameWidth * frameHeight);
+    mWorker = std::thread(&FramePipeline::run, this);
+  }
+
+  ~FramePipeline() { stop(); }
+
+  // Stops the worker after the frame it is on and waits for it. Waiting
+  // frames are dropped and later submits refused. Once this returns the work
+  // function is never called again, though other threads may still submit and
+  // poll. Only one thread may call it.
+  inline void stop()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mStop = true;
+    }
+    mWakeWorker.notify_one();
+    if (mWorker.joinable())
+      mWorker.join();
+  }
+
+  // Copies the plane into a free slot and returns its frame id, or -1 if the
+  // drop policy refused it or the pipeline was stopped
+  inline long submit(const jnicommon::LumaImageView &frame)
+  {
+    if (frame.empty())
+      return -1;
+    Slot *slot = NULL;
+    long frameId;
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      if (mStop)
+        return -1;
+      ++mSubmitted;
+      slot = findSlot(FREE, false);
+      if (slot == NULL && mPolicy == DROP_OLDEST)
+      {
+        slot = findSlot(READY, false);
+        if (slot != NULL)
+          ++mDropped;
+      }
+      if (slot == NULL)
+      {
+        ++mDropped;
+        return -1;
+      }
+      slot->state = FILLING;
+      frameId = mNextFrameId++;
+    }
+
+    const int width = frame.width();
+    const int height = frame.height();
+    slot->pixels.resize((size_t)width * height);
+    for (int r = 0; r < height; ++r)
+      memcpy(&slot->pixels[(size_t)r * width],
+             frame.data() + (long)r * frame.rowStride(), width);
+    slot->width = width;
+    slot->height = height;
+    slot->frameId = frameId;
+
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      if (mStop)
+      {
+        // stop() came during the copy and the worker is gone
+        slot->state = FREE;
+        ++mDropped;
+        mIdle.notify_all();
+        return -1;
+      }
+      slot->state = READY;
+    }
+    mWakeWorker.notify_one();
+    return frameId;
+  }
+
+  // The newest result if one was finished since the last poll, else NULL.
+  // The result stays valid until the next poll. Only one thread may poll.
+  inline const Result *poll()
+  {
+    return mResults.update() ? &mResults.front() : NULL;
+  }
+
+  // Waits until every submitted frame was processed or dropped
+  inline void drain()
+  {
+    std::unique_lock<std::mutex> lock(mMutex);
+    mIdle.wait(lock, [this] { return !hasWork(); });
+  }
+
+  inline Stats getStats()
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    Stats stats = {mSubmitted, mDropped, mProcessed};
+    return stats;
+  }
+
+  inline int getNumSlots() const { return (int)mSlots.size(); }
+
+  inline DropPolicy getDropPolicy() const { return mPolicy; }
+
+private:
+  enum SlotState
+  {
+    FREE,
+    FILLING,
+    READY,
+    BUSY
+  };
+
+  struct Slot
+  {
+    Slot() : state(FREE), frameId(-1), width(0), height(0) {}
+    SlotState state;
+    long frameId;
+    int width;
+    int height;
+    std::vector<jnicommon::uint8> pixels;
+  };
+
+  // The slot in the state with the lowest frame id, or the highest if newest
+  inline Slot *findSlot(SlotState state, bool newest)
+  {
+    Slot *found = NULL;
+    for (Slot &slot : mSlots)
+    {
+      if (slot.state != state)
+        continue;
+      if (found == NULL || (newest ? slot.frameId > found->frameId
+                                   : slot.frameId < found->frameId))
+        found = &slot;
+    }
+    return found;
+  }
+
+  inline bool hasWork() const
+  {
+    for (const Slot &slot : mSlots)
+      if (slot.state != FREE)
+        return true;
+    return false;
+  }
+
+  inline void run()
+  {
+    for (;;)
+    {
+      Slot *slot = NULL;
+      {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mWakeWorker.wait(lock, [this] {
+          return mStop || findSlot(READY, false) != NULL;
+        });
+        if (mStop)
+          break;
+        if (mPolicy == DROP_OLDEST)
+        {
+          // Frames older than the newest one are stale
+          slot = findSlot(READY, true);
+          for (Slot &other : mSlots)
+          {
+            if (&other != slot && other.state == READY)
+            {
+              other.state = FREE;
+              ++mDropped;
+            }
+          }
+        }
+        else
+        {
+          slot = findSlot(READY, false);
+        }
+        slot->state = BUSY;
+      }
+
+      Result &result = mResults.back();
+      result.frameId = slot->frameId;
+      mWork(jnicommon::LumaImageView(&slot->pixels[0], slot->width,
+                                     slot->height, slot->width),
+            result.values);
+      mResults.publish();
+
+      {
+        std::lock_guard<std::mutex> lock(mMutex);
+        slot->state = FREE;
+        ++mProcessed;
+        if (!hasWork())
+          mIdle.notify_all();
+      }
+    }
+
+    // Let drain() return once the worker is gone
+    std::lock_guard<std::mutex> lock(mMutex);
+    for (Slot &slot : mSlots)
+    {
+      if (slot.state == READY)
+      {
+        slot.state = FREE;
+        ++mDropped;
+      }
+    }
+    mIdle.notify_all();
+  }
+
+  std::vector<Slot> mSlots;
+  const DropPolicy mPolicy;
+  Work mWork;
+  TripleBuffer<Result> mResults;
+
+  std::mutex mMutex;
+  std::condition_variable mWakeWorker;
+  std::condition_variable mIdle;
+  long mNextFrameId;
+  long mSubmitted;
+  long mDropped;
+  long mProcessed;
+  bool mStop;
+  std::thread mWorker;
+};
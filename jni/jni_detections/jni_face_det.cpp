@@ -12,6 +12,7 @@
 #include <jni_common/jni_fileutils.h>
 #include <jni_common/jni_utils.h>
 #include <detector.h>
+#include <jni_face_det.h>
 #include <jni.h>
 
 using namespace cv;
@@ -104,306 +105,86 @@ jobjectArray getDetectResult(JNIEnv *env, DetectorPtr faceDetector,
                              const int &size)
 {
         LOG(INFO) << "getFaceRet";
-        jobjectArray jDetRetArray = JNI_VisionDetRet::createJObjectArray(env, size);
+        jobjectArray jDetRetArray = g_pJNI_VisionDetRet->createJObjectArray(env, size);
+        const std::vector<dlib::rectangle> &rects = faceDetector->getResult();
+        const std::unordered_map<int, dlib::full_object_detection> &faceShapeMap =
+            faceDetector->getFaceShapeMap();
         for (int i = 0; i < size; i++)
         {
-                jobject jDetRet = JNI_VisionDetRet::createJObject(env);
+                jobject jDetRet = g_pJNI_VisionDetRet->createJObject(env);
                 env->SetObjectArrayElement(jDetRetArray, i, jDetRet);
-                dlib::rectangle rect = faceDetector->getResult()[i];
+                const dlib::rectangle &rect = rects[i];
                 g_pJNI_VisionDetRet->setRect(env, jDetRet, rect.left(), rect.top(),
                                              rect.right(), rect.bottom());
                 g_pJNI_VisionDetRet->setLabel(env, jDetRet, "face");
-                std::unordered_map<int, dlib::full_object_detection> &faceShapeMap =
-                    faceDetector->getFaceShapeMap();
-                if (faceShapeMap.find(i) != faceShapeMap.end())
+                auto it = faceShapeMap.find(i);
+                if (it != faceShapeMap.end())
                 {
-                        dlib::full_object_detection shape = faceShapeMap[i];
+                        const dlib::full_object_detection &shape = it->second;
                         for (unsigned long j = 0; j < shape.num_parts(); j++)
                         {
-                                int x = shape.part(j).x();
-                                int y = shape.part(j).y();
+                                // Parts a cut down model doesn't find are -1, as in
+                                // the packed results
+                                int x = -1;
+                                int y = -1;
+                                if (shape.part(j) != dlib::OBJECT_PART_NOT_PRESENT)
+                                {
+                                        x = shape.part(j).x();
+                                        y = shape.part(j).y();
+                                }
                                 // Call addLandmark
                                 g_pJNI_VisionDetRet->addLandmark(env, jDetRet, x, y);
                         }
                 }
+                env->DeleteLocalRef(jDetRet);
         }
         return jDetRetArray;
 }
 
-bool rightRotate(std::vector<std::vector<InnerPoint>> &points)
+jfloatArray newFloatArray(JNIEnv *env, const std::vector<float> &values)
 {
-        int size = points.size();
-        int frame = 0;
-        int mStartNumRight = 0;
-        float resizeRatio = 1;
-        int mStartNumRightTemp = 0;
-        int mStartNumLeftTemp = 0;
-        int temp_x;
-        int temp_y;
-        double RDetect;
-        float gap_threshold = 2;
-
-        InnerPoint right_pupil;
-        InnerPoint left_pupil;
-
-        for (int i = 0; i < size; i++)
-        {
-                std::vector<InnerPoint> &face_points = (points[i]);
-
-                // Face landmanr result
-                temp_x = 0;
-                temp_y = 0;
-                for (int j = 36; j < 42; j++)
-                {
-                        temp_x = temp_x + (int)(face_points[j].x * resizeRatio);
-                        temp_y = temp_y + (int)(face_points[j].y * resizeRatio);
-                }
-                left_pupil.x = temp_x / 6;
-                left_pupil.y = temp_y / 6;
-
-                temp_x = 0;
-                temp_y = 0;
-
-                for (int j = 42; j < 48; j++)
-                {
-                        temp_x = temp_x + (int)(face_points[j].x * resizeRatio);
-                        temp_y = temp_y + (int)(face_points[j].y * resizeRatio);
-                }
-                right_pupil.x = temp_x / 6;
-                right_pupil.y = temp_y / 6;
-
-                mStartNumRightTemp = abs(right_pupil.x - face_points[30].x);
-                mStartNumLeftTemp = abs(face_points[30].x - left_pupil.x);
-
-                if (fabs(mStartNumRightTemp / (float)mStartNumLeftTemp - 1) < fabs(gap_threshold - 1.0))
-                {
-                        gap_threshold = mStartNumRightTemp / (float)mStartNumLeftTemp;
-                        mStartNumRight = mStartNumRightTemp;
-                }
-        }
-        if (gap_threshold > 1.2 || gap_threshold < 0.8)
-        {
-                return false;
-        }
-
-        for (int i = 0; i < size; i++)
-        {
-                std::vector<InnerPoint> &face_points = (points[i]);
-
-                // Face landmanr result
-                temp_x = 0;
-                temp_y = 0;
-                for (int j = 36; j < 42; j++)
-                {
-                        temp_x = temp_x + (int)(face_points[j].x * resizeRatio);
-                        temp_y = temp_y + (int)(face_points[j].y * resizeRatio);
-                }
-                left_pupil.x = temp_x / 6;
-                left_pupil.y = temp_y / 6;
-
-                temp_x = 0;
-                temp_y = 0;
-
-                for (int j = 42; j < 48; j++)
-                {
-                        temp_x = temp_x + (int)(face_points[j].x * resizeRatio);
-                        temp_y = temp_y + (int)(face_points[j].y * resizeRatio);
-                }
-                right_pupil.x = temp_x / 6;
-                right_pupil.y = temp_y / 6;
-
-                face_points[30].x = (int)(face_points[30].x * resizeRatio);
-
-                RDetect = abs(right_pupil.x - face_points[30].x) / (float)(mStartNumRight);
-                if (RDetect < 0.5)
-                {
-                        frame += 1;
-                }
-        }
-        int threshold = 2;
-        if (threshold < 1)
-                threshold = 1;
-        if (frame >= threshold)
-        {
-                return true;
-        }
-        return false;
+        jfloatArray jValues = env->NewFloatArray(values.size());
+        if (jValues != NULL && !values.empty())
+                env->SetFloatArrayRegion(jValues, 0, values.size(), &values[0]);
+        return jValues;
 }
 
-bool leftRotate(std::vector<std::vector<InnerPoint>> &points)
+// The last det() as one float[], laid out as described at
+// DLibHOGFaceDetector::getPackedResult()
+jfloatArray getPackedDetectResult(JNIEnv *env, DetectorPtr faceDetector,
+                                  const int &size)
 {
-        int size = points.size();
-        int frame = 0;
-        int mStartNumLeft = 0;
-        float resizeRatio = 1;
-        int mStartNumRightTemp = 0;
-        int mStartNumLeftTemp = 0;
-        int temp_x;
-        int temp_y;
-        double LDetect;
-        float gap_threshold = 2;
-
-        InnerPoint right_pupil;
-        InnerPoint left_pupil;
-
-        for (int i = 0; i < size; i++)
-        {
-                std::vector<InnerPoint> &face_points = (points[i]);
-
-                // Face landmanr result
-                temp_x = 0;
-                temp_y = 0;
-                for (int j = 36; j < 42; j++)
-                {
-                        temp_x = temp_x + (int)(face_points[j].x * resizeRatio);
-                        temp_y = temp_y + (int)(face_points[j].y * resizeRatio);
-                }
-                left_pupil.x = temp_x / 6;
-                left_pupil.y = temp_y / 6;
-
-                temp_x = 0;
-                temp_y = 0;
-
-                for (int j = 42; j < 48; j++)
-                {
-                        temp_x = temp_x + (int)(face_points[j].x * resizeRatio);
-                        temp_y = temp_y + (int)(face_points[j].y * resizeRatio);
-                }
-                right_pupil.x = temp_x / 6;
-                right_pupil.y = temp_y / 6;
-
-                mStartNumRightTemp = abs(right_pupil.x - face_points[30].x);
-                mStartNumLeftTemp = abs(face_points[30].x - left_pupil.x);
-
-                if (fabs(mStartNumRightTemp / (float)mStartNumLeftTemp - 1) < fabs(gap_threshold - 1.0))
-                {
-                        gap_threshold = mStartNumRightTemp / (float)mStartNumLeftTemp;
-                        mStartNumLeft = mStartNumLeftTemp;
-                }
-        }
-
-        if (gap_threshold > 1.2 || gap_threshold < 0.8)
-        {
-
-                return false;
-        }
-
-        for (int i = 0; i < size; i++)
-        {
-                std::vector<InnerPoint> &face_points = (points[i]);
-
-                // Face landmanr result
-                temp_x = 0;
-                temp_y = 0;
-                for (int j = 36; j < 42; j++)
-                {
-                        temp_x = temp_x + (int)(face_points[j].x * resizeRatio);
-                        temp_y = temp_y + (int)(face_points[j].y * resizeRatio);
-                }
-                left_pupil.x = temp_x / 6;
-                left_pupil.y = temp_y / 6;
-
-                temp_x = 0;
-                temp_y = 0;
-
-                for (int j = 42; j < 48; j++)
-                {
-                        temp_x = temp_x + (int)(face_points[j].x * resizeRatio);
-                        temp_y = temp_y + (int)(face_points[j].y * resizeRatio);
-                }
-                right_pupil.x = temp_x / 6;
-                right_pupil.y = temp_y / 6;
-
-                face_points[30].x = (int)(face_points[30].x * resizeRatio);
-
-                LDetect = abs(face_points[30].x - left_pupil.x) / (float)(mStartNumLeft);
-                if (LDetect < 0.5)
-                {
-                        frame += 1;
-                }
-        }
-        int threshold = 2;
-        if (threshold < 1)
-                threshold = 1;
-        if (frame >= threshold)
-        {
-                return true;
-        }
-        return false;
-}
-
-double getDistance(InnerPoint p1, InnerPoint p2)
-{
-        return sqrt((p2.x - p1.x) * (p2.x - p1.x) + (p2.y - p1.y) * (p2.y - p1.y));
-}
-
-double ear(InnerPoint p1, InnerPoint p2, InnerPoint p3, InnerPoint p4, InnerPoint p5, InnerPoint p6)
-{
-        return (getDistance(p2, p6) + getDistance(p3, p5)) / (2 * getDistance(p1, p4));
-}
-
-bool eyeClosed(std::vector<std::vector<InnerPoint>> &points)
-{
-        int size = points.size();
-        int frame = 0;
-        int mStartNumLeft = 0;
-        int mStartNumRight = 0;
-        float resizeRatio = 1;
-
-        for (int i = 0; i < size; i++)
-        {
-                std::vector<InnerPoint> &face_points = points[i];
-
-                face_points[30].x = (int)(face_points[30].x * resizeRatio);
-                face_points[48].x = (int)(face_points[48].x * resizeRatio);
-                face_points[54].x = (int)(face_points[54].x * resizeRatio);
-
-                face_points[30].y = (int)(face_points[30].y * resizeRatio);
-                face_points[48].y = (int)(face_points[48].y * resizeRatio);
-                face_points[54].y = (int)(face_points[54].y * resizeRatio);
-
-                // Eye detection
-                double rightEAR = ear(face_points[36],
-                                      face_points[37], face_points[38],
-                                      face_points[39], face_points[40],
-                                      face_points[41]) *
-                                  resizeRatio;
-                double leftEAR = ear(face_points[42],
-                                     face_points[43], face_points[44],
-                                     face_points[45], face_points[46],
-                                     face_points[47]) *
-                                 resizeRatio;
-                double earAve = (rightEAR + leftEAR) / 2;
-                if (earAve < 0.2)
-                        frame += 1;
-        }
-        int threshold = 1;
-        if (threshold < 1)
-                threshold = 1;
-        if (frame >= threshold)
-        {
-                return true;
-        }
-        return false;
+        std::vector<float> packed;
+        faceDetector->getPackedResult(size, packed);
+        return newFloatArray(env, packed);
 }
 
-JNIEXPORT jboolean JNICALL
-    DLIB_FACE_JNI_METHOD(rightRotateEx)(JNIEnv *env, jobject thiz,
-                                        jobjectArray arrayList)
+// Reads the landmarks of an ArrayList of VisionDetRet
+void getLandmarkHistory(JNIEnv *env, jobject arrayList,
+                        std::vector<std::vector<InnerPoint>> &Rlt)
 {
-        LOG(INFO) << "rightRotateEx";
-        jclass java_util_ArrayList = static_cast<jclass>(env->NewGlobalRef(env->FindClass("java/util/ArrayList")));
+        jclass java_util_ArrayList = env->FindClass("java/util/ArrayList");
         CHECK_NOTNULL(java_util_ArrayList);
         auto java_util_ArrayList_size = env->GetMethodID(java_util_ArrayList, "size", "()I");
         auto java_util_ArrayList_get = env->GetMethodID(java_util_ArrayList, "get", "(I)Ljava/lang/Object;");
+        env->DeleteLocalRef(java_util_ArrayList);
         jint size = env->CallIntMethod(arrayList, java_util_ArrayList_size);
-        std::vector<std::vector<InnerPoint>> Rlt(size);
+        Rlt.resize(size);
         for (jint i = 0; i < size; i++)
         {
                 jobject visonRet = env->CallObjectMethod(arrayList, java_util_ArrayList_get, i);
                 g_pJNI_VisionDetRet->getLandmark(env, visonRet, Rlt[i]);
                 env->DeleteLocalRef(visonRet);
         }
+}
+
+JNIEXPORT jboolean JNICALL
+    DLIB_FACE_JNI_METHOD(rightRotateEx)(JNIEnv *env, jobject thiz,
+                                        jobjectArray arrayList)
+{
+        LOG(INFO) << "rightRotateEx";
+        std::vector<std::vector<InnerPoint>> Rlt;
+        getLandmarkHistory(env, arrayList, Rlt);
 
         auto is_right = rightRotate(Rlt);
         LOG(INFO) << "rightRotateEx result: " << is_right;
@@ -415,18 +196,8 @@ JNIEXPORT jboolean JNICALL
                                        jobjectArray arrayList)
 {
         LOG(INFO) << "leftRotate";
-        jclass java_util_ArrayList = static_cast<jclass>(env->NewGlobalRef(env->FindClass("java/util/ArrayList")));
-        CHECK_NOTNULL(java_util_ArrayList);
-        auto java_util_ArrayList_size = env->GetMethodID(java_util_ArrayList, "size", "()I");
-        auto java_util_ArrayList_get = env->GetMethodID(java_util_ArrayList, "get", "(I)Ljava/lang/Object;");
-        jint size = env->CallIntMethod(arrayList, java_util_ArrayList_size);
-        std::vector<std::vector<InnerPoint>> Rlt(size);
-        for (jint i = 0; i < size; i++)
-        {
-                jobject visonRet = env->CallObjectMethod(arrayList, java_util_ArrayList_get, i);
-                g_pJNI_VisionDetRet->getLandmark(env, visonRet, Rlt[i]);
-                env->DeleteLocalRef(visonRet);
-        }
+        std::vector<std::vector<InnerPoint>> Rlt;
+        getLandmarkHistory(env, arrayList, Rlt);
 
         auto is_right = leftRotate(Rlt);
         LOG(INFO) << "rightRotateEx result: " << is_right;
@@ -438,24 +209,50 @@ JNIEXPORT jboolean JNICALL
                                       jobjectArray arrayList)
 {
         LOG(INFO) << "leftRotate";
-        jclass java_util_ArrayList = static_cast<jclass>(env->NewGlobalRef(env->FindClass("java/util/ArrayList")));
-        CHECK_NOTNULL(java_util_ArrayList);
-        auto java_util_ArrayList_size = env->GetMethodID(java_util_ArrayList, "size", "()I");
-        auto java_util_ArrayList_get = env->GetMethodID(java_util_ArrayList, "get", "(I)Ljava/lang/Object;");
-        jint size = env->CallIntMethod(arrayList, java_util_ArrayList_size);
-        std::vector<std::vector<InnerPoint>> Rlt(size);
-        for (jint i = 0; i < size; i++)
-        {
-                jobject visonRet = env->CallObjectMethod(arrayList, java_util_ArrayList_get, i);
-                g_pJNI_VisionDetRet->getLandmark(env, visonRet, Rlt[i]);
-                env->DeleteLocalRef(visonRet);
-        }
+        std::vector<std::vector<InnerPoint>> Rlt;
+        getLandmarkHistory(env, arrayList, Rlt);
 
         auto is_right = eyeClosed(Rlt);
         LOG(INFO) << "rightRotateEx result: " << is_right;
         return is_right;
 }
 
+// The liveness challenges on the history the detector keeps itself. Every
+// detect call with a landmark model adds the biggest face to it.
+JNIEXPORT void JNICALL
+    DLIB_FACE_JNI_METHOD(jniLivenessReset)(JNIEnv *env, jobject thiz,
+                                           jint capacity)
+{
+        LOG(INFO) << "jniLivenessReset " << capacity;
+        DetectorPtr detPtr = getDetectorPtr(env, thiz);
+        std::lock_guard<std::mutex> lock(detPtr->getLock());
+        detPtr->getLivenessSession().reset(capacity);
+}
+
+JNIEXPORT jboolean JNICALL
+    DLIB_FACE_JNI_METHOD(jniLivenessRightRotate)(JNIEnv *env, jobject thiz)
+{
+        DetectorPtr detPtr = getDetectorPtr(env, thiz);
+        std::lock_guard<std::mutex> lock(detPtr->getLock());
+        return detPtr->getLivenessSession().rightRotate();
+}
+
+JNIEXPORT jboolean JNICALL
+    DLIB_FACE_JNI_METHOD(jniLivenessLeftRotate)(JNIEnv *env, jobject thiz)
+{
+        DetectorPtr detPtr = getDetectorPtr(env, thiz);
+        std::lock_guard<std::mutex> lock(detPtr->getLock());
+        return detPtr->getLivenessSession().leftRotate();
+}
+
+JNIEXPORT jboolean JNICALL
+    DLIB_FACE_JNI_METHOD(jniLivenessEyeClosed)(JNIEnv *env, jobject thiz)
+{
+        DetectorPtr detPtr = getDetectorPtr(env, thiz);
+        std::lock_guard<std::mutex> lock(detPtr->getLock());
+        return detPtr->getLivenessSession().eyeClosed();
+}
+
 JNIEXPORT jobjectArray JNICALL
     DLIB_FACE_JNI_METHOD(jniDetect)(JNIEnv *env, jobject thiz,
                                     jstring imgPath)
@@ -463,6 +260,7 @@ JNIEXPORT jobjectArray JNICALL
         LOG(INFO) << "jniFaceDet";
         const char *img_path = env->GetStringUTFChars(imgPath, 0);
         DetectorPtr detPtr = getDetectorPtr(env, thiz);
+        std::lock_guard<std::mutex> lock(detPtr->getLock());
         int size = detPtr->det(std::string(img_path));
         env->ReleaseStringUTFChars(imgPath, img_path);
         LOG(INFO) << "det face size: " << size;
@@ -479,6 +277,7 @@ JNIEXPORT jobjectArray JNICALL
         jniutils::ConvertBitmapToRGBAMat(env, bitmap, rgbaMat, true);
         cv::cvtColor(rgbaMat, bgrMat, cv::COLOR_RGBA2BGR);
         DetectorPtr detPtr = getDetectorPtr(env, thiz);
+        std::lock_guard<std::mutex> lock(detPtr->getLock());
         jint size = detPtr->det(bgrMat);
 #if 0
   cv::Mat rgbMat;
@@ -489,6 +288,46 @@ JNIEXPORT jobjectArray JNICALL
         return getDetectResult(env, detPtr, size);
 }
 
+// Wraps the direct buffer as a luminance view, or throws
+// IllegalArgumentException and returns false if it can't hold the plane
+bool getYPlaneView(JNIEnv *env, jobject yBuffer, jint width, jint height,
+                   jint rowStride, jnicommon::LumaImageView &yView)
+{
+        const jnicommon::uint8 *yPlane =
+            (const jnicommon::uint8 *)env->GetDirectBufferAddress(yBuffer);
+        const jlong capacity = env->GetDirectBufferCapacity(yBuffer);
+        if (yPlane == NULL || width <= 0 || height <= 0 || rowStride < width ||
+            capacity < jnicommon::LumaImageView::requiredCapacity(width, height,
+                                                                  rowStride))
+        {
+                jclass iaeClass = env->FindClass("java/lang/IllegalArgumentException");
+                env->ThrowNew(iaeClass, "yBuffer must be a direct buffer holding a "
+                                        "width x height plane with rowStride");
+                return false;
+        }
+        yView = jnicommon::LumaImageView(yPlane, width, height, rowStride);
+        return true;
+}
+
+// yBuffer is the Y plane of a YUV_420_888 camera image as a direct ByteBuffer,
+// e.g. Image.getPlanes()[0].getBuffer(), and rowStride its getRowStride().
+// The plane is used in place, with no conversion to RGB.
+JNIEXPORT jobjectArray JNICALL
+    DLIB_FACE_JNI_METHOD(jniYPlaneDetect)(JNIEnv *env, jobject thiz,
+                                          jobject yBuffer, jint width,
+                                          jint height, jint rowStride)
+{
+        LOG(INFO) << "jniYPlaneDetect";
+        jnicommon::LumaImageView yView;
+        if (!getYPlaneView(env, yBuffer, width, height, rowStride, yView))
+                return NULL;
+        DetectorPtr detPtr = getDetectorPtr(env, thiz);
+        std::lock_guard<std::mutex> lock(detPtr->getLock());
+        jint size = detPtr->det(yView);
+        LOG(INFO) << "det face size: " << size;
+        return getDetectResult(env, detPtr, size);
+}
+
 jint JNIEXPORT JNICALL DLIB_FACE_JNI_METHOD(jniInit)(JNIEnv *env, jobject thiz,
                                                      jstring jLandmarkPath)
 {
@@ -504,6 +343,10 @@ jint JNIEXPORT JNICALL
     DLIB_FACE_JNI_METHOD(jniDeInit)(JNIEnv *env, jobject thiz)
 {
         LOG(INFO) << "jniDeInit";
+        // The worker is joined before the detector it runs on is deleted
+        DetectorPtr detPtr = getDetectorPtr(env, thiz);
+        if (detPtr != JAVA_NULL)
+                detPtr->stopPipeline();
         setDetectorPtr(env, thiz, JAVA_NULL);
         return JNI_OK;
 }
@@ -511,3 +354,264 @@ jint JNIEXPORT JNICALL
 #ifdef __cplusplus
 }
 #endif
+
+// The packed variants below return getPackedDetectResult() instead of
+// VisionDetRet objects, so a frame costs the same few JNI crossings however
+// many faces and landmarks it has. They are bound by registerFaceDetNatives()
+// at JNI_OnLoad rather than by symbol name.
+static jfloatArray packedYPlaneDetect(JNIEnv *env, jobject thiz,
+                                      jobject yBuffer, jint width, jint height,
+                                      jint rowStride)
+{
+        jnicommon::LumaImageView yView;
+        if (!getYPlaneView(env, yBuffer, width, height, rowStride, yView))
+                return NULL;
+        DetectorPtr detPtr = getDetectorPtr(env, thiz);
+        std::lock_guard<std::mutex> lock(detPtr->getLock());
+        jint size = detPtr->det(yView);
+        return getPackedDetectResult(env, detPtr, size);
+}
+
+// The same on the frame cropped, rotated and scaled to outWidth x outHeight
+// by the detector's LumaPreprocessor. The results are in the coordinates of
+// that small upright image.
+static jfloatArray packedYPlanePreprocessDetect(JNIEnv *env, jobject thiz,
+                                                jobject yBuffer, jint width,
+                                                jint height, jint rowStride,
+                                                jint rotation, jint outWidth,
+                                                jint outHeight)
+{
+        jnicommon::LumaImageView yView;
+        if (!getYPlaneView(env, yBuffer, width, height, rowStride, yView))
+                return NULL;
+        DetectorPtr detPtr = getDetectorPtr(env, thiz);
+        std::lock_guard<std::mutex> lock(detPtr->getLock());
+        const jnicommon::LumaImageView &small =
+            detPtr->getPreprocessor().process(yView, rotation, outWidth,
+                                              outHeight);
+        if (small.empty())
+        {
+                jclass iaeClass = env->FindClass("java/lang/IllegalArgumentException");
+                env->ThrowNew(iaeClass, "rotation must be 0, 90, 180 or 270 and "
+                                        "the output size positive");
+                return NULL;
+        }
+        jint size = detPtr->det(small);
+        return getPackedDetectResult(env, detPtr, size);
+}
+
+static jfloatArray packedBitmapDetect(JNIEnv *env, jobject thiz,
+                                      jobject bitmap)
+{
+        cv::Mat rgbaMat;
+        cv::Mat bgrMat;
+        jniutils::ConvertBitmapToRGBAMat(env, bitmap, rgbaMat, true);
+        cv::cvtColor(rgbaMat, bgrMat, cv::COLOR_RGBA2BGR);
+        DetectorPtr detPtr = getDetectorPtr(env, thiz);
+        std::lock_guard<std::mutex> lock(detPtr->getLock());
+        jint size = detPtr->det(bgrMat);
+        return getPackedDetectResult(env, detPtr, size);
+}
+
+static const JNINativeMethod gFaceDetPackedMethods[] = {
+    {"jniYPlaneDetectPacked", "(Ljava/nio/ByteBuffer;III)[F",
+     (void *)packedYPlaneDetect},
+    {"jniBitmapDetectPacked", "(Landroid/graphics/Bitmap;)[F",
+     (void *)packedBitmapDetect},
+};
+
+static const JNINativeMethod gFaceDetPreprocessMethods[] = {
+    {"jniYPlanePreprocessDetectPacked", "(Ljava/nio/ByteBuffer;IIIIII)[F",
+     (void *)packedYPlanePreprocessDetect},
+};
+
+// The asynchronous pipeline. submit copies the Y plane and returns at once
+// with a frame id, or -1 if the frame was dropped. poll returns the packed
+// result of the newest finished frame, or null if none finished since the last
+// poll, and writes its frame id to frameId[0] if frameId isn't null. The other
+// natives take the detector's lock, so they wait for the frame the worker is
+// on instead of running alongside it.
+static jboolean pipelineStart(JNIEnv *env, jobject thiz, jint numSlots,
+                              jint dropPolicy, jint width, jint height,
+                              jint rotation, jint outWidth, jint outHeight)
+{
+        DetectorPtr detPtr = getDetectorPtr(env, thiz);
+        FramePipeline::DropPolicy policy = dropPolicy == FramePipeline::DROP_NEWEST
+                                               ? FramePipeline::DROP_NEWEST
+                                               : FramePipeline::DROP_OLDEST;
+        return detPtr->startPipeline(numSlots, policy, width, height, rotation,
+                                     outWidth, outHeight)
+                   ? JNI_TRUE
+                   : JNI_FALSE;
+}
+
+static void pipelineStop(JNIEnv *env, jobject thiz)
+{
+        getDetectorPtr(env, thiz)->stopPipeline();
+}
+
+static jlong pipelineSubmit(JNIEnv *env, jobject thiz, jobject yBuffer,
+                            jint width, jint height, jint rowStride)
+{
+        std::shared_ptr<FramePipeline> pipeline =
+            getDetectorPtr(env, thiz)->getPipeline();
+        jnicommon::LumaImageView yView;
+        if (!pipeline ||
+            !getYPlaneView(env, yBuffer, width, height, rowStride, yView))
+                return -1;
+        return pipeline->submit(yView);
+}
+
+static jfloatArray pipelinePoll(JNIEnv *env, jobject thiz, jlongArray jFrameId)
+{
+        std::shared_ptr<FramePipeline> pipeline =
+            getDetectorPtr(env, thiz)->getPipeline();
+        const FramePipeline::Result *result = pipeline ? pipeline->poll() : NULL;
+        if (result == NULL)
+                return NULL;
+        if (jFrameId != NULL && env->GetArrayLength(jFrameId) > 0)
+        {
+                jlong frameId = result->frameId;
+                env->SetLongArrayRegion(jFrameId, 0, 1, &frameId);
+        }
+        return newFloatArray(env, result->values);
+}
+
+// Fills stats with the number of frames submitted, dropped and processed
+static void pipelineStats(JNIEnv *env, jobject thiz, jlongArray jStats)
+{
+        std::shared_ptr<FramePipeline> pipeline =
+            getDetectorPtr(env, thiz)->getPipeline();
+        if (!pipeline || jStats == NULL || env->GetArrayLength(jStats) < 3)
+                return;
+        const FramePipeline::Stats stats = pipeline->getStats();
+        const jlong values[3] = {stats.submitted, stats.dropped, stats.processed};
+        env->SetLongArrayRegion(jStats, 0, 3, values);
+}
+
+static const JNINativeMethod gFaceDetPipelineMethods[] = {
+    {"jniPipelineStart", "(IIIIIII)Z", (void *)pipelineStart},
+    {"jniPipelineStop", "()V", (void *)pipelineStop},
+    {"jniPipelineSubmit", "(Ljava/nio/ByteBuffer;III)J", (void *)pipelineSubmit},
+    {"jniPipelinePoll", "([J)[F", (void *)pipelinePoll},
+    {"jniPipelineStats", "([J)V", (void *)pipelineStats},
+};
+
+// Detect-then-track. jniSetTracking(detectInterval, minPsr) runs the full
+// scan only every detectInterval frames and tracks the biggest face in
+// between. jniGetLastDetectPath() returns the DetectPath of the last detect
+// call, and jniGetPathCounts(counts) fills {detect, track, redetect, region}
+// frame counts, as many as counts holds, and restarts them.
+static void setTracking(JNIEnv *env, jobject thiz, jint detectInterval,
+                        jfloat minPsr)
+{
+        DetectorPtr detPtr = getDetectorPtr(env, thiz);
+        std::lock_guard<std::mutex> lock(detPtr->getLock());
+        detPtr->setTracking(detectInterval, minPsr);
+}
+
+static jint getLastDetectPath(JNIEnv *env, jobject thiz)
+{
+        DetectorPtr detPtr = getDetectorPtr(env, thiz);
+        std::lock_guard<std::mutex> lock(detPtr->getLock());
+        return detPtr->getLastPath();
+}
+
+static jfloat getLastPsr(JNIEnv *env, jobject thiz)
+{
+        DetectorPtr detPtr = getDetectorPtr(env, thiz);
+        std::lock_guard<std::mutex> lock(detPtr->getLock());
+        return detPtr->getLastPsr();
+}
+
+static void getPathCounts(JNIEnv *env, jobject thiz, jlongArray jCounts)
+{
+        DetectorPtr detPtr = getDetectorPtr(env, thiz);
+        if (jCounts == NULL)
+                return;
+        std::lock_guard<std::mutex> lock(detPtr->getLock());
+
+        const jlong counts[4] = {
+            detPtr->getPathCount(DLibHOGFaceDetector::PATH_DETECT),
+            detPtr->getPathCount(DLibHOGFaceDetector::PATH_TRACK),
+            detPtr->getPathCount(DLibHOGFaceDetector::PATH_REDETECT),
+            detPtr->getPathCount(DLibHOGFaceDetector::PATH_REGION)};
+        const jsize length = std::min<jsize>(env->GetArrayLength(jCounts), 4);
+        env->SetLongArrayRegion(jCounts, 0, length, counts);
+        detPtr->resetPathCounts();
+}
+
+static const JNINativeMethod gFaceDetTrackingMethods[] = {
+    {"jniSetTracking", "(IF)V", (void *)setTracking},
+    {"jniGetLastDetectPath", "()I", (void *)getLastDetectPath},
+    {"jniGetLastPsr", "()F", (void *)getLastPsr},
+    {"jniGetPathCounts", "([J)V", (void *)getPathCounts},
+};
+
+// jniInit(landmarkPath, minFaceSize, maxFaceSize) only looks for faces about
+// minFaceSize to maxFaceSize pixels wide, 0 meaning no limit, and never builds
+// the pyramid levels for smaller ones. See setFaceSizeRange().
+static jint initWithFaceSize(JNIEnv *env, jobject thiz, jstring jLandmarkPath,
+                             jint minFaceSize, jint maxFaceSize)
+{
+        LOG(INFO) << "jniInit face size " << minFaceSize << " - " << maxFaceSize;
+        std::string landmarkPath = jniutils::convertJStrToString(env, jLandmarkPath);
+        DetectorPtr detPtr = new DLibHOGFaceDetector(
+            landmarkPath, DLibHOGFaceDetector::DEFAULT_NUM_THREADS, minFaceSize,
+            maxFaceSize);
+        setDetectorPtr(env, thiz, detPtr);
+        return JNI_OK;
+}
+
+static const JNINativeMethod gFaceDetInitMethods[] = {
+    {"jniInit", "(Ljava/lang/String;II)I", (void *)initWithFaceSize},
+};
+
+// An older FaceDet without some of the methods still loads
+static jint registerOptionalNatives(JNIEnv *env, jclass clazz,
+                                    const JNINativeMethod *methods,
+                                    int numMethods, const char *what)
+{
+        jint ret = env->RegisterNatives(clazz, methods, numMethods);
+        if (ret != JNI_OK)
+        {
+                env->ExceptionClear();
+                LOG(WARNING) << "FaceDet has no " << what << " methods";
+        }
+        return ret;
+}
+
+jint registerFaceDetNatives(JNIEnv *env)
+{
+        jclass clazz = env->FindClass(CLASSNAME_FACE_DET);
+        if (clazz == NULL)
+        {
+                env->ExceptionClear();
+                return JNI_ERR;
+        }
+        jint ret = registerOptionalNatives(
+            env, clazz, gFaceDetPackedMethods,
+            sizeof(gFaceDetPackedMethods) / sizeof(gFaceDetPackedMethods[0]),
+            "packed detect");
+        registerOptionalNatives(
+            env, clazz, gFaceDetPreprocessMethods,
+            sizeof(gFaceDetPreprocessMethods) / sizeof(gFaceDetPreprocessMethods[0]),
+            "preprocessed detect");
+        registerOptionalNatives(
+            env, clazz, gFaceDetPipelineMethods,
+            sizeof(gFaceDetPipelineMethods) / sizeof(gFaceDetPipelineMethods[0]),
+            "pipeline");
+        registerOptionalNatives(
+            env, clazz, gFaceDetTrackingMethods,
+            sizeof(gFaceDetTrackingMethods) / sizeof(gFaceDetTrackingMethods[0]),
+            "tracking");
+        registerOptionalNatives(
+            env, clazz, gFaceDetInitMethods,
+            sizeof(gFaceDetInitMethods) / sizeof(gFaceDetInitMethods[0]),
+            "face size init");
+        env->DeleteLocalRef(clazz);
+        return ret;
+}
+
+static const bool gFaceDetNativesAdded =
+    jniutils::addNativeRegistrar(registerFaceDetNatives);
@@ -0,0 +1,17 @@
+/*
+ * jni_face_det.h using google-style
+ *
+ *  Created on: May 24, 2016
+ *      Author: Nanyun
+ *
+ *  Copyright (c) 2016 Nanyun. All rights reserved.
+ */
+
+#pragma once
+
+#include <jni.h>
+
+// Binds FaceDet's natives that aren't found by their Java_ symbol names.
+// jni_face_det.cpp adds it to jniutils::addNativeRegistrar(), so JNI_OnLoad
+// calls it.
+jint registerFaceDetNatives(JNIEnv *env);
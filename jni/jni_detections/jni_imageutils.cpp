@@ -7,10 +7,15 @@
  *  Copyright (c) 2016 Nanyun. All rights reserved.
  */
 #include <jni_common/rgb2yuv.h>
+#include <jni_common/thread_count.h>
 #include <jni_common/types.h>
 #include <jni_common/yuv2rgb.h>
+#include <luma_preprocess.h>
+#include <dlib/threads/thread_pool_extension.h>
 #include <glog/logging.h>
 #include <jni.h>
+#include <memory>
+#include <mutex>
 #include <stdio.h>
 #include <stdlib.h>
 
@@ -19,6 +24,28 @@ using namespace jnicommon;
 #define IMAGEUTILS_METHOD(METHOD_NAME) \
   Java_com_nanyun_dlibtest_ImageUtils_##METHOD_NAME // NOLINT
 
+// The workers the converters split their rows over, shared by every caller,
+// as many as DEFAULT_NUM_THREADS until setNumThreads().
+// Each call holds its own reference, so setNumThreads() never destroys a pool
+// a conversion is still running on. Callers on different threads can share
+// it since each only waits for its own bands.
+static std::mutex gPoolLock;
+static std::shared_ptr<dlib::thread_pool> gPool;
+
+static std::shared_ptr<dlib::thread_pool> getPool()
+{
+  std::lock_guard<std::mutex> lock(gPoolLock);
+  if (!gPool)
+    gPool = std::make_shared<dlib::thread_pool>(DEFAULT_NUM_THREADS);
+  return gPool;
+}
+
+// convertYUV420ToLuma() keeps its box tables and row sums from frame to
+// frame, the way DLibHOGFaceDetector keeps its own preprocessor. The lock is
+// only contended if Java converts on two threads at once.
+static std::mutex gPreprocessorLock;
+static LumaPreprocessor gPreprocessor;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -50,6 +77,15 @@ JNIEXPORT void JNICALL
                                                jbyteArray output, jint width,
                                                jint height);
 
+JNIEXPORT jboolean JNICALL IMAGEUTILS_METHOD(convertYUV420ToLuma)(
+    JNIEnv *env, jclass clazz, jbyteArray y, jbyteArray output, jint width,
+    jint height, jint y_row_stride, jint rotation, jint out_width,
+    jint out_height);
+
+JNIEXPORT void JNICALL IMAGEUTILS_METHOD(setNumThreads)(JNIEnv *env,
+                                                        jclass clazz,
+                                                        jint numThreads);
+
 #ifdef __cplusplus
 }
 #endif
@@ -72,9 +108,10 @@ JNIEXPORT void JNICALL IMAGEUTILS_METHOD(convertYUV420SPToARGB8888)(
   }
   else
   {
-    ConvertYUV420SPToARGB8888(reinterpret_cast<uint8 *>(i),
-                              reinterpret_cast<uint8 *>(i) + width * height,
-                              reinterpret_cast<uint32 *>(o), width, height);
+    ConvertYUV420SPToARGB8888Fast(
+        reinterpret_cast<uint8 *>(i),
+        reinterpret_cast<uint8 *>(i) + width * height,
+        reinterpret_cast<uint32 *>(o), width, height, getPool().get());
   }
 
   env->ReleaseByteArrayElements(input, i, JNI_ABORT);
@@ -102,10 +139,11 @@ JNIEXPORT void JNICALL IMAGEUTILS_METHOD(convertYUV420ToARGB8888)(
     jbyte *const u_buff = env->GetByteArrayElements(u, &inputCopy);
     jbyte *const v_buff = env->GetByteArrayElements(v, &inputCopy);
 
-    ConvertYUV420ToARGB8888(
+    ConvertYUV420ToARGB8888Fast(
         reinterpret_cast<uint8 *>(y_buff), reinterpret_cast<uint8 *>(u_buff),
         reinterpret_cast<uint8 *>(v_buff), reinterpret_cast<uint32 *>(o), width,
-        height, y_row_stride, uv_row_stride, uv_pixel_stride);
+        height, y_row_stride, uv_row_stride, uv_pixel_stride,
+        getPool().get());
 
     env->ReleaseByteArrayElements(u, u_buff, JNI_ABORT);
     env->ReleaseByteArrayElements(v, v_buff, JNI_ABORT);
@@ -127,8 +165,9 @@ JNIEXPORT void JNICALL
   jboolean outputCopy = JNI_FALSE;
   jbyte *const o = env->GetByteArrayElements(output, &outputCopy);
 
-  ConvertYUV420SPToRGB565(reinterpret_cast<uint8 *>(i),
-                          reinterpret_cast<uint16 *>(o), width, height);
+  ConvertYUV420SPToRGB565Fast(reinterpret_cast<uint8 *>(i),
+                              reinterpret_cast<uint16 *>(o), width, height,
+                              getPool().get());
 
   env->ReleaseByteArrayElements(input, i, JNI_ABORT);
   env->ReleaseByteArrayElements(output, o, 0);
@@ -146,8 +185,9 @@ JNIEXPORT void JNICALL
   jboolean outputCopy = JNI_FALSE;
   jbyte *const o = env->GetByteArrayElements(output, &outputCopy);
 
-  ConvertARGB8888ToYUV420SP(reinterpret_cast<uint32 *>(i),
-                            reinterpret_cast<uint8 *>(o), width, height);
+  ConvertARGB8888ToYUV420SPFast(reinterpret_cast<uint32 *>(i),
+                                reinterpret_cast<uint8 *>(o), width, height,
+                                getPool().get());
 
   env->ReleaseIntArrayElements(input, i, JNI_ABORT);
   env->ReleaseByteArrayElements(output, o, 0);
@@ -171,3 +211,51 @@ JNIEXPORT void JNICALL
   env->ReleaseByteArrayElements(input, i, JNI_ABORT);
   env->ReleaseByteArrayElements(output, o, 0);
 }
+
+// Crops the center of the Y plane to the aspect ratio of the output, rotates
+// it clockwise by rotation degrees and scales it to out_width x out_height,
+// all in one pass, so the gray input of the detector never goes through a
+// full size ARGB frame. Returns false if the arguments don't describe a
+// valid frame and output.
+JNIEXPORT jboolean JNICALL IMAGEUTILS_METHOD(convertYUV420ToLuma)(
+    JNIEnv *env, jclass clazz, jbyteArray y, jbyteArray output, jint width,
+    jint height, jint y_row_stride, jint rotation, jint out_width,
+    jint out_height)
+{
+  std::lock_guard<std::mutex> lock(gPreprocessorLock);
+  LumaPreprocessor &preprocessor = gPreprocessor;
+  if (y_row_stride < width ||
+      !preprocessor.configure(width, height, rotation, out_width, out_height) ||
+      env->GetArrayLength(y) <
+          LumaImageView::requiredCapacity(width, height, y_row_stride) ||
+      env->GetArrayLength(output) < (jlong)out_width * out_height)
+  {
+    LOG(WARNING) << "convertYUV420ToLuma: bad frame or output size";
+    return JNI_FALSE;
+  }
+
+  jboolean inputCopy = JNI_FALSE;
+  jbyte *const y_buff = env->GetByteArrayElements(y, &inputCopy);
+  jboolean outputCopy = JNI_FALSE;
+  jbyte *const o = env->GetByteArrayElements(output, &outputCopy);
+
+  preprocessor.run(reinterpret_cast<uint8 *>(y_buff), y_row_stride,
+                   reinterpret_cast<uint8 *>(o));
+
+  env->ReleaseByteArrayElements(y, y_buff, JNI_ABORT);
+  env->ReleaseByteArrayElements(output, o, 0);
+  return JNI_TRUE;
+}
+
+// numThreads == 0 converts on the calling thread. The results are the same
+// for any numThreads.
+JNIEXPORT void JNICALL IMAGEUTILS_METHOD(setNumThreads)(JNIEnv *env,
+                                                        jclass clazz,
+                                                        jint numThreads)
+{
+  std::shared_ptr<dlib::thread_pool> pool =
+      std::make_shared<dlib::thread_pool>(numThreads > 0 ? numThreads : 0);
+  std::lock_guard<std::mutex> lock(gPoolLock);
+  // the old pool stops its workers once its last conversion lets go of it
+  gPool.swap(pool);
+}
@@ -101,10 +101,10 @@ extern "C" {
 jobjectArray getDetRet(JNIEnv *env, DetectorPtr detectorPtr, const int &size)
 {
   LOG(INFO) << "getDetRet";
-  jobjectArray jDetRetArray = JNI_VisionDetRet::createJObjectArray(env, size);
+  jobjectArray jDetRetArray = g_pJNI_VisionDetRet->createJObjectArray(env, size);
   for (int i = 0; i < size; i++)
   {
-    jobject jDetRet = JNI_VisionDetRet::createJObject(env);
+    jobject jDetRet = g_pJNI_VisionDetRet->createJObject(env);
     env->SetObjectArrayElement(jDetRetArray, i, jDetRet);
     cv::Rect rect = detectorPtr->getResult()[i];
     g_pJNI_VisionDetRet->setRect(env, jDetRet, rect.x, rect.y,
@@ -0,0 +1,513 @@
+/*
+ * liveness.h using google-style
+ *
+ *  Created on: May 24, 2016
+ *      Author: Nanyun
+ *
+ *  Copyright (c) 2016 Nanyun. All rights reserved.
+ */
+
+#pragma once
+
+#include <jni_common/jni_utils.h>
+#include <dlib/image_processing/full_object_detection.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+#include <vector>
+
+// The liveness challenges over the 68 point landmarks of the last few frames,
+// oldest first. They go through every frame again on each call, and are kept
+// as the reference for LivenessSession below.
+
+inline bool rightRotate(std::vector<std::vector<InnerPoint>> &points)
+{
+        int size = points.size();
+        int frame = 0;
+        int mStartNumRight = 0;
+        float resizeRatio = 1;
+        int mStartNumRightTemp = 0;
+        int mStartNumLeftTemp = 0;
+        int temp_x;
+        int temp_y;
+        double RDetect;
+        float gap_threshold = 2;
+
+        InnerPoint right_pupil;
+        InnerPoint left_pupil;
+
+        for (int i = 0; i < size; i++)
+        {
+                std::vector<InnerPoint> &face_points = (points[i]);
+
+                // Face landmanr result
+                temp_x = 0;
+                temp_y = 0;
+                for (int j = 36; j < 42; j++)
+                {
+                        temp_x = temp_x + (int)(face_points[j].x * resizeRatio);
+                        temp_y = temp_y + (int)(face_points[j].y * resizeRatio);
+                }
+                left_pupil.x = temp_x / 6;
+                left_pupil.y = temp_y / 6;
+
+                temp_x = 0;
+                temp_y = 0;
+
+                for (int j = 42; j < 48; j++)
+                {
+                        temp_x = temp_x + (int)(face_points[j].x * resizeRatio);
+                        temp_y = temp_y + (int)(face_points[j].y * resizeRatio);
+                }
+                right_pupil.x = temp_x / 6;
+                right_pupil.y = temp_y / 6;
+
+                mStartNumRightTemp = abs(right_pupil.x - face_points[30].x);
+                mStartNumLeftTemp = abs(face_points[30].x - left_pupil.x);
+
+                if (fabs(mStartNumRightTemp / (float)mStartNumLeftTemp - 1) < fabs(gap_threshold - 1.0))
+                {
+                        gap_threshold = mStartNumRightTemp / (float)mStartNumLeftTemp;
+                        mStartNumRight = mStartNumRightTemp;
+                }
+        }
+        if (gap_threshold > 1.2 || gap_threshold < 0.8)
+        {
+                return false;
+        }
+
+        for (int i = 0; i < size; i++)
+        {
+                std::vector<InnerPoint> &face_points = (points[i]);
+
+                // Face landmanr result
+                temp_x = 0;
+                temp_y = 0;
+                for (int j = 36; j < 42; j++)
+                {
+                        temp_x = temp_x + (int)(face_points[j].x * resizeRatio);
+                        temp_y = temp_y + (int)(face_points[j].y * resizeRatio);
+                }
+                left_pupil.x = temp_x / 6;
+                left_pupil.y = temp_y / 6;
+
+                temp_x = 0;
+                temp_y = 0;
+
+                for (int j = 42; j < 48; j++)
+                {
+                        temp_x = temp_x + (int)(face_points[j].x * resizeRatio);
+                        temp_y = temp_y + (int)(face_points[j].y * resizeRatio);
+                }
+                right_pupil.x = temp_x / 6;
+                right_pupil.y = temp_y / 6;
+
+                face_points[30].x = (int)(face_points[30].x * resizeRatio);
+
+                RDetect = abs(right_pupil.x - face_points[30].x) / (float)(mStartNumRight);
+                if (RDetect < 0.5)
+                {
+                        frame += 1;
+                }
+        }
+        int threshold = 2;
+        if (threshold < 1)
+                threshold = 1;
+        if (frame >= threshold)
+        {
+                return true;
+        }
+        return false;
+}
+
+inline bool leftRotate(std::vector<std::vector<InnerPoint>> &points)
+{
+        int size = points.size();
+        int frame = 0;
+        int mStartNumLeft = 0;
+        float resizeRatio = 1;
+        int mStartNumRightTemp = 0;
+        int mStartNumLeftTemp = 0;
+        int temp_x;
+        int temp_y;
+        double LDetect;
+        float gap_threshold = 2;
+
+        InnerPoint right_pupil;
+        InnerPoint left_pupil;
+
+        for (int i = 0; i < size; i++)
+        {
+                std::vector<InnerPoint> &face_points = (points[i]);
+
+                // Face landmanr result
+                temp_x = 0;
+                temp_y = 0;
+                for (int j = 36; j < 42; j++)
+                {
+                        temp_x = temp_x + (int)(face_points[j].x * resizeRatio);
+                        temp_y = temp_y + (int)(face_points[j].y * resizeRatio);
+                }
+                left_pupil.x = temp_x / 6;
+                left_pupil.y = temp_y / 6;
+
+                temp_x = 0;
+                temp_y = 0;
+
+                for (int j = 42; j < 48; j++)
+                {
+                        temp_x = temp_x + (int)(face_points[j].x * resizeRatio);
+                        temp_y = temp_y + (int)(face_points[j].y * resizeRatio);
+                }
+                right_pupil.x = temp_x / 6;
+                right_pupil.y = temp_y / 6;
+
+                mStartNumRightTemp = abs(right_pupil.x - face_points[30].x);
+                mStartNumLeftTemp = abs(face_points[30].x - left_pupil.x);
+
+                if (fabs(mStartNumRightTemp / (float)mStartNumLeftTemp - 1) < fabs(gap_threshold - 1.0))
+                {
+                        gap_threshold = mStartNumRightTemp / (float)mStartNumLeftTemp;
+                        mStartNumLeft = mStartNumLeftTemp;
+                }
+        }
+
+        if (gap_threshold > 1.2 || gap_threshold < 0.8)
+        {
+
+                return false;
+        }
+
+        for (int i = 0; i < size; i++)
+        {
+                std::vector<InnerPoint> &face_points = (points[i]);
+
+                // Face landmanr result
+                temp_x = 0;
+                temp_y = 0;
+                for (int j = 36; j < 42; j++)
+                {
+                        temp_x = temp_x + (int)(face_points[j].x * resizeRatio);
+                        temp_y = temp_y + (int)(face_points[j].y * resizeRatio);
+                }
+                left_pupil.x = temp_x / 6;
+                left_pupil.y = temp_y / 6;
+
+                temp_x = 0;
+                temp_y = 0;
+
+                for (int j = 42; j < 48; j++)
+                {
+                        temp_x = temp_x + (int)(face_points[j].x * resizeRatio);
+                        temp_y = temp_y + (int)(face_points[j].y * resizeRatio);
+                }
+                right_pupil.x = temp_x / 6;
+                right_pupil.y = temp_y / 6;
+
+                face_points[30].x = (int)(face_points[30].x * resizeRatio);
+
+                LDetect = abs(face_points[30].x - left_pupil.x) / (float)(mStartNumLeft);
+                if (LDetect < 0.5)
+                {
+                        frame += 1;
+                }
+        }
+        int threshold = 2;
+        if (threshold < 1)
+                threshold = 1;
+        if (frame >= threshold)
+        {
+                return true;
+        }
+        return false;
+}
+
+inline double getDistance(InnerPoint p1, InnerPoint p2)
+{
+        return sqrt((p2.x - p1.x) * (p2.x - p1.x) + (p2.y - p1.y) * (p2.y - p1.y));
+}
+
+inline double ear(InnerPoint p1, InnerPoint p2, InnerPoint p3, InnerPoint p4, InnerPoint p5, InnerPoint p6)
+{
+        return (getDistance(p2, p6) + getDistance(p3, p5)) / (2 * getDistance(p1, p4));
+}
+
+inline bool eyeClosed(std::vector<std::vector<InnerPoint>> &points)
+{
+        int size = points.size();
+        int frame = 0;
+        int mStartNumLeft = 0;
+        int mStartNumRight = 0;
+        float resizeRatio = 1;
+
+        for (int i = 0; i < size; i++)
+        {
+                std::vector<InnerPoint> &face_points = points[i];
+
+                face_points[30].x = (int)(face_points[30].x * resizeRatio);
+                face_points[48].x = (int)(face_points[48].x * resizeRatio);
+                face_points[54].x = (int)(face_points[54].x * resizeRatio);
+
+                face_points[30].y = (int)(face_points[30].y * resizeRatio);
+                face_points[48].y = (int)(face_points[48].y * resizeRatio);
+                face_points[54].y = (int)(face_points[54].y * resizeRatio);
+
+                // Eye detection
+                double rightEAR = ear(face_points[36],
+                                      face_points[37], face_points[38],
+                                      face_points[39], face_points[40],
+                                      face_points[41]) *
+                                  resizeRatio;
+                double leftEAR = ear(face_points[42],
+                                     face_points[43], face_points[44],
+                                     face_points[45], face_points[46],
+                                     face_points[47]) *
+                                 resizeRatio;
+                double earAve = (rightEAR + leftEAR) / 2;
+                if (earAve < 0.2)
+                        frame += 1;
+        }
+        int threshold = 1;
+        if (threshold < 1)
+                threshold = 1;
+        if (frame >= threshold)
+        {
+                return true;
+        }
+        return false;
+}
+
+// The liveness history of a face over its last few frames, kept on the native
+// side and filled by the detector, so the challenges run without handing the
+// history back and forth through Java.
+//
+// Each frame is measured once as it arrives: its pupil to nose distances, the
+// ratio the rotation baseline is picked by, and whether its eyes are closed.
+// The session keeps running counts over the buffered frames, so a challenge
+// is answered in constant time. The pupil distances of the buffered frames are
+// also kept sorted, so when the baseline frame changes the counts are two
+// binary searches rather than a pass over the buffer. A frame costs
+// O(log capacity) comparisons, plus moving at most capacity ints in each
+// sorted list. The answers are the same as the batch functions above give
+// for the buffered frames, oldest first.
+class LivenessSession
+{
+      public:
+        static const int DEFAULT_CAPACITY = 10;
+        static const int NUM_LANDMARKS = 68;
+
+        explicit LivenessSession(int capacity = DEFAULT_CAPACITY)
+            : mPoints(NUM_LANDMARKS)
+        {
+                reset(capacity);
+        }
+
+        // Drops the history and sets how many frames are kept
+        void reset(int capacity)
+        {
+                mCapacity = capacity > 0 ? capacity : 1;
+                mFrames.assign(mCapacity, Frame());
+                mBaselines.assign(mCapacity, 0);
+                mRightSorted.clear();
+                mLeftSorted.clear();
+                mRightSorted.reserve(mCapacity);
+                mLeftSorted.reserve(mCapacity);
+                mNumPushed = 0;
+                mSize = 0;
+                mBaselineHead = 0;
+                mNumBaselines = 0;
+                mRightCount = 0;
+                mLeftCount = 0;
+                mClosedCount = 0;
+        }
+
+        void clear() { reset(mCapacity); }
+
+        // Adds the landmarks of a frame, replacing the oldest frame once the
+        // buffer is full. Shapes from other than the 68 point model are ignored.
+        bool push(const dlib::full_object_detection &shape)
+        {
+                if (shape.num_parts() != NUM_LANDMARKS)
+                        return false;
+                for (int j = 0; j < NUM_LANDMARKS; j++)
+                {
+                        mPoints[j].x = shape.part(j).x();
+                        mPoints[j].y = shape.part(j).y();
+                }
+                push(mPoints);
+                return true;
+        }
+
+        // points holds the 68 landmarks of a frame
+        void push(const std::vector<InnerPoint> &points)
+        {
+                const long long id = mNumPushed;
+                const long long oldBaseline = baselineId();
+                const Frame frame = measure(points);
+
+                bool evicted = false;
+                Frame oldest;
+                if (mSize == mCapacity)
+                {
+                        const long long oldestId = id - mSize;
+                        oldest = mFrames[slot(oldestId)];
+                        evicted = true;
+                        if (mNumBaselines > 0 && mBaselines[mBaselineHead] == oldestId)
+                        {
+                                mBaselineHead = (mBaselineHead + 1) % mCapacity;
+                                mNumBaselines--;
+                        }
+                        mClosedCount -= oldest.eyeClosed;
+                        erase(mRightSorted, oldest.right);
+                        erase(mLeftSorted, oldest.left);
+                        mSize--;
+                }
+
+                mFrames[slot(id)] = frame;
+                insert(mRightSorted, frame.right);
+                insert(mLeftSorted, frame.left);
+                mSize++;
+                mNumPushed++;
+                mClosedCount += frame.eyeClosed;
+
+                // The baseline is the earliest frame with the smallest key, so
+                // frames with a bigger key than this one can't be it any more
+                while (mNumBaselines > 0 &&
+                       mFrames[slot(mBaselines[backIndex()])].key > frame.key)
+                        mNumBaselines--;
+                mNumBaselines++;
+                mBaselines[backIndex()] = id;
+
+                const Frame &base = mFrames[slot(baselineId())];
+                if (baselineId() != oldBaseline)
+                {
+                        mRightCount = countTurned(mRightSorted, base.right);
+                        mLeftCount = countTurned(mLeftSorted, base.left);
+                        return;
+                }
+                if (evicted)
+                {
+                        mRightCount -= isTurned(oldest.right, base.right);
+                        mLeftCount -= isTurned(oldest.left, base.left);
+                }
+                mRightCount += isTurned(frame.right, base.right);
+                mLeftCount += isTurned(frame.left, base.left);
+        }
+
+        int size() const { return mSize; }
+        int capacity() const { return mCapacity; }
+
+        bool rightRotate() const { return hasBaseline() && mRightCount >= 2; }
+        bool leftRotate() const { return hasBaseline() && mLeftCount >= 2; }
+        bool eyeClosed() const { return mClosedCount >= 1; }
+
+      private:
+        struct Frame
+        {
+                Frame() : right(0), left(0), ratio(0), key(0), eyeClosed(0) {}
+                // Distance from the nose to the right and left pupil
+                int right;
+                int left;
+                float ratio;
+                // How far the face is from frontal, infinite if it can't be
+                // the baseline
+                double key;
+                int eyeClosed;
+        };
+
+        // The same arithmetic as rightRotate(), leftRotate() and eyeClosed()
+        static Frame measure(const std::vector<InnerPoint> &points)
+        {
+                Frame frame;
+                int temp_x = 0;
+                for (int j = 36; j < 42; j++)
+                        temp_x = temp_x + points[j].x;
+                const int left_pupil_x = temp_x / 6;
+                temp_x = 0;
+                for (int j = 42; j < 48; j++)
+                        temp_x = temp_x + points[j].x;
+                const int right_pupil_x = temp_x / 6;
+
+                frame.right = abs(right_pupil_x - points[30].x);
+                frame.left = abs(points[30].x - left_pupil_x);
+                frame.ratio = frame.right / (float)frame.left;
+                frame.key = fabs((double)frame.ratio - 1.0);
+                if (!(frame.key < 1.0))
+                        frame.key = std::numeric_limits<double>::infinity();
+
+                double rightEAR = ear(points[36], points[37], points[38],
+                                      points[39], points[40], points[41]);
+                double leftEAR = ear(points[42], points[43], points[44],
+                                     points[45], points[46], points[47]);
+                frame.eyeClosed = (rightEAR + leftEAR) / 2 < 0.2;
+                return frame;
+        }
+
+        // distance / (float)baseline < 0.5 of the batch functions. The
+        // distances aren't negative, and below 2^24 the float division can't
+        // round across 0.5, so this is exact.
+        static int isTurned(int distance, int baseline)
+        {
+                return 2 * distance < baseline;
+        }
+
+        // How many of the sorted distances are turned from baseline
+        static int countTurned(const std::vector<int> &sorted, int baseline)
+        {
+                return std::lower_bound(sorted.begin(), sorted.end(),
+                                        (baseline + 1) / 2) -
+                       sorted.begin();
+        }
+
+        static void insert(std::vector<int> &sorted, int distance)
+        {
+                sorted.insert(std::upper_bound(sorted.begin(), sorted.end(),
+                                               distance),
+                              distance);
+        }
+
+        static void erase(std::vector<int> &sorted, int distance)
+        {
+                sorted.erase(std::lower_bound(sorted.begin(), sorted.end(),
+                                              distance));
+        }
+
+        int slot(long long id) const { return id % mCapacity; }
+        int backIndex() const
+        {
+                return (mBaselineHead + mNumBaselines - 1) % mCapacity;
+        }
+        long long baselineId() const
+        {
+                return mNumBaselines > 0 ? mBaselines[mBaselineHead] : -1;
+        }
+
+        bool hasBaseline() const
+        {
+                if (mNumBaselines == 0)
+                        return false;
+                const Frame &base = mFrames[slot(baselineId())];
+                if (!(base.key < 1.0))
+                        return false;
+                float gap_threshold = base.ratio;
+                return !(gap_threshold > 1.2 || gap_threshold < 0.8);
+        }
+
+        int mCapacity;
+        std::vector<Frame> mFrames;
+        // Ids of the frames that can still become the baseline, by rising key
+        // and then age. The first is the current baseline.
+        std::vector<long long> mBaselines;
+        int mBaselineHead;
+        int mNumBaselines;
+        long long mNumPushed;
+        int mSize;
+        // The right and left distances of the buffered frames, ascending
+        std::vector<int> mRightSorted;
+        std::vector<int> mLeftSorted;
+        int mRightCount;
+        int mLeftCount;
+        int mClosedCount;
+        std::vector<InnerPoint> mPoints;
+};
@@ -0,0 +1,188 @@
+/*
+ * luma_preprocess.h using google-style
+ *
+ *  Created on: May 24, 2016
+ *      Author: Nanyun
+ *
+ *  Copyright (c) 2016 Nanyun. All rights reserved.
+ */
+
+#pragma once
+
+#include <jni_common/luma_image.h>
+#include <jni_common/types.h>
+#include <algorithm>
+#include <vector>
+
+// Turns a camera frame into the small upright gray image the detector runs
+// on, in one pass over the Y plane: the centered crop with the output's
+// aspect ratio, the rotation and the downscale all happen while each source
+// row is read once. This replaces converting the whole frame to ARGB and
+// cropping, rotating and scaling a Bitmap in Java.
+//
+// Each output pixel is the rounded mean of the box of source pixels it
+// covers, so downscaling doesn't alias. When upscaling, a box is one pixel.
+class LumaPreprocessor
+{
+public:
+  LumaPreprocessor()
+      : mSrcWidth(0), mSrcHeight(0), mRotation(0), mOutWidth(0),
+        mOutHeight(0), mCropX(0) {}
+
+  // rotation is 0, 90, 180 or 270 degrees clockwise, the same as
+  // Matrix.postRotate(). outWidth x outHeight is the size after the rotation.
+  // Returns false for any other rotation or an empty size. The box tables are
+  // only rebuilt when the geometry changes.
+  inline bool configure(int srcWidth, int srcHeight, int rotation,
+                        int outWidth, int outHeight)
+  {
+    if (srcWidth <= 0 || srcHeight <= 0 || outWidth <= 0 || outHeight <= 0 ||
+        (rotation != 0 && rotation != 90 && rotation != 180 && rotation != 270))
+      return false;
+    if (srcWidth == mSrcWidth && srcHeight == mSrcHeight &&
+        rotation == mRotation && outWidth == mOutWidth &&
+        outHeight == mOutHeight)
+      return true;
+    mSrcWidth = srcWidth;
+    mSrcHeight = srcHeight;
+    mRotation = rotation;
+    mOutWidth = outWidth;
+    mOutHeight = outHeight;
+
+    // The output before the rotation
+    const bool swap = rotation == 90 || rotation == 270;
+    const int width = swap ? outHeight : outWidth;
+    const int height = swap ? outWidth : outHeight;
+    const double scale = std::min((double)srcWidth / width,
+                                  (double)srcHeight / height);
+    const int cropWidth =
+        std::max(1, std::min(srcWidth, (int)(width * scale + 0.5)));
+    const int cropHeight =
+        std::max(1, std::min(srcHeight, (int)(height * scale + 0.5)));
+    mCropX = (srcWidth - cropWidth) / 2;
+    buildBoxes(width, cropWidth, 0, mColBegin, mColEnd);
+    buildBoxes(height, cropHeight, (srcHeight - cropHeight) / 2, mRowBegin,
+               mRowEnd);
+    mColumnSums.resize(cropWidth);
+    return true;
+  }
+
+  // Fills out, which holds outWidth x outHeight bytes without row padding,
+  // from a Y plane of the configured size
+  inline void run(const jnicommon::uint8 *yData, int yRowStride,
+                  jnicommon::uint8 *out)
+  {
+    using jnicommon::uint8;
+    using jnicommon::uint32;
+    const int width = (int)mColBegin.size();
+    const int height = (int)mRowBegin.size();
+    const int cropWidth = (int)mColumnSums.size();
+
+    // Where output row v, column u of the unrotated image lands:
+    // out[base + u * step]
+    long base = 0;
+    long baseStep = 0;
+    long step = 0;
+    switch (mRotation)
+    {
+    case 0:
+      base = 0;
+      baseStep = mOutWidth;
+      step = 1;
+      break;
+    case 90:
+      base = height - 1;
+      baseStep = -1;
+      step = mOutWidth;
+      break;
+    case 180:
+      base = (long)(height - 1) * mOutWidth + width - 1;
+      baseStep = -mOutWidth;
+      step = -1;
+      break;
+    default:
+      base = (long)(width - 1) * mOutWidth;
+      baseStep = 1;
+      step = -mOutWidth;
+      break;
+    }
+
+    for (int v = 0; v < height; ++v, base += baseStep)
+    {
+      // Sum the box rows column by column, then each box of columns
+      std::fill(mColumnSums.begin(), mColumnSums.end(), 0);
+      for (int r = mRowBegin[v]; r < mRowEnd[v]; ++r)
+      {
+        const uint8 *row = yData + (long)yRowStride * r + mCropX;
+        for (int c = 0; c < cropWidth; ++c)
+          mColumnSums[c] += row[c];
+      }
+      const uint32 boxHeight = mRowEnd[v] - mRowBegin[v];
+      uint8 *dst = out + base;
+      for (int u = 0; u < width; ++u, dst += step)
+      {
+        uint32 sum = 0;
+        for (int c = mColBegin[u]; c < mColEnd[u]; ++c)
+          sum += mColumnSums[c];
+        const uint32 area = boxHeight * (mColEnd[u] - mColBegin[u]);
+        *dst = (uint8)((sum + area / 2) / area);
+      }
+    }
+  }
+
+  // configure() and run() into a buffer the preprocessor keeps between
+  // frames. Returns an empty view if the geometry is invalid. The view stays
+  // valid until the next call.
+  inline const jnicommon::LumaImageView &process(
+      const jnicommon::LumaImageView &src, int rotation, int outWidth,
+      int outHeight)
+  {
+    if (src.empty() ||
+        !configure(src.width(), src.height(), rotation, outWidth, outHeight))
+    {
+      mOutput = jnicommon::LumaImageView();
+      return mOutput;
+    }
+    mBuffer.resize((size_t)outWidth * outHeight);
+    run(src.data(), src.rowStride(), &mBuffer[0]);
+    mOutput = jnicommon::LumaImageView(&mBuffer[0], outWidth, outHeight,
+                                       outWidth);
+    return mOutput;
+  }
+
+  inline const jnicommon::LumaImageView &getOutput() const { return mOutput; }
+
+private:
+  // Splits [offset, offset + cropSize) into count boxes of near equal size.
+  // Boxes are at least one pixel, which repeats pixels when upscaling.
+  static inline void buildBoxes(int count, int cropSize, int offset,
+                                std::vector<int> &begin, std::vector<int> &end)
+  {
+    begin.resize(count);
+    end.resize(count);
+    for (int i = 0; i < count; ++i)
+    {
+      begin[i] = (int)((long)i * cropSize / count);
+      end[i] = std::max(begin[i] + 1, (int)((long)(i + 1) * cropSize / count));
+      end[i] = std::min(end[i], cropSize);
+      begin[i] = std::min(begin[i], end[i] - 1);
+      begin[i] += offset;
+      end[i] += offset;
+    }
+  }
+
+  int mSrcWidth;
+  int mSrcHeight;
+  int mRotation;
+  int mOutWidth;
+  int mOutHeight;
+  int mCropX;
+  // Column boxes are relative to mCropX, row boxes are plane rows
+  std::vector<int> mColBegin;
+  std::vector<int> mColEnd;
+  std::vector<int> mRowBegin;
+  std::vector<int> mRowEnd;
+  std::vector<jnicommon::uint32> mColumnSums;
+  std::vector<jnicommon::uint8> mBuffer;
+  jnicommon::LumaImageView mOutput;
+};
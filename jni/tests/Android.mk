@@ -69,6 +69,648 @@ LOCAL_LDFLAGS += -pie -fPIE
 include $(BUILD_EXECUTABLE)
 #-----------------------------------------------------------------------------
 
+# C++ TestFhogThreadPool
+# =======================================================
+include $(CLEAR_VARS)
+LOCAL_MODULE := TestFhogThreadPool
+
+# import dlib
+LOCAL_STATIC_LIBRARIES += dlib
+
+LOCAL_SRC_FILES := TestFhogThreadPool.cpp
+
+LOCAL_LDLIBS := -lm -llog -ldl -lz
+LOCAL_CPPFLAGS += -fexceptions -frtti -std=c++11
+
+ifeq ($(TARGET_ARCH_ABI), armeabi-v7a)
+LOCAL_ARM_MODE := arm
+LOCAL_ARM_NEON := true
+endif
+
+LOCAL_CFLAGS += -pie -fPIE
+LOCAL_LDFLAGS += -pie -fPIE
+
+include $(BUILD_EXECUTABLE)
+#-----------------------------------------------------------------------------
+
+# C++ TestYPlaneDetect
+# =======================================================
+include $(CLEAR_VARS)
+OpenCV_INSTALL_MODULES := on
+OPENCV_CAMERA_MODULES := off
+OPENCV_LIB_TYPE := STATIC
+include $(OPENCV_PATH)/OpenCV.mk
+
+LOCAL_MODULE := TestYPlaneDetect
+
+LOCAL_C_INCLUDES += $(OPENCV_INCLUDE_DIR) \
+                    $(LOCAL_PATH)/../jni_detections
+
+# import dlib
+LOCAL_STATIC_LIBRARIES += dlib \
+                          jni_common \
+                          miniglog
+
+LOCAL_SRC_FILES := TestYPlaneDetect.cpp
+
+LOCAL_LDLIBS := -lm -llog -ldl -lz
+LOCAL_CPPFLAGS += -fexceptions -frtti -std=c++11
+
+ifeq ($(TARGET_ARCH_ABI), armeabi-v7a)
+LOCAL_ARM_MODE := arm
+LOCAL_ARM_NEON := true
+endif
+
+LOCAL_CFLAGS += -pie -fPIE
+LOCAL_LDFLAGS += -pie -fPIE
+
+include $(BUILD_EXECUTABLE)
+#-----------------------------------------------------------------------------
+
+# C++ TestGrayDetect
+# =======================================================
+include $(CLEAR_VARS)
+OpenCV_INSTALL_MODULES := on
+OPENCV_CAMERA_MODULES := off
+OPENCV_LIB_TYPE := STATIC
+include $(OPENCV_PATH)/OpenCV.mk
+
+LOCAL_MODULE := TestGrayDetect
+
+LOCAL_C_INCLUDES += $(OPENCV_INCLUDE_DIR) \
+                    $(LOCAL_PATH)/../jni_detections
+
+# import dlib
+LOCAL_STATIC_LIBRARIES += dlib \
+                          jni_common \
+                          miniglog
+
+LOCAL_SRC_FILES := TestGrayDetect.cpp
+
+LOCAL_LDLIBS := -lm -llog -ldl -lz
+LOCAL_CPPFLAGS += -fexceptions -frtti -std=c++11
+
+ifeq ($(TARGET_ARCH_ABI), armeabi-v7a)
+LOCAL_ARM_MODE := arm
+LOCAL_ARM_NEON := true
+endif
+
+LOCAL_CFLAGS += -pie -fPIE
+LOCAL_LDFLAGS += -pie -fPIE
+
+include $(BUILD_EXECUTABLE)
+#-----------------------------------------------------------------------------
+
+# C++ TestLiveness
+# =======================================================
+include $(CLEAR_VARS)
+LOCAL_MODULE := TestLiveness
+
+LOCAL_C_INCLUDES += $(LOCAL_PATH)/.. \
+                    $(LOCAL_PATH)/../jni_detections
+
+# import dlib
+LOCAL_STATIC_LIBRARIES += dlib
+
+LOCAL_SRC_FILES := TestLiveness.cpp
+
+LOCAL_LDLIBS := -lm -llog -ldl -lz
+LOCAL_CPPFLAGS += -fexceptions -frtti -std=c++11
+
+ifeq ($(TARGET_ARCH_ABI), armeabi-v7a)
+LOCAL_ARM_MODE := arm
+LOCAL_ARM_NEON := true
+endif
+
+LOCAL_CFLAGS += -pie -fPIE
+LOCAL_LDFLAGS += -pie -fPIE
+
+include $(BUILD_EXECUTABLE)
+#-----------------------------------------------------------------------------
+
+# C++ TestYuvConvert
+# =======================================================
+include $(CLEAR_VARS)
+LOCAL_MODULE := TestYuvConvert
+
+LOCAL_C_INCLUDES += $(LOCAL_PATH)/..
+
+# import dlib
+LOCAL_STATIC_LIBRARIES += jni_common \
+                          dlib
+
+LOCAL_SRC_FILES := TestYuvConvert.cpp
+
+LOCAL_LDLIBS := -lm -llog -ldl -lz
+LOCAL_CPPFLAGS += -fexceptions -frtti -std=c++11
+
+ifeq ($(TARGET_ARCH_ABI), armeabi-v7a)
+LOCAL_ARM_MODE := arm
+LOCAL_ARM_NEON := true
+endif
+
+LOCAL_CFLAGS += -pie -fPIE
+LOCAL_LDFLAGS += -pie -fPIE
+
+include $(BUILD_EXECUTABLE)
+#-----------------------------------------------------------------------------
+
+# C++ TestLumaPreprocess
+# =======================================================
+include $(CLEAR_VARS)
+LOCAL_MODULE := TestLumaPreprocess
+
+LOCAL_C_INCLUDES += $(LOCAL_PATH)/.. \
+                    $(LOCAL_PATH)/../jni_detections
+
+# import dlib
+LOCAL_STATIC_LIBRARIES += jni_common \
+                          dlib
+
+LOCAL_SRC_FILES := TestLumaPreprocess.cpp
+
+LOCAL_LDLIBS := -lm -llog -ldl -lz
+LOCAL_CPPFLAGS += -fexceptions -frtti -std=c++11
+
+ifeq ($(TARGET_ARCH_ABI), armeabi-v7a)
+LOCAL_ARM_MODE := arm
+LOCAL_ARM_NEON := true
+endif
+
+LOCAL_CFLAGS += -pie -fPIE
+LOCAL_LDFLAGS += -pie -fPIE
+
+include $(BUILD_EXECUTABLE)
+#-----------------------------------------------------------------------------
+
+# C++ TestFramePipeline
+# =======================================================
+include $(CLEAR_VARS)
+LOCAL_MODULE := TestFramePipeline
+
+LOCAL_C_INCLUDES += $(LOCAL_PATH)/.. \
+                    $(LOCAL_PATH)/../jni_detections
+
+# import dlib
+LOCAL_STATIC_LIBRARIES += dlib
+
+LOCAL_SRC_FILES := TestFramePipeline.cpp
+
+LOCAL_LDLIBS := -lm -llog -ldl -lz
+LOCAL_CPPFLAGS += -fexceptions -frtti -std=c++11
+
+ifeq ($(TARGET_ARCH_ABI), armeabi-v7a)
+LOCAL_ARM_MODE := arm
+endif
+
+LOCAL_CFLAGS += -pie -fPIE
+LOCAL_LDFLAGS += -pie -fPIE
+
+include $(BUILD_EXECUTABLE)
+#-----------------------------------------------------------------------------
+
+# C++ TestFaceTracking
+# =======================================================
+include $(CLEAR_VARS)
+OpenCV_INSTALL_MODULES := on
+OPENCV_CAMERA_MODULES := off
+OPENCV_LIB_TYPE := STATIC
+include $(OPENCV_PATH)/OpenCV.mk
+
+LOCAL_MODULE := TestFaceTracking
+
+LOCAL_C_INCLUDES += $(OPENCV_INCLUDE_DIR) \
+                    $(LOCAL_PATH)/../jni_detections
+
+# import dlib
+LOCAL_STATIC_LIBRARIES += dlib \
+                          jni_common \
+                          miniglog
+
+LOCAL_SRC_FILES := TestFaceTracking.cpp
+
+LOCAL_LDLIBS := -lm -llog -ldl -lz
+LOCAL_CPPFLAGS += -fexceptions -frtti -std=c++11
+
+ifeq ($(TARGET_ARCH_ABI), armeabi-v7a)
+LOCAL_ARM_MODE := arm
+LOCAL_ARM_NEON := true
+endif
+
+LOCAL_CFLAGS += -pie -fPIE
+LOCAL_LDFLAGS += -pie -fPIE
+
+include $(BUILD_EXECUTABLE)
+#-----------------------------------------------------------------------------
+
+# C++ TestRegionScan
+# =======================================================
+include $(CLEAR_VARS)
+LOCAL_MODULE := TestRegionScan
+
+# import dlib
+LOCAL_STATIC_LIBRARIES += dlib
+
+LOCAL_SRC_FILES := TestRegionScan.cpp
+
+LOCAL_LDLIBS := -lm -llog -ldl -lz
+LOCAL_CPPFLAGS += -fexceptions -frtti -std=c++11
+
+ifeq ($(TARGET_ARCH_ABI), armeabi-v7a)
+LOCAL_ARM_MODE := arm
+LOCAL_ARM_NEON := true
+endif
+
+LOCAL_CFLAGS += -pie -fPIE
+LOCAL_LDFLAGS += -pie -fPIE
+
+include $(BUILD_EXECUTABLE)
+#-----------------------------------------------------------------------------
+
+# C++ TestScanPlan
+# =======================================================
+include $(CLEAR_VARS)
+LOCAL_MODULE := TestScanPlan
+
+# import dlib
+LOCAL_STATIC_LIBRARIES += dlib
+
+LOCAL_SRC_FILES := TestScanPlan.cpp
+
+LOCAL_LDLIBS := -lm -llog -ldl -lz
+LOCAL_CPPFLAGS += -fexceptions -frtti -std=c++11
+
+ifeq ($(TARGET_ARCH_ABI), armeabi-v7a)
+LOCAL_ARM_MODE := arm
+LOCAL_ARM_NEON := true
+endif
+
+LOCAL_CFLAGS += -pie -fPIE
+LOCAL_LDFLAGS += -pie -fPIE
+
+include $(BUILD_EXECUTABLE)
+#-----------------------------------------------------------------------------
+
+# C++ TestFhogBands
+# =======================================================
+include $(CLEAR_VARS)
+LOCAL_MODULE := TestFhogBands
+
+# import dlib
+LOCAL_STATIC_LIBRARIES += dlib
+
+LOCAL_SRC_FILES := TestFhogBands.cpp
+
+LOCAL_LDLIBS := -lm -llog -ldl -lz
+LOCAL_CPPFLAGS += -fexceptions -frtti -std=c++11
+
+ifeq ($(TARGET_ARCH_ABI), armeabi-v7a)
+LOCAL_ARM_MODE := arm
+LOCAL_ARM_NEON := true
+endif
+
+LOCAL_CFLAGS += -pie -fPIE
+LOCAL_LDFLAGS += -pie -fPIE
+
+include $(BUILD_EXECUTABLE)
+#-----------------------------------------------------------------------------
+
+# C++ TestStreamPyramid
+# =======================================================
+include $(CLEAR_VARS)
+LOCAL_MODULE := TestStreamPyramid
+
+# import dlib
+LOCAL_STATIC_LIBRARIES += dlib
+
+LOCAL_SRC_FILES := TestStreamPyramid.cpp
+
+LOCAL_LDLIBS := -lm -llog -ldl -lz
+LOCAL_CPPFLAGS += -fexceptions -frtti -std=c++11
+
+ifeq ($(TARGET_ARCH_ABI), armeabi-v7a)
+LOCAL_ARM_MODE := arm
+LOCAL_ARM_NEON := true
+endif
+
+LOCAL_CFLAGS += -pie -fPIE
+LOCAL_LDFLAGS += -pie -fPIE
+
+include $(BUILD_EXECUTABLE)
+#-----------------------------------------------------------------------------
+
+# C++ TestWorkspace
+# =======================================================
+include $(CLEAR_VARS)
+LOCAL_MODULE := TestWorkspace
+
+# import dlib
+LOCAL_STATIC_LIBRARIES += dlib
+
+LOCAL_SRC_FILES := TestWorkspace.cpp
+
+LOCAL_LDLIBS := -lm -llog -ldl -lz
+LOCAL_CPPFLAGS += -fexceptions -frtti -std=c++11
+
+ifeq ($(TARGET_ARCH_ABI), armeabi-v7a)
+LOCAL_ARM_MODE := arm
+LOCAL_ARM_NEON := true
+endif
+
+LOCAL_CFLAGS += -pie -fPIE
+LOCAL_LDFLAGS += -pie -fPIE
+
+include $(BUILD_EXECUTABLE)
+#-----------------------------------------------------------------------------
+
+# C++ TestFilterBank
+# =======================================================
+include $(CLEAR_VARS)
+LOCAL_MODULE := TestFilterBank
+
+# import dlib
+LOCAL_STATIC_LIBRARIES += dlib
+
+LOCAL_SRC_FILES := TestFilterBank.cpp
+
+LOCAL_LDLIBS := -lm -llog -ldl -lz
+LOCAL_CPPFLAGS += -fexceptions -frtti -std=c++11
+
+ifeq ($(TARGET_ARCH_ABI), armeabi-v7a)
+LOCAL_ARM_MODE := arm
+LOCAL_ARM_NEON := true
+endif
+
+LOCAL_CFLAGS += -pie -fPIE
+LOCAL_LDFLAGS += -pie -fPIE
+
+include $(BUILD_EXECUTABLE)
+#-----------------------------------------------------------------------------
+
+# C++ TestCascade
+# =======================================================
+include $(CLEAR_VARS)
+LOCAL_MODULE := TestCascade
+
+# import dlib
+LOCAL_STATIC_LIBRARIES += dlib
+
+LOCAL_SRC_FILES := TestCascade.cpp
+
+LOCAL_LDLIBS := -lm -llog -ldl -lz
+LOCAL_CPPFLAGS += -fexceptions -frtti -std=c++11
+
+ifeq ($(TARGET_ARCH_ABI), armeabi-v7a)
+LOCAL_ARM_MODE := arm
+LOCAL_ARM_NEON := true
+endif
+
+LOCAL_CFLAGS += -pie -fPIE
+LOCAL_LDFLAGS += -pie -fPIE
+
+include $(BUILD_EXECUTABLE)
+#-----------------------------------------------------------------------------
+
+# C++ TestPoseSubset
+# =======================================================
+include $(CLEAR_VARS)
+LOCAL_MODULE := TestPoseSubset
+
+# import dlib
+LOCAL_STATIC_LIBRARIES += dlib
+
+LOCAL_SRC_FILES := TestPoseSubset.cpp
+
+LOCAL_LDLIBS := -lm -llog -ldl -lz
+LOCAL_CPPFLAGS += -fexceptions -frtti -std=c++11
+
+ifeq ($(TARGET_ARCH_ABI), armeabi-v7a)
+LOCAL_ARM_MODE := arm
+LOCAL_ARM_NEON := true
+endif
+
+LOCAL_CFLAGS += -pie -fPIE
+LOCAL_LDFLAGS += -pie -fPIE
+
+include $(BUILD_EXECUTABLE)
+#-----------------------------------------------------------------------------
+
+# C++ TestScannerDetect
+# =======================================================
+include $(CLEAR_VARS)
+LOCAL_MODULE := TestScannerDetect
+
+# import dlib
+LOCAL_STATIC_LIBRARIES += dlib
+
+LOCAL_SRC_FILES := TestScannerDetect.cpp
+
+LOCAL_LDLIBS := -lm -llog -ldl -lz
+LOCAL_CPPFLAGS += -fexceptions -frtti -std=c++11
+
+ifeq ($(TARGET_ARCH_ABI), armeabi-v7a)
+LOCAL_ARM_MODE := arm
+LOCAL_ARM_NEON := true
+endif
+
+LOCAL_CFLAGS += -pie -fPIE
+LOCAL_LDFLAGS += -pie -fPIE
+
+include $(BUILD_EXECUTABLE)
+#-----------------------------------------------------------------------------
+
+# C++ TestSuppression
+# =======================================================
+include $(CLEAR_VARS)
+LOCAL_MODULE := TestSuppression
+
+# import dlib
+LOCAL_STATIC_LIBRARIES += dlib
+
+LOCAL_SRC_FILES := TestSuppression.cpp
+
+LOCAL_LDLIBS := -lm -llog -ldl -lz
+LOCAL_CPPFLAGS += -fexceptions -frtti -std=c++11
+
+ifeq ($(TARGET_ARCH_ABI), armeabi-v7a)
+LOCAL_ARM_MODE := arm
+LOCAL_ARM_NEON := true
+endif
+
+LOCAL_CFLAGS += -pie -fPIE
+LOCAL_LDFLAGS += -pie -fPIE
+
+include $(BUILD_EXECUTABLE)
+#-----------------------------------------------------------------------------
+
+# C++ TestFixedPoint
+# =======================================================
+include $(CLEAR_VARS)
+LOCAL_MODULE := TestFixedPoint
+
+# import dlib
+LOCAL_STATIC_LIBRARIES += dlib
+
+LOCAL_SRC_FILES := TestFixedPoint.cpp
+
+LOCAL_LDLIBS := -lm -llog -ldl -lz
+LOCAL_CPPFLAGS += -fexceptions -frtti -std=c++11
+
+ifeq ($(TARGET_ARCH_ABI), armeabi-v7a)
+LOCAL_ARM_MODE := arm
+LOCAL_ARM_NEON := true
+endif
+
+LOCAL_CFLAGS += -pie -fPIE
+LOCAL_LDFLAGS += -pie -fPIE
+
+include $(BUILD_EXECUTABLE)
+#-----------------------------------------------------------------------------
+
+# C++ TestShapeForest
+# =======================================================
+include $(CLEAR_VARS)
+LOCAL_MODULE := TestShapeForest
+
+# import dlib
+LOCAL_STATIC_LIBRARIES += dlib
+
+LOCAL_SRC_FILES := TestShapeForest.cpp
+
+LOCAL_LDLIBS := -lm -llog -ldl -lz
+LOCAL_CPPFLAGS += -fexceptions -frtti -std=c++11
+
+ifeq ($(TARGET_ARCH_ABI), armeabi-v7a)
+LOCAL_ARM_MODE := arm
+LOCAL_ARM_NEON := true
+endif
+
+LOCAL_CFLAGS += -pie -fPIE
+LOCAL_LDFLAGS += -pie -fPIE
+
+include $(BUILD_EXECUTABLE)
+#-----------------------------------------------------------------------------
+
+# C++ TestMappedShapePredictor
+# =======================================================
+include $(CLEAR_VARS)
+LOCAL_MODULE := TestMappedShapePredictor
+
+# import dlib
+LOCAL_STATIC_LIBRARIES += dlib
+
+LOCAL_SRC_FILES := TestMappedShapePredictor.cpp
+
+LOCAL_LDLIBS := -lm -llog -ldl -lz
+LOCAL_CPPFLAGS += -fexceptions -frtti -std=c++11
+
+ifeq ($(TARGET_ARCH_ABI), armeabi-v7a)
+LOCAL_ARM_MODE := arm
+LOCAL_ARM_NEON := true
+endif
+
+LOCAL_CFLAGS += -pie -fPIE
+LOCAL_LDFLAGS += -pie -fPIE
+
+include $(BUILD_EXECUTABLE)
+#-----------------------------------------------------------------------------
+
+# C++ ConvertShapePredictor
+# =======================================================
+include $(CLEAR_VARS)
+LOCAL_MODULE := ConvertShapePredictor
+
+# import dlib
+LOCAL_STATIC_LIBRARIES += dlib
+
+LOCAL_SRC_FILES := ConvertShapePredictor.cpp
+
+LOCAL_LDLIBS := -lm -llog -ldl -lz
+LOCAL_CPPFLAGS += -fexceptions -frtti -std=c++11
+
+ifeq ($(TARGET_ARCH_ABI), armeabi-v7a)
+LOCAL_ARM_MODE := arm
+LOCAL_ARM_NEON := true
+endif
+
+LOCAL_CFLAGS += -pie -fPIE
+LOCAL_LDFLAGS += -pie -fPIE
+
+include $(BUILD_EXECUTABLE)
+#-----------------------------------------------------------------------------
+
+# C++ TestLandmarkSubset
+# =======================================================
+include $(CLEAR_VARS)
+LOCAL_MODULE := TestLandmarkSubset
+
+# import dlib
+LOCAL_STATIC_LIBRARIES += dlib
+
+LOCAL_SRC_FILES := TestLandmarkSubset.cpp
+
+LOCAL_LDLIBS := -lm -llog -ldl -lz
+LOCAL_CPPFLAGS += -fexceptions -frtti -std=c++11
+
+ifeq ($(TARGET_ARCH_ABI), armeabi-v7a)
+LOCAL_ARM_MODE := arm
+LOCAL_ARM_NEON := true
+endif
+
+LOCAL_CFLAGS += -pie -fPIE
+LOCAL_LDFLAGS += -pie -fPIE
+
+include $(BUILD_EXECUTABLE)
+#-----------------------------------------------------------------------------
+
+# C++ TestWarmStart
+# =======================================================
+include $(CLEAR_VARS)
+LOCAL_MODULE := TestWarmStart
+
+# import dlib
+LOCAL_STATIC_LIBRARIES += dlib
+
+LOCAL_SRC_FILES := TestWarmStart.cpp
+
+LOCAL_LDLIBS := -lm -llog -ldl -lz
+LOCAL_CPPFLAGS += -fexceptions -frtti -std=c++11
+
+ifeq ($(TARGET_ARCH_ABI), armeabi-v7a)
+LOCAL_ARM_MODE := arm
+LOCAL_ARM_NEON := true
+endif
+
+LOCAL_CFLAGS += -pie -fPIE
+LOCAL_LDFLAGS += -pie -fPIE
+
+include $(BUILD_EXECUTABLE)
+#-----------------------------------------------------------------------------
+
+# C++ TestLumaSampling
+# =======================================================
+include $(CLEAR_VARS)
+LOCAL_MODULE := TestLumaSampling
+
+# import dlib
+LOCAL_STATIC_LIBRARIES += dlib
+
+LOCAL_SRC_FILES := TestLumaSampling.cpp
+
+LOCAL_LDLIBS := -lm -llog -ldl -lz
+LOCAL_CPPFLAGS += -fexceptions -frtti -std=c++11
+
+ifeq ($(TARGET_ARCH_ABI), armeabi-v7a)
+LOCAL_ARM_MODE := arm
+LOCAL_ARM_NEON := true
+endif
+
+LOCAL_CFLAGS += -pie -fPIE
+LOCAL_LDFLAGS += -pie -fPIE
+
+include $(BUILD_EXECUTABLE)
+#-----------------------------------------------------------------------------
+
 ### Test daemon
 #==========================svm_ex===================================
 include $(CLEAR_VARS)
@@ -0,0 +1,63 @@
+//============================================================================
+// Name        : ConvertShapePredictor.cpp
+// Author      : Nanyun
+// Version     : 1.0
+// Copyright   : Nanyun
+// Description : Converts a shape_predictor .dat file, e.g.
+//               shape_predictor_68_face_landmarks.dat, to the mapped format of
+//               dlib/image_processing/shape_predictor_mapped.h, which
+//               DLibHOGFaceDetector loads without parsing.
+//============================================================================
+#include <dlib/image_processing.h>
+#include <dlib/image_processing/shape_predictor_mapped.h>
+
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+using namespace dlib;
+using namespace std;
+
+int main(int argc, char **argv)
+{
+  const bool float16 = argc == 4 && strcmp(argv[3], "--float16") == 0;
+  if (argc != 3 && !float16)
+  {
+    cout << "Call this program like this:" << endl;
+    cout << "./ConvertShapePredictor shape_predictor_68_face_landmarks.dat "
+            "shape_predictor_68_face_landmarks.spm [--float16]"
+         << endl;
+    cout << "--float16 stores the leaves as half floats, for a file half the "
+            "size that is converted when loaded."
+         << endl;
+    return 0;
+  }
+
+  try
+  {
+    shape_predictor sp;
+    deserialize(argv[1]) >> sp;
+    save_mapped_shape_predictor(sp, argv[2], float16);
+
+    // read it back and check it writes the same trees
+    shape_predictor mapped;
+    load_mapped_shape_predictor(mapped, argv[2]);
+    std::ostringstream before, after;
+    serialize(sp, before);
+    serialize(mapped, after);
+    if (!float16 && before.str() != after.str())
+    {
+      cout << "The mapped file doesn't hold the same model" << endl;
+      return 1;
+    }
+    cout << "Wrote " << argv[2] << ", " << mapped.num_parts() << " parts"
+         << (float16 ? ", float16 leaves" : "") << endl;
+  }
+  catch (std::exception &e)
+  {
+    cout << e.what() << endl;
+    return 1;
+  }
+  return 0;
+}
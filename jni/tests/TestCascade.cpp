@@ -0,0 +1,168 @@
+//============================================================================
+// Name        : TestCascade.cpp
+// Author      : Nanyun
+// Version     : 1.0
+// Copyright   : Nanyun
+// Description : Checks that the frontal face detector finds the same faces
+//               with its filters scored in a cascade as with all of them at
+//               every window, on the images the built in cascades were
+//               calibrated on. Then calibrates their stages on half the
+//               images and checks them on the other half, and prints the
+//               recall against the time of other first stages and tightened
+//               bounds.
+//============================================================================
+#include <dlib/image_io.h>
+#include <dlib/image_processing/frontal_face_detector.h>
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+using namespace dlib;
+using namespace std;
+
+typedef std::vector<array2d<unsigned char> > image_list;
+
+struct CurvePoint
+{
+  int found;
+  int total;
+  double fullMs;
+  double cascadeMs;
+  double left;
+};
+
+static bool sameFace(const rect_detection &a, const rect_detection &b)
+{
+  return a.rect == b.rect &&
+         std::abs(a.detection_confidence - b.detection_confidence) < 1e-4;
+}
+
+// Runs detector on the images with and without its cascades, counting the
+// faces of the full scan the cascade finds too
+static void runImages(frontal_face_detector &detector, const image_list &images,
+                      CurvePoint &point)
+{
+  scan_fhog_pyramid<pyramid_down<6> > &scanner = detector.get_scanner();
+  for (const array2d<unsigned char> &img : images)
+  {
+    std::vector<rect_detection> ref, dets;
+    scanner.set_cascade_scoring(false);
+    auto t0 = std::chrono::steady_clock::now();
+    detector(img, ref);
+    auto t1 = std::chrono::steady_clock::now();
+    scanner.set_cascade_scoring(true);
+    detector(img, dets);
+    auto t2 = std::chrono::steady_clock::now();
+    point.left += scanner.get_cascade_stats().fraction_left(1);
+    scanner.set_cascade_scoring(false);
+
+    point.fullMs += std::chrono::duration<double, std::milli>(t1 - t0).count();
+    point.cascadeMs +=
+        std::chrono::duration<double, std::milli>(t2 - t1).count();
+    point.total += ref.size();
+    for (const rect_detection &face : ref)
+      for (const rect_detection &det : dets)
+        if (sameFace(face, det))
+        {
+          ++point.found;
+          break;
+        }
+  }
+}
+
+// Calibrates cascades with the given stages on each half of the images, with
+// the bounds scaled by scale, and runs them on the other half
+static void runHeldOut(const frontal_face_detector &detector,
+                       const image_list *halves,
+                       const std::vector<unsigned long> &stages, double scale,
+                       CurvePoint &point)
+{
+  for (int h = 0; h < 2; ++h)
+  {
+    std::vector<fhog_cascade> cascades =
+        calibrate_fhog_cascades(detector, halves[h], stages, -0.5);
+    for (fhog_cascade &cascade : cascades)
+      for (double &bound : cascade.bounds)
+        bound *= scale;
+    frontal_face_detector calibrated = detector;
+    set_fhog_cascades(calibrated, cascades);
+    runImages(calibrated, halves[1 - h], point);
+  }
+}
+
+static double recall(const CurvePoint &point)
+{
+  return point.total ? (double)point.found / point.total : 0;
+}
+
+int main(int argc, char **argv)
+{
+  cout << "TestCascade" << endl;
+  if (argc < 3)
+  {
+    cout << "Call this program like this:" << endl;
+    cout << "./TestCascade lena.jpg faces/*.jpg" << endl;
+    return 0;
+  }
+
+  image_list images(argc - 1);
+  for (int i = 1; i < argc; ++i)
+    load_image(images[i - 1], argv[i]);
+
+  // The built in cascades must not lose a face. They were calibrated on
+  // these images, so this is an in-sample check.
+  frontal_face_detector detector = get_frontal_face_detector();
+  CurvePoint builtIn = {0, 0, 0, 0, 0};
+  runImages(detector, images, builtIn);
+  cout << "built in cascades: found " << builtIn.found << " of "
+       << builtIn.total << " faces, " << builtIn.fullMs / images.size()
+       << " ms/frame full, " << builtIn.cascadeMs / images.size()
+       << " ms/frame cascade, " << 100 * builtIn.left / images.size()
+       << "% of the windows left after the first stage" << endl;
+  bool ok = builtIn.total > 0 && builtIn.found == builtIn.total &&
+            builtIn.left / images.size() < 0.1;
+
+  // Calibrate on the even images, run on the odd ones, and the other way
+  image_list halves[2];
+  for (unsigned long i = 0; i < images.size(); ++i)
+  {
+    halves[i % 2].push_back(array2d<unsigned char>());
+    assign_image(halves[i % 2].back(), images[i]);
+  }
+
+  // The stages of the built in cascades must not lose a face they weren't
+  // calibrated on either
+  const std::vector<fhog_cascade> builtInCascades = get_frontal_face_cascades();
+  CurvePoint heldOut = {0, 0, 0, 0, 0};
+  runHeldOut(detector, halves, builtInCascades[0].stage_sizes, 1, heldOut);
+  cout << "held out recall of the built in stages: " << recall(heldOut)
+       << " (" << heldOut.found << "/" << heldOut.total << ")" << endl;
+  if (heldOut.total == 0 || heldOut.found != heldOut.total)
+    ok = false;
+
+  cout << "held out recall and ms/frame: first stage, bound scale" << endl;
+  const unsigned long firstStages[] = {8, 12, 16, 24};
+  const double scales[] = {1, 0.75, 0.5};
+  for (unsigned long firstStage : firstStages)
+    for (double scale : scales)
+    {
+      std::vector<unsigned long> stages;
+      stages.push_back(firstStage);
+      stages.push_back(100);
+      CurvePoint point = {0, 0, 0, 0, 0};
+      runHeldOut(detector, halves, stages, scale, point);
+      cout << "  " << firstStage << ", " << scale << ": recall "
+           << recall(point) << " (" << point.found << "/" << point.total
+           << "), " << point.fullMs / images.size() << " -> "
+           << point.cascadeMs / images.size() << " ms, "
+           << 100 * point.left / images.size() << "% left" << endl;
+      // Untightened bounds should hold on images they weren't made from
+      if (scale == 1 && point.found != point.total)
+        ok = false;
+    }
+
+  cout << (ok ? "PASS" : "FAIL") << endl;
+  return ok ? 0 : 1;
+}
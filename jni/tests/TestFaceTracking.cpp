@@ -0,0 +1,164 @@
+//============================================================================
+// Name        : TestFaceTracking.cpp
+// Author      : Nanyun
+// Version     : 1.0
+// Copyright   : Nanyun
+// Description : Pans a camera window over a still image and runs
+//               DLibHOGFaceDetector on every frame, once with the full scan
+//               each frame and once detecting then tracking. Prints the time
+//               per frame, how many frames took each path, and how far the
+//               tracked boxes and landmarks drift from the full scan ones.
+//============================================================================
+#include <detector.h>
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include "test_util.h"
+
+using namespace std;
+
+static const int kFrames = 90;
+
+struct FrameResult
+{
+  bool found;
+  dlib::rectangle rect;
+  std::vector<dlib::point> parts;
+};
+
+// The window of frame i pans smoothly over the image, the way a handheld
+// camera drifts over a face
+static jnicommon::LumaImageView window(const cv::Mat &gray, int i, int width,
+                                       int height)
+{
+  const int rangeX = gray.cols - width;
+  const int rangeY = gray.rows - height;
+  const int x = (int)(rangeX * (0.5 + 0.5 * std::sin(2 * M_PI * i / 60.0)));
+  const int y = (int)(rangeY * (0.5 + 0.5 * std::sin(2 * M_PI * i / 45.0)));
+  return jnicommon::LumaImageView(gray.ptr(y) + x, width, height,
+                                  (int)gray.step);
+}
+
+static double runFrames(DLibHOGFaceDetector &detector, const cv::Mat &gray,
+                        int width, int height, std::vector<FrameResult> &out)
+{
+  out.resize(kFrames);
+  double total = 0;
+  for (int i = 0; i < kFrames; ++i)
+  {
+    const jnicommon::LumaImageView frame = window(gray, i, width, height);
+    auto t0 = std::chrono::steady_clock::now();
+    const int size = detector.det(frame);
+    auto t1 = std::chrono::steady_clock::now();
+    total += std::chrono::duration<double, std::milli>(t1 - t0).count();
+
+    // The biggest face, the one the tracker follows
+    FrameResult &result = out[i];
+    result.found = size > 0;
+    result.parts.clear();
+    if (!result.found)
+      continue;
+    int biggest = 0;
+    for (int j = 1; j < size; ++j)
+      if (detector.getResult()[j].area() > detector.getResult()[biggest].area())
+        biggest = j;
+    result.rect = detector.getResult()[biggest];
+    auto it = detector.getFaceShapeMap().find(biggest);
+    if (it != detector.getFaceShapeMap().end())
+      for (unsigned long j = 0; j < it->second.num_parts(); ++j)
+        result.parts.push_back(it->second.part(j));
+  }
+  return total / kFrames;
+}
+
+int main(int argc, char **argv)
+{
+  cout << "TestFaceTracking" << endl;
+  if (argc < 3)
+  {
+    cout << "Call this program like this:" << endl;
+    cout << "./TestFaceTracking shape_predictor_68_face_landmarks.dat "
+            "lena.bmp [detectInterval]"
+         << endl;
+    return 0;
+  }
+  const int interval = argc > 3 ? atoi(argv[3]) : 10;
+
+  cv::Mat gray = cv::imread(argv[2], CV_LOAD_IMAGE_GRAYSCALE);
+  if (gray.empty())
+  {
+    cout << argv[2] << ": can't read" << endl;
+    return 1;
+  }
+  const int width = gray.cols * 3 / 4;
+  const int height = gray.rows * 3 / 4;
+
+  DLibHOGFaceDetector full(argv[1]);
+  std::vector<FrameResult> reference;
+  const double fullMs = runFrames(full, gray, width, height, reference);
+
+  DLibHOGFaceDetector tracking(argv[1]);
+  tracking.setTracking(interval);
+  std::vector<FrameResult> tracked;
+  const double trackMs = runFrames(tracking, gray, width, height, tracked);
+  const long detects = tracking.getPathCount(DLibHOGFaceDetector::PATH_DETECT);
+  const long tracks = tracking.getPathCount(DLibHOGFaceDetector::PATH_TRACK);
+  const long redetects =
+      tracking.getPathCount(DLibHOGFaceDetector::PATH_REDETECT);
+  const long regions = tracking.getPathCount(DLibHOGFaceDetector::PATH_REGION);
+
+  // Drift against the full scan on the frames where both found a face
+  int compared = 0;
+  int missed = 0;
+  double sumOverlap = 0;
+  double worstOverlap = 1;
+  double sumDistance = 0;
+  long numParts = 0;
+  for (int i = 0; i < kFrames; ++i)
+  {
+    if (!reference[i].found)
+      continue;
+    if (!tracked[i].found)
+    {
+      ++missed;
+      continue;
+    }
+    ++compared;
+    const double o = overlap(reference[i].rect, tracked[i].rect);
+    sumOverlap += o;
+    worstOverlap = std::min(worstOverlap, o);
+    for (size_t j = 0; j < reference[i].parts.size() &&
+                       j < tracked[i].parts.size();
+         ++j)
+    {
+      sumDistance += dlib::length(reference[i].parts[j] - tracked[i].parts[j]);
+      ++numParts;
+    }
+  }
+
+  cout << kFrames << " frames of " << width << "x" << height
+       << ", detect interval " << interval << endl;
+  cout << "  full scan : " << fullMs << " ms/frame" << endl;
+  cout << "  tracking  : " << trackMs << " ms/frame, " << fullMs / trackMs
+       << "x" << endl;
+  cout << "  paths     : " << detects << " detect, " << tracks << " track, "
+       << redetects << " redetect, " << regions << " region" << endl;
+  cout << "  box overlap: " << (compared ? sumOverlap / compared : 0)
+       << " mean, " << worstOverlap << " worst, " << missed << " faces missed"
+       << endl;
+  if (numParts > 0)
+    cout << "  mean landmark distance: " << sumDistance / numParts << " px"
+         << endl;
+
+  bool ok = compared > 0;
+  // A scan, of the region or the whole frame, at least every interval frames
+  ok &= detects + redetects + regions >= (kFrames + interval - 1) / interval;
+  ok &= detects + tracks + redetects + regions == kFrames;
+  ok &= interval <= 1 || tracks > 0;
+  ok &= compared == 0 || sumOverlap / compared > 0.5;
+  cout << (ok ? "PASS" : "FAIL") << endl;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,119 @@
+//============================================================================
+// Name        : TestFhogBands.cpp
+// Author      : Nanyun
+// Version     : 1.0
+// Copyright   : Nanyun
+// Description : Checks that extract_fhog_feature_rows() gives bit-identical
+//               features to extract_fhog_features() however the rows are cut
+//               into bands, then prints how scan_fhog_pyramid::load() spreads
+//               the pyramid over a thread pool and how busy each thread was.
+//============================================================================
+#include <dlib/image_io.h>
+#include <dlib/image_processing/frontal_face_detector.h>
+#include <dlib/threads/thread_pool_extension.h>
+
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+using namespace dlib;
+using namespace std;
+
+static bool checkBands(const array2d<unsigned char> &img)
+{
+  bool ok = true;
+  const int cellSizes[] = {2, 3, 4, 8};
+  const int paddings[] = {1, 6, 10};
+  const int bandRows[] = {1, 3, 8, 1000};
+  for (int cellSize : cellSizes)
+    for (int padding : paddings)
+    {
+      dlib::array<array2d<float> > ref;
+      extract_fhog_features(img, ref, cellSize, padding, padding);
+      for (int step : bandRows)
+      {
+        dlib::array<array2d<float> > hog;
+        const int rows = init_fhog_features(img, hog, cellSize, padding, padding);
+        // Last band first, so no band can lean on rows done before it
+        for (int first = (rows - 1) / step * step; first >= 0; first -= step)
+          extract_fhog_feature_rows(img, hog, first, std::min(rows, first + step),
+                                    cellSize, padding, padding);
+        for (unsigned long i = 0; i < ref.size(); ++i)
+        {
+          if (hog[i].nr() != ref[i].nr() || hog[i].nc() != ref[i].nc() ||
+              memcmp(image_data(hog[i]), image_data(ref[i]),
+                     ref[i].size() * sizeof(float)) != 0)
+          {
+            cout << "  cell size " << cellSize << ", padding " << padding
+                 << ", bands of " << step << " rows: plane " << i << " differs"
+                 << endl;
+            ok = false;
+            break;
+          }
+        }
+      }
+    }
+  return ok;
+}
+
+static void printStats(const fhog_thread_stats &stats)
+{
+  cout << "    " << stats.num_levels << " levels in " << stats.num_tasks
+       << " tasks (" << stats.num_bands << " bands), " << stats.wall_ms
+       << " ms, busy ms per thread:";
+  for (double ms : stats.busy_ms)
+    cout << " " << ms;
+  cout << ", utilisation " << stats.utilisation() << endl;
+}
+
+int main(int argc, char **argv)
+{
+  cout << "TestFhogBands" << endl;
+  if (argc < 2)
+  {
+    cout << "Call this program like this:" << endl;
+    cout << "./TestFhogBands lena.jpg faces/*.jpg" << endl;
+    return 0;
+  }
+
+  bool ok = true;
+  frontal_face_detector detector = get_frontal_face_detector();
+  thread_pool pool(3);
+  for (int i = 1; i < argc; ++i)
+  {
+    array2d<unsigned char> img;
+    load_image(img, argv[i]);
+    cout << argv[i] << " " << img.nc() << "x" << img.nr() << endl;
+    ok = checkBands(img) && ok;
+
+    // The same faces from banded levels as from whole ones
+    std::vector<rect_detection> ref, dets;
+    detector.get_scanner().set_thread_pool(0);
+    detector(img, ref);
+    cout << "  no pool" << endl;
+    printStats(detector.get_scanner().get_thread_stats());
+    detector.get_scanner().set_thread_pool(&pool);
+    detector(img, dets);
+    cout << "  3 threads" << endl;
+    const fhog_thread_stats &stats = detector.get_scanner().get_thread_stats();
+    printStats(stats);
+    if (stats.num_bands == 0 || stats.busy_ms.size() < 3)
+    {
+      cout << "  the biggest levels weren't cut into bands" << endl;
+      ok = false;
+    }
+    bool same = ref.size() == dets.size();
+    for (unsigned long j = 0; same && j < ref.size(); ++j)
+      same = ref[j].rect == dets[j].rect &&
+             ref[j].detection_confidence == dets[j].detection_confidence;
+    if (!same)
+    {
+      cout << "  the faces differ with the pool" << endl;
+      ok = false;
+    }
+  }
+  detector.get_scanner().set_thread_pool(0);
+
+  cout << (ok ? "PASS" : "FAIL") << endl;
+  return ok ? 0 : 1;
+}
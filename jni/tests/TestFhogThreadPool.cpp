@@ -0,0 +1,99 @@
+//============================================================================
+// Name        : TestFhogThreadPool.cpp
+// Author      : Nanyun
+// Version     : 1.0
+// Copyright   : Nanyun
+// Description : Checks that the frontal face detector gives bit-identical
+//               results on the calling thread and on thread pools of any
+//               size, and prints the time per frame for each pool size.
+//============================================================================
+#include <dlib/image_processing/frontal_face_detector.h>
+#include <dlib/image_io.h>
+#include <dlib/threads/thread_pool_extension.h>
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "test_util.h"
+
+using namespace dlib;
+using namespace std;
+
+template <typename image_type>
+static bool checkImage(frontal_face_detector &detector, const image_type &img)
+{
+  const int kRuns = 5;
+  detector.get_scanner().set_thread_pool(0);
+  std::vector<rect_detection> ref;
+  detector(img, ref);
+
+  bool ok = true;
+  for (int numThreads = 0; numThreads <= 4; ++numThreads)
+  {
+    thread_pool pool(numThreads);
+    detector.get_scanner().set_thread_pool(&pool);
+    double total = 0;
+    for (int i = 0; i < kRuns; ++i)
+    {
+      std::vector<rect_detection> dets;
+      auto t0 = std::chrono::steady_clock::now();
+      detector(img, dets);
+      auto t1 = std::chrono::steady_clock::now();
+      total += std::chrono::duration<double, std::milli>(t1 - t0).count();
+      if (!sameDetections(ref, dets))
+      {
+        cout << "  threads " << numThreads << ": results differ" << endl;
+        ok = false;
+        break;
+      }
+    }
+    cout << "  threads " << numThreads << ": " << ref.size() << " faces, "
+         << total / kRuns << " ms/frame" << endl;
+  }
+  detector.get_scanner().set_thread_pool(0);
+
+  // The banded grayscale resize on its own
+  array2d<unsigned char> gray, ref_small, small;
+  assign_image(gray, img);
+  ref_small.set_size(gray.nr() * 5 / 6, gray.nc() * 5 / 6);
+  small.set_size(ref_small.nr(), ref_small.nc());
+  resize_image(gray, ref_small, interpolate_bilinear());
+  thread_pool pool(3);
+  resize_image(gray, small, interpolate_bilinear(), &pool);
+  if (memcmp(image_data(ref_small), image_data(small),
+             ref_small.size() * sizeof(unsigned char)) != 0)
+  {
+    cout << "  resize_image results differ" << endl;
+    ok = false;
+  }
+  return ok;
+}
+
+int main(int argc, char **argv)
+{
+  cout << "TestFhogThreadPool" << endl;
+  if (argc == 1)
+  {
+    cout << "Give some bmp files as arguments to this program." << endl;
+    return 0;
+  }
+
+  frontal_face_detector detector = get_frontal_face_detector();
+  bool ok = true;
+  for (int i = 1; i < argc; ++i)
+  {
+    array2d<rgb_pixel> img;
+    load_bmp(img, argv[i]);
+    array2d<unsigned char> gray;
+    assign_image(gray, img);
+
+    cout << argv[i] << " (rgb)" << endl;
+    ok = checkImage(detector, img) && ok;
+    cout << argv[i] << " (gray)" << endl;
+    ok = checkImage(detector, gray) && ok;
+  }
+  cout << (ok ? "PASS" : "FAIL") << endl;
+  return ok ? 0 : 1;
+}
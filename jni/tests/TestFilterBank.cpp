@@ -0,0 +1,114 @@
+//============================================================================
+// Name        : TestFilterBank.cpp
+// Author      : Nanyun
+// Version     : 1.0
+// Copyright   : Nanyun
+// Description : Checks that float_filter_bank_separable() gives the same
+//               saliency as one float_spatially_filter_image_separable() per
+//               filter, over random planes, filter sizes and blocks, then that
+//               scan_fhog_pyramid finds the same faces with the fused filter
+//               bank. Prints the time per frame both ways.
+//============================================================================
+#include <dlib/image_io.h>
+#include <dlib/image_processing/frontal_face_detector.h>
+
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+#include "test_util.h"
+
+using namespace dlib;
+using namespace std;
+
+static const int kRuns = 5;
+
+static bool checkKernel()
+{
+  const long blocks[] = {0, 1, 3, 7};
+  bool ok = true;
+  int checked = 0, identical = 0;
+  double worst = 0;
+  forEachRandomBank([&](const long *size, const long *image,
+                        const dlib::array<array2d<float> > &planes,
+                        const filter_bank &rowFilters,
+                        const filter_bank &colFilters) {
+    array2d<float> ref, scratch;
+    rectangle refArea;
+    bool addTo = false;
+    for (int i = 0; i < kPlanes; ++i)
+      for (unsigned long j = 0; j < rowFilters[i].size(); ++j)
+      {
+        refArea = float_spatially_filter_image_separable(
+            planes[i], ref, rowFilters[i][j], colFilters[i][j], scratch, addTo);
+        addTo = true;
+      }
+
+    for (long block : blocks)
+    {
+      array2d<float> out, bankScratch;
+      const rectangle area = float_filter_bank_separable(
+          planes, rowFilters, colFilters, out, bankScratch, block);
+      const double err = relativeError(ref, out);
+      ++checked;
+      worst = std::max(worst, err);
+      if (err == 0 && memcmp(image_data(ref), image_data(out),
+                             ref.size() * sizeof(float)) == 0)
+        ++identical;
+      if (area != refArea || err > 1e-5)
+      {
+        cout << "  " << size[0] << "x" << size[1] << " filters on " << image[1]
+             << "x" << image[0] << " planes, blocks of " << block
+             << " rows: error " << err << endl;
+        ok = false;
+      }
+    }
+  });
+  cout << "checked " << checked << " filter banks, " << identical
+       << " bit-identical, worst relative error " << worst << endl;
+  return ok;
+}
+
+int main(int argc, char **argv)
+{
+  cout << "TestFilterBank" << endl;
+  if (argc < 2)
+  {
+    cout << "Call this program like this:" << endl;
+    cout << "./TestFilterBank lena.jpg faces/*.jpg" << endl;
+    return 0;
+  }
+
+  bool ok = checkKernel();
+
+  frontal_face_detector detector = get_frontal_face_detector();
+  scan_fhog_pyramid<pyramid_down<6> > &scanner = detector.get_scanner();
+  cout << "ms/frame: one filter at a time, fused filter bank" << endl;
+  for (int i = 1; i < argc; ++i)
+  {
+    array2d<unsigned char> img;
+    load_image(img, argv[i]);
+    std::vector<rect_detection> ref, dets;
+    scanner.set_fused_filter_bank(false);
+    const double refMs = timeMs(kRuns, [&] { detector(img, ref); });
+    scanner.set_fused_filter_bank(true);
+    const double fusedMs = timeMs(kRuns, [&] { detector(img, dets); });
+
+    bool same = ref.size() == dets.size();
+    for (unsigned long j = 0; same && j < ref.size(); ++j)
+      same = overlap(ref[j].rect, dets[j].rect) > 0.99 &&
+             std::abs(ref[j].detection_confidence -
+                      dets[j].detection_confidence) < 1e-4;
+    if (!same)
+    {
+      cout << "  " << argv[i] << ": the faces differ" << endl;
+      ok = false;
+    }
+    cout << "  " << argv[i] << " " << img.nc() << "x" << img.nr() << ": "
+         << refMs << ", " << fusedMs << endl;
+  }
+
+  cout << (ok ? "PASS" : "FAIL") << endl;
+  return ok ? 0 : 1;
+}
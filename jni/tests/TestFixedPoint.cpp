@@ -0,0 +1,125 @@
+//============================================================================
+// Name        : TestFixedPoint.cpp
+// Author      : Nanyun
+// Version     : 1.0
+// Copyright   : Nanyun
+// Description : Checks that fixed_filter_bank_separable() over int16 planes
+//               and filters stays close to float_filter_bank_separable(), over
+//               random planes and filters, then that scan_fhog_pyramid finds the
+//               same faces with set_fixed_point() as in float. Prints the error
+//               and the time per frame both ways.
+//============================================================================
+#include <dlib/image_io.h>
+#include <dlib/image_processing/frontal_face_detector.h>
+
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include "test_util.h"
+
+using namespace dlib;
+using namespace std;
+
+static const int kRuns = 5;
+// Relative to the biggest output of a level
+static const double kMaxKernelError = 1e-3;
+static const double kMaxScoreError = 0.01;
+
+static bool checkKernel()
+{
+  bool ok = true;
+  int checked = 0;
+  double worst = 0;
+  forEachRandomBank([&](const long *size, const long *image,
+                        const dlib::array<array2d<float> > &planes,
+                        const filter_bank &rowFilters,
+                        const filter_bank &colFilters) {
+    array2d<float> ref, scratch;
+    const rectangle refArea = float_filter_bank_separable(
+        planes, rowFilters, colFilters, ref, scratch);
+
+    dlib::array<array2d<int16> > fixedPlanes(kPlanes);
+    std::vector<float> scales(kPlanes);
+    std::vector<std::vector<fixed_separable_filter> > filters(kPlanes);
+    for (int i = 0; i < kPlanes; ++i)
+    {
+      scales[i] = quantize_plane(planes[i], fixedPlanes[i]);
+      filters[i].resize(rowFilters[i].size());
+      for (unsigned long j = 0; j < rowFilters[i].size(); ++j)
+        quantize_separable_filter(rowFilters[i][j], colFilters[i][j],
+                                  filters[i][j]);
+    }
+    array2d<float> out;
+    array2d<int16> fixedScratch;
+    const rectangle area = fixed_filter_bank_separable(
+        fixedPlanes, scales, filters, out, fixedScratch);
+
+    const double err = relativeError(ref, out);
+    ++checked;
+    worst = std::max(worst, err);
+    if (area != refArea || err > kMaxKernelError)
+    {
+      cout << "  " << size[0] << "x" << size[1] << " filters on " << image[1]
+           << "x" << image[0] << " planes: error " << err << endl;
+      ok = false;
+    }
+  });
+  cout << "checked " << checked << " filter banks, worst relative error "
+       << worst << endl;
+  return ok;
+}
+
+int main(int argc, char **argv)
+{
+  cout << "TestFixedPoint" << endl;
+  if (argc < 2)
+  {
+    cout << "Call this program like this:" << endl;
+    cout << "./TestFixedPoint lena.jpg faces/*.jpg" << endl;
+    return 0;
+  }
+
+  bool ok = checkKernel();
+
+  frontal_face_detector detector = get_frontal_face_detector();
+  scan_fhog_pyramid<pyramid_down<6> > &scanner = detector.get_scanner();
+  int numFaces = 0, numSame = 0;
+  double worstScore = 0;
+  cout << "ms/frame: float, fixed point" << endl;
+  for (int i = 1; i < argc; ++i)
+  {
+    array2d<unsigned char> img;
+    load_image(img, argv[i]);
+    std::vector<rect_detection> ref, dets;
+    scanner.set_fixed_point(false);
+    const double floatMs = timeMs(kRuns, [&] { detector(img, ref); });
+    scanner.set_fixed_point(true);
+    const double fixedMs = timeMs(kRuns, [&] { detector(img, dets); });
+
+    numFaces += ref.size();
+    for (const rect_detection &face : ref)
+      for (const rect_detection &det : dets)
+        if (face.rect == det.rect && face.weight_index == det.weight_index)
+        {
+          const double diff =
+              std::abs(face.detection_confidence - det.detection_confidence);
+          worstScore = std::max(worstScore, diff);
+          if (diff < kMaxScoreError)
+            ++numSame;
+          break;
+        }
+    if (ref.size() != dets.size())
+      ok = false;
+    cout << "  " << argv[i] << " " << img.nc() << "x" << img.nr() << ": "
+         << floatMs << ", " << fixedMs << endl;
+  }
+  scanner.set_fixed_point(false);
+  cout << "fixed point found " << numSame << " of " << numFaces
+       << " faces, worst score difference " << worstScore << endl;
+  if (numSame != numFaces)
+    ok = false;
+
+  cout << (ok ? "PASS" : "FAIL") << endl;
+  return ok ? 0 : 1;
+}
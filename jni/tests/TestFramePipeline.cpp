@@ -0,0 +1,240 @@
+//============================================================================
+// Name        : TestFramePipeline.cpp
+// Author      : Nanyun
+// Version     : 1.0
+// Copyright   : Nanyun
+// Description : Feeds FramePipeline frames faster than a slow fake detector
+//               takes them, under both drop policies. Checks that every
+//               result belongs to its frame, that results come out in frame
+//               order, and that every frame is either processed or dropped.
+//               A stopped pipeline must refuse frames and never call its work
+//               function again. Prints what submit() costs the camera thread.
+//============================================================================
+#include <frame_pipeline.h>
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using jnicommon::uint8;
+
+// A frame whose pixels depend on its number, with padded rows
+static void fillFrame(std::vector<uint8> &plane, int width, int height,
+                      int stride, long number)
+{
+  plane.assign((size_t)stride * height, 0xff);
+  for (int r = 0; r < height; ++r)
+    for (int c = 0; c < width; ++c)
+      plane[(size_t)r * stride + c] = (uint8)(number * 7 + r * 3 + c);
+}
+
+static float checksum(const uint8 *data, int width, int height, int stride)
+{
+  double sum = 0;
+  for (int r = 0; r < height; ++r)
+    for (int c = 0; c < width; ++c)
+      sum += data[(long)r * stride + c] * (1 + (r + c) % 5);
+  return (float)sum;
+}
+
+static bool runPolicy(FramePipeline::DropPolicy policy, const char *name)
+{
+  const int width = 64;
+  const int height = 48;
+  const int stride = width + 16;
+  const int kFrames = 60;
+
+  // Written by the worker only, read after drain()
+  std::vector<float> processedSums;
+  FramePipeline pipeline(
+      3, policy, [&](const jnicommon::LumaImageView &frame,
+                     std::vector<float> &values) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(4));
+        const float sum = checksum(frame.data(), frame.width(), frame.height(),
+                                   frame.rowStride());
+        processedSums.push_back(sum);
+        values.assign(1, sum);
+      });
+
+  bool ok = true;
+  std::vector<float> expected(kFrames);
+  std::vector<uint8> plane;
+  long lastPolled = -1;
+  long accepted = 0;
+  for (int i = 0; i < kFrames; ++i)
+  {
+    fillFrame(plane, width, height, stride, i);
+    expected[i] = checksum(&plane[0], width, height, stride);
+    const long frameId =
+        pipeline.submit(jnicommon::LumaImageView(&plane[0], width, height,
+                                                 stride));
+    if (frameId >= 0)
+    {
+      // Ids count the accepted frames
+      if (frameId != accepted)
+      {
+        cout << "  " << name << ": frame " << i << " got id " << frameId
+             << endl;
+        ok = false;
+      }
+      ++accepted;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    const FramePipeline::Result *result = pipeline.poll();
+    if (result != NULL)
+    {
+      if (result->frameId <= lastPolled)
+      {
+        cout << "  " << name << ": result " << result->frameId << " after "
+             << lastPolled << endl;
+        ok = false;
+      }
+      lastPolled = result->frameId;
+    }
+  }
+  pipeline.drain();
+
+  const FramePipeline::Stats stats = pipeline.getStats();
+  cout << "  " << name << ": submitted " << stats.submitted << ", dropped "
+       << stats.dropped << ", processed " << stats.processed << endl;
+  if (stats.submitted != kFrames ||
+      stats.submitted != stats.processed + stats.dropped ||
+      stats.processed != (long)processedSums.size() || stats.dropped == 0)
+  {
+    cout << "  " << name << ": the counts don't add up" << endl;
+    ok = false;
+  }
+
+  // Every processed frame is a submitted one, taken in submission order
+  size_t next = 0;
+  for (float sum : processedSums)
+  {
+    while (next < expected.size() && expected[next] != sum)
+      ++next;
+    if (next == expected.size())
+    {
+      cout << "  " << name << ": a result matches no frame in order" << endl;
+      ok = false;
+      break;
+    }
+    ++next;
+  }
+
+  // The last frame is always kept when dropping the oldest
+  if (policy == FramePipeline::DROP_OLDEST &&
+      (processedSums.empty() || processedSums.back() != expected.back()))
+  {
+    cout << "  " << name << ": the newest frame wasn't processed" << endl;
+    ok = false;
+  }
+
+  // The newest result is still there for a poll that missed it
+  const FramePipeline::Result *result = pipeline.poll();
+  if (result != NULL && (result->values.size() != 1 ||
+                         result->values[0] != processedSums.back()))
+  {
+    cout << "  " << name << ": the last result is wrong" << endl;
+    ok = false;
+  }
+  if (pipeline.poll() != NULL)
+  {
+    cout << "  " << name << ": polled the same result twice" << endl;
+    ok = false;
+  }
+  return ok;
+}
+
+int main(int argc, char **argv)
+{
+  cout << "TestFramePipeline" << endl;
+  bool ok = runPolicy(FramePipeline::DROP_NEWEST, "drop newest");
+  ok &= runPolicy(FramePipeline::DROP_OLDEST, "drop oldest");
+
+  // Stopping with frames waiting must not hang
+  {
+    FramePipeline pipeline(
+        2, FramePipeline::DROP_NEWEST,
+        [](const jnicommon::LumaImageView &, std::vector<float> &) {
+          std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        });
+    std::vector<uint8> plane(16, 1);
+    for (int i = 0; i < 4; ++i)
+      pipeline.submit(jnicommon::LumaImageView(&plane[0], 4, 4, 4));
+  }
+
+  // Nothing runs after stop(), though the pipeline is still there for the
+  // threads holding it
+  {
+    std::atomic<int> calls(0);
+    FramePipeline pipeline(
+        2, FramePipeline::DROP_OLDEST,
+        [&](const jnicommon::LumaImageView &, std::vector<float> &) {
+          ++calls;
+          std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        },
+        4, 4);
+    std::vector<uint8> plane(16, 1);
+    const jnicommon::LumaImageView frame(&plane[0], 4, 4, 4);
+    pipeline.submit(frame);
+    pipeline.submit(frame);
+    pipeline.stop();
+    const int callsAtStop = calls;
+    if (pipeline.submit(frame) != -1)
+    {
+      cout << "  a stopped pipeline took a frame" << endl;
+      ok = false;
+    }
+    pipeline.drain();
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    const FramePipeline::Stats stats = pipeline.getStats();
+    if (calls != callsAtStop ||
+        stats.submitted != stats.processed + stats.dropped)
+    {
+      cout << "  the work function ran after stop()" << endl;
+      ok = false;
+    }
+  }
+
+  // What the camera thread pays for a 1080p frame while a 30 ms detection
+  // runs, against running the detection itself
+  const int width = 1920;
+  const int height = 1080;
+  std::vector<uint8> plane((size_t)width * height, 128);
+  jnicommon::LumaImageView frame(&plane[0], width, height, width);
+  FramePipeline pipeline(
+      2, FramePipeline::DROP_OLDEST,
+      [](const jnicommon::LumaImageView &, std::vector<float> &) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(30));
+      },
+      width, height);
+  const int kRuns = 30;
+  double total = 0;
+  double worst = 0;
+  for (int i = 0; i < kRuns; ++i)
+  {
+    auto s0 = std::chrono::steady_clock::now();
+    pipeline.submit(frame);
+    auto s1 = std::chrono::steady_clock::now();
+    const double ms = std::chrono::duration<double, std::milli>(s1 - s0).count();
+    total += ms;
+    worst = std::max(worst, ms);
+    std::this_thread::sleep_for(std::chrono::milliseconds(16));
+  }
+  pipeline.drain();
+  const FramePipeline::Stats stats = pipeline.getStats();
+  cout << "1080p submit at 60 fps with a 30 ms detector: " << total / kRuns
+       << " ms/frame average, " << worst << " ms worst, " << stats.processed
+       << " of " << stats.submitted << " frames detected" << endl;
+  // submit() only copies the frame, it never waits for the detector
+  if (worst >= 30)
+  {
+    cout << "  submit() blocked for " << worst << " ms" << endl;
+    ok = false;
+  }
+
+  cout << (ok ? "PASS" : "FAIL") << endl;
+  return ok ? 0 : 1;
+}
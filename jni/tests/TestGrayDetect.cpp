@@ -0,0 +1,122 @@
+//============================================================================
+// Name        : TestGrayDetect.cpp
+// Author      : Nanyun
+// Version     : 1.0
+// Copyright   : Nanyun
+// Description : Compares DLibHOGFaceDetector on a BGR image and on its gray
+//               version. Prints the speedup of the gray path, how many faces
+//               both paths agree on, and how far apart their landmarks are.
+//============================================================================
+#include <detector.h>
+
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+#include "test_util.h"
+
+using namespace std;
+
+static const int kRuns = 5;
+
+static double timeDet(DLibHOGFaceDetector &detector, const cv::Mat &img)
+{
+  double total = 0;
+  for (int i = 0; i < kRuns; ++i)
+  {
+    auto t0 = std::chrono::steady_clock::now();
+    detector.det(img);
+    auto t1 = std::chrono::steady_clock::now();
+    total += std::chrono::duration<double, std::milli>(t1 - t0).count();
+  }
+  return total / kRuns;
+}
+
+int main(int argc, char **argv)
+{
+  cout << "TestGrayDetect" << endl;
+  if (argc < 3)
+  {
+    cout << "Call this program like this:" << endl;
+    cout << "./TestGrayDetect shape_predictor_68_face_landmarks.dat "
+            "lena.jpg faces/*.jpg"
+         << endl;
+    cout << "Pass \"\" as the model to skip the landmarks." << endl;
+    return 0;
+  }
+
+  DLibHOGFaceDetector detector(argv[1]);
+  double bgrTotal = 0;
+  double grayTotal = 0;
+  int bgrFaces = 0;
+  int grayFaces = 0;
+  int matched = 0;
+  double landmarkDist = 0;
+  long numLandmarks = 0;
+  for (int i = 2; i < argc; ++i)
+  {
+    cv::Mat bgr = cv::imread(argv[i], CV_LOAD_IMAGE_COLOR);
+    if (bgr.empty())
+    {
+      cout << argv[i] << ": can't read" << endl;
+      continue;
+    }
+    cv::Mat gray;
+    cv::cvtColor(bgr, gray, CV_BGR2GRAY);
+
+    double bgrMs = timeDet(detector, bgr);
+    std::vector<dlib::rectangle> bgrRects = detector.getResult();
+    auto bgrShapes = detector.getFaceShapeMap();
+    double grayMs = timeDet(detector, gray);
+    std::vector<dlib::rectangle> grayRects = detector.getResult();
+    auto &grayShapes = detector.getFaceShapeMap();
+
+    // Pair every BGR face with the gray face it overlaps most
+    int imageMatched = 0;
+    for (unsigned long j = 0; j < bgrRects.size(); ++j)
+    {
+      double best = 0;
+      unsigned long bestIdx = 0;
+      for (unsigned long k = 0; k < grayRects.size(); ++k)
+      {
+        if (overlap(bgrRects[j], grayRects[k]) > best)
+        {
+          best = overlap(bgrRects[j], grayRects[k]);
+          bestIdx = k;
+        }
+      }
+      if (best < 0.5)
+        continue;
+      ++imageMatched;
+      if (bgrShapes.count(j) && grayShapes.count(bestIdx))
+      {
+        const dlib::full_object_detection &a = bgrShapes[j];
+        const dlib::full_object_detection &b = grayShapes[bestIdx];
+        for (unsigned long p = 0; p < a.num_parts() && p < b.num_parts(); ++p)
+        {
+          landmarkDist += dlib::length(a.part(p) - b.part(p));
+          ++numLandmarks;
+        }
+      }
+    }
+
+    cout << argv[i] << ": bgr " << bgrRects.size() << " faces " << bgrMs
+         << " ms, gray " << grayRects.size() << " faces " << grayMs
+         << " ms, matched " << imageMatched << endl;
+    bgrTotal += bgrMs;
+    grayTotal += grayMs;
+    bgrFaces += bgrRects.size();
+    grayFaces += grayRects.size();
+    matched += imageMatched;
+  }
+
+  cout << "bgr  : " << bgrFaces << " faces, " << bgrTotal << " ms" << endl;
+  cout << "gray : " << grayFaces << " faces, " << grayTotal << " ms" << endl;
+  if (grayTotal > 0)
+    cout << "speedup: " << bgrTotal / grayTotal << "x" << endl;
+  cout << "matched faces: " << matched << " of " << bgrFaces << endl;
+  if (numLandmarks > 0)
+    cout << "mean landmark distance: " << landmarkDist / numLandmarks
+         << " px" << endl;
+  return 0;
+}
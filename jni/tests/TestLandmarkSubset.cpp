@@ -0,0 +1,180 @@
+//============================================================================
+// Name        : TestLandmarkSubset.cpp
+// Author      : Nanyun
+// Version     : 1.0
+// Copyright   : Nanyun
+// Description : Trains a small 68 landmark shape_predictor on the faces of
+//               training_with_face_landmarks.xml and cuts it down with
+//               select_parts() to the landmarks the liveness checks read, 30
+//               and 36 to 54. On the faces of testing_with_face_landmarks.xml
+//               it prints how far the kept landmarks move from where the full
+//               model puts them, and from the labelled ones, for the shape
+//               aligned by all the kept landmarks and by the rigid ones only,
+//               and the time per face. Keeping every landmark must give the
+//               full model's landmarks.
+//============================================================================
+#include <dlib/data_io.h>
+#include <dlib/image_processing.h>
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#include "test_util.h"
+
+using namespace dlib;
+using namespace std;
+
+static const int kRuns = 20;
+static const unsigned long kParts = 68;
+
+// The landmarks the liveness checks read, and the ones that move with the head
+// but not with a blink or a smile, which the shape is aligned by
+static std::vector<unsigned long> livenessParts()
+{
+  std::vector<unsigned long> parts(1, 30);
+  for (unsigned long j = 36; j <= 54; ++j)
+    parts.push_back(j);
+  return parts;
+}
+
+static std::vector<unsigned long> rigidParts()
+{
+  const unsigned long parts[] = {27, 28, 29, 30, 31, 33, 35, 36, 39, 42, 45};
+  return std::vector<unsigned long>(parts, parts + sizeof(parts) / sizeof(parts[0]));
+}
+
+struct Errors
+{
+  double toFull = 0, maxToFull = 0, toLabels = 0, ms = 0;
+};
+
+int main(int argc, char **argv)
+{
+  cout << "TestLandmarkSubset" << endl;
+  if (argc < 3)
+  {
+    cout << "Call this program like this:" << endl;
+    cout << "./TestLandmarkSubset faces/training_with_face_landmarks.xml "
+            "faces/testing_with_face_landmarks.xml"
+         << endl;
+    return 0;
+  }
+
+  dlib::array<array2d<unsigned char> > trainImages, testImages;
+  std::vector<std::vector<full_object_detection> > trainFaces, testFaces;
+  load_image_dataset(trainImages, trainFaces, argv[1]);
+  load_image_dataset(testImages, testFaces, argv[2]);
+
+  shape_predictor_trainer trainer;
+  trainer.set_oversampling_amount(20);
+  trainer.set_nu(0.1);
+  trainer.set_cascade_depth(10);
+  trainer.set_num_threads(1);
+  const shape_predictor sp = trainer.train(trainImages, trainFaces);
+
+  const std::vector<unsigned long> kept = livenessParts();
+  const shape_predictor allAligned = sp.select_parts(kept, std::vector<unsigned long>());
+  const shape_predictor rigidAligned = sp.select_parts(kept, rigidParts());
+  std::vector<unsigned long> everyPart;
+  for (unsigned long j = 0; j < kParts; ++j)
+    everyPart.push_back(j);
+  const shape_predictor allParts = sp.select_parts(everyPart, everyPart);
+
+  bool ok = true;
+  if (rigidAligned.num_parts() != kParts || rigidAligned.num_found_parts() != 26)
+  {
+    cout << "  the cut down model has " << rigidAligned.num_parts() << " parts, "
+         << rigidAligned.num_found_parts() << " found" << endl;
+    ok = false;
+  }
+  try
+  {
+    std::ostringstream out;
+    serialize(rigidAligned, out);
+    cout << "  a cut down model was serialized" << endl;
+    ok = false;
+  }
+  catch (serialization_error &)
+  {
+  }
+
+  // the parts each cut down model finds, the others must be left out
+  std::vector<bool> found[2];
+  found[0].assign(kParts, false);
+  for (unsigned long j : kept)
+    found[0][j] = true;
+  found[1] = found[0];
+  for (unsigned long j : rigidParts())
+    found[1][j] = true;
+
+  int numFaces = 0, numSame = 0;
+  double fullMs = 0, fullToLabels = 0, interocular = 0;
+  Errors all, rigid;
+  for (unsigned long i = 0; i < testImages.size(); ++i)
+  {
+    for (const full_object_detection &truth : testFaces[i])
+    {
+      const rectangle &face = truth.get_rect();
+      full_object_detection full, shape;
+      fullMs += timeMs(kRuns, [&] { full = sp(testImages[i], face); });
+      interocular += length(full.part(36) - full.part(45));
+      for (unsigned long j : kept)
+        fullToLabels += length(full.part(j) - truth.part(j));
+
+      shape = allParts(testImages[i], face);
+      bool same = true;
+      for (unsigned long j = 0; j < kParts; ++j)
+        same = same && shape.part(j) == full.part(j);
+      if (same)
+        ++numSame;
+
+      const shape_predictor *subsets[] = {&allAligned, &rigidAligned};
+      Errors *errors[] = {&all, &rigid};
+      for (int k = 0; k < 2; ++k)
+      {
+        errors[k]->ms += timeMs(kRuns, [&] { shape = (*subsets[k])(testImages[i], face); });
+        for (unsigned long j = 0; j < kParts; ++j)
+        {
+          if (!found[k][j])
+          {
+            if (shape.part(j) != OBJECT_PART_NOT_PRESENT)
+              ok = false;
+            continue;
+          }
+          if (std::find(kept.begin(), kept.end(), j) == kept.end())
+            continue;
+          const double d = length(shape.part(j) - full.part(j));
+          errors[k]->toFull += d;
+          errors[k]->maxToFull = std::max(errors[k]->maxToFull, d);
+          errors[k]->toLabels += length(shape.part(j) - truth.part(j));
+        }
+      }
+      ++numFaces;
+    }
+  }
+  if (numSame != numFaces)
+    ok = false;
+
+  const double numPoints = numFaces * kept.size();
+  cout << "model " << sp.num_parts() << " parts, cut down to " << kept.size()
+       << " liveness parts" << endl;
+  cout << "every part kept: same landmarks on " << numSame << " of " << numFaces
+       << " faces" << endl;
+  cout << "mean interocular distance " << interocular / numFaces << " pixels" << endl;
+  cout << "full model: " << fullToLabels / numPoints << " pixels from the labels, "
+       << fullMs / numFaces << " ms/face" << endl;
+  const char *names[] = {"aligned by all kept parts", "aligned by rigid parts"};
+  const Errors *errors[] = {&all, &rigid};
+  for (int k = 0; k < 2; ++k)
+  {
+    cout << names[k] << ": " << errors[k]->toFull / numPoints
+         << " pixels from the full model (at most " << errors[k]->maxToFull
+         << "), " << errors[k]->toLabels / numPoints << " from the labels, "
+         << errors[k]->ms / numFaces << " ms/face" << endl;
+  }
+
+  cout << (ok ? "PASS" : "FAIL") << endl;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,120 @@
+//============================================================================
+// Name        : TestLiveness.cpp
+// Author      : Nanyun
+// Version     : 1.0
+// Copyright   : Nanyun
+// Description : Feeds random landmark sequences to LivenessSession and
+//               checks every answer against the batch rightRotate(),
+//               leftRotate() and eyeClosed() on the same frames.
+//============================================================================
+#include <liveness.h>
+
+#include <chrono>
+#include <deque>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+// A face whose pupils are about right and left pixels from the nose, with
+// eyes open or closed. The eye points get some noise so the pupil averages
+// round differently from frame to frame.
+static std::vector<InnerPoint> makeFace(std::mt19937 &rng, int right,
+                                        int left, int eyeHeight)
+{
+  std::uniform_int_distribution<int> noise(-3, 3);
+  std::vector<InnerPoint> points(LivenessSession::NUM_LANDMARKS);
+  for (int j = 0; j < LivenessSession::NUM_LANDMARKS; ++j)
+  {
+    points[j].x = 200 + noise(rng);
+    points[j].y = 200 + noise(rng);
+  }
+  const int noseX = 200;
+  points[30].x = noseX;
+  // The eye outlines: corners 0 and 3, upper lids 1 and 2, lower lids 4 and 5
+  const int dx[6] = {-12, -4, 4, 12, 4, -4};
+  const int dy[6] = {0, -1, -1, 0, 1, 1};
+  for (int k = 0; k < 6; ++k)
+  {
+    points[36 + k].x = noseX - left + dx[k] + noise(rng);
+    points[36 + k].y = 150 + dy[k] * eyeHeight;
+    points[42 + k].x = noseX + right + dx[k] + noise(rng);
+    points[42 + k].y = 150 + dy[k] * eyeHeight;
+  }
+  return points;
+}
+
+int main(int argc, char **argv)
+{
+  cout << "TestLiveness" << endl;
+  std::mt19937 rng(1234);
+  std::uniform_int_distribution<int> distance(0, 60);
+  std::uniform_int_distribution<int> eyeHeight(0, 8);
+  std::uniform_int_distribution<int> kind(0, 9);
+
+  const int kFrames = 20000;
+  bool ok = true;
+  long mismatches = 0;
+  double sessionMs = 0;
+  double batchMs = 0;
+  for (int capacity = 1; capacity <= 16 && ok; capacity += 3)
+  {
+    LivenessSession session(capacity);
+    std::deque<std::vector<InnerPoint>> history;
+    for (int i = 0; i < kFrames; ++i)
+    {
+      std::vector<InnerPoint> face;
+      switch (kind(rng))
+      {
+      case 0:
+        // Same ratio at a different scale, so the earliest frame must win
+        face = makeFace(rng, 20, 20, eyeHeight(rng));
+        break;
+      case 1:
+        face = makeFace(rng, 40, 40, eyeHeight(rng));
+        break;
+      case 2:
+        // No distance on one side
+        face = makeFace(rng, distance(rng), 0, eyeHeight(rng));
+        break;
+      default:
+        face = makeFace(rng, distance(rng), distance(rng), eyeHeight(rng));
+        break;
+      }
+
+      auto t0 = std::chrono::steady_clock::now();
+      session.push(face);
+      bool right = session.rightRotate();
+      bool left = session.leftRotate();
+      bool closed = session.eyeClosed();
+      auto t1 = std::chrono::steady_clock::now();
+
+      history.push_back(face);
+      if ((int)history.size() > capacity)
+        history.pop_front();
+      std::vector<std::vector<InnerPoint>> frames(history.begin(),
+                                                  history.end());
+      auto t2 = std::chrono::steady_clock::now();
+      bool refRight = rightRotate(frames);
+      bool refLeft = leftRotate(frames);
+      bool refClosed = eyeClosed(frames);
+      auto t3 = std::chrono::steady_clock::now();
+
+      sessionMs += std::chrono::duration<double, std::milli>(t1 - t0).count();
+      batchMs += std::chrono::duration<double, std::milli>(t3 - t2).count();
+      if (right != refRight || left != refLeft || closed != refClosed)
+      {
+        if (mismatches++ < 10)
+          cout << "  capacity " << capacity << " frame " << i << ": session "
+               << right << left << closed << ", batch " << refRight << refLeft
+               << refClosed << endl;
+        ok = false;
+      }
+    }
+  }
+  cout << "session: " << sessionMs << " ms, batch: " << batchMs << " ms"
+       << endl;
+  cout << (ok ? "PASS" : "FAIL") << endl;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,184 @@
+//============================================================================
+// Name        : TestLumaPreprocess.cpp
+// Author      : Nanyun
+// Version     : 1.0
+// Copyright   : Nanyun
+// Description : Checks LumaPreprocessor against a direct per pixel crop,
+//               rotation and box average, and that its rotations turn the
+//               image clockwise. Prints its time per camera frame next to
+//               converting the whole frame to ARGB.
+//============================================================================
+#include <jni_common/yuv2rgb.h>
+#include <luma_preprocess.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace std;
+using jnicommon::uint8;
+using jnicommon::uint32;
+
+static const int kRuns = 20;
+
+// Box i of count boxes over [0, cropSize), written out independently of
+// LumaPreprocessor
+static void box(int i, int count, int cropSize, int &begin, int &end)
+{
+  begin = (int)((long)i * cropSize / count);
+  end = (int)((long)(i + 1) * cropSize / count);
+  if (end <= begin)
+    end = begin + 1;
+  if (end > cropSize)
+  {
+    end = cropSize;
+    begin = cropSize - 1;
+  }
+}
+
+static std::vector<uint8> reference(const std::vector<uint8> &plane, int width,
+                                    int height, int stride, int rotation,
+                                    int outWidth, int outHeight)
+{
+  const bool swap = rotation == 90 || rotation == 270;
+  const int w = swap ? outHeight : outWidth;
+  const int h = swap ? outWidth : outHeight;
+  const double scale = std::min((double)width / w, (double)height / h);
+  const int cropW = std::max(1, std::min(width, (int)(w * scale + 0.5)));
+  const int cropH = std::max(1, std::min(height, (int)(h * scale + 0.5)));
+  const int cropX = (width - cropW) / 2;
+  const int cropY = (height - cropH) / 2;
+
+  std::vector<uint8> out(outWidth * outHeight);
+  for (int oy = 0; oy < outHeight; ++oy)
+  {
+    for (int ox = 0; ox < outWidth; ++ox)
+    {
+      // Undo the clockwise rotation
+      int u = ox, v = oy;
+      if (rotation == 90)
+      {
+        u = oy;
+        v = h - 1 - ox;
+      }
+      else if (rotation == 180)
+      {
+        u = w - 1 - ox;
+        v = h - 1 - oy;
+      }
+      else if (rotation == 270)
+      {
+        u = w - 1 - oy;
+        v = ox;
+      }
+      int x0, x1, y0, y1;
+      box(u, w, cropW, x0, x1);
+      box(v, h, cropH, y0, y1);
+      uint32 sum = 0;
+      for (int y = cropY + y0; y < cropY + y1; ++y)
+        for (int x = cropX + x0; x < cropX + x1; ++x)
+          sum += plane[y * stride + x];
+      const uint32 area = (x1 - x0) * (y1 - y0);
+      out[oy * outWidth + ox] = (sum + area / 2) / area;
+    }
+  }
+  return out;
+}
+
+// Turns a width x height image clockwise by 90 degrees
+static std::vector<uint8> rotate90(const std::vector<uint8> &img, int width,
+                                   int height)
+{
+  std::vector<uint8> out(img.size());
+  for (int y = 0; y < height; ++y)
+    for (int x = 0; x < width; ++x)
+      out[x * height + (height - 1 - y)] = img[y * width + x];
+  return out;
+}
+
+int main(int argc, char **argv)
+{
+  cout << "TestLumaPreprocess" << endl;
+  std::mt19937 rng(1234);
+  std::uniform_int_distribution<int> byte(0, 255);
+
+  // Camera sizes, odd sizes and upscaling
+  const int frames[][4] = {{640, 480, 224, 224}, {1280, 720, 224, 224},
+                           {1920, 1080, 320, 240}, {333, 171, 97, 55},
+                           {50, 40, 120, 90},     {7, 5, 3, 11},
+                           {1000, 1, 1, 1000}};
+  const int rotations[] = {0, 90, 180, 270};
+  bool ok = true;
+  LumaPreprocessor preprocessor;
+  for (const auto &frame : frames)
+  {
+    const int width = frame[0];
+    const int height = frame[1];
+    const int stride = width + 32;
+    std::vector<uint8> plane(stride * height);
+    for (size_t i = 0; i < plane.size(); ++i)
+      plane[i] = byte(rng);
+    jnicommon::LumaImageView src(&plane[0], width, height, stride);
+
+    for (int rotation : rotations)
+    {
+      const int outWidth = frame[2];
+      const int outHeight = frame[3];
+      const jnicommon::LumaImageView &out =
+          preprocessor.process(src, rotation, outWidth, outHeight);
+      std::vector<uint8> got(out.data(), out.data() + outWidth * outHeight);
+      if (got != reference(plane, width, height, stride, rotation, outWidth,
+                           outHeight))
+      {
+        cout << "  " << width << "x" << height << " rotation " << rotation
+             << ": differs from the reference" << endl;
+        ok = false;
+      }
+
+      // Rotating the unrotated output must give the rotated one
+      if (rotation == 90)
+      {
+        std::vector<uint8> upright(outHeight * outWidth);
+        uint8 *dst = &upright[0];
+        preprocessor.configure(width, height, 0, outHeight, outWidth);
+        preprocessor.run(&plane[0], stride, dst);
+        if (rotate90(upright, outHeight, outWidth) != got)
+        {
+          cout << "  " << width << "x" << height
+               << ": rotation 90 isn't clockwise" << endl;
+          ok = false;
+        }
+      }
+    }
+  }
+
+  // A 1080p YUV_420_888 frame to the 224 x 224 portrait input of the demo
+  const int width = 1920;
+  const int height = 1080;
+  std::vector<uint8> y(width * height);
+  std::vector<uint8> uv(width * height / 2);
+  for (size_t i = 0; i < y.size(); ++i)
+    y[i] = byte(rng);
+  std::vector<uint32> argb(width * height);
+  jnicommon::LumaImageView yView(&y[0], width, height, width);
+
+  auto t0 = std::chrono::steady_clock::now();
+  for (int i = 0; i < kRuns; ++i)
+    preprocessor.process(yView, 90, 224, 224);
+  auto t1 = std::chrono::steady_clock::now();
+  for (int i = 0; i < kRuns; ++i)
+    jnicommon::ConvertYUV420SPToARGB8888Fast(&y[0], &uv[0], &argb[0], width,
+                                             height);
+  auto t2 = std::chrono::steady_clock::now();
+  cout << "1080p to 224x224 luma: "
+       << std::chrono::duration<double, std::milli>(t1 - t0).count() / kRuns
+       << " ms/frame" << endl;
+  cout << "1080p to full ARGB   : "
+       << std::chrono::duration<double, std::milli>(t2 - t1).count() / kRuns
+       << " ms/frame" << endl;
+
+  cout << (ok ? "PASS" : "FAIL") << endl;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,206 @@
+//============================================================================
+// Name        : TestLumaSampling.cpp
+// Author      : Nanyun
+// Version     : 1.0
+// Copyright   : Nanyun
+// Description : Checks that the feature pixels of the shape predictor, found
+//               in one batch and then read, are the ones the pixel by pixel
+//               loop used to read, on the colour and gray images of the
+//               labelled faces of testing_with_face_landmarks.xml, made twice
+//               as big. Prints the time of both for the 10 levels of a face,
+//               and the time per face of a shape_predictor trained on
+//               training_with_face_landmarks.xml on colour and gray images.
+//============================================================================
+#include <dlib/data_io.h>
+#include <dlib/image_processing.h>
+#include <dlib/image_transforms.h>
+#include <dlib/rand.h>
+
+#include <iostream>
+#include <vector>
+
+#include "test_util.h"
+
+using namespace dlib;
+using namespace std;
+
+static const int kRuns = 20;
+static const unsigned long kLevels = 10;
+static const unsigned long kPoolSize = 400;
+
+// impl::extract_feature_pixel_values as it was, one pixel at a time
+template <typename image_type>
+static void pixelByPixel(const image_type &img_, const rectangle &rect,
+                         const matrix<float, 0, 1> &current_shape,
+                         const matrix<float, 0, 1> &reference_shape,
+                         const std::vector<unsigned long> &anchor_idx,
+                         const std::vector<dlib::vector<float, 2> > &deltas,
+                         std::vector<float> &values)
+{
+  const matrix<float, 2, 2> tform = matrix_cast<float>(
+      impl::find_tform_between_shapes(reference_shape, current_shape).get_m());
+  const point_transform_affine tform_to_img = impl::unnormalizing_tform(rect);
+  const rectangle area = get_rect(img_);
+  const_image_view<image_type> img(img_);
+  values.resize(deltas.size());
+  for (unsigned long i = 0; i < values.size(); ++i)
+  {
+    point p = tform_to_img(tform * deltas[i] +
+                           impl::location(current_shape, anchor_idx[i]));
+    if (area.contains(p))
+      values[i] = get_pixel_intensity(img[p.y()][p.x()]);
+    else
+      values[i] = 0;
+  }
+}
+
+// The shape of face in the coordinates of its box
+static matrix<float, 0, 1> normalized(const full_object_detection &face)
+{
+  const point_transform_affine toBox = impl::normalizing_tform(face.get_rect());
+  matrix<float, 0, 1> shape(face.num_parts() * 2);
+  for (unsigned long j = 0; j < face.num_parts(); ++j)
+  {
+    const dlib::vector<double, 2> p = toBox(face.part(j));
+    shape(j * 2) = p.x();
+    shape(j * 2 + 1) = p.y();
+  }
+  return shape;
+}
+
+template <typename image_type>
+static void upsample(dlib::array<image_type> &images,
+                     std::vector<std::vector<full_object_detection> > &faces)
+{
+  pyramid_down<2> pyr;
+  for (unsigned long i = 0; i < images.size(); ++i)
+  {
+    pyramid_up(images[i], pyr);
+    for (full_object_detection &face : faces[i])
+    {
+      std::vector<point> parts(face.num_parts());
+      for (unsigned long j = 0; j < parts.size(); ++j)
+        parts[j] = pyr.point_up(face.part(j));
+      face = full_object_detection(pyr.rect_up(face.get_rect()), parts);
+    }
+  }
+}
+
+int main(int argc, char **argv)
+{
+  cout << "TestLumaSampling" << endl;
+  if (argc < 3)
+  {
+    cout << "Call this program like this:" << endl;
+    cout << "./TestLumaSampling faces/training_with_face_landmarks.xml "
+            "faces/testing_with_face_landmarks.xml"
+         << endl;
+    return 0;
+  }
+
+  dlib::array<array2d<unsigned char> > trainImages;
+  dlib::array<array2d<bgr_pixel> > testImages;
+  std::vector<std::vector<full_object_detection> > trainFaces, testFaces;
+  load_image_dataset(trainImages, trainFaces, argv[1]);
+  load_image_dataset(testImages, testFaces, argv[2]);
+  upsample(testImages, testFaces);
+
+  shape_predictor_trainer trainer;
+  trainer.set_oversampling_amount(20);
+  trainer.set_nu(0.1);
+  trainer.set_cascade_depth(kLevels);
+  trainer.set_num_threads(1);
+  const shape_predictor sp = trainer.train(trainImages, trainFaces);
+
+  // Feature pixels around a labelled training face, found on each test face
+  dlib::rand rnd;
+  const matrix<float, 0, 1> reference = normalized(trainFaces[0][0]);
+  std::vector<std::vector<unsigned long> > anchorIdx(kLevels);
+  std::vector<std::vector<dlib::vector<float, 2> > > deltas(kLevels);
+  for (unsigned long l = 0; l < kLevels; ++l)
+  {
+    std::vector<dlib::vector<float, 2> > pixels(kPoolSize);
+    for (dlib::vector<float, 2> &p : pixels)
+      p = dlib::vector<float, 2>(rnd.get_random_double() * 1.2 - 0.1,
+                                 rnd.get_random_double() * 1.2 - 0.1);
+    impl::create_shape_relative_encoding(reference, pixels, anchorIdx[l], deltas[l]);
+  }
+
+  bool ok = true;
+  int numFaces = 0, numSame = 0;
+  double pixelMs[2] = {0, 0}, batchMs[2] = {0, 0}, faceMs[2] = {0, 0};
+  for (unsigned long i = 0; i < testImages.size(); ++i)
+  {
+    array2d<unsigned char> gray;
+    assign_image(gray, testImages[i]);
+    for (const full_object_detection &face : testFaces[i])
+    {
+      const rectangle &rect = face.get_rect();
+      const matrix<float, 0, 1> current = normalized(face);
+      std::vector<float> before, after;
+      bool same = true;
+      for (unsigned long l = 0; l < kLevels; ++l)
+      {
+        pixelByPixel(testImages[i], rect, current, reference, anchorIdx[l], deltas[l], before);
+        impl::extract_feature_pixel_values(testImages[i], rect, current, reference,
+                                           anchorIdx[l], deltas[l], after);
+        same = same && before == after;
+        pixelByPixel(gray, rect, current, reference, anchorIdx[l], deltas[l], before);
+        impl::extract_feature_pixel_values(gray, rect, current, reference,
+                                           anchorIdx[l], deltas[l], after);
+        same = same && before == after;
+      }
+      if (same)
+        ++numSame;
+
+      const point_transform_affine toImg = impl::unnormalizing_tform(rect);
+      std::vector<long> offsets;
+      pixelMs[0] += timeMs(kRuns, [&] {
+        for (unsigned long l = 0; l < kLevels; ++l)
+          pixelByPixel(testImages[i], rect, current, reference, anchorIdx[l], deltas[l], before);
+      });
+      pixelMs[1] += timeMs(kRuns, [&] {
+        for (unsigned long l = 0; l < kLevels; ++l)
+          pixelByPixel(gray, rect, current, reference, anchorIdx[l], deltas[l], before);
+      });
+      batchMs[0] += timeMs(kRuns, [&] {
+        for (unsigned long l = 0; l < kLevels; ++l)
+        {
+          impl::find_feature_pixels(testImages[i], toImg, current, reference, anchorIdx[l],
+                                    deltas[l], std::vector<unsigned long>(), offsets);
+          impl::read_feature_pixels(testImages[i], offsets, after);
+        }
+      });
+      batchMs[1] += timeMs(kRuns, [&] {
+        for (unsigned long l = 0; l < kLevels; ++l)
+        {
+          impl::find_feature_pixels(gray, toImg, current, reference, anchorIdx[l],
+                                    deltas[l], std::vector<unsigned long>(), offsets);
+          impl::read_feature_pixels(gray, offsets, after);
+        }
+      });
+
+      full_object_detection colourShape, grayShape;
+      faceMs[0] += timeMs(kRuns, [&] { colourShape = sp(testImages[i], rect); });
+      faceMs[1] += timeMs(kRuns, [&] { grayShape = sp(gray, rect); });
+      for (unsigned long j = 0; j < sp.num_parts(); ++j)
+        ok = ok && colourShape.part(j) == grayShape.part(j);
+      ++numFaces;
+    }
+  }
+  if (numSame != numFaces)
+    ok = false;
+
+  cout << "same feature pixels on " << numSame << " of " << numFaces << " faces"
+       << endl;
+  const char *names[] = {"colour", "gray"};
+  for (int k = 0; k < 2; ++k)
+  {
+    cout << names[k] << ": feature pixels of " << kLevels << " levels, ms/face pixel by pixel "
+         << pixelMs[k] / numFaces << ", batch " << batchMs[k] / numFaces
+         << "; shape_predictor ms/face " << faceMs[k] / numFaces << endl;
+  }
+
+  cout << (ok ? "PASS" : "FAIL") << endl;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,230 @@
+//============================================================================
+// Name        : TestMappedShapePredictor.cpp
+// Author      : Nanyun
+// Version     : 1.0
+// Copyright   : Nanyun
+// Description : Builds a random shape_predictor the size of the 68 landmark
+//               model, writes it as a .dat file and in the mapped format, with
+//               float and float16 leaves, and prints how long each takes to
+//               load. The mapped float model must give the same landmarks as
+//               the .dat one, and truncated or corrupt files must not load.
+//               A model trained on the faces given must lose no accuracy with
+//               float16 leaves.
+//============================================================================
+#include <dlib/data_io.h>
+#include <dlib/image_io.h>
+#include <dlib/image_processing.h>
+#include <dlib/image_processing/shape_predictor_mapped.h>
+#include <dlib/rand.h>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#include "test_util.h"
+
+using namespace dlib;
+using namespace std;
+
+static const unsigned long kParts = 68;
+static const unsigned long kLevels = 15;
+static const unsigned long kTrees = 500;
+static const unsigned long kTreeDepth = 4;
+static const unsigned long kPoolSize = 400;
+
+static const char *kDatFile = "TestMappedShapePredictor.dat";
+static const char *kMappedFile = "TestMappedShapePredictor.spm";
+static const char *kHalfFile = "TestMappedShapePredictor16.spm";
+static const char *kCutFile = "TestMappedShapePredictorCut.spm";
+static const char *kBadFile = "TestMappedShapePredictorBad.spm";
+static const char *kTrainedFile = "TestMappedShapePredictorTrained16.spm";
+
+// How far float16 leaves may move the landmarks of a trained model, in
+// pixels. A leaf rounded in one tree can move a feature pixel by one pixel
+// and send the trees after it down another path.
+static const double kHalfMeanTolerance = 0.05;
+static const double kHalfWorstTolerance = 2;
+
+static shape_predictor randomModel(dlib::rand &rnd)
+{
+  matrix<float, 0, 1> initialShape(kParts * 2);
+  for (long i = 0; i < initialShape.size(); ++i)
+    initialShape(i) = 0.1 + 0.8 * rnd.get_random_double();
+
+  const unsigned long numSplits = (1 << kTreeDepth) - 1;
+  std::vector<std::vector<impl::regression_tree> > forests(
+      kLevels, std::vector<impl::regression_tree>(kTrees));
+  std::vector<std::vector<dlib::vector<float, 2> > > pixels(kLevels);
+  for (unsigned long l = 0; l < kLevels; ++l)
+  {
+    pixels[l].resize(kPoolSize);
+    for (dlib::vector<float, 2> &p : pixels[l])
+      p = dlib::vector<float, 2>(rnd.get_random_double() * 1.2 - 0.1,
+                                 rnd.get_random_double() * 1.2 - 0.1);
+    for (impl::regression_tree &tree : forests[l])
+    {
+      tree.splits.resize(numSplits);
+      for (impl::split_feature &split : tree.splits)
+      {
+        split.idx1 = rnd.get_random_32bit_number() % kPoolSize;
+        split.idx2 = rnd.get_random_32bit_number() % kPoolSize;
+        split.thresh = rnd.get_random_double() * 64 - 32;
+      }
+      tree.leaf_values.resize(numSplits + 1);
+      for (matrix<float, 0, 1> &leaf : tree.leaf_values)
+      {
+        leaf.set_size(kParts * 2);
+        for (long i = 0; i < leaf.size(); ++i)
+          leaf(i) = rnd.get_random_gaussian() * 0.001;
+      }
+    }
+  }
+  return shape_predictor(initialShape, forests, pixels);
+}
+
+static double fileMB(const char *name)
+{
+  std::ifstream in(name, std::ios::binary | std::ios::ate);
+  return in.tellg() / (1024.0 * 1024.0);
+}
+
+int main(int argc, char **argv)
+{
+  cout << "TestMappedShapePredictor" << endl;
+  if (argc < 3)
+  {
+    cout << "Call this program like this:" << endl;
+    cout << "./TestMappedShapePredictor faces/training_with_face_landmarks.xml "
+            "faces/testing_with_face_landmarks.xml"
+         << endl;
+    return 0;
+  }
+
+  dlib::array<array2d<unsigned char> > trainImages, testImages;
+  std::vector<std::vector<full_object_detection> > trainFaces, testFaces;
+  load_image_dataset(trainImages, trainFaces, argv[1]);
+  load_image_dataset(testImages, testFaces, argv[2]);
+
+  bool ok = true;
+  {
+    dlib::rand rnd;
+    const shape_predictor sp = randomModel(rnd);
+    serialize(kDatFile) << sp;
+    save_mapped_shape_predictor(sp, kMappedFile);
+    save_mapped_shape_predictor(sp, kHalfFile, true);
+  }
+
+  shape_predictor dat, mapped, half;
+  const double datMs = timeMs(1, [&] { deserialize(kDatFile) >> dat; });
+  const double mappedMs =
+      timeMs(1, [&] { load_mapped_shape_predictor(mapped, kMappedFile); });
+  const double halfMs =
+      timeMs(1, [&] { load_mapped_shape_predictor(half, kHalfFile); });
+  cout << "load: file MB, ms" << endl;
+  cout << "  .dat " << fileMB(kDatFile) << ", " << datMs << endl;
+  cout << "  mapped " << fileMB(kMappedFile) << ", " << mappedMs << endl;
+  cout << "  mapped float16 " << fileMB(kHalfFile) << ", " << halfMs << endl;
+
+  // A file cut short is refused instead of read past its end, and so is one
+  // whose first level claims 2^64-1 trees, which wraps around to 0 in
+  // num_trees+1
+  {
+    std::ifstream in(kMappedFile, std::ios::binary);
+    std::vector<char> bytes((std::istreambuf_iterator<char>(in)),
+                            std::istreambuf_iterator<char>());
+    std::ofstream cut(kCutFile, std::ios::binary);
+    cut.write(&bytes[0], bytes.size() / 2);
+    uint64 levels;
+    std::memcpy(&levels, &bytes[40], sizeof(levels));
+    std::memset(&bytes[levels], 0xff, sizeof(uint64));
+    std::ofstream bad(kBadFile, std::ios::binary);
+    bad.write(&bytes[0], bytes.size());
+  }
+  const char *badFiles[] = {kCutFile, kBadFile};
+  for (const char *name : badFiles)
+  {
+    try
+    {
+      shape_predictor bad;
+      load_mapped_shape_predictor(bad, name);
+      cout << "  " << name << " loaded" << endl;
+      ok = false;
+    }
+    catch (serialization_error &)
+    {
+    }
+  }
+
+  // The random model's trees split on any pixel difference, so only the
+  // float leaves are compared on it
+  int numFaces = 0, numSame = 0;
+  for (unsigned long i = 0; i < testImages.size(); ++i)
+  {
+    for (const full_object_detection &face : testFaces[i])
+    {
+      const full_object_detection ref = dat(testImages[i], face.get_rect());
+      const full_object_detection shape = mapped(testImages[i], face.get_rect());
+      bool same = true;
+      for (unsigned long j = 0; j < kParts; ++j)
+        same = same && shape.part(j) == ref.part(j);
+      ++numFaces;
+      if (same)
+        ++numSame;
+    }
+  }
+  cout << "mapped landmarks the same on " << numSame << " of " << numFaces
+       << " faces" << endl;
+  if (numFaces == 0 || numSame != numFaces)
+    ok = false;
+
+  // float16 leaves on a trained model, against its float leaves
+  shape_predictor_trainer trainer;
+  trainer.set_oversampling_amount(20);
+  trainer.set_nu(0.1);
+  trainer.set_cascade_depth(10);
+  trainer.set_num_threads(1);
+  const shape_predictor trained = trainer.train(trainImages, trainFaces);
+  save_mapped_shape_predictor(trained, kTrainedFile, true);
+  shape_predictor trainedHalf;
+  load_mapped_shape_predictor(trainedHalf, kTrainedFile);
+  double sumHalf = 0, worstHalf = 0;
+  long numParts = 0;
+  for (unsigned long i = 0; i < testImages.size(); ++i)
+  {
+    for (const full_object_detection &face : testFaces[i])
+    {
+      const full_object_detection ref = trained(testImages[i], face.get_rect());
+      const full_object_detection shape =
+          trainedHalf(testImages[i], face.get_rect());
+      for (unsigned long j = 0; j < ref.num_parts(); ++j)
+      {
+        const double d = length(shape.part(j) - ref.part(j));
+        sumHalf += d;
+        worstHalf = std::max(worstHalf, d);
+        ++numParts;
+      }
+    }
+  }
+  const double meanHalf = numParts ? sumHalf / numParts : 0;
+  const double floatError = test_shape_predictor(trained, testImages, testFaces);
+  const double halfError =
+      test_shape_predictor(trainedHalf, testImages, testFaces);
+  cout << "trained float16: " << meanHalf << " pixels off on average, "
+       << worstHalf << " at most; error " << halfError << " against "
+       << floatError << " with float leaves" << endl;
+  if (numParts == 0 || meanHalf > kHalfMeanTolerance ||
+      worstHalf > kHalfWorstTolerance || halfError > floatError * 1.01)
+    ok = false;
+
+  std::remove(kDatFile);
+  std::remove(kMappedFile);
+  std::remove(kHalfFile);
+  std::remove(kCutFile);
+  std::remove(kBadFile);
+  std::remove(kTrainedFile);
+
+  cout << (ok ? "PASS" : "FAIL") << endl;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,140 @@
+//============================================================================
+// Name        : TestPoseSubset.cpp
+// Author      : Nanyun
+// Version     : 1.0
+// Copyright   : Nanyun
+// Description : Checks that the frontal face detector run with only some of
+//               its 5 pose filters finds the same faces as a detector built
+//               from just those filters, keeping the weight_index of the full
+//               model, then prints the cost of each pose filter and the time
+//               per frame with all the poses and with the turn-left ones.
+//============================================================================
+#include <dlib/image_io.h>
+#include <dlib/image_processing/frontal_face_detector.h>
+
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include "test_util.h"
+
+using namespace dlib;
+using namespace std;
+
+static const int kRuns = 3;
+static const char *kPoseNames[] = {"frontal", "left", "right", "tilted left",
+                                   "tilted right"};
+
+// The faces of a detector made of the filters of poses, in the order of the
+// full model, with their weight_index mapped back to it
+static void detectWithOwnDetector(const frontal_face_detector &detector,
+                                  const std::vector<unsigned long> &poses,
+                                  const array2d<unsigned char> &img,
+                                  std::vector<rect_detection> &dets)
+{
+  std::vector<frontal_face_detector::feature_vector_type> weights;
+  for (unsigned long pose : poses)
+    weights.push_back(detector.get_w(pose));
+  frontal_face_detector own(detector.get_scanner(),
+                            detector.get_overlap_tester(), weights);
+  own(img, dets);
+  for (rect_detection &det : dets)
+    det.weight_index = poses[det.weight_index];
+}
+
+static bool sameFaces(const std::vector<rect_detection> &a,
+                      const std::vector<rect_detection> &b)
+{
+  if (a.size() != b.size())
+    return false;
+  for (unsigned long i = 0; i < a.size(); ++i)
+    if (a[i].rect != b[i].rect || a[i].weight_index != b[i].weight_index ||
+        std::abs(a[i].detection_confidence - b[i].detection_confidence) > 1e-9)
+      return false;
+  return true;
+}
+
+int main(int argc, char **argv)
+{
+  cout << "TestPoseSubset" << endl;
+  if (argc < 2)
+  {
+    cout << "Call this program like this:" << endl;
+    cout << "./TestPoseSubset lena.jpg faces/*.jpg" << endl;
+    return 0;
+  }
+
+  frontal_face_detector detector = get_frontal_face_detector();
+  bool ok = detector.num_detectors() == 5;
+
+  std::vector<std::vector<unsigned long> > subsets;
+  for (unsigned long pose = 0; pose < 5; ++pose)
+    subsets.push_back(std::vector<unsigned long>(1, pose));
+  // what a turn-left challenge needs
+  subsets.push_back(std::vector<unsigned long>{0, 1});
+  subsets.push_back(std::vector<unsigned long>{0, 1, 2, 3, 4});
+
+  double allMs = 0, turnLeftMs = 0;
+  int numFaces = 0;
+  detector.reset_filter_stats();
+  for (int i = 1; i < argc; ++i)
+  {
+    array2d<unsigned char> img;
+    load_image(img, argv[i]);
+
+    std::vector<rect_detection> dets, ref;
+    for (const std::vector<unsigned long> &poses : subsets)
+    {
+      detector.set_enabled_detectors(poses);
+      detector(img, dets);
+      detectWithOwnDetector(detector, poses, img, ref);
+      if (!sameFaces(ref, dets) ||
+          detector.num_enabled_detectors() != poses.size())
+      {
+        cout << "  " << argv[i] << ": " << poses.size()
+             << " poses starting with " << kPoseNames[poses[0]]
+             << " give other faces than their own detector" << endl;
+        ok = false;
+      }
+    }
+
+    // Every pose runs once per frame when they are all on
+    detector.enable_all_detectors();
+    detector.reset_filter_stats();
+    allMs += timeMs(kRuns, [&] { detector(img, dets); });
+    numFaces += dets.size();
+    for (unsigned long pose = 0; pose < 5; ++pose)
+      if (detector.get_filter_stats()[pose].num_scans != (unsigned long)kRuns)
+        ok = false;
+
+    detector.set_enabled_detectors(subsets[5]);
+    turnLeftMs += timeMs(kRuns, [&] { detector(img, dets); });
+    if (detector.get_filter_stats()[2].num_scans != (unsigned long)kRuns ||
+        detector.get_filter_stats()[1].num_scans != 2 * (unsigned long)kRuns)
+      ok = false;
+  }
+  detector.enable_all_detectors();
+
+  const int numImages = argc - 1;
+  cout << "found " << numFaces << " faces with all the poses" << endl;
+  cout << "ms/frame: all poses " << allMs / numImages << ", frontal and left "
+       << turnLeftMs / numImages << endl;
+
+  // The cost of each pose filter over every image with all the poses on
+  detector.reset_filter_stats();
+  for (int i = 1; i < argc; ++i)
+  {
+    array2d<unsigned char> img;
+    load_image(img, argv[i]);
+    detector(img);
+  }
+  const std::vector<detector_filter_stats> &stats = detector.get_filter_stats();
+  cout << "pose filter: ms/frame, windows over threshold" << endl;
+  for (unsigned long pose = 0; pose < stats.size(); ++pose)
+    cout << "  " << pose << " " << kPoseNames[pose] << ": "
+         << stats[pose].total_ms / stats[pose].num_scans << ", "
+         << stats[pose].num_detections << endl;
+
+  cout << (ok ? "PASS" : "FAIL") << endl;
+  return ok ? 0 : 1;
+}
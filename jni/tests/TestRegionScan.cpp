@@ -0,0 +1,104 @@
+//============================================================================
+// Name        : TestRegionScan.cpp
+// Author      : Nanyun
+// Version     : 1.0
+// Copyright   : Nanyun
+// Description : Checks that object_detector::detect_in_region() finds each
+//               face of a full scan again from a search rectangle around it
+//               and a size range, and only returns boxes centered in the
+//               rectangle. Prints the time of both scans as the image grows.
+//============================================================================
+#include <dlib/image_io.h>
+#include <dlib/image_processing/frontal_face_detector.h>
+
+#include <iostream>
+#include <vector>
+
+#include "test_util.h"
+
+using namespace std;
+
+static const int kRuns = 5;
+
+// Where to look for a face seen at face last frame
+static dlib::rectangle searchRect(const dlib::rectangle &face)
+{
+  return dlib::grow_rect(face, face.width() / 2);
+}
+
+int main(int argc, char **argv)
+{
+  cout << "TestRegionScan" << endl;
+  if (argc < 2)
+  {
+    cout << "Call this program like this:" << endl;
+    cout << "./TestRegionScan lena.jpg faces/*.jpg" << endl;
+    return 0;
+  }
+
+  dlib::frontal_face_detector detector = dlib::get_frontal_face_detector();
+  bool ok = true;
+  int numFaces = 0;
+  int found = 0;
+  for (int i = 1; i < argc; ++i)
+  {
+    dlib::array2d<unsigned char> img;
+    dlib::load_image(img, argv[i]);
+    std::vector<dlib::rect_detection> faces;
+    detector(img, faces);
+    for (const dlib::rect_detection &face : faces)
+    {
+      ++numFaces;
+      const dlib::rectangle search = searchRect(face.rect);
+      std::vector<dlib::rect_detection> dets;
+      detector.detect_in_region(img, search, face.rect.width() * 7 / 10,
+                                face.rect.width() * 14 / 10, dets);
+      double best = 0;
+      for (const dlib::rect_detection &det : dets)
+      {
+        best = std::max(best, overlap(det.rect, face.rect));
+        if (!search.contains(dlib::center(det.rect)))
+        {
+          cout << argv[i] << ": a box outside the search rectangle" << endl;
+          ok = false;
+        }
+      }
+      if (best >= 0.6)
+        ++found;
+      else
+        cout << argv[i] << ": missed " << face.rect << ", best overlap "
+             << best << endl;
+    }
+  }
+  cout << "found " << found << " of " << numFaces << " faces again" << endl;
+  ok &= numFaces > 0 && found == numFaces;
+
+  // The first image at growing sizes, as camera resolutions grow
+  dlib::array2d<unsigned char> base;
+  dlib::load_image(base, argv[1]);
+  std::vector<dlib::rect_detection> baseFaces;
+  detector(base, baseFaces);
+  if (!baseFaces.empty())
+  {
+    cout << "ms/frame: full scan, region scan" << endl;
+    for (int scale = 1; scale <= 3; ++scale)
+    {
+      dlib::array2d<unsigned char> img(base.nr() * scale, base.nc() * scale);
+      dlib::resize_image(base, img);
+      const dlib::rectangle &r = baseFaces[0].rect;
+      const dlib::rectangle face(r.left() * scale, r.top() * scale,
+                                 r.right() * scale, r.bottom() * scale);
+      std::vector<dlib::rect_detection> dets;
+      const double fullMs = timeMs(kRuns, [&] { detector(img, dets); });
+      const double regionMs = timeMs(kRuns, [&] {
+        detector.detect_in_region(img, searchRect(face), face.width() * 7 / 10,
+                                  face.width() * 14 / 10, dets);
+      });
+      cout << "  " << img.nc() << "x" << img.nr() << ": " << fullMs << ", "
+           << regionMs << endl;
+    }
+  }
+
+  cout << (ok ? "PASS" : "FAIL") << endl;
+  return ok ? 0 : 1;
+}
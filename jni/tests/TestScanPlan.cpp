@@ -0,0 +1,154 @@
+//============================================================================
+// Name        : TestScanPlan.cpp
+// Author      : Nanyun
+// Version     : 1.0
+// Copyright   : Nanyun
+// Description : Checks that a box size range on scan_fhog_pyramid skips the
+//               pyramid levels of faces smaller than the range and still
+//               finds the faces inside it. Prints the levels scanned and the
+//               time against the full pyramid as the image grows, and that
+//               a face's feature vector is about the same either way.
+//============================================================================
+#include <dlib/image_io.h>
+#include <dlib/image_processing/frontal_face_detector.h>
+
+#include <iostream>
+#include <vector>
+
+#include "test_util.h"
+
+using namespace std;
+
+static const int kRuns = 5;
+
+// Finds every face of faces in dets again
+static int countFound(const std::vector<dlib::rect_detection> &faces,
+                      const std::vector<dlib::rect_detection> &dets)
+{
+  int found = 0;
+  for (const dlib::rect_detection &face : faces)
+  {
+    double best = 0;
+    for (const dlib::rect_detection &det : dets)
+      best = std::max(best, overlap(det.rect, face.rect));
+    if (best >= 0.6)
+      ++found;
+  }
+  return found;
+}
+
+int main(int argc, char **argv)
+{
+  cout << "TestScanPlan" << endl;
+  if (argc < 2)
+  {
+    cout << "Call this program like this:" << endl;
+    cout << "./TestScanPlan lena.jpg faces/*.jpg" << endl;
+    return 0;
+  }
+
+  dlib::frontal_face_detector full = dlib::get_frontal_face_detector();
+  dlib::frontal_face_detector planned = full;
+  bool ok = true;
+  int numFaces = 0;
+  int found = 0;
+  for (int i = 1; i < argc; ++i)
+  {
+    dlib::array2d<unsigned char> img;
+    dlib::load_image(img, argv[i]);
+    std::vector<dlib::rect_detection> faces;
+    full.get_scanner().set_box_size_range(0, 0);
+    full(img, faces);
+    if (faces.empty())
+      continue;
+    unsigned long smallest = faces[0].rect.width();
+    for (const dlib::rect_detection &face : faces)
+      smallest = std::min(smallest, face.rect.width());
+
+    // A range that holds every face, and only looks at smaller ones when the
+    // detection window itself is bigger
+    planned.get_scanner().set_box_size_range(smallest * 9 / 10, 0);
+    std::vector<dlib::rect_detection> dets;
+    planned(img, dets);
+    numFaces += faces.size();
+    const int n = countFound(faces, dets);
+    found += n;
+    if (n != (int)faces.size())
+      cout << argv[i] << ": found " << n << " of " << faces.size()
+           << " faces of at least " << smallest << " px" << endl;
+  }
+  cout << "found " << found << " of " << numFaces << " faces again" << endl;
+  ok &= numFaces > 0 && found == numFaces;
+
+  // The first image at growing sizes, as camera resolutions grow, looking for
+  // faces at least as big as the one in it
+  dlib::array2d<unsigned char> base;
+  dlib::load_image(base, argv[1]);
+  std::vector<dlib::rect_detection> baseFaces;
+  full.get_scanner().set_box_size_range(0, 0);
+  full(base, baseFaces);
+  if (!baseFaces.empty())
+  {
+    cout << "ms/frame: full pyramid, planned pyramid (levels)" << endl;
+    for (int scale = 1; scale <= 3; ++scale)
+    {
+      dlib::array2d<unsigned char> img(base.nr() * scale, base.nc() * scale);
+      dlib::resize_image(base, img);
+      const unsigned long minSize = baseFaces[0].rect.width() * scale * 8 / 10;
+      planned.get_scanner().set_box_size_range(minSize, 0);
+
+      unsigned long fullFirst, fullLevels, first, levels;
+      full.get_scanner().get_scan_plan(dlib::get_rect(img), fullFirst,
+                                       fullLevels);
+      planned.get_scanner().get_scan_plan(dlib::get_rect(img), first, levels);
+      // Faces this big are never seen at full size once the image is scaled
+      if (scale > 1 && first == 0)
+      {
+        cout << "  " << img.nc() << "x" << img.nr()
+             << ": the full size level is still scanned" << endl;
+        ok = false;
+      }
+
+      std::vector<dlib::rect_detection> fullDets, dets;
+      const double fullMs = timeMs(kRuns, [&] { full(img, fullDets); });
+      const double plannedMs = timeMs(kRuns, [&] { planned(img, dets); });
+      for (const dlib::rect_detection &det : fullDets)
+        if (det.rect.width() >= minSize &&
+            countFound(std::vector<dlib::rect_detection>(1, det), dets) == 0)
+        {
+          cout << "  " << img.nc() << "x" << img.nr() << ": missed " << det.rect
+               << endl;
+          ok = false;
+        }
+      // The features of a face come from the same level as with the full
+      // pyramid, although feats[0] is no longer its first level
+      if (!dets.empty())
+      {
+        typedef dlib::frontal_face_detector::feature_vector_type vector_type;
+        const dlib::full_object_detection obj(dets[0].rect);
+        vector_type fullPsi(full.get_scanner().get_num_dimensions());
+        vector_type psi(fullPsi.size());
+        fullPsi = 0;
+        psi = 0;
+        full.get_scanner().load(img);
+        full.get_scanner().get_feature_vector(obj, fullPsi);
+        planned.get_scanner().load(img);
+        planned.get_scanner().get_feature_vector(obj, psi);
+        // The planned levels are resampled from img directly, so they are only
+        // close.  A wrong level is not close at all.
+        if (dlib::length(psi - fullPsi) > 0.5 * dlib::length(fullPsi))
+        {
+          cout << "  " << img.nc() << "x" << img.nr()
+               << ": the feature vector differs from the full pyramid's" << endl;
+          ok = false;
+        }
+      }
+      cout << "  " << img.nc() << "x" << img.nr() << ": " << fullMs << " ("
+           << fullLevels << "), " << plannedMs << " (" << first << ".."
+           << first + levels - 1 << ")" << endl;
+    }
+  }
+
+  cout << (ok ? "PASS" : "FAIL") << endl;
+  return ok ? 0 : 1;
+}
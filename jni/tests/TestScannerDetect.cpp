@@ -0,0 +1,144 @@
+//============================================================================
+// Name        : TestScannerDetect.cpp
+// Author      : Nanyun
+// Version     : 1.0
+// Copyright   : Nanyun
+// Description : Checks that scan_fhog_pyramid::detect() replaces what was in
+//               dets and sorts it strongest first, so that running the 5 pose
+//               filters of the frontal face detector one after another into
+//               one vector gives every window to the filter that found it, with
+//               the right weight_index. Prints how many windows would have gone
+//               to the wrong filter if detect() appended to dets.
+//============================================================================
+#include <dlib/image_io.h>
+#include <dlib/image_processing/frontal_face_detector.h>
+
+#include <iostream>
+#include <vector>
+
+#include "test_util.h"
+
+using namespace dlib;
+using namespace std;
+
+typedef std::vector<std::pair<double, rectangle> > window_list;
+
+// Low enough that every filter finds a few windows
+static const double kAdjustThreshold = -0.5;
+
+static bool strongestFirst(const window_list &dets)
+{
+  for (unsigned long i = 1; i < dets.size(); ++i)
+    if (dets[i - 1].first < dets[i].first)
+      return false;
+  return true;
+}
+
+static bool hasWindow(const window_list &dets, const rect_detection &det,
+                      double thresh)
+{
+  for (const std::pair<double, rectangle> &d : dets)
+    if (d.second == det.rect && d.first - thresh == det.detection_confidence)
+      return true;
+  return false;
+}
+
+// The windows of the last image the detector was run on, one filter at a time
+// into one vector, each given the weight_index of the filter that was run, as
+// object_detector does before its non-max suppression. Returns how many of
+// them the filter of their weight_index didn't find.
+static unsigned long misattributed(const frontal_face_detector &detector,
+                                   const std::vector<window_list> &own,
+                                   unsigned long &total, bool &ok)
+{
+  const scan_fhog_pyramid<pyramid_down<6> > &scanner = detector.get_scanner();
+  window_list dets;
+  unsigned long wrong = 0;
+  total = 0;
+  for (unsigned long i = 0; i < detector.num_detectors(); ++i)
+  {
+    const double thresh = detector.get_w(i)(scanner.get_num_dimensions());
+    scanner.detect(detector.get_processed_w(i).get_detect_argument(), dets,
+                   thresh + kAdjustThreshold);
+    if (!strongestFirst(dets))
+      ok = false;
+    for (const std::pair<double, rectangle> &d : dets)
+    {
+      rect_detection det;
+      det.rect = d.second;
+      det.detection_confidence = d.first - thresh;
+      det.weight_index = i;
+      if (!hasWindow(own[i], det, thresh))
+        ++wrong;
+      ++total;
+    }
+  }
+  return wrong;
+}
+
+int main(int argc, char **argv)
+{
+  cout << "TestScannerDetect" << endl;
+  if (argc < 2)
+  {
+    cout << "Call this program like this:" << endl;
+    cout << "./TestScannerDetect lena.jpg faces/*.jpg" << endl;
+    return 0;
+  }
+
+  frontal_face_detector detector = get_frontal_face_detector();
+  const scan_fhog_pyramid<pyramid_down<6> > &scanner = detector.get_scanner();
+  bool ok = true;
+  unsigned long numWindows = 0, numWrong = 0;
+  for (int i = 1; i < argc; ++i)
+  {
+    array2d<unsigned char> img;
+    load_image(img, argv[i]);
+    std::vector<rect_detection> faces;
+    detector(img, faces, kAdjustThreshold);
+
+    // Each filter on its own, into a fresh vector
+    std::vector<window_list> own(detector.num_detectors());
+    for (unsigned long f = 0; f < own.size(); ++f)
+    {
+      const double thresh = detector.get_w(f)(scanner.get_num_dimensions());
+      scanner.detect(detector.get_processed_w(f).get_detect_argument(), own[f],
+                     thresh + kAdjustThreshold);
+      if (!strongestFirst(own[f]))
+      {
+        cout << "  " << argv[i] << ": filter " << f
+             << " isn't sorted strongest first" << endl;
+        ok = false;
+      }
+    }
+
+    unsigned long total = 0;
+    const unsigned long wrong = misattributed(detector, own, total, ok);
+    numWindows += total;
+    numWrong += wrong;
+    if (wrong != 0)
+    {
+      cout << "  " << argv[i] << ": " << wrong << " of " << total
+           << " windows went to a filter that didn't find them" << endl;
+      ok = false;
+    }
+
+    // The detector's faces come from the filter of their weight_index
+    for (const rect_detection &face : faces)
+    {
+      const double thresh =
+          detector.get_w(face.weight_index)(scanner.get_num_dimensions());
+      if (!hasWindow(own[face.weight_index], face, thresh))
+      {
+        cout << "  " << argv[i] << ": a face has the weight_index of filter "
+             << face.weight_index << ", which didn't find it" << endl;
+        ok = false;
+      }
+    }
+  }
+
+  cout << "windows with adjust_threshold " << kAdjustThreshold << ": "
+       << numWindows << ", given to the wrong filter: " << numWrong << endl;
+  cout << (ok ? "PASS" : "FAIL") << endl;
+  return ok ? 0 : 1;
+}
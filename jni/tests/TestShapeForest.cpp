@@ -0,0 +1,244 @@
+//============================================================================
+// Name        : TestShapeForest.cpp
+// Author      : Nanyun
+// Version     : 1.0
+// Copyright   : Nanyun
+// Description : Builds a random shape_predictor the size of the 68 landmark
+//               model and checks that its packed forests give the same leaves
+//               and landmarks as walking the regression trees one at a time,
+//               on the faces of the images given. Checks that it serializes to
+//               the same bytes as the nested trees, that malformed or
+//               truncated trees don't load, and prints the time per face
+//               both ways.
+//============================================================================
+#include <dlib/image_io.h>
+#include <dlib/image_processing.h>
+#include <dlib/image_processing/frontal_face_detector.h>
+#include <dlib/rand.h>
+
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#include "test_util.h"
+
+using namespace dlib;
+using namespace std;
+
+typedef std::vector<std::vector<impl::regression_tree> > forest_list;
+
+static const int kRuns = 20;
+static const unsigned long kParts = 68;
+static const unsigned long kLevels = 15;
+static const unsigned long kTrees = 500;
+static const unsigned long kTreeDepth = 4;
+static const unsigned long kPoolSize = 400;
+
+struct RandomModel
+{
+  matrix<float, 0, 1> initialShape;
+  forest_list forests;
+  std::vector<std::vector<dlib::vector<float, 2> > > pixels;
+  std::vector<std::vector<unsigned long> > anchorIdx;
+  std::vector<std::vector<dlib::vector<float, 2> > > deltas;
+};
+
+static void randomModel(dlib::rand &rnd, RandomModel &model)
+{
+  model.initialShape.set_size(kParts * 2);
+  for (long i = 0; i < model.initialShape.size(); ++i)
+    model.initialShape(i) = 0.1 + 0.8 * rnd.get_random_double();
+
+  const unsigned long numSplits = (1 << kTreeDepth) - 1;
+  model.forests.assign(kLevels, std::vector<impl::regression_tree>(kTrees));
+  model.pixels.resize(kLevels);
+  model.anchorIdx.resize(kLevels);
+  model.deltas.resize(kLevels);
+  for (unsigned long l = 0; l < kLevels; ++l)
+  {
+    model.pixels[l].resize(kPoolSize);
+    for (dlib::vector<float, 2> &p : model.pixels[l])
+      p = dlib::vector<float, 2>(rnd.get_random_double() * 1.2 - 0.1,
+                                 rnd.get_random_double() * 1.2 - 0.1);
+    impl::create_shape_relative_encoding(model.initialShape, model.pixels[l],
+                                         model.anchorIdx[l], model.deltas[l]);
+    for (impl::regression_tree &tree : model.forests[l])
+    {
+      tree.splits.resize(numSplits);
+      for (impl::split_feature &split : tree.splits)
+      {
+        split.idx1 = rnd.get_random_32bit_number() % kPoolSize;
+        split.idx2 = rnd.get_random_32bit_number() % kPoolSize;
+        split.thresh = rnd.get_random_double() * 64 - 32;
+      }
+      tree.leaf_values.resize(numSplits + 1);
+      for (matrix<float, 0, 1> &leaf : tree.leaf_values)
+      {
+        leaf.set_size(kParts * 2);
+        for (long i = 0; i < leaf.size(); ++i)
+          leaf(i) = rnd.get_random_gaussian() * 0.001;
+      }
+    }
+  }
+}
+
+// shape_predictor::operator() the way it walked the trees before they were
+// packed, with the leaf of every tree
+static full_object_detection treeByTree(const RandomModel &model,
+                                        const array2d<unsigned char> &img,
+                                        const rectangle &rect,
+                                        std::vector<unsigned long> &leaves)
+{
+  leaves.clear();
+  matrix<float, 0, 1> shape = model.initialShape;
+  std::vector<float> values;
+  for (unsigned long l = 0; l < model.forests.size(); ++l)
+  {
+    impl::extract_feature_pixel_values(img, rect, shape, model.initialShape,
+                                       model.anchorIdx[l], model.deltas[l],
+                                       values);
+    for (const impl::regression_tree &tree : model.forests[l])
+    {
+      unsigned long leafIdx;
+      shape += tree(values, leafIdx);
+      leaves.push_back(leafIdx);
+    }
+  }
+  const point_transform_affine toImg = impl::unnormalizing_tform(rect);
+  std::vector<point> parts(shape.size() / 2);
+  for (unsigned long i = 0; i < parts.size(); ++i)
+    parts[i] = toImg(impl::location(shape, i));
+  return full_object_detection(rect, parts);
+}
+
+// Whether deserialize() refuses the model with forests in place of its own
+static bool refuses(const RandomModel &model, const forest_list &forests)
+{
+  std::ostringstream out;
+  serialize(1, out);
+  serialize(model.initialShape, out);
+  serialize(forests, out);
+  serialize(model.anchorIdx, out);
+  serialize(model.deltas, out);
+  std::istringstream in(out.str());
+  shape_predictor sp;
+  try
+  {
+    deserialize(sp, in);
+  }
+  catch (serialization_error &)
+  {
+    return true;
+  }
+  return false;
+}
+
+int main(int argc, char **argv)
+{
+  cout << "TestShapeForest" << endl;
+  if (argc < 2)
+  {
+    cout << "Call this program like this:" << endl;
+    cout << "./TestShapeForest lena.jpg faces/*.jpg" << endl;
+    return 0;
+  }
+
+  dlib::rand rnd;
+  RandomModel model;
+  randomModel(rnd, model);
+  const shape_predictor sp(model.initialShape, model.forests, model.pixels);
+  bool ok = true;
+
+  // The packed trees are written as the nested vectors were
+  std::ostringstream packed, nested;
+  serialize(sp, packed);
+  serialize(1, nested);
+  serialize(model.initialShape, nested);
+  serialize(model.forests, nested);
+  serialize(model.anchorIdx, nested);
+  serialize(model.deltas, nested);
+  if (packed.str() != nested.str())
+  {
+    cout << "  serialize() writes other bytes than the nested trees" << endl;
+    ok = false;
+  }
+  shape_predictor loaded;
+  std::istringstream in(packed.str());
+  deserialize(loaded, in);
+
+  // Malformed trees must be refused before they are packed
+  forest_list bad = model.forests;
+  bad[1][2].leaf_values[3].set_size(kParts);
+  const bool shortLeaf = refuses(model, bad);
+  bad = model.forests;
+  bad[1][2].leaf_values.pop_back();
+  const bool missingLeaf = refuses(model, bad);
+  bad = model.forests;
+  bad[1][2].splits.pop_back();
+  const bool missingSplit = refuses(model, bad);
+  bad = model.forests;
+  bad[1][2].splits[0].idx1 = kPoolSize;
+  const bool farSplit = refuses(model, bad);
+  std::istringstream truncated(packed.str().substr(0, packed.str().size() / 2));
+  bool truncatedRefused = false;
+  try
+  {
+    deserialize(loaded, truncated);
+  }
+  catch (serialization_error &)
+  {
+    truncatedRefused = true;
+  }
+  if (!shortLeaf || !missingLeaf || !missingSplit || !farSplit ||
+      !truncatedRefused)
+  {
+    cout << "  a malformed model was loaded" << endl;
+    ok = false;
+  }
+  in.clear();
+  in.str(packed.str());
+  deserialize(loaded, in);
+
+  frontal_face_detector detector = get_frontal_face_detector();
+  int numFaces = 0, numSame = 0;
+  double treeMs = 0, packedMs = 0;
+  for (int i = 1; i < argc; ++i)
+  {
+    array2d<unsigned char> img;
+    load_image(img, argv[i]);
+    std::vector<rectangle> faces = detector(img);
+    for (const rectangle &face : faces)
+    {
+      std::vector<unsigned long> leaves;
+      full_object_detection ref, shape, loadedShape;
+      treeMs += timeMs(kRuns, [&] { ref = treeByTree(model, img, face, leaves); });
+      packedMs += timeMs(kRuns, [&] { shape = sp(img, face); });
+      loadedShape = loaded(img, face);
+
+      // the leaves come back as feature indexes, offset by the leaves before
+      std::vector<std::pair<unsigned long, double> > feats;
+      sp(img, face, feats);
+      bool same = feats.size() == leaves.size();
+      const unsigned long numLeaves = 1 << kTreeDepth;
+      for (unsigned long j = 0; same && j < feats.size(); ++j)
+        same = feats[j].first == j * numLeaves + leaves[j];
+      for (unsigned long j = 0; same && j < kParts; ++j)
+        same = shape.part(j) == ref.part(j) && loadedShape.part(j) == ref.part(j);
+      ++numFaces;
+      if (same)
+        ++numSame;
+    }
+  }
+  cout << "model " << kLevels << " levels of " << kTrees << " trees of depth "
+       << kTreeDepth << ", " << kParts << " parts" << endl;
+  cout << "same leaves and landmarks on " << numSame << " of " << numFaces
+       << " faces" << endl;
+  if (numFaces != 0)
+    cout << "ms/face tree by tree " << treeMs / numFaces << ", packed "
+         << packedMs / numFaces << endl;
+  if (numSame != numFaces)
+    ok = false;
+
+  cout << (ok ? "PASS" : "FAIL") << endl;
+  return ok ? 0 : 1;
+}
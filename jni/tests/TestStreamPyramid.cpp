@@ -0,0 +1,110 @@
+//============================================================================
+// Name        : TestStreamPyramid.cpp
+// Author      : Nanyun
+// Version     : 1.0
+// Copyright   : Nanyun
+// Description : Checks that scan_fhog_pyramid's streaming mode finds the same
+//               faces, to the bit, as building the whole pixel pyramid first,
+//               on gray and color images, with and without a pool and a face
+//               size range. Prints the time and the pixel pyramid memory of
+//               both modes as the image grows.
+//============================================================================
+#include <dlib/image_io.h>
+#include <dlib/image_processing/frontal_face_detector.h>
+#include <dlib/threads/thread_pool_extension.h>
+
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+#include "test_util.h"
+
+using namespace dlib;
+using namespace std;
+
+static const int kRuns = 5;
+
+template <typename image_type>
+static bool checkImage(frontal_face_detector &detector, const image_type &img,
+                       thread_pool *pool, unsigned long minFaceSize,
+                       const char *name)
+{
+  detector.get_scanner().set_thread_pool(pool);
+  detector.get_scanner().set_box_size_range(minFaceSize, 0);
+  std::vector<rect_detection> ref, dets;
+  detector.get_scanner().set_streaming_pyramid(false);
+  detector(img, ref);
+  detector.get_scanner().set_streaming_pyramid(true);
+  detector(img, dets);
+  detector.get_scanner().set_streaming_pyramid(false);
+  detector.get_scanner().set_box_size_range(0, 0);
+  detector.get_scanner().set_thread_pool(0);
+  if (sameDetections(ref, dets))
+    return true;
+  cout << "  " << name << ", " << (pool ? "pool" : "no pool")
+       << ", min face " << minFaceSize << ": the faces differ" << endl;
+  return false;
+}
+
+int main(int argc, char **argv)
+{
+  cout << "TestStreamPyramid" << endl;
+  if (argc < 2)
+  {
+    cout << "Call this program like this:" << endl;
+    cout << "./TestStreamPyramid lena.jpg faces/*.jpg" << endl;
+    return 0;
+  }
+
+  frontal_face_detector detector = get_frontal_face_detector();
+  thread_pool pool(3);
+  bool ok = true;
+  for (int i = 1; i < argc; ++i)
+  {
+    array2d<rgb_pixel> rgb;
+    load_image(rgb, argv[i]);
+    array2d<unsigned char> gray;
+    assign_image(gray, rgb);
+    for (thread_pool *p : {(thread_pool *)0, &pool})
+      for (unsigned long minFaceSize : {0ul, 150ul})
+      {
+        ok = checkImage(detector, gray, p, minFaceSize, argv[i]) && ok;
+        ok = checkImage(detector, rgb, p, minFaceSize, argv[i]) && ok;
+      }
+  }
+  cout << "checked " << argc - 1 << " images" << endl;
+
+  // The first image at growing sizes, as camera resolutions grow
+  array2d<unsigned char> base;
+  load_image(base, argv[1]);
+  detector.get_scanner().set_thread_pool(&pool);
+  cout << "ms/frame and pyramid bytes: whole pyramid, streaming" << endl;
+  for (int scale = 1; scale <= 3; ++scale)
+  {
+    array2d<unsigned char> img(base.nr() * scale, base.nc() * scale);
+    resize_image(base, img);
+    double ms[2];
+    unsigned long bytes[2];
+    for (int stream = 0; stream < 2; ++stream)
+    {
+      detector.get_scanner().set_streaming_pyramid(stream == 1);
+      std::vector<rect_detection> dets;
+      auto t0 = std::chrono::steady_clock::now();
+      for (int r = 0; r < kRuns; ++r)
+        detector(img, dets);
+      auto t1 = std::chrono::steady_clock::now();
+      ms[stream] =
+          std::chrono::duration<double, std::milli>(t1 - t0).count() / kRuns;
+      bytes[stream] = detector.get_scanner().get_thread_stats().pyramid_bytes;
+    }
+    cout << "  " << img.nc() << "x" << img.nr() << ": " << ms[0] << " ms "
+         << bytes[0] << " bytes, " << ms[1] << " ms " << bytes[1] << " bytes"
+         << endl;
+    ok &= bytes[1] < bytes[0];
+  }
+  detector.get_scanner().set_streaming_pyramid(false);
+  detector.get_scanner().set_thread_pool(0);
+
+  cout << (ok ? "PASS" : "FAIL") << endl;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,256 @@
+//============================================================================
+// Name        : TestSuppression.cpp
+// Author      : Nanyun
+// Version     : 1.0
+// Copyright   : Nanyun
+// Description : Checks that box_overlap_grid keeps the same boxes as testing
+//               every kept box, on thousands of random candidates and on the
+//               frontal face detector run with a low threshold, and prints the
+//               time of both. Then checks that
+//               scan_fhog_pyramid::set_level_suppression() keeps the faces at the
+//               trained threshold, that no two windows it keeps on one level
+//               overlap, and prints how many candidates and faces it leaves
+//               with the low one.
+//============================================================================
+#include <dlib/image_io.h>
+#include <dlib/image_processing/frontal_face_detector.h>
+#include <dlib/rand.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include "test_util.h"
+
+using namespace dlib;
+using namespace std;
+
+typedef std::vector<std::pair<double, rectangle> > candidate_list;
+
+static const int kRuns = 20;
+// Low enough that the detector gives thousands of candidates per frame
+static const double kAdjustThreshold = -2.5;
+
+static bool strongerFirst(const std::pair<double, rectangle> &a,
+                          const std::pair<double, rectangle> &b)
+{
+  return a.first > b.first;
+}
+
+static void suppressLinear(const test_box_overlap &tester,
+                           const candidate_list &candidates,
+                           std::vector<rectangle> &kept)
+{
+  kept.clear();
+  for (const std::pair<double, rectangle> &c : candidates)
+  {
+    bool overlaps = false;
+    for (unsigned long i = 0; i < kept.size() && !overlaps; ++i)
+      overlaps = tester(kept[i], c.second);
+    if (!overlaps)
+      kept.push_back(c.second);
+  }
+}
+
+static void suppressGrid(const test_box_overlap &tester,
+                         const candidate_list &candidates,
+                         box_overlap_grid &grid, std::vector<rectangle> &kept)
+{
+  rectangle area;
+  double width = 0;
+  for (const std::pair<double, rectangle> &c : candidates)
+  {
+    area += c.second;
+    width += c.second.width();
+  }
+  grid.reset(area, (long)(width / candidates.size()));
+  kept.clear();
+  for (const std::pair<double, rectangle> &c : candidates)
+  {
+    if (grid.overlaps_any(tester, c.second))
+      continue;
+    grid.add(c.second);
+    kept.push_back(c.second);
+  }
+}
+
+// Clusters of boxes of a few sizes around random centers, the way the
+// windows over threshold bunch up around a face on every pyramid level
+static void randomCandidates(dlib::rand &rnd, int num, candidate_list &list)
+{
+  list.clear();
+  std::vector<point> centers(num / 40 + 1);
+  for (point &p : centers)
+    p = point(rnd.get_random_32bit_number() % 1280,
+              rnd.get_random_32bit_number() % 720);
+  for (int i = 0; i < num; ++i)
+  {
+    const point &p = centers[rnd.get_random_32bit_number() % centers.size()];
+    const long size = 80 * std::pow(1.2, rnd.get_random_32bit_number() % 8);
+    const point jitter(rnd.get_random_32bit_number() % 31 - 15,
+                       rnd.get_random_32bit_number() % 31 - 15);
+    list.push_back(std::make_pair(rnd.get_random_double(),
+                                  centered_rect(p + jitter, size, size)));
+  }
+  std::sort(list.begin(), list.end(), strongerFirst);
+}
+
+static bool checkRandom()
+{
+  dlib::rand rnd;
+  const test_box_overlap tester;
+  box_overlap_grid grid;
+  bool ok = true;
+  cout << "random candidates: kept, ms linear, ms grid" << endl;
+  for (int num : {100, 1000, 5000, 20000})
+  {
+    candidate_list list;
+    randomCandidates(rnd, num, list);
+    std::vector<rectangle> linear, gridKept;
+    const double linearMs =
+        timeMs(kRuns, [&] { suppressLinear(tester, list, linear); });
+    const double gridMs =
+        timeMs(kRuns, [&] { suppressGrid(tester, list, grid, gridKept); });
+    if (linear != gridKept)
+      ok = false;
+    cout << "  " << num << ": " << gridKept.size() << ", " << linearMs << ", "
+         << gridMs << endl;
+  }
+  return ok;
+}
+
+// The candidates of all the filters of the last image the detector was run on,
+// strongest first, as object_detector suppresses them
+static void detectorCandidates(frontal_face_detector &detector,
+                               candidate_list &list)
+{
+  list.clear();
+  const scan_fhog_pyramid<pyramid_down<6> > &scanner = detector.get_scanner();
+  candidate_list dets;
+  for (unsigned long i = 0; i < detector.num_detectors(); ++i)
+  {
+    const double thresh =
+        detector.get_w(i)(scanner.get_num_dimensions());
+    scanner.detect(detector.get_processed_w(i).get_detect_argument(), dets,
+                   thresh + kAdjustThreshold);
+    for (const std::pair<double, rectangle> &d : dets)
+      list.push_back(std::make_pair(d.first - thresh, d.second));
+  }
+  std::stable_sort(list.begin(), list.end(), strongerFirst);
+}
+
+// Whether a filter of the detector kept two overlapping windows of one
+// pyramid level, told apart by their size, on the last image it was run on
+static bool levelKeepsOverlaps(frontal_face_detector &detector,
+                               const test_box_overlap &tester)
+{
+  const scan_fhog_pyramid<pyramid_down<6> > &scanner = detector.get_scanner();
+  candidate_list dets;
+  for (unsigned long i = 0; i < detector.num_detectors(); ++i)
+  {
+    const double thresh =
+        detector.get_w(i)(scanner.get_num_dimensions());
+    scanner.detect(detector.get_processed_w(i).get_detect_argument(), dets,
+                   thresh + kAdjustThreshold);
+    for (unsigned long a = 0; a < dets.size(); ++a)
+      for (unsigned long b = a + 1; b < dets.size(); ++b)
+        if (dets[a].second.width() == dets[b].second.width() &&
+            tester(dets[a].second, dets[b].second))
+          return true;
+  }
+  return false;
+}
+
+int main(int argc, char **argv)
+{
+  cout << "TestSuppression" << endl;
+  if (argc < 2)
+  {
+    cout << "Call this program like this:" << endl;
+    cout << "./TestSuppression lena.jpg faces/*.jpg" << endl;
+    return 0;
+  }
+
+  bool ok = checkRandom();
+
+  frontal_face_detector detector = get_frontal_face_detector();
+  scan_fhog_pyramid<pyramid_down<6> > &scanner = detector.get_scanner();
+  const test_box_overlap tester = detector.get_overlap_tester();
+  box_overlap_grid grid;
+  unsigned long numCandidates = 0, numLevelCandidates = 0;
+  unsigned long numFaces = 0, numLevelFaces = 0, numSame = 0;
+  double linearMs = 0, gridMs = 0, fullMs = 0, levelMs = 0;
+  for (int i = 1; i < argc; ++i)
+  {
+    array2d<unsigned char> img;
+    load_image(img, argv[i]);
+
+    std::vector<rect_detection> dets, levelDets;
+    scanner.set_level_suppression(false);
+    fullMs += timeMs(kRuns, [&] { detector(img, dets, kAdjustThreshold); });
+
+    // The detector keeps what a linear suppression keeps
+    candidate_list list;
+    detectorCandidates(detector, list);
+    std::vector<rectangle> linear, gridKept;
+    linearMs += timeMs(kRuns, [&] { suppressLinear(tester, list, linear); });
+    gridMs += timeMs(kRuns, [&] { suppressGrid(tester, list, grid, gridKept); });
+    std::vector<rectangle> kept;
+    for (const rect_detection &d : dets)
+      kept.push_back(d.rect);
+    if (linear != kept || gridKept != kept)
+    {
+      cout << "  " << argv[i] << ": the suppressions keep other boxes" << endl;
+      ok = false;
+    }
+    numCandidates += list.size();
+    numFaces += dets.size();
+
+    // At the trained threshold the level suppression finds the same faces
+    std::vector<rect_detection> faces, levelFaces;
+    detector(img, faces);
+    scanner.set_level_suppression(true, tester);
+    detector(img, levelFaces);
+    bool same = faces.size() == levelFaces.size();
+    for (unsigned long j = 0; same && j < faces.size(); ++j)
+      same = faces[j].rect == levelFaces[j].rect &&
+             faces[j].weight_index == levelFaces[j].weight_index;
+    if (!same)
+    {
+      cout << "  " << argv[i] << ": level suppression changes the faces" << endl;
+      ok = false;
+    }
+
+    levelMs += timeMs(kRuns, [&] { detector(img, levelDets, kAdjustThreshold); });
+    detectorCandidates(detector, list);
+    numLevelCandidates += list.size();
+    if (levelKeepsOverlaps(detector, tester))
+    {
+      cout << "  " << argv[i] << ": level suppression keeps overlapping windows"
+           << endl;
+      ok = false;
+    }
+    numLevelFaces += levelDets.size();
+    for (const rect_detection &d : levelDets)
+      for (const rect_detection &ref : dets)
+        if (d.rect == ref.rect && d.weight_index == ref.weight_index)
+        {
+          ++numSame;
+          break;
+        }
+  }
+  scanner.set_level_suppression(false);
+
+  const int numImages = argc - 1;
+  cout << "detector candidates/frame with adjust_threshold " << kAdjustThreshold
+       << ": " << numCandidates / numImages << ", suppression ms/frame linear "
+       << linearMs / numImages << ", grid " << gridMs / numImages << endl;
+  cout << "level suppression: candidates/frame " << numLevelCandidates / numImages
+       << ", faces " << numLevelFaces << " of " << numFaces << " ("
+       << numSame << " the same), ms/frame " << fullMs / numImages << " -> "
+       << levelMs / numImages << endl;
+
+  cout << (ok ? "PASS" : "FAIL") << endl;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,189 @@
+//============================================================================
+// Name        : TestWarmStart.cpp
+// Author      : Nanyun
+// Version     : 1.0
+// Copyright   : Nanyun
+// Description : Trains a small 68 landmark shape_predictor on the faces of
+//               training_with_face_landmarks.xml and runs it on short made up
+//               videos of the faces of testing_with_face_landmarks.xml, the
+//               face moving and rolling a little every frame, with a jittered
+//               box, and one jump. Each frame starts from the landmarks of the
+//               frame before and runs the cascade levels warm_start_levels()
+//               gives. It prints how far that is from the labels and from
+//               running the whole cascade, with the levels and time per frame.
+//               A jump must run the whole cascade and give its landmarks.
+//============================================================================
+#include <dlib/data_io.h>
+#include <dlib/image_processing.h>
+#include <dlib/rand.h>
+
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include "test_util.h"
+
+using namespace dlib;
+using namespace std;
+
+static const int kRuns = 5;
+static const int kFrames = 30;
+static const int kJumpFrame = 20;
+static const double kMaxMotion = 0.2;
+
+struct Frame
+{
+  array2d<unsigned char> img;
+  rectangle box;
+  full_object_detection truth;
+};
+
+// A face moving smoothly by about 2% of its width and rolling by up to 5
+// degrees, its box off by about 1% more, and jumping by half its width at
+// kJumpFrame. The box doesn't roll, so the landmarks have to follow.
+static void makeVideo(dlib::rand &rnd, const array2d<unsigned char> &img,
+                      const full_object_detection &face, std::vector<Frame> &frames)
+{
+  frames.resize(kFrames);
+  const double width = face.get_rect().width();
+  const dlib::vector<double, 2> center = dcenter(face.get_rect());
+  for (int k = 0; k < kFrames; ++k)
+  {
+    dlib::vector<double, 2> offset(0.08 * width * std::sin(k * 0.3),
+                                   0.05 * width * std::cos(k * 0.2));
+    if (k >= kJumpFrame)
+      offset.x() += width / 2;
+    const double angle = 5 * pi / 180 * std::sin(k * 0.25);
+    // from the face in img to the face in the frame
+    const point_transform_affine move(
+        rotation_matrix(angle),
+        center + offset - rotation_matrix(angle) * center);
+    frames[k].img.set_size(img.nr(), img.nc());
+    transform_image(img, frames[k].img, interpolate_bilinear(), inv(move));
+
+    const point jitter(std::lround(0.01 * width * rnd.get_random_gaussian()),
+                       std::lround(0.01 * width * rnd.get_random_gaussian()));
+    frames[k].box = translate_rect(face.get_rect(), point(offset) + jitter);
+    std::vector<point> parts(face.num_parts());
+    for (unsigned long j = 0; j < parts.size(); ++j)
+      parts[j] = move(face.part(j));
+    frames[k].truth = full_object_detection(frames[k].box, parts);
+  }
+}
+
+static double meanDistance(const full_object_detection &shape,
+                           const full_object_detection &other)
+{
+  double sum = 0;
+  for (unsigned long j = 0; j < shape.num_parts(); ++j)
+    sum += length(shape.part(j) - other.part(j));
+  return sum / shape.num_parts();
+}
+
+struct Totals
+{
+  double toLabels = 0, toFull = 0, levels = 0, ms = 0;
+};
+
+int main(int argc, char **argv)
+{
+  cout << "TestWarmStart" << endl;
+  if (argc < 3)
+  {
+    cout << "Call this program like this:" << endl;
+    cout << "./TestWarmStart faces/training_with_face_landmarks.xml "
+            "faces/testing_with_face_landmarks.xml"
+         << endl;
+    return 0;
+  }
+
+  dlib::array<array2d<unsigned char> > trainImages, testImages;
+  std::vector<std::vector<full_object_detection> > trainFaces, testFaces;
+  load_image_dataset(trainImages, trainFaces, argv[1]);
+  load_image_dataset(testImages, testFaces, argv[2]);
+
+  shape_predictor_trainer trainer;
+  trainer.set_oversampling_amount(20);
+  trainer.set_nu(0.1);
+  trainer.set_cascade_depth(10);
+  trainer.set_num_threads(1);
+  // On so few faces 500 trees fit the first level and leave the others
+  // nothing to correct, unlike a model trained on thousands of faces
+  trainer.set_num_trees_per_cascade_level(50);
+  const shape_predictor sp = trainer.train(trainImages, trainFaces);
+
+  const unsigned long minLevels[] = {1, 2, 3};
+  const int numConfigs = sizeof(minLevels) / sizeof(minLevels[0]);
+  Totals full, warm[numConfigs];
+  dlib::rand rnd;
+  bool ok = true;
+  int numVideos = 0;
+  std::vector<Frame> frames;
+  for (unsigned long i = 0; i < testImages.size(); ++i)
+  {
+    for (const full_object_detection &face : testFaces[i])
+    {
+      makeVideo(rnd, testImages[i], face, frames);
+      std::vector<full_object_detection> cold(kFrames);
+      for (int k = 0; k < kFrames; ++k)
+      {
+        full.ms += timeMs(kRuns, [&] { cold[k] = sp(frames[k].img, frames[k].box); });
+        full.toLabels += meanDistance(cold[k], frames[k].truth);
+        full.levels += sp.num_cascade_levels();
+      }
+
+      for (int c = 0; c < numConfigs; ++c)
+      {
+        full_object_detection previous = cold[0];
+        for (int k = 1; k < kFrames; ++k)
+        {
+          const unsigned long levels = sp.warm_start_levels(
+              previous.get_rect(), frames[k].box, minLevels[c], kMaxMotion);
+          full_object_detection shape;
+          warm[c].ms += timeMs(kRuns, [&] { shape = sp(frames[k].img, frames[k].box, previous, levels); });
+          warm[c].levels += levels;
+          warm[c].toLabels += meanDistance(shape, frames[k].truth);
+          warm[c].toFull += meanDistance(shape, cold[k]);
+          if (k == kJumpFrame)
+          {
+            // the box jumped, so the whole cascade runs from the mean shape
+            if (levels != sp.num_cascade_levels() ||
+                meanDistance(shape, cold[k]) != 0)
+              ok = false;
+          }
+          previous = shape;
+        }
+      }
+      ++numVideos;
+    }
+  }
+
+  // the whole cascade from the frame before is the cold start
+  {
+    const full_object_detection &face = testFaces[0][0];
+    const full_object_detection previous = sp(testImages[0], face.get_rect());
+    const full_object_detection all =
+        sp(testImages[0], face.get_rect(), previous, sp.num_cascade_levels());
+    if (meanDistance(all, previous) != 0)
+      ok = false;
+  }
+
+  const int numColdFrames = numVideos * kFrames;
+  const int numFrames = numVideos * (kFrames - 1);
+  cout << "model " << sp.num_cascade_levels() << " cascade levels, "
+       << numVideos << " videos of " << kFrames << " frames" << endl;
+  cout << "whole cascade: " << full.toLabels / numColdFrames
+       << " pixels from the labels, " << full.ms / numColdFrames << " ms/frame"
+       << endl;
+  for (int c = 0; c < numConfigs; ++c)
+  {
+    cout << "warm start, at least " << minLevels[c]
+         << " levels: " << warm[c].toLabels / numFrames
+         << " pixels from the labels, " << warm[c].toFull / numFrames
+         << " from the whole cascade, " << warm[c].levels / numFrames
+         << " levels, " << warm[c].ms / numFrames << " ms/frame" << endl;
+  }
+
+  cout << (ok ? "PASS" : "FAIL") << endl;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,150 @@
+//============================================================================
+// Name        : TestWorkspace.cpp
+// Author      : Nanyun
+// Version     : 1.0
+// Copyright   : Nanyun
+// Description : Counts the heap allocations of the frontal face detector
+//               frame after frame. Once scan_fhog_pyramid's workspace has seen
+//               the biggest frame, full scans, region scans and smaller frames
+//               must not allocate at all, with or without a pool, streaming or
+//               a face size range. One of the smaller frames has the size of
+//               data/lena.bmp, 361x302, so the streamed pyramids of the frames
+//               have both an odd and an even number of levels. Prints the
+//               workspace counters.
+//============================================================================
+#include <dlib/image_io.h>
+#include <dlib/image_processing/frontal_face_detector.h>
+#include <dlib/threads/thread_pool_extension.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <vector>
+
+using namespace dlib;
+using namespace std;
+
+static const int kFrames = 8;
+static const int kKinds = 4;
+
+// Every operator new of the program goes through here. The other forms
+// forward to these two, as the default ones do. They are kept out of line so
+// the compiler never sees free() on a pointer from operator new.
+static std::atomic<long> gAllocs(0);
+
+__attribute__((noinline)) void *operator new(size_t n)
+{
+  ++gAllocs;
+  void *p = malloc(n ? n : 1);
+  if (!p)
+    throw std::bad_alloc();
+  return p;
+}
+
+__attribute__((noinline)) void operator delete(void *p) noexcept
+{
+  free(p);
+}
+
+void *operator new[](size_t n) { return ::operator new(n); }
+void operator delete[](void *p) noexcept { ::operator delete(p); }
+void operator delete(void *p, size_t) noexcept { ::operator delete(p); }
+void operator delete[](void *p, size_t) noexcept { ::operator delete[](p); }
+
+// The frames a camera gives: the big one, two smaller ones, and region scans
+// around the face in between
+template <typename image_type>
+static void runFrame(frontal_face_detector &detector, const image_type &big,
+                     const image_type &small, const image_type &bmp, int i,
+                     std::vector<rect_detection> &dets)
+{
+  if (i % kKinds == 3 && !dets.empty())
+  {
+    const rectangle face = dets[0].rect;
+    detector.detect_in_region(big, grow_rect(face, face.width() / 2),
+                              face.width() * 7 / 10, face.width() * 14 / 10,
+                              dets);
+  }
+  else
+  {
+    detector(i % kKinds == 1 ? small : i % kKinds == 2 ? bmp : big, dets);
+  }
+}
+
+template <typename image_type>
+static bool checkSteadyState(frontal_face_detector &detector,
+                             const image_type &big, const image_type &small,
+                             const image_type &bmp, thread_pool *pool,
+                             bool stream,
+                             unsigned long minFaceSize, const char *name)
+{
+  scan_fhog_pyramid<pyramid_down<6> > &scanner = detector.get_scanner();
+  scanner.set_thread_pool(pool);
+  scanner.set_streaming_pyramid(stream);
+  scanner.set_box_size_range(minFaceSize, 0);
+
+  // One round of each kind of frame sizes the workspace
+  std::vector<rect_detection> dets;
+  for (int i = 0; i < kKinds; ++i)
+    runFrame(detector, big, small, bmp, i, dets);
+  const fhog_workspace_stats before = scanner.get_workspace_stats();
+
+  const long allocs = gAllocs;
+  for (int i = 0; i < kFrames; ++i)
+    runFrame(detector, big, small, bmp, i, dets);
+  const long frameAllocs = gAllocs - allocs;
+  const fhog_workspace_stats &after = scanner.get_workspace_stats();
+
+  cout << "  " << name << ", " << (pool ? "pool" : "no pool") << ", "
+       << (stream ? "streaming" : "whole pyramid") << ", min face "
+       << minFaceSize << ": " << frameAllocs << " allocations in " << kFrames
+       << " frames, " << after.num_calls - before.num_calls << " calls, "
+       << after.num_grows - before.num_grows << " grows, " << after.bytes
+       << " bytes" << endl;
+
+  scanner.set_box_size_range(0, 0);
+  scanner.set_streaming_pyramid(false);
+  scanner.set_thread_pool(0);
+  return frameAllocs == 0 && after.num_grows == before.num_grows &&
+         after.num_calls > before.num_calls;
+}
+
+int main(int argc, char **argv)
+{
+  cout << "TestWorkspace" << endl;
+  if (argc < 2)
+  {
+    cout << "Call this program like this:" << endl;
+    cout << "./TestWorkspace lena.jpg" << endl;
+    return 0;
+  }
+
+  array2d<rgb_pixel> rgb;
+  load_image(rgb, argv[1]);
+  array2d<rgb_pixel> smallRgb(rgb.nr() * 3 / 4, rgb.nc() * 3 / 4);
+  resize_image(rgb, smallRgb);
+  // The size of data/lena.bmp
+  array2d<rgb_pixel> bmpRgb(302, 361);
+  resize_image(rgb, bmpRgb);
+  array2d<unsigned char> gray, smallGray, bmpGray;
+  assign_image(gray, rgb);
+  assign_image(smallGray, smallRgb);
+  assign_image(bmpGray, bmpRgb);
+
+  frontal_face_detector detector = get_frontal_face_detector();
+  thread_pool pool(3);
+  bool ok = true;
+  for (thread_pool *p : {(thread_pool *)0, &pool})
+    for (bool stream : {false, true})
+      for (unsigned long minFaceSize : {0ul, 150ul})
+      {
+        ok = checkSteadyState(detector, gray, smallGray, bmpGray, p, stream,
+                              minFaceSize, "gray") && ok;
+        ok = checkSteadyState(detector, rgb, smallRgb, bmpRgb, p, stream,
+                              minFaceSize, "rgb") && ok;
+      }
+
+  cout << (ok ? "PASS" : "FAIL") << endl;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,119 @@
+//============================================================================
+// Name        : TestYPlaneDetect.cpp
+// Author      : Nanyun
+// Version     : 1.0
+// Copyright   : Nanyun
+// Description : Runs DLibHOGFaceDetector on a padded luminance plane, the way
+//               a camera Y plane arrives, and on the BGR image that the
+//               bitmap path would build. Prints the time per frame of both
+//               and checks the Y plane path doesn't depend on the row stride.
+//============================================================================
+#include <detector.h>
+
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+using namespace std;
+
+static const int kRuns = 5;
+
+template <typename image_type>
+static double timeDet(DLibHOGFaceDetector &detector, const image_type &img,
+                      int &numFaces)
+{
+  double total = 0;
+  for (int i = 0; i < kRuns; ++i)
+  {
+    auto t0 = std::chrono::steady_clock::now();
+    numFaces = detector.det(img);
+    auto t1 = std::chrono::steady_clock::now();
+    total += std::chrono::duration<double, std::milli>(t1 - t0).count();
+  }
+  return total / kRuns;
+}
+
+static bool sameResults(const std::vector<dlib::rectangle> &rectsA,
+                        std::unordered_map<int, dlib::full_object_detection> &shapesA,
+                        const std::vector<dlib::rectangle> &rectsB,
+                        std::unordered_map<int, dlib::full_object_detection> &shapesB)
+{
+  if (rectsA != rectsB || shapesA.size() != shapesB.size())
+    return false;
+  for (auto &it : shapesA)
+  {
+    const dlib::full_object_detection &a = it.second;
+    const dlib::full_object_detection &b = shapesB[it.first];
+    if (a.num_parts() != b.num_parts())
+      return false;
+    for (unsigned long j = 0; j < a.num_parts(); ++j)
+      if (a.part(j) != b.part(j))
+        return false;
+  }
+  return true;
+}
+
+int main(int argc, char **argv)
+{
+  cout << "TestYPlaneDetect" << endl;
+  if (argc < 3)
+  {
+    cout << "Call this program like this:" << endl;
+    cout << "./TestYPlaneDetect shape_predictor_68_face_landmarks.dat "
+            "faces/*.jpg"
+         << endl;
+    cout << "Pass \"\" as the model to skip the landmarks." << endl;
+    return 0;
+  }
+
+  DLibHOGFaceDetector detector(argv[1]);
+  bool ok = true;
+  for (int i = 2; i < argc; ++i)
+  {
+    cv::Mat bgr = cv::imread(argv[i], CV_LOAD_IMAGE_COLOR);
+    if (bgr.empty())
+    {
+      cout << argv[i] << ": can't read" << endl;
+      ok = false;
+      continue;
+    }
+    cv::Mat gray;
+    cv::cvtColor(bgr, gray, CV_BGR2GRAY);
+
+    // Camera planes usually have padded rows, so test with a stride that
+    // isn't the width
+    const int rowStride = (gray.cols + 63) / 64 * 64 + 64;
+    std::vector<jnicommon::uint8> yPlane(
+        jnicommon::LumaImageView::requiredCapacity(gray.cols, gray.rows,
+                                                   rowStride),
+        0xAA);
+    for (int r = 0; r < gray.rows; ++r)
+      memcpy(&yPlane[r * rowStride], gray.ptr(r), gray.cols);
+    jnicommon::LumaImageView padded(&yPlane[0], gray.cols, gray.rows,
+                                    rowStride);
+    cv::Mat contiguous = gray.clone();
+    jnicommon::LumaImageView packed(contiguous.ptr(), contiguous.cols,
+                                    contiguous.rows, contiguous.cols);
+
+    int bgrFaces = 0;
+    int yFaces = 0;
+    double bgrMs = timeDet(detector, bgr, bgrFaces);
+    double yMs = timeDet(detector, padded, yFaces);
+    std::vector<dlib::rectangle> paddedRects = detector.getResult();
+    auto paddedShapes = detector.getFaceShapeMap();
+    detector.det(packed);
+    if (!sameResults(paddedRects, paddedShapes, detector.getResult(),
+                     detector.getFaceShapeMap()))
+    {
+      cout << argv[i] << ": results depend on the row stride" << endl;
+      ok = false;
+    }
+
+    cout << argv[i] << " " << gray.cols << "x" << gray.rows << endl;
+    cout << "  bgr    : " << bgrFaces << " faces, " << bgrMs << " ms/frame"
+         << endl;
+    cout << "  y plane: " << yFaces << " faces, " << yMs << " ms/frame" << endl;
+  }
+  cout << (ok ? "PASS" : "FAIL") << endl;
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,209 @@
+//============================================================================
+// Name        : TestYuvConvert.cpp
+// Author      : Nanyun
+// Version     : 1.0
+// Copyright   : Nanyun
+// Description : Checks the SIMD and threaded YUV converters against the
+//               scalar ones byte for byte, at every SIMD level this CPU runs,
+//               for odd sizes and padded planes. Prints the time per 1080p
+//               frame of each level.
+//============================================================================
+#include <jni_common/rgb2yuv.h>
+#include <jni_common/simd_dispatch.h>
+#include <jni_common/yuv2rgb.h>
+
+#include <dlib/threads.h>
+
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "test_util.h"
+
+using namespace std;
+using namespace jnicommon;
+
+static const int kRuns = 10;
+
+static std::vector<uint8> randomBytes(std::mt19937 &rng, size_t size)
+{
+  std::uniform_int_distribution<int> byte(0, 255);
+  std::vector<uint8> bytes(size);
+  for (size_t i = 0; i < size; ++i)
+    bytes[i] = byte(rng);
+  return bytes;
+}
+
+// A camera frame the way YUV_420_888 delivers it: padded rows, and separate
+// U and V buffers that end right after their last sample
+struct Frame
+{
+  int width, height, yRowStride, uvRowStride, uvPixelStride;
+  std::vector<uint8> y, u, v;
+};
+
+static Frame makeFrame(std::mt19937 &rng, int width, int height,
+                       int uvPixelStride, int padding)
+{
+  Frame f;
+  f.width = width;
+  f.height = height;
+  f.yRowStride = width + padding;
+  f.uvPixelStride = uvPixelStride;
+  const int uvWidth = (width + 1) / 2;
+  const int uvHeight = (height + 1) / 2;
+  f.uvRowStride = uvWidth * uvPixelStride + padding;
+  f.y = randomBytes(rng, f.yRowStride * (height - 1) + width);
+  const size_t uvSize =
+      f.uvRowStride * (uvHeight - 1) + (uvWidth - 1) * uvPixelStride + 1;
+  f.u = randomBytes(rng, uvSize);
+  f.v = randomBytes(rng, uvSize);
+  return f;
+}
+
+template <typename T>
+static bool check(const char *what, const std::vector<T> &ref,
+                  const std::vector<T> &out, int width, int height,
+                  SimdLevel level, int threads)
+{
+  for (size_t i = 0; i < ref.size(); ++i)
+  {
+    if (ref[i] != out[i])
+    {
+      cout << "  " << what << " " << width << "x" << height << " "
+           << SimdLevelName(level) << " threads " << threads
+           << ": first difference at " << i << endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool testSize(std::mt19937 &rng, int width, int height,
+                     const std::vector<SimdLevel> &levels,
+                     dlib::thread_pool &pool)
+{
+  bool ok = true;
+  const int n = width * height;
+  for (int uvPixelStride = 1; uvPixelStride <= 2; ++uvPixelStride)
+  {
+    Frame f = makeFrame(rng, width, height, uvPixelStride, uvPixelStride * 3);
+    std::vector<uint32> ref(n);
+    ConvertYUV420ToARGB8888(&f.y[0], &f.u[0], &f.v[0], &ref[0], width, height,
+                            f.yRowStride, f.uvRowStride, f.uvPixelStride);
+    for (SimdLevel level : levels)
+    {
+      SetSimdLevel(level);
+      for (int threads = 0; threads <= 1; ++threads)
+      {
+        std::vector<uint32> out(n);
+        ConvertYUV420ToARGB8888Fast(&f.y[0], &f.u[0], &f.v[0], &out[0], width,
+                                    height, f.yRowStride, f.uvRowStride,
+                                    f.uvPixelStride, threads ? &pool : 0);
+        ok &= check(uvPixelStride == 1 ? "yuv420 argb" : "yuv420 argb 2",
+                    ref, out, width, height, level, threads);
+      }
+    }
+  }
+
+  // NV21: a Y plane followed by interleaved V and U rows of width bytes. With
+  // an odd width the last U sample is one byte past the last row.
+  const int uvHeight = (height + 1) / 2;
+  std::vector<uint8> nv21 =
+      randomBytes(rng, n + width * uvHeight + width % 2);
+  std::vector<uint32> refArgb(n);
+  std::vector<uint16> ref565(n);
+  ConvertYUV420SPToARGB8888(&nv21[0], &nv21[n], &refArgb[0], width, height);
+  ConvertYUV420SPToRGB565(&nv21[0], &ref565[0], width, height);
+
+  // ARGB to NV21. The UV blocks of an odd width or height are partial.
+  const int uvSize = 2 * ((width + 1) / 2) * uvHeight;
+  std::vector<uint8> argbBytes = randomBytes(rng, n * 4);
+  std::vector<uint32> argb(n);
+  memcpy(&argb[0], &argbBytes[0], n * 4);
+  std::vector<uint8> refYuv(n + uvSize);
+  ConvertARGB8888ToYUV420SP(&argb[0], &refYuv[0], width, height);
+
+  for (SimdLevel level : levels)
+  {
+    SetSimdLevel(level);
+    for (int threads = 0; threads <= 1; ++threads)
+    {
+      dlib::thread_pool *p = threads ? &pool : 0;
+      std::vector<uint32> outArgb(n);
+      ConvertYUV420SPToARGB8888Fast(&nv21[0], &nv21[n], &outArgb[0], width,
+                                    height, p);
+      ok &= check("nv21 argb", refArgb, outArgb, width, height, level,
+                  threads);
+      std::vector<uint16> out565(n);
+      ConvertYUV420SPToRGB565Fast(&nv21[0], &out565[0], width, height, p);
+      ok &= check("nv21 rgb565", ref565, out565, width, height, level,
+                  threads);
+      // Garbage in the output, since the scalar code clears each UV block
+      std::vector<uint8> outYuv = randomBytes(rng, n + uvSize);
+      ConvertARGB8888ToYUV420SPFast(&argb[0], &outYuv[0], width, height, p);
+      ok &= check("argb nv21", refYuv, outYuv, width, height, level, threads);
+    }
+  }
+  return ok;
+}
+
+int main(int argc, char **argv)
+{
+  cout << "TestYuvConvert" << endl;
+  std::mt19937 rng(1234);
+  dlib::thread_pool pool(3);
+
+  const SimdLevel supported = GetSupportedSimdLevel();
+  std::vector<SimdLevel> levels(1, SIMD_NONE);
+  if (supported == SIMD_AVX2)
+    levels.push_back(SIMD_SSE2);
+  if (supported != SIMD_NONE)
+    levels.push_back(supported);
+  cout << "supported: " << SimdLevelName(supported) << endl;
+
+  const int sizes[][2] = {{1, 1},   {2, 2},   {7, 5},    {8, 8},
+                          {15, 3},  {16, 2},  {17, 9},   {33, 17},
+                          {64, 48}, {99, 71}, {640, 480}, {1280, 721}};
+  bool ok = true;
+  for (const auto &size : sizes)
+    ok &= testSize(rng, size[0], size[1], levels, pool);
+
+  // 1080p from a YUV_420_888 camera with a pixel stride of 2
+  const int width = 1920;
+  const int height = 1080;
+  Frame f = makeFrame(rng, width, height, 2, 0);
+  std::vector<uint32> argb(width * height);
+  std::vector<uint8> nv21(width * height * 3 / 2);
+  cout << "1080p, ms/frame: to argb, to nv21" << endl;
+  cout << "  scalar: " << timeMs(kRuns, [&] {
+    ConvertYUV420ToARGB8888(&f.y[0], &f.u[0], &f.v[0], &argb[0], width, height,
+                            f.yRowStride, f.uvRowStride, f.uvPixelStride);
+  }) << ", " << timeMs(kRuns, [&] {
+    ConvertARGB8888ToYUV420SP(&argb[0], &nv21[0], width, height);
+  }) << endl;
+  for (SimdLevel level : levels)
+  {
+    SetSimdLevel(level);
+    for (int threads = 0; threads <= 1; ++threads)
+    {
+      dlib::thread_pool *p = threads ? &pool : 0;
+      cout << "  " << SimdLevelName(level) << (threads ? " + pool" : "")
+           << ": " << timeMs(kRuns, [&] {
+                ConvertYUV420ToARGB8888Fast(
+                    &f.y[0], &f.u[0], &f.v[0], &argb[0], width, height,
+                    f.yRowStride, f.uvRowStride, f.uvPixelStride, p);
+              })
+           << ", " << timeMs(kRuns, [&] {
+                ConvertARGB8888ToYUV420SPFast(&argb[0], &nv21[0], width,
+                                              height, p);
+              })
+           << endl;
+    }
+  }
+  SetSimdLevel(supported);
+
+  cout << (ok ? "PASS" : "FAIL") << endl;
+  return ok ? 0 : 1;
+}
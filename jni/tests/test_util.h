@@ -0,0 +1,140 @@
+//============================================================================
+// Name        : test_util.h
+// Author      : Nanyun
+// Version     : 1.0
+// Copyright   : Nanyun
+// Description : The helpers the tests share: timing a call, the overlap of two
+//               boxes, comparing two runs of the detector bit for bit, and
+//               random FHOG planes and separable filter banks for the filter
+//               kernels.
+//============================================================================
+#pragma once
+
+#include <dlib/array.h>
+#include <dlib/array2d.h>
+#include <dlib/geometry/rectangle.h>
+#include <dlib/image_processing/object_detector.h>
+#include <dlib/matrix.h>
+#include <dlib/rand.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+// The average ms of runs calls to f
+template <typename F>
+inline double timeMs(int runs, F f)
+{
+  auto t0 = std::chrono::steady_clock::now();
+  for (int i = 0; i < runs; ++i)
+    f();
+  auto t1 = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::milli>(t1 - t0).count() / runs;
+}
+
+// Intersection over union
+inline double overlap(const dlib::rectangle &a, const dlib::rectangle &b)
+{
+  const double inter = a.intersect(b).area();
+  return inter / (a.area() + b.area() - inter);
+}
+
+// The same boxes from the same filters, with the same bits in the confidences
+inline bool sameDetections(const std::vector<dlib::rect_detection> &a,
+                           const std::vector<dlib::rect_detection> &b)
+{
+  if (a.size() != b.size())
+    return false;
+  for (unsigned long i = 0; i < a.size(); ++i)
+  {
+    if (a[i].rect != b[i].rect || a[i].weight_index != b[i].weight_index ||
+        memcmp(&a[i].detection_confidence, &b[i].detection_confidence,
+               sizeof(double)) != 0)
+      return false;
+  }
+  return true;
+}
+
+typedef std::vector<std::vector<dlib::matrix<float, 0, 1> > > filter_bank;
+
+// As many planes as an FHOG feature image
+static const int kPlanes = 31;
+
+// FHOG planes are in [0, 0.4], and mostly small
+inline void randomPlanes(dlib::rand &rnd, long nr, long nc,
+                         dlib::array<dlib::array2d<float> > &planes)
+{
+  planes.clear();
+  planes.resize(kPlanes);
+  for (unsigned long i = 0; i < planes.size(); ++i)
+  {
+    planes[i].set_size(nr, nc);
+    for (long r = 0; r < nr; ++r)
+      for (long c = 0; c < nc; ++c)
+      {
+        const float u = rnd.get_random_float();
+        planes[i][r][c] = u * u * 0.4f;
+      }
+  }
+}
+
+// Up to 3 filter pairs per plane, and some planes with none, the way a
+// trained filter bank keeps only the big singular values
+inline void randomFilters(dlib::rand &rnd, long rowSize, long colSize,
+                          filter_bank &rowFilters, filter_bank &colFilters)
+{
+  rowFilters.assign(kPlanes, std::vector<dlib::matrix<float, 0, 1> >());
+  colFilters.assign(kPlanes, std::vector<dlib::matrix<float, 0, 1> >());
+  for (int i = 0; i < kPlanes; ++i)
+  {
+    const int num = i == 0 ? 1 : rnd.get_random_32bit_number() % 4;
+    for (int j = 0; j < num; ++j)
+    {
+      dlib::matrix<float, 0, 1> row(rowSize), col(colSize);
+      for (long n = 0; n < rowSize; ++n)
+        row(n) = rnd.get_random_gaussian();
+      for (long m = 0; m < colSize; ++m)
+        col(m) = rnd.get_random_gaussian();
+      rowFilters[i].push_back(row);
+      colFilters[i].push_back(col);
+    }
+  }
+}
+
+// Calls f(filterSize, planeSize, planes, rowFilters, colFilters) for random
+// banks of filters from 1x1 to 12x4 over planes smaller and bigger than the
+// filters. The sizes are {rows, columns}.
+template <typename F>
+inline void forEachRandomBank(F f)
+{
+  dlib::rand rnd;
+  const long sizes[][2] = {{1, 1}, {5, 3}, {10, 10}, {2, 7}, {12, 4}};
+  const long images[][2] = {{40, 67}, {13, 5}, {8, 8}, {97, 33}, {3, 120}};
+  for (const long *size : sizes)
+    for (const long *image : images)
+    {
+      dlib::array<dlib::array2d<float> > planes;
+      randomPlanes(rnd, image[0], image[1], planes);
+      filter_bank rowFilters, colFilters;
+      randomFilters(rnd, size[1], size[0], rowFilters, colFilters);
+      f(size, image, planes, rowFilters, colFilters);
+    }
+}
+
+// The largest difference to ref, relative to the largest value of ref
+inline double relativeError(const dlib::array2d<float> &ref,
+                            const dlib::array2d<float> &img)
+{
+  if (ref.nr() != img.nr() || ref.nc() != img.nc())
+    return 1e30;
+  double maxRef = 1e-6, maxDiff = 0;
+  for (long r = 0; r < ref.nr(); ++r)
+    for (long c = 0; c < ref.nc(); ++c)
+    {
+      maxRef = std::max(maxRef, (double)std::abs(ref[r][c]));
+      maxDiff = std::max(maxDiff, (double)std::abs(ref[r][c] - img[r][c]));
+    }
+  return maxDiff / maxRef;
+}
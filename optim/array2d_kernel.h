@@ -138,7 +138,9 @@ namespace dlib
             last(0),
             at_start_(true),
             shadow(false),
-            sr_(0)
+            sr_(0),
+            cap_(0),
+            grow_only_(false)
         {
         }
 
@@ -153,7 +155,9 @@ namespace dlib
             last(0),
             at_start_(true),
             shadow(false),
-            sr_(0)
+            sr_(0),
+            cap_(0),
+            grow_only_(false)
         {
             // make sure requires clause is not broken
             DLIB_ASSERT((cols >= 0 && rows >= 0),
@@ -236,6 +240,8 @@ namespace dlib
             pool.swap(item.pool);
 			exchange(shadow,item.shadow);
 			exchange(sr_,item.sr_);
+            exchange(cap_,item.cap_);
+            exchange(grow_only_,item.grow_only_);
         }
 
         void clear (
@@ -253,6 +259,7 @@ namespace dlib
 				shadow = false;
 				sr_ = 0;
             }
+            cap_ = 0;
         }
 
         void set_size (
@@ -260,6 +267,28 @@ namespace dlib
             long cols
         );
 
+        void set_grow_only (
+            bool grow_only
+        ) { grow_only_ = grow_only; }
+        /*!
+            ensures
+                - When grow_only is true, set_size() to a non-empty size that fits in
+                  the memory already held keeps that memory, so a buffer resized every
+                  frame only allocates when a frame is bigger than any before.  The
+                  elements don't get initial values then.  clear() and set_size(0,0)
+                  still give the memory back.
+        !*/
+
+        bool get_grow_only (
+        ) const { return grow_only_; }
+
+        unsigned long capacity (
+        ) const { return shadow ? 0 : cap_; }
+        /*!
+            ensures
+                - returns how many elements the memory this object owns can hold
+        !*/
+
         bool at_start (
         ) const { return at_start_; }
 
@@ -333,6 +362,8 @@ namespace dlib
 			const array2d<T>& a
 		)
 		{
+			if (!shadow)
+				clear();
     		this->data = a.data;
 			this->nc_ = a.nc_;
 			this->nr_ = a.nr_;
@@ -415,6 +446,10 @@ namespace dlib
         mutable bool at_start_;
 		bool shadow;
 		long sr_;
+        // the elements data was allocated for, which is more than size() when
+        // grow_only_ kept a bigger buffer
+        unsigned long cap_;
+        bool grow_only_;
 		
         // restricted functions
         array2d(array2d&);        // copy constructor
@@ -557,15 +592,28 @@ template <
             return;
         }
 
+        // reuse the memory we have if it's big enough and we were asked to keep it
+        if (grow_only_ && !shadow && (unsigned long)(rows*cols) <= cap_ && rows*cols > 0)
+        {
+            nc_ = cols;
+            nr_ = rows;
+            last = data + nr_*nc_ - 1;
+            return;
+        }
+
         nc_ = cols;
         nr_ = rows;
 
-        // free any existing memory
+        // free any existing memory, unless it belongs to the array2d we shadow
         if (data != 0)
         {
-            pool.deallocate_array(data);
+            if (!shadow)
+                pool.deallocate_array(data);
             data = 0;
         }
+        shadow = false;
+        sr_ = 0;
+        cap_ = 0;
 
         // now setup this object to have the new size
         try
@@ -574,6 +622,7 @@ template <
             {
                 data = pool.allocate_array(nr_*nc_);
                 last = data + nr_*nc_ - 1;
+                cap_ = nr_*nc_;
             }
         }
         catch (...)
@@ -0,0 +1,161 @@
+// License: Boost Software License   See LICENSE.txt for the full license.
+#ifndef DLIB_BOX_OVERLAP_GRId_Hh_
+#define DLIB_BOX_OVERLAP_GRId_Hh_
+
+#include "box_overlap_testing.h"
+#include "../geometry.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace dlib
+{
+
+// ----------------------------------------------------------------------------------------
+
+    class box_overlap_grid
+    {
+        /*!
+            WHAT THIS OBJECT REPRESENTS
+                The boxes a greedy non-max suppression has kept so far, bucketed in a grid
+                of square cells over the area the candidates come from.  A candidate is
+                only tested against the kept boxes that share a cell with it, instead of
+                against all of them.  test_box_overlap never matches boxes that don't
+                intersect, so overlaps_any() gives the same answer as testing every kept
+                box in turn.
+
+                The buckets keep their memory from one reset() to the next, so a
+                suppression run on every frame doesn't allocate once they are big
+                enough.
+        !*/
+    public:
+
+        box_overlap_grid (
+        ) : origin_x(0), origin_y(0), cell_size(1), num_cols(0), num_rows(0), stamp(0) {}
+
+        void reset (
+            const rectangle& area,
+            long box_size,
+            unsigned long max_cells = 1024
+        )
+        /*!
+            requires
+                - max_cells > 0
+            ensures
+                - #size() == 0
+                - The boxes added from now on are inside area.  box_size is about their
+                  width, e.g. their mean, and sets the size of the cells unless that
+                  would make more than max_cells of them.
+        !*/
+        {
+            for (unsigned long i = 0; i < cells.size(); ++i)
+                cells[i].clear();
+            boxes.clear();
+            tested.clear();
+            stamp = 0;
+
+            origin_x = area.left();
+            origin_y = area.top();
+            cell_size = std::max<long>(box_size, 1);
+            const double num = (double)(area.width()/cell_size + 1)*(area.height()/cell_size + 1);
+            if (num > max_cells)
+                cell_size = (long)std::ceil(cell_size*std::sqrt(num/max_cells));
+            num_cols = area.width()/cell_size + 1;
+            num_rows = area.height()/cell_size + 1;
+            if (cells.size() < (unsigned long)(num_cols*num_rows))
+                cells.resize(num_cols*num_rows);
+        }
+
+        unsigned long size (
+        ) const { return boxes.size(); }
+
+        const rectangle& operator[] (
+            unsigned long idx
+        ) const { return boxes[idx]; }
+
+        bool overlaps_any (
+            const test_box_overlap& tester,
+            const rectangle& rect
+        )
+        /*!
+            ensures
+                - returns true if tester((*this)[i], rect) for some i < size()
+        !*/
+        {
+            ++stamp;
+            const long c0 = col(rect.left()), c1 = col(rect.right());
+            const long r0 = row(rect.top()), r1 = row(rect.bottom());
+            for (long r = r0; r <= r1; ++r)
+            {
+                for (long c = c0; c <= c1; ++c)
+                {
+                    const std::vector<unsigned long>& cell = cells[r*num_cols + c];
+                    for (unsigned long i = 0; i < cell.size(); ++i)
+                    {
+                        // a box spanning several cells is tested once
+                        const unsigned long idx = cell[i];
+                        if (tested[idx] == stamp)
+                            continue;
+                        tested[idx] = stamp;
+                        if (tester(boxes[idx], rect))
+                            return true;
+                    }
+                }
+            }
+            return false;
+        }
+
+        void add (
+            const rectangle& rect
+        )
+        /*!
+            ensures
+                - #size() == size() + 1
+                - #(*this)[size()] == rect
+        !*/
+        {
+            const unsigned long idx = boxes.size();
+            boxes.push_back(rect);
+            tested.push_back(0);
+            const long c0 = col(rect.left()), c1 = col(rect.right());
+            const long r0 = row(rect.top()), r1 = row(rect.bottom());
+            for (long r = r0; r <= r1; ++r)
+            {
+                for (long c = c0; c <= c1; ++c)
+                    cells[r*num_cols + c].push_back(idx);
+            }
+        }
+
+        unsigned long capacity_bytes (
+        ) const
+        {
+            unsigned long bytes = cells.capacity()*sizeof(std::vector<unsigned long>) +
+                boxes.capacity()*sizeof(rectangle) + tested.capacity()*sizeof(unsigned long);
+            for (unsigned long i = 0; i < cells.size(); ++i)
+                bytes += cells[i].capacity()*sizeof(unsigned long);
+            return bytes;
+        }
+
+    private:
+
+        // a box past the edge of the area goes in the cells along the edge
+        long col (long x) const { return std::min(std::max((x - origin_x)/cell_size, 0L), num_cols-1); }
+        long row (long y) const { return std::min(std::max((y - origin_y)/cell_size, 0L), num_rows-1); }
+
+        long origin_x;
+        long origin_y;
+        long cell_size;
+        long num_cols;
+        long num_rows;
+        unsigned long stamp;
+        std::vector<std::vector<unsigned long> > cells;
+        std::vector<rectangle> boxes;
+        // the stamp of the last query that tested each box
+        std::vector<unsigned long> tested;
+    };
+
+// ----------------------------------------------------------------------------------------
+
+}
+
+#endif // DLIB_BOX_OVERLAP_GRId_Hh_
@@ -15,12 +15,37 @@ namespace dlib
     typedef object_detector<scan_fhog_pyramid<pyramid_down<6> > > frontal_face_detector;
     inline const std::string get_serialized_frontal_faces();
 
+    inline std::vector<fhog_cascade> get_frontal_face_cascades()
+    {
+        // From calibrate_fhog_cascades() on the images of examples/faces with an
+        // adjust_threshold of -0.5, rounded up: the 16 separable filters with the
+        // biggest singular values at every window, the other 45 where the score can
+        // still reach the threshold.  These are the images TestCascade checks them on,
+        // so that check is in-sample.  Its held-out check calibrates the same stages
+        // on half of the images and must find every face of the other half.
+        // That is 12 faces, and the tilted right filter's bound rests on 9 windows, so
+        // these bounds are examples only.  Calibrate on frames from the camera the
+        // detector runs on before relying on them.
+        const double bounds[] = {2.1893, 1.9769, 1.9458, 2.5961, 2.3240};
+        const unsigned long positives[] = {70, 40, 45, 42, 9};
+        std::vector<fhog_cascade> cascades(5);
+        for (unsigned long i = 0; i < cascades.size(); ++i)
+        {
+            cascades[i].stage_sizes.push_back(16);
+            cascades[i].stage_sizes.push_back(45);
+            cascades[i].bounds.push_back(bounds[i]);
+            cascades[i].num_positives = positives[i];
+        }
+        return cascades;
+    }
+
     inline frontal_face_detector get_frontal_face_detector()
     {
         std::istringstream sin(get_serialized_frontal_faces());
         frontal_face_detector detector;
         deserialize(detector, sin);
-		std::cout << "num of detectors = " << detector.num_detectors() << std::endl;
+        // only used once the scanner's cascade scoring is turned on
+        set_fhog_cascades(detector, get_frontal_face_cascades());
         return detector;
     }
 
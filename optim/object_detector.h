@@ -6,7 +6,9 @@
 #include "object_detector_abstract.h"
 #include "../geometry.h"
 #include <vector>
+#include <chrono>
 #include "box_overlap_testing.h"
+#include "box_overlap_grid.h"
 #include "full_object_detection.h"
 
 namespace dlib
@@ -38,6 +40,26 @@ namespace dlib
         bool operator<(const full_detection& item) const { return detection_confidence < item.detection_confidence; }
     };
 
+// ----------------------------------------------------------------------------------------
+
+    struct detector_filter_stats
+    {
+        /*!
+            WHAT THIS OBJECT REPRESENTS
+                What one weight vector of an object_detector cost since the last
+                reset_filter_stats(): how often it was run, how many windows it
+                found over its threshold before non-max suppression, and the time
+                spent in the scanner's detect() for it.  The time of loading the
+                image is shared by all the weight vectors and isn't counted.
+        !*/
+        detector_filter_stats() : num_scans(0), num_detections(0), total_ms(0), last_ms(0) {}
+
+        unsigned long num_scans;
+        unsigned long num_detections;
+        double total_ms;
+        double last_ms;
+    };
+
 // ----------------------------------------------------------------------------------------
 
     template <typename image_scanner_type>
@@ -115,12 +137,65 @@ namespace dlib
             unsigned long idx = 0
         ) const { return w[idx]; }
 
+        // lets a scanner keep more about a filter next to it, such as its cascade
+        processed_weight_vector<image_scanner_type>& get_processed_w (
+            unsigned long idx = 0
+        ) { return w[idx]; }
+
+        void set_enabled_detectors (
+            const std::vector<unsigned long>& weight_indices
+        );
+        /*!
+            requires
+                - weight_indices[i] < num_detectors() for all valid i
+            ensures
+                - operator() and detect_in_region() only run the weight vectors whose
+                  index is in weight_indices, until this is called again or
+                  enable_all_detectors() is.  An empty list runs none of them.
+                - The detections keep the weight_index they have with all the weight
+                  vectors run, e.g. the pose of a filter of the frontal face detector.
+        !*/
+
+        void enable_all_detectors (
+        );
+        /*!
+            ensures
+                - #is_detector_enabled(i) == true for all i < num_detectors()
+        !*/
+
+        bool is_detector_enabled (
+            unsigned long idx
+        ) const { return enabled.empty() || (idx < enabled.size() && enabled[idx]); }
+
+        unsigned long num_enabled_detectors (
+        ) const;
+
+        const std::vector<detector_filter_stats>& get_filter_stats (
+        ) const { return filter_stats; }
+        /*!
+            ensures
+                - returns the cost of each weight vector, by weight_index, over the
+                  detections since the last reset_filter_stats().  It is empty until the
+                  first detection.
+        !*/
+
+        void reset_filter_stats (
+        );
+
         const test_box_overlap& get_overlap_tester (
         ) const;
 
         const image_scanner_type& get_scanner (
         ) const;
 
+        image_scanner_type& get_scanner (
+        );
+        /*!
+            ensures
+                - returns the scanner so run time settings that don't change the
+                  model, like the thread pool of scan_fhog_pyramid, can be set on it.
+        !*/
+
         object_detector& operator= (
             const object_detector& item 
         );
@@ -183,6 +258,29 @@ namespace dlib
             double adjust_threshold = 0
         );
 
+        template <
+            typename image_type
+            >
+        void detect_in_region (
+            const image_type& img,
+            const rectangle& search_rect,
+            unsigned long min_box_size,
+            unsigned long max_box_size,
+            std::vector<rect_detection>& final_dets,
+            double adjust_threshold = 0
+        );
+        /*!
+            requires
+                - image_scanner_type has load_region(), like scan_fhog_pyramid
+                - min_box_size <= max_box_size
+            ensures
+                - The same as operator()(img, final_dets, adjust_threshold) except that it
+                  only looks for boxes centered in search_rect that are about min_box_size
+                  to max_box_size pixels wide, and only builds features around
+                  search_rect.  See scan_fhog_pyramid::load_region().  The boxes are in
+                  img coordinates.
+        !*/
+
         template <typename T>
         friend void serialize (
             const object_detector<T>& item,
@@ -197,6 +295,15 @@ namespace dlib
 
     private:
 
+        void detect_loaded (
+            std::vector<rect_detection>& final_dets,
+            double adjust_threshold
+        );
+
+        // up to this many candidates the kept boxes are all tested, past it
+        // box_overlap_grid finds the ones near each candidate
+        static const unsigned long max_linear_suppression = 32;
+
         bool overlaps_any_box (
             const std::vector<rect_detection>& rects,
             const dlib::rectangle& rect
@@ -213,6 +320,14 @@ namespace dlib
         test_box_overlap boxes_overlap;
         std::vector<processed_weight_vector<image_scanner_type> > w;
         image_scanner_type scanner;
+        // one flag per weight vector, empty when they are all run
+        std::vector<char> enabled;
+        std::vector<detector_filter_stats> filter_stats;
+        // detect_loaded()'s lists, kept so a detector run on every frame doesn't
+        // allocate them again
+        std::vector<std::pair<double, rectangle> > dets;
+        std::vector<rect_detection> dets_accum;
+        box_overlap_grid kept_boxes;
     };
 
 // ----------------------------------------------------------------------------------------
@@ -246,6 +361,8 @@ namespace dlib
     {
         int version = 0;
         deserialize(version, in);
+        item.enabled.clear();
+        item.filter_stats.clear();
         if (version == 1)
         {
             deserialize(item.scanner, in);
@@ -260,8 +377,6 @@ namespace dlib
             deserialize(item.boxes_overlap, in);
             unsigned long num_detectors = 0;
             deserialize(num_detectors, in);
-			std::cout << __FUNCTION__ << " num_detectors = " << num_detectors << std::endl;
-			num_detectors = 1;
             item.w.resize(num_detectors);
             for (unsigned long i = 0; i < item.w.size(); ++i)
             {
@@ -302,6 +417,7 @@ namespace dlib
     {
         boxes_overlap = item.boxes_overlap;
         w = item.w;
+        enabled = item.enabled;
         scanner.copy_configuration(item.scanner);
     }
 
@@ -419,6 +535,7 @@ namespace dlib
 
         boxes_overlap = item.boxes_overlap;
         w = item.w;
+        enabled = item.enabled;
         scanner.copy_configuration(item.scanner);
         return *this;
     }
@@ -443,16 +560,64 @@ namespace dlib
 		//long long t1 = currentTimeInMilliseconds();
 		//std::cout << "t1-t0 take " << t1-t0 << " ms "<< std::endl;    
 		//LOGD("t1-t0 take %lld ms",t1-t0);    
-		
-        std::vector<std::pair<double, rectangle> > dets;
-        std::vector<rect_detection> dets_accum;
+        detect_loaded(final_dets, adjust_threshold);
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename image_scanner_type
+        >
+    template <
+        typename image_type
+        >
+    void object_detector<image_scanner_type>::
+    detect_in_region (
+        const image_type& img,
+        const rectangle& search_rect,
+        unsigned long min_box_size,
+        unsigned long max_box_size,
+        std::vector<rect_detection>& final_dets,
+        double adjust_threshold
+    ) 
+    {
+        scanner.load_region(img, search_rect, min_box_size, max_box_size);
+        detect_loaded(final_dets, adjust_threshold);
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename image_scanner_type
+        >
+    void object_detector<image_scanner_type>::
+    detect_loaded (
+        std::vector<rect_detection>& final_dets,
+        double adjust_threshold
+    ) 
+    {
+        dets_accum.clear();
+        if (filter_stats.size() != w.size())
+            filter_stats.resize(w.size());
 		//long long t2 = currentTimeInMilliseconds();
 		//std::cout << "t2-t1 take " << t2-t1 << " ms "<< std::endl; 
 
+        typedef std::chrono::steady_clock clock;
+        unsigned long num_run = 0;
         for (unsigned long i = 0; i < w.size(); ++i)
         {
+            if (!is_detector_enabled(i))
+                continue;
+            ++num_run;
             const double thresh = w[i].w(scanner.get_num_dimensions());
+            const clock::time_point t0 = clock::now();
+            dets.clear();
             scanner.detect(w[i].get_detect_argument(), dets, thresh + adjust_threshold);
+            detector_filter_stats& stats = filter_stats[i];
+            stats.last_ms = std::chrono::duration<double, std::milli>(clock::now() - t0).count();
+            stats.total_ms += stats.last_ms;
+            stats.num_detections += dets.size();
+            ++stats.num_scans;
             for (unsigned long j = 0; j < dets.size(); ++j)
             {
                 rect_detection temp;
@@ -468,14 +633,38 @@ namespace dlib
 
         // Do non-max suppression
         final_dets.clear();
-        if (w.size() > 1)
+        if (num_run > 1)
             std::sort(dets_accum.rbegin(), dets_accum.rend());
-        for (unsigned long i = 0; i < dets_accum.size(); ++i)
+        if (dets_accum.size() <= max_linear_suppression)
         {
-            if (overlaps_any_box(final_dets, dets_accum[i].rect))
-                continue;
+            for (unsigned long i = 0; i < dets_accum.size(); ++i)
+            {
+                if (overlaps_any_box(final_dets, dets_accum[i].rect))
+                    continue;
 
-            final_dets.push_back(dets_accum[i]);
+                final_dets.push_back(dets_accum[i]);
+            }
+        }
+        else
+        {
+            // Only the kept boxes near a candidate can overlap it, so they are
+            // looked up in a grid rather than all tested.  The same boxes are kept.
+            rectangle area;
+            double width = 0;
+            for (unsigned long i = 0; i < dets_accum.size(); ++i)
+            {
+                area += dets_accum[i].rect;
+                width += dets_accum[i].rect.width();
+            }
+            kept_boxes.reset(area, (long)(width/dets_accum.size()));
+            for (unsigned long i = 0; i < dets_accum.size(); ++i)
+            {
+                if (kept_boxes.overlaps_any(boxes_overlap, dets_accum[i].rect))
+                    continue;
+
+                kept_boxes.add(dets_accum[i].rect);
+                final_dets.push_back(dets_accum[i]);
+            }
         }
 		//long long t4 = currentTimeInMilliseconds();
 		//std::cout << "t4-t3 take " << t4-t3 << " ms "<< std::endl;  		
@@ -615,6 +804,73 @@ namespace dlib
         }
     }
 
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename image_scanner_type
+        >
+    void object_detector<image_scanner_type>::
+    set_enabled_detectors (
+        const std::vector<unsigned long>& weight_indices
+    )
+    {
+        enabled.assign(w.size(), 0);
+        for (unsigned long i = 0; i < weight_indices.size(); ++i)
+        {
+            // make sure requires clause is not broken
+            DLIB_ASSERT(weight_indices[i] < w.size(),
+                "\t void object_detector::set_enabled_detectors()"
+                << "\n\t Invalid inputs were given to this function "
+                << "\n\t weight_indices["<<i<<"]: " << weight_indices[i]
+                << "\n\t num_detectors():   " << num_detectors()
+                << "\n\t this: " << this
+                );
+            enabled[weight_indices[i]] = 1;
+        }
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename image_scanner_type
+        >
+    void object_detector<image_scanner_type>::
+    enable_all_detectors (
+    )
+    {
+        enabled.clear();
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename image_scanner_type
+        >
+    unsigned long object_detector<image_scanner_type>::
+    num_enabled_detectors (
+    ) const
+    {
+        unsigned long num = 0;
+        for (unsigned long i = 0; i < w.size(); ++i)
+        {
+            if (is_detector_enabled(i))
+                ++num;
+        }
+        return num;
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename image_scanner_type
+        >
+    void object_detector<image_scanner_type>::
+    reset_filter_stats (
+    )
+    {
+        filter_stats.assign(w.size(), detector_filter_stats());
+    }
+
 // ----------------------------------------------------------------------------------------
 
     template <
@@ -639,6 +895,18 @@ namespace dlib
         return scanner;
     }
 
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename image_scanner_type
+        >
+    image_scanner_type& object_detector<image_scanner_type>::
+    get_scanner (
+    )
+    {
+        return scanner;
+    }
+
 // ----------------------------------------------------------------------------------------
 
 }
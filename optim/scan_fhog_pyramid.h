@@ -9,7 +9,13 @@
 #include "../array.h"
 #include "../array2d.h"
 #include "object_detector.h"
-#include <pthread.h>
+#include "../threads/pool_tasks.h"
+#include "../image_transforms/separable_filter_bank.h"
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <limits>
+#include <memory>
 
 namespace dlib
 {
@@ -62,6 +68,597 @@ namespace dlib
     inline void serialize   (const default_fhog_feature_extractor&, std::ostream&) {}
     inline void deserialize (default_fhog_feature_extractor&, std::istream&) {}
 
+// ----------------------------------------------------------------------------------------
+
+    namespace impl
+    {
+        struct fhog_region
+        {
+            /*!
+                WHAT THIS OBJECT REPRESENTS
+                    Where the feature images of a scan_fhog_pyramid::load_region() came
+                    from.  Feature image i was built from the part of pyramid level
+                    levels[i] whose top left corner is offsets[i], in that level's pixel
+                    coordinates.  Only boxes centered in search_rect are kept, unless it
+                    is empty.  When levels is empty the feature images are the whole
+                    pyramid.
+            !*/
+            std::vector<unsigned long> levels;
+            std::vector<point> offsets;
+            rectangle search_rect;
+
+            void clear()
+            {
+                levels.clear();
+                offsets.clear();
+                search_rect = rectangle();
+            }
+        };
+
+        // Only default_fhog_feature_extractor can fill a feature image in bands of
+        // rows.  For other extractors init_fhog_rows() returns 0 and each level is
+        // extracted whole.
+        template <typename feature_extractor_type, typename image_type>
+        long init_fhog_rows (
+            const feature_extractor_type& ,
+            const image_type& ,
+            array<array2d<float> >& ,
+            int , int , int 
+        ) { return 0; }
+
+        template <typename image_type>
+        long init_fhog_rows (
+            const default_fhog_feature_extractor& ,
+            const image_type& img,
+            array<array2d<float> >& hog,
+            int cell_size,
+            int filter_rows_padding,
+            int filter_cols_padding
+        ) { return init_fhog_features(img, hog, cell_size, filter_rows_padding, filter_cols_padding); }
+
+        template <typename feature_extractor_type, typename image_type>
+        void extract_fhog_rows (
+            const feature_extractor_type& fe,
+            const image_type& img,
+            array<array2d<float> >& hog,
+            int cell_size,
+            int filter_rows_padding,
+            int filter_cols_padding,
+            long ,
+            long ,
+            fhog_scratch* 
+        ) { fe(img, hog, cell_size, filter_rows_padding, filter_cols_padding); }
+
+        template <typename image_type>
+        void extract_fhog_rows (
+            const default_fhog_feature_extractor& ,
+            const image_type& img,
+            array<array2d<float> >& hog,
+            int cell_size,
+            int filter_rows_padding,
+            int filter_cols_padding,
+            long first_row,
+            long last_row,
+            fhog_scratch* scratch
+        ) { extract_fhog_feature_rows(img, hog, first_row, last_row, cell_size, filter_rows_padding, filter_cols_padding, scratch); }
+
+        // The whole feature image, built in scratch when fe can use one
+        template <typename feature_extractor_type>
+        bool uses_fhog_scratch (
+            const feature_extractor_type& 
+        ) { return false; }
+
+        inline bool uses_fhog_scratch (
+            const default_fhog_feature_extractor& 
+        ) { return true; }
+
+        template <typename feature_extractor_type, typename image_type>
+        void extract_fhog_image (
+            const feature_extractor_type& fe,
+            const image_type& img,
+            array<array2d<float> >& hog,
+            int cell_size,
+            int filter_rows_padding,
+            int filter_cols_padding,
+            fhog_scratch* 
+        ) { fe(img, hog, cell_size, filter_rows_padding, filter_cols_padding); }
+
+        template <typename image_type>
+        void extract_fhog_image (
+            const default_fhog_feature_extractor& fe,
+            const image_type& img,
+            array<array2d<float> >& hog,
+            int cell_size,
+            int filter_rows_padding,
+            int filter_cols_padding,
+            fhog_scratch* scratch
+        )
+        {
+            if (scratch == 0 || cell_size == 1)
+            {
+                fe(img, hog, cell_size, filter_rows_padding, filter_cols_padding);
+                return;
+            }
+            // all the rows as one band, which is bit-identical to fe()
+            const long rows = init_fhog_features(img, hog, cell_size, filter_rows_padding, filter_cols_padding);
+            if (rows == 0)
+                hog.clear();
+            else
+                extract_fhog_feature_rows(img, hog, 0, rows, cell_size, filter_rows_padding, filter_cols_padding, scratch);
+        }
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    struct fhog_thread_stats
+    {
+        /*!
+            WHAT THIS OBJECT REPRESENTS
+                How the feature extraction of the last scan_fhog_pyramid::load() was
+                spread over the threads of its pool.  Big pyramid levels are cut into
+                bands of feature rows and small ones are extracted whole, one task each.
+        !*/
+
+        fhog_thread_stats() : num_levels(0), num_tasks(0), num_bands(0), wall_ms(0), pyramid_bytes(0) {}
+
+        unsigned long num_levels;
+        // whole levels plus bands
+        unsigned long num_tasks;
+        unsigned long num_bands;
+        // from handing out the first task to the end of the last one
+        double wall_ms;
+        // the time each thread of the pool spent in tasks, or the calling thread's
+        // when there is no pool
+        std::vector<double> busy_ms;
+        // the most memory the pixel levels took at once, not counting the input image
+        unsigned long pyramid_bytes;
+
+        double utilisation (
+        ) const
+        /*!
+            ensures
+                - returns the fraction of wall_ms the threads spent in tasks, 1 when the
+                  work was spread perfectly.
+        !*/
+        {
+            if (wall_ms <= 0 || busy_ms.size() == 0)
+                return 0;
+            double busy = 0;
+            for (unsigned long i = 0; i < busy_ms.size(); ++i)
+                busy += busy_ms[i];
+            return busy/(wall_ms*busy_ms.size());
+        }
+
+        void reset (
+        )
+        /*!
+            ensures
+                - zeroes the counts and empties busy_ms, keeping its memory
+        !*/
+        {
+            num_levels = 0;
+            num_tasks = 0;
+            num_bands = 0;
+            wall_ms = 0;
+            busy_ms.clear();
+            pyramid_bytes = 0;
+        }
+    };
+
+// ----------------------------------------------------------------------------------------
+
+    struct fhog_workspace_stats
+    {
+        /*!
+            WHAT THIS OBJECT REPRESENTS
+                How the buffers a scan_fhog_pyramid keeps from one call to the next have
+                been used.  They only grow, up to what the biggest frame so far needed,
+                so once num_grows stops going up load() and detect() don't allocate.
+        !*/
+
+        fhog_workspace_stats() : num_calls(0), num_grows(0), bytes(0) {}
+
+        // load(), load_region() and detect() calls
+        unsigned long num_calls;
+        // the calls that had to make a buffer bigger
+        unsigned long num_grows;
+        // the memory the buffers and the feature pyramid hold
+        unsigned long bytes;
+    };
+
+// ----------------------------------------------------------------------------------------
+
+    struct fhog_cascade
+    {
+        /*!
+            WHAT THIS OBJECT REPRESENTS
+                The stages in which a detector's separable filters are scored.  The
+                filters are ranked by their singular values.  The first stage scores the
+                first stage_sizes[0] of them at every window, stage s adds the next
+                stage_sizes[s] at the windows still left, and the last stage adds all
+                the filters that are left.  A window is dropped after
+                stage s when its score so far plus bounds[s] is under the detection
+                threshold, so bounds[s] is the most the later stages added to any window
+                over the threshold in the images the cascade was calibrated on.
+        !*/
+
+        fhog_cascade() : num_positives(0) {}
+
+        std::vector<unsigned long> stage_sizes;
+        // one for each stage but the last
+        std::vector<double> bounds;
+        // the windows over the threshold the bounds were calibrated on.  Without any
+        // the bounds mean nothing and every filter is scored everywhere.
+        unsigned long num_positives;
+    };
+
+    inline void serialize (
+        const fhog_cascade& item,
+        std::ostream& out
+    )
+    {
+        int version = 1;
+        serialize(version, out);
+        serialize(item.stage_sizes, out);
+        serialize(item.bounds, out);
+        serialize(item.num_positives, out);
+    }
+
+    inline void deserialize (
+        fhog_cascade& item,
+        std::istream& in
+    )
+    {
+        int version = 0;
+        deserialize(version, in);
+        if (version != 1)
+            throw serialization_error("Unsupported version found when deserializing a fhog_cascade object.");
+        deserialize(item.stage_sizes, in);
+        deserialize(item.bounds, in);
+        deserialize(item.num_positives, in);
+    }
+
+    struct fhog_cascade_stats
+    {
+        /*!
+            WHAT THIS OBJECT REPRESENTS
+                How far the windows got through the cascades of the detect() calls since
+                the last load().  windows[0] is every window scored, windows[s] the ones
+                that were still left for stage s.
+        !*/
+
+        std::vector<unsigned long> windows;
+
+        // keeps the memory, a detector run on every frame shouldn't allocate
+        void reset() { std::fill(windows.begin(), windows.end(), 0); }
+
+        double fraction_left (
+            unsigned long stage
+        ) const { return stage < windows.size() && windows[0] != 0 ? (double)windows[stage]/windows[0] : 0; }
+    };
+
+// ----------------------------------------------------------------------------------------
+
+    namespace impl
+    {
+        struct fhog_task
+        {
+            unsigned long level;
+            // rows [first_row, last_row) of the level's features, or the whole level
+            // when whole is set
+            bool whole;
+            long first_row;
+            long last_row;
+        };
+
+        // Bands shorter than this spend more time on their halo than on their rows
+        const long min_fhog_band_rows = 8;
+
+        // detect() always cuts the feature rows into this many bands, so the detections
+        // don't depend on how many threads run them
+        const long num_detect_bands = 3;
+
+        inline bool compare_singular_values (
+            const std::pair<double, std::pair<unsigned long,unsigned long> >& a,
+            const std::pair<double, std::pair<unsigned long,unsigned long> >& b
+        )
+        {
+            return a.first > b.first;
+        }
+
+        class fhog_task_timer : noncopyable
+        {
+            /*!
+                WHAT THIS OBJECT REPRESENTS
+                    Adds up the time each thread spends in the tasks of one
+                    create_fhog_pyramid() call, for fhog_thread_stats.  Each thread also
+                    gets a slot number, counted from 0 in the order they show up, to pick
+                    its scratch buffers with.
+            !*/
+        public:
+            typedef std::chrono::steady_clock clock;
+
+            fhog_task_timer() : start(clock::now()) {}
+
+            void restart (
+                unsigned long max_threads
+            )
+            {
+                start = clock::now();
+                thread_ids.clear();
+                busy_ms.clear();
+                thread_ids.reserve(max_threads);
+                busy_ms.reserve(max_threads);
+            }
+
+            template <typename T>
+            void time (
+                const T& funct
+            )
+            /*!
+                ensures
+                    - calls funct(slot) with the slot of the calling thread
+            !*/
+            {
+                unsigned long t = 0;
+                {
+                    auto_mutex lock(m);
+                    const thread_id_type id = get_thread_id();
+                    while (t < thread_ids.size() && thread_ids[t] != id)
+                        ++t;
+                    if (t == thread_ids.size())
+                    {
+                        thread_ids.push_back(id);
+                        busy_ms.push_back(0);
+                    }
+                }
+
+                const clock::time_point t0 = clock::now();
+                funct(t);
+                const double ms = std::chrono::duration<double, std::milli>(clock::now() - t0).count();
+
+                auto_mutex lock(m);
+                busy_ms[t] += ms;
+            }
+
+            void finish (
+                fhog_thread_stats& stats,
+                long num_threads
+            )
+            {
+                stats.wall_ms = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+                // threads that got no task count as idle
+                busy_ms.resize(std::max<unsigned long>(busy_ms.size(), std::max(num_threads, 1L)), 0);
+                // and the memory of the old stats comes back to us for the next call
+                stats.busy_ms.swap(busy_ms);
+            }
+
+            unsigned long capacity_bytes (
+            ) const
+            {
+                return thread_ids.capacity()*sizeof(thread_id_type) + busy_ms.capacity()*sizeof(double);
+            }
+
+        private:
+            clock::time_point start;
+            mutex m;
+            std::vector<thread_id_type> thread_ids;
+            std::vector<double> busy_ms;
+        };
+
+        // The memory of every element of a, including the ones past a.size() that
+        // set_size() only hid and will show again.
+        template <typename T, typename mm>
+        unsigned long capacity_bytes (
+            const array<array2d<T>,mm>& a
+        )
+        {
+            unsigned long bytes = a.max_size()*sizeof(array2d<T>);
+            for (unsigned long i = 0; i < a.max_size(); ++i)
+                bytes += (a.begin()+i)->capacity()*sizeof(T);
+            return bytes;
+        }
+
+        template <typename T, typename mm>
+        unsigned long capacity_bytes (
+            const array<array<array2d<T> >,mm>& a
+        )
+        {
+            unsigned long bytes = a.max_size()*sizeof(array<array2d<T> >);
+            for (unsigned long i = 0; i < a.max_size(); ++i)
+                bytes += capacity_bytes(*(a.begin()+i));
+            return bytes;
+        }
+
+        template <typename T, typename mm>
+        void set_grow_only (
+            array<array2d<T>,mm>& a
+        )
+        {
+            for (unsigned long i = 0; i < a.max_size(); ++i)
+                (a.begin()+i)->set_grow_only(true);
+        }
+
+        template <typename T>
+        void shadow_detect_band (
+            const array<array<array2d<T> > >& feats,
+            int band,
+            int num_bands,
+            int filter_rows,
+            array<array<array2d<T> > >& band_feats
+        )
+        /*!
+            ensures
+                - #band_feats has the planes of feats, each shadowing the rows of band
+                  band of num_bands, plus the filter_rows-1 rows under it that the
+                  filters of its last windows reach.  See array2d::config_by_tid().
+        !*/
+        {
+            if (band_feats.max_size() < feats.size())
+                band_feats.set_max_size(feats.size());
+            band_feats.set_size(feats.size());
+            for (unsigned long i = 0; i < band_feats.size(); ++i)
+            {
+                if (band_feats[i].max_size() < feats[i].size())
+                    band_feats[i].set_max_size(feats[i].size());
+                band_feats[i].set_size(feats[i].size());
+                for (unsigned long j = 0; j < band_feats[i].size(); ++j)
+                {
+                    band_feats[i][j].set_private_member(feats[i][j]);
+                    band_feats[i][j].config_by_tid(band, num_bands, filter_rows);
+                }
+            }
+        }
+
+        class fhog_pixel_buffers_base
+        {
+        public:
+            virtual ~fhog_pixel_buffers_base() {}
+            virtual unsigned long capacity_bytes() const = 0;
+        };
+
+        template <typename pixel_type>
+        class fhog_pixel_buffers : public fhog_pixel_buffers_base
+        {
+            /*!
+                WHAT THIS OBJECT REPRESENTS
+                    The pixel images create_fhog_pyramid() and load_region() make from
+                    an image of pixel_type, kept between calls.  levels holds a whole
+                    pyramid or the chips of a region, cur and next the two levels of a
+                    streamed pyramid, and temp1 and temp2 the halvings of
+                    resample_image().  All of them are grow-only.
+            !*/
+        public:
+            fhog_pixel_buffers()
+            {
+                cur.set_grow_only(true);
+                next.set_grow_only(true);
+                temp1.set_grow_only(true);
+                temp2.set_grow_only(true);
+            }
+
+            array<array2d<pixel_type> >& get_levels (
+                unsigned long num
+            )
+            {
+                if (levels.max_size() < num)
+                {
+                    levels.set_max_size(num);
+                    set_grow_only(levels);
+                }
+                levels.set_size(num);
+                return levels;
+            }
+
+            virtual unsigned long capacity_bytes (
+            ) const
+            {
+                return impl::capacity_bytes(levels) + (cur.capacity() + next.capacity() +
+                    temp1.capacity() + temp2.capacity())*sizeof(pixel_type);
+            }
+
+            array2d<pixel_type> cur, next, temp1, temp2;
+
+        private:
+            array<array2d<pixel_type> > levels;
+        };
+
+        class fhog_workspace : noncopyable
+        {
+            /*!
+                WHAT THIS OBJECT REPRESENTS
+                    The temporaries of scan_fhog_pyramid's load() and detect(), kept from
+                    one call to the next.  Each buffer is sized by the biggest frame it
+                    has seen, so once the camera resolution settles the scanner doesn't
+                    go back to the memory manager.
+            !*/
+        public:
+            fhog_workspace()
+            {
+                for (long h = 0; h < num_detect_bands; ++h)
+                {
+                    saliency[h].set_grow_only(true);
+                    filter_scratch[h].set_grow_only(true);
+                }
+            }
+
+            template <typename pixel_type>
+            fhog_pixel_buffers<pixel_type>& pixels (
+            )
+            {
+                // Frames come in one pixel type, so only the last one is kept
+                fhog_pixel_buffers<pixel_type>* p = dynamic_cast<fhog_pixel_buffers<pixel_type>*>(pixel_buffers.get());
+                if (p == 0)
+                {
+                    p = new fhog_pixel_buffers<pixel_type>();
+                    pixel_buffers.reset(p);
+                }
+                return *p;
+            }
+
+            fhog_scratch* get_fhog_scratch (
+                unsigned long slot
+            ) { return slot < fhog_buffers.size() ? &fhog_buffers[slot] : 0; }
+            /*!
+                ensures
+                    - returns the histogram buffers of thread slot slot, or 0 when
+                      reserve_fhog_scratch() didn't make that many
+            !*/
+
+            void reserve_fhog_scratch (
+                unsigned long num
+            )
+            {
+                // resize() moves the buffers we have into the bigger array
+                if (fhog_buffers.size() < num)
+                    fhog_buffers.resize(num);
+            }
+
+            unsigned long capacity_bytes (
+            ) const
+            {
+                unsigned long bytes = pixel_buffers ? pixel_buffers->capacity_bytes() : 0;
+                for (unsigned long i = 0; i < fhog_buffers.size(); ++i)
+                    bytes += fhog_buffers[i].capacity_bytes();
+                bytes += tasks.capacity()*sizeof(fhog_task) + timer.capacity_bytes() +
+                    candidates.capacity()*sizeof(std::pair<double, unsigned long>) +
+                    level_grid.capacity_bytes();
+                for (long h = 0; h < num_detect_bands; ++h)
+                {
+                    bytes += impl::capacity_bytes(feats_dp[h]);
+                    bytes += dets_dp[h].capacity()*sizeof(std::pair<double, rectangle>);
+                    bytes += (saliency[h].capacity() + filter_scratch[h].capacity())*sizeof(float);
+                    bytes += stage_windows[h].capacity()*sizeof(unsigned long);
+                    bytes += level_ends[h].capacity()*sizeof(unsigned long);
+                    bytes += impl::capacity_bytes(fixed_feats_dp[h]) + fixed_scratch[h].capacity()*sizeof(int16);
+                }
+                return bytes;
+            }
+
+            // load()
+            std::vector<fhog_task> tasks;
+            fhog_task_timer timer;
+            // load_region()
+            std::vector<std::pair<double, unsigned long> > candidates;
+            // detect(), one of each per band.  feats_dp shadows the rows of the band.
+            array<array<array2d<float> > > feats_dp[num_detect_bands];
+            std::vector<std::pair<double, rectangle> > dets_dp[num_detect_bands];
+            array2d<float> saliency[num_detect_bands];
+            array2d<float> filter_scratch[num_detect_bands];
+            std::vector<unsigned long> stage_windows[num_detect_bands];
+            std::vector<unsigned long> level_ends[num_detect_bands];
+            // detect() with set_level_suppression(), over the bands of a level merged
+            box_overlap_grid level_grid;
+            // detect() with set_fixed_point(), shadowing the int16 planes
+            array<array<array2d<int16> > > fixed_feats_dp[num_detect_bands];
+            array2d<int16> fixed_scratch[num_detect_bands];
+
+        private:
+            std::unique_ptr<fhog_pixel_buffers_base> pixel_buffers;
+            array<fhog_scratch> fhog_buffers;
+        };
+    }
+
 // ----------------------------------------------------------------------------------------
 
     template <
@@ -70,6 +667,14 @@ namespace dlib
         >
     class scan_fhog_pyramid : noncopyable
     {
+        /*!
+            SCAN SETTINGS
+                set_thread_pool(), set_box_size_range(), set_streaming_pyramid(),
+                set_fused_filter_bank(), set_cascade_scoring(), set_fixed_point() and
+                set_level_suppression() change how images are scanned, not the model.
+                None of them is serialized or copied by copy_configuration(), so a
+                scanner loaded from a saved model starts with their defaults.
+        !*/
 
     public:
 
@@ -92,6 +697,69 @@ namespace dlib
             const image_type& img
         );
 
+        template <
+            typename image_type
+            >
+        void load_region (
+            const image_type& img,
+            const rectangle& search_rect,
+            unsigned long min_box_size,
+            unsigned long max_box_size
+        );
+        /*!
+            requires
+                - min_box_size <= max_box_size
+            ensures
+                - Like load(), except that detect() only finds boxes whose center is in
+                  search_rect and whose width is about min_box_size to max_box_size
+                  pixels.  Only the pyramid levels of that size range are built, at most
+                  MAX_REGION_LEVELS of them, and each only over search_rect padded by a
+                  detection window.  So the cost follows the size of search_rect rather
+                  than the size of img.  When no level matches the range the nearest one
+                  is used.
+                - Each level is resampled from img directly instead of from the level
+                  above it, so the scores can differ slightly from those of load().
+                - detect() returns boxes in img coordinates, as after load().
+                - get_feature_vector() needs load().
+        !*/
+
+        static const unsigned long MAX_REGION_LEVELS = 3;
+
+        void set_box_size_range (
+            unsigned long min_box_size,
+            unsigned long max_box_size
+        ) { min_box_size_ = min_box_size; max_box_size_ = max_box_size; }
+        /*!
+            ensures
+                - load() only builds the pyramid levels that can find boxes about
+                  min_box_size to max_box_size pixels wide, see get_scan_plan().  The
+                  image is resampled straight to the first of them, so when only big
+                  boxes are wanted the full size levels are never built.  0 means no
+                  limit.  This is one of the SCAN SETTINGS.
+                - get_feature_vector() still maps boxes against the whole pyramid.  A box
+                  whose best level was not built adds nothing to psi.
+        !*/
+
+        unsigned long get_min_box_size (
+        ) const { return min_box_size_; }
+
+        unsigned long get_max_box_size (
+        ) const { return max_box_size_; }
+
+        void get_scan_plan (
+            const rectangle& img_rect,
+            unsigned long& first_level,
+            unsigned long& num_levels
+        ) const;
+        /*!
+            ensures
+                - #first_level and #num_levels are the pyramid levels load() builds for
+                  an image of img_rect's size.  A level is kept when its detection box
+                  is within one pyramid step of the box size range.  The whole
+                  pyramid is kept when no range is set, and at least one level always
+                  is.
+        !*/
+
         inline bool is_loaded_with_image (
         ) const;
 
@@ -182,6 +850,142 @@ namespace dlib
         inline unsigned long get_min_pyramid_layer_height (
         ) const;
 
+        void set_thread_pool (
+            thread_pool* pool_
+        ) { pool = pool_; }
+        /*!
+            ensures
+                - load() and detect() hand their work to the given pool.  If pool_ == 0
+                  the same work runs on the calling thread, which gives bit-identical
+                  results.  The pool isn't owned by this object.  This is one of the
+                  SCAN SETTINGS.
+        !*/
+
+        thread_pool* get_thread_pool (
+        ) const { return pool; }
+
+        void set_streaming_pyramid (
+            bool stream
+        ) { stream_pyramid_ = stream; }
+        /*!
+            ensures
+                - When stream is true, load() makes each pixel level of the pyramid right
+                  before its features and drops it right after, rather than building
+                  them all first.  Only two levels are held at once, and each level's
+                  pixels are still in cache when its features are extracted.  The
+                  features are bit-identical either way.  This is one of the SCAN
+                  SETTINGS.
+        !*/
+
+        bool get_streaming_pyramid (
+        ) const { return stream_pyramid_; }
+
+        void set_fused_filter_bank (
+            bool fused
+        ) { fused_filters_ = fused; }
+        /*!
+            ensures
+                - When fused is true, detect() applies the separable filters of all the
+                  feature planes with float_filter_bank_separable(), one block of rows
+                  at a time, rather than with one float_spatially_filter_image_separable()
+                  call per filter over the whole level.  The saliency images agree to
+                  the last bit on x86 and to rounding on ARM.  This is one of the SCAN
+                  SETTINGS.
+                - It is false by default, until its time and its results have been
+                  measured with NEON on ARM.
+        !*/
+
+        bool get_fused_filter_bank (
+        ) const { return fused_filters_; }
+
+        void set_cascade_scoring (
+            bool cascade
+        ) { cascade_scoring_ = cascade; }
+        /*!
+            ensures
+                - When cascade is true, detect() scores the filter banks that have a
+                  calibrated cascade (see fhog_filterbank::set_cascade() and
+                  calibrate_fhog_cascades()) in stages, and only scores the later stages
+                  at the windows that can still reach the threshold.  The windows the
+                  cascade keeps get the same score to rounding.  A window over the
+                  threshold is only dropped when the later stages add more to it than
+                  they ever did in the calibration images.  This is one of the SCAN
+                  SETTINGS.
+        !*/
+
+        bool get_cascade_scoring (
+        ) const { return cascade_scoring_; }
+
+        void set_fixed_point (
+            bool fixed
+        ) { fixed_point_ = fixed; }
+        /*!
+            ensures
+                - When fixed is true, load() and load_region() also keep each feature
+                  plane rounded to int16, with one scale per plane, and detect() runs
+                  the separable filters over those with fixed_filter_bank_separable().
+                  It takes effect from the next load().
+                - Every filter pass then reads half the bytes, and NEON sums eight int16
+                  products per instruction instead of four floats.  SSE2's float filters
+                  are as fast, so on x86 this only costs the rounding of the planes.
+                - The scores are within a few 1e-4 of the float ones, relative to the
+                  biggest score of a level, so only windows right at the threshold can
+                  come out differently.
+                - The cascade of set_cascade_scoring() and filter banks that don't use
+                  separable filters stay in float.
+                - This is one of the SCAN SETTINGS.
+        !*/
+
+        bool get_fixed_point (
+        ) const { return fixed_point_; }
+
+        void set_level_suppression (
+            bool suppress,
+            const test_box_overlap& tester = test_box_overlap()
+        ) { level_suppression_ = suppress; level_tester_ = tester; }
+        /*!
+            ensures
+                - When suppress is true, detect() runs a non-max suppression with tester
+                  over the detections of each pyramid level, once the bands of rows
+                  detect() cuts the level into are merged, and only returns the ones it
+                  keeps.  With the tester of the object_detector this drops most of the
+                  candidates before they are sorted, which matters with low thresholds.  A window
+                  dropped for a stronger one next to it on its level stays dropped even
+                  if that one is later suppressed from another level, so the faces can
+                  differ from a suppression over all the levels at once.  They only do
+                  far below the trained threshold, where the windows chain together.
+                  This is one of the SCAN SETTINGS.
+        !*/
+
+        bool get_level_suppression (
+        ) const { return level_suppression_; }
+
+        const fhog_cascade_stats& get_cascade_stats (
+        ) const { return cascade_stats; }
+        /*!
+            ensures
+                - returns how many windows reached each stage of the cascades in the
+                  detect() calls since the last load() or load_region().
+        !*/
+
+        const fhog_thread_stats& get_thread_stats (
+        ) const { return thread_stats; }
+        /*!
+            ensures
+                - returns how the feature extraction of the last load() was spread over
+                  the threads of get_thread_pool().
+        !*/
+
+        const fhog_workspace_stats& get_workspace_stats (
+        ) const { return workspace_stats; }
+        /*!
+            ensures
+                - returns how the buffers this object keeps between calls have grown.
+                  load(), load_region() and detect() build their pixel levels, gradient
+                  histograms, filter outputs and detection lists in them, sized by the
+                  biggest frame seen so far, instead of allocating them every call.
+        !*/
+
         void detect (
             const feature_vector_type& w,
             std::vector<std::pair<double, rectangle> >& dets,
@@ -226,19 +1030,105 @@ namespace dlib
                 {
                     num += row_filters[i].size();
                 }
-				//std::cout << __FUNCTION__ << " num = " << num << std::endl;
                 return num;
             }
 
+            bool uses_separable_filters() const
+            {
+                // the separable filters are used when they would be faster than the
+                // regular filters.
+                return !(num_separable_filters() > filters.size()*std::min(filters[0].nr(),filters[0].nc())/3.0);
+            }
+
+            void set_cascade (
+                const fhog_cascade& new_cascade
+            )
+            /*!
+                requires
+                    - new_cascade.bounds.size() + 1 == new_cascade.stage_sizes.size() or
+                      new_cascade.num_positives == 0
+                ensures
+                    - Scores the separable filters in the stages of new_cascade when the
+                      scanner's cascade scoring is on.  The stages past the first are
+                      summed into one full filter per plane, since they are only scored
+                      at the windows the earlier stages left.
+            !*/
+            {
+                cascade = new_cascade;
+                stage_row_filters.clear();
+                stage_col_filters.clear();
+                stage_filters.clear();
+                if (!has_cascade())
+                    return;
+
+                stage_row_filters.resize(row_filters.size());
+                stage_col_filters.resize(row_filters.size());
+                unsigned long k = 0;
+                for (unsigned long s = 0; s < cascade.stage_sizes.size(); ++s)
+                {
+                    if (s != 0)
+                        stage_filters.push_back(std::vector<matrix<float> >(row_filters.size()));
+                    const unsigned long end = cascade_stage_end(cascade.stage_sizes, s, k);
+                    for (; k < end; ++k)
+                    {
+                        const unsigned long i = ranked[k].first;
+                        const unsigned long j = ranked[k].second;
+                        if (s == 0)
+                        {
+                            stage_row_filters[i].push_back(row_filters[i][j]);
+                            stage_col_filters[i].push_back(col_filters[i][j]);
+                            continue;
+                        }
+                        matrix<float>& f = stage_filters.back()[i];
+                        if (f.size() == 0)
+                            f = col_filters[i][j]*trans(row_filters[i][j]);
+                        else
+                            f += col_filters[i][j]*trans(row_filters[i][j]);
+                    }
+                }
+            }
+
+            const fhog_cascade& get_cascade() const { return cascade; }
+
+            unsigned long cascade_stage_end (
+                const std::vector<unsigned long>& stage_sizes,
+                unsigned long stage,
+                unsigned long begin
+            ) const
+            {
+                // the last stage scores whatever filters are left
+                if (stage+1 == stage_sizes.size())
+                    return ranked.size();
+                return std::min<unsigned long>(begin + stage_sizes[stage], ranked.size());
+            }
+
+            bool has_cascade() const
+            {
+                return cascade.num_positives != 0 && cascade.stage_sizes.size() > 1 &&
+                    cascade.bounds.size() + 1 == cascade.stage_sizes.size() &&
+                    cascade.stage_sizes[0] != 0 && ranked.size() != 0 && uses_separable_filters();
+            }
+
             std::vector<matrix<float> > filters;
             std::vector<std::vector<matrix<float,0,1> > > row_filters, col_filters;
+            // row_filters and col_filters with int16 taps, for set_fixed_point()
+            std::vector<std::vector<fixed_separable_filter> > fixed_filters;
+            // (plane, filter) of every separable filter, biggest singular value first
+            std::vector<std::pair<unsigned long, unsigned long> > ranked;
+
+            // the first stage of the cascade, as separable filters, then the later ones
+            // as one full filter per plane, empty where a plane has none in that stage
+            std::vector<std::vector<matrix<float,0,1> > > stage_row_filters, stage_col_filters;
+            std::vector<std::vector<matrix<float> > > stage_filters;
+
+        private:
+            fhog_cascade cascade;
         };
 
         fhog_filterbank build_fhog_filterbank (
             const feature_vector_type& weights 
         ) const
         {
-			std::cout << " weights.size() = " << weights.size() << std::endl;
             // make sure requires clause is not broken
             DLIB_ASSERT(weights.size() >= get_num_dimensions(),
                 "\t fhog_filterbank scan_fhog_pyramid::build_fhog_filterbank()"
@@ -252,11 +1142,13 @@ namespace dlib
             temp.filters.resize(fe.get_num_planes());
             temp.row_filters.resize(fe.get_num_planes());
             temp.col_filters.resize(fe.get_num_planes());
+            temp.fixed_filters.resize(fe.get_num_planes());
 
             // load filters from w
             unsigned long width, height;
             compute_fhog_window_size(width, height);
             const long size = width*height;
+            std::vector<std::pair<double, std::pair<unsigned long,unsigned long> > > singular_values;
             for (unsigned long i = 0; i < temp.filters.size(); ++i)
             {
                 matrix<double> u,v,w,f;
@@ -279,11 +1171,19 @@ namespace dlib
                     {
                         temp.col_filters[i].push_back(matrix_cast<float>(colm(u,j)*std::sqrt(w(j))));
                         temp.row_filters[i].push_back(matrix_cast<float>(colm(v,j)*std::sqrt(w(j))));
+                        temp.fixed_filters[i].push_back(fixed_separable_filter());
+                        quantize_separable_filter(temp.row_filters[i].back(), temp.col_filters[i].back(),
+                            temp.fixed_filters[i].back());
+                        singular_values.push_back(std::make_pair(w(j), std::make_pair(i, temp.row_filters[i].size()-1)));
                     }
                 }
-				//std::cout << __FUNCTION__ <<"i=" << i << std::endl;
             }
 
+            // rank the separable filters for a cascade, biggest singular value first
+            std::stable_sort(singular_values.begin(), singular_values.end(), impl::compare_singular_values);
+            for (unsigned long k = 0; k < singular_values.size(); ++k)
+                temp.ranked.push_back(singular_values[k].second);
+
             return temp;
         }
 
@@ -293,6 +1193,23 @@ namespace dlib
             const double thresh
         ) const;
 
+        void update_cascade_bounds (
+            const fhog_filterbank& w,
+            const double thresh,
+            fhog_cascade& cascade
+        ) const;
+        /*!
+            requires
+                - is_loaded_with_image() == true
+                - w.uses_separable_filters() == true
+                - cascade.bounds.size() + 1 == cascade.stage_sizes.size()
+            ensures
+                - For every window of the loaded image that w scores at thresh or more,
+                  raises cascade.bounds[s] to what the stages after s add to its score
+                  and counts it in cascade.num_positives.  The bounds should start at
+                  -infinity.
+        !*/
+
 
         void get_feature_vector (
             const full_object_detection& obj,
@@ -384,6 +1301,20 @@ namespace dlib
             return (r1.intersect(r2).area())/(double)(r1 + r2).area();
         }
 
+        void quantize_features (
+        );
+
+        void note_workspace_use (
+        ) const
+        {
+            const unsigned long bytes = workspace.capacity_bytes() + impl::capacity_bytes(feats) +
+                impl::capacity_bytes(fixed_feats);
+            ++workspace_stats.num_calls;
+            if (bytes > workspace_stats.bytes)
+                ++workspace_stats.num_grows;
+            workspace_stats.bytes = bytes;
+        }
+
         typedef array<array2d<float> > fhog_image;
 
         feature_extractor_type fe;
@@ -396,6 +1327,25 @@ namespace dlib
         unsigned long min_pyramid_layer_width;
         unsigned long min_pyramid_layer_height;
         double nuclear_norm_regularization_strength;
+        thread_pool* pool;
+        bool stream_pyramid_;
+        bool fused_filters_;
+        bool cascade_scoring_;
+        bool level_suppression_;
+        test_box_overlap level_tester_;
+        bool fixed_point_;
+        // feats rounded to int16 and the scale of each plane, when fixed_loaded
+        array<array<array2d<int16> > > fixed_feats;
+        std::vector<std::vector<float> > fixed_scales;
+        bool fixed_loaded;
+        fhog_thread_stats thread_stats;
+        // detect() is const but works in the workspace too
+        mutable impl::fhog_workspace workspace;
+        mutable fhog_workspace_stats workspace_stats;
+        mutable fhog_cascade_stats cascade_stats;
+        impl::fhog_region region;
+        unsigned long min_box_size_;
+        unsigned long max_box_size_;
 
         void init()
         {
@@ -407,6 +1357,15 @@ namespace dlib
             min_pyramid_layer_width = 64;
             min_pyramid_layer_height = 64;
             nuclear_norm_regularization_strength = 0;
+            pool = 0;
+            stream_pyramid_ = false;
+            fused_filters_ = false;
+            cascade_scoring_ = false;
+            level_suppression_ = false;
+            fixed_point_ = false;
+            fixed_loaded = false;
+            min_box_size_ = 0;
+            max_box_size_ = 0;
         }
 
     };
@@ -415,24 +1374,19 @@ namespace dlib
 
     namespace impl
     {
-		//long long total_pyr_time = 0;
-		//long long total_fe_time = 0;
-		
 		template <typename fhog_filterbank>
         rectangle apply_filters_to_fhog (
             const fhog_filterbank& w,
             const array<array2d<float> >& feats,
-            array2d<float>& saliency_image
+            array2d<float>& saliency_image,
+            array2d<float>* filter_scratch = 0,
+            bool fused = false
         )
         {
             const unsigned long num_separable_filters = w.num_separable_filters();
             rectangle area;
-			//std::cout << " w.num_separable_filters() = " << w.num_separable_filters() << std::endl;
-			//std::cout << " w.filters.size() = " << w.filters.size() << std::endl;
-			//std::cout << " w.filters[0].nr() = " << w.filters[0].nr() << std::endl;
-			//std::cout << " w.filters[0].nc() = " << w.filters[0].nc() << std::endl;
             // use the separable filters if they would be faster than running the regular filters.
-            if (num_separable_filters > w.filters.size()*std::min(w.filters[0].nr(),w.filters[0].nc())/3.0)
+            if (!w.uses_separable_filters())
             {
                 area = spatially_filter_image(feats[0], saliency_image, w.filters[0]);
                 for (unsigned long i = 1; i < w.filters.size(); ++i)
@@ -444,8 +1398,14 @@ namespace dlib
             }
             else
             {
-                saliency_image.clear();
-                array2d<float> scratch;
+                // saliency_image and scratch may hold the memory of an earlier level,
+                // so whether a filter was applied yet is tracked on its own
+                bool filtered = false;
+                array2d<float> local_scratch;
+                array2d<float>& scratch = filter_scratch ? *filter_scratch : local_scratch;
+
+                if (fused && num_separable_filters != 0)
+                    return float_filter_bank_separable(feats, w.row_filters, w.col_filters, saliency_image, scratch);
 
                 // find the first filter to apply
                 unsigned long i = 0;
@@ -454,16 +1414,13 @@ namespace dlib
 				
                 for (; i < w.row_filters.size(); ++i)
                 {
-					//std::cout << " w.row_filters[" << i <<"].size() = " << w.row_filters[i].size() << std::endl;
 					for (unsigned long j = 0; j < w.row_filters[i].size(); ++j)
                     {
-                        if (saliency_image.size() == 0)
-                            area = float_spatially_filter_image_separable(feats[i], saliency_image, w.row_filters[i][j], w.col_filters[i][j],scratch,false);
-                        else
-                            area = float_spatially_filter_image_separable(feats[i], saliency_image, w.row_filters[i][j], w.col_filters[i][j],scratch,true);
+                        area = float_spatially_filter_image_separable(feats[i], saliency_image, w.row_filters[i][j], w.col_filters[i][j],scratch,filtered);
+                        filtered = true;
                     }
                 }
-                if (saliency_image.size() == 0)
+                if (!filtered)
                 {
                     saliency_image.set_size(feats[0].nr(), feats[0].nc());
                     assign_all_pixels(saliency_image, 0);
@@ -471,6 +1428,82 @@ namespace dlib
             }
             return area;
         }
+
+        inline float score_fhog_window (
+            const std::vector<matrix<float> >& filters,
+            const array<array2d<float> >& feats,
+            long top,
+            long left
+        )
+        /*!
+            ensures
+                - returns the sum of the full filters over the window of feats with its
+                  top left corner at (left, top).  Empty filters are skipped.
+        !*/
+        {
+            float score = 0;
+            for (unsigned long i = 0; i < filters.size(); ++i)
+            {
+                const matrix<float>& f = filters[i];
+                for (long m = 0; m < f.nr(); ++m)
+                {
+                    const float* in = &feats[i][top+m][left];
+                    const float* fr = &f(m,0);
+                    float sum = 0;
+                    for (long n = 0; n < f.nc(); ++n)
+                        sum += fr[n]*in[n];
+                    score += sum;
+                }
+            }
+            return score;
+        }
+
+        template <typename fhog_filterbank>
+        rectangle apply_fhog_cascade (
+            const fhog_filterbank& w,
+            const array<array2d<float> >& feats,
+            const double thresh,
+            array2d<float>& saliency_image,
+            array2d<float>& scratch,
+            std::vector<unsigned long>& stage_windows
+        )
+        /*!
+            requires
+                - w.has_cascade() == true
+            ensures
+                - Scores the first stage of w's cascade at every window, then each later
+                  stage only at the windows whose score so far plus the stage's bound
+                  still reaches thresh.  saliency_image gets the full score of the
+                  windows that went through every stage and -infinity for the others.
+                - Adds the windows that reached each stage to stage_windows.
+        !*/
+        {
+            const rectangle area = float_filter_bank_separable(feats, w.stage_row_filters, w.stage_col_filters, saliency_image, scratch);
+            const std::vector<double>& bounds = w.get_cascade().bounds;
+            const unsigned long num_stages = w.stage_filters.size();
+            if (stage_windows.size() < num_stages+1)
+                stage_windows.resize(num_stages+1, 0);
+
+            for (long r = area.top(); r <= area.bottom(); ++r)
+            {
+                for (long c = area.left(); c <= area.right(); ++c)
+                {
+                    float& score = saliency_image[r][c];
+                    ++stage_windows[0];
+                    for (unsigned long s = 0; s < num_stages; ++s)
+                    {
+                        if (score + bounds[s] < thresh)
+                        {
+                            score = -std::numeric_limits<float>::infinity();
+                            break;
+                        }
+                        ++stage_windows[s+1];
+                        score += score_fhog_window(w.stage_filters[s], feats, r-area.top(), c-area.left());
+                    }
+                }
+            }
+            return area;
+        }
     }
 
 // ----------------------------------------------------------------------------------------
@@ -566,176 +1599,432 @@ namespace dlib
 
     namespace impl
     {
-		template <
+        template <
+            typename pyramid_type,
+            typename in_image_type,
+            typename out_image_type
+            >
+        void pyramid_down_level (
+            const pyramid_type& pyr,
+            const in_image_type& in,
+            out_image_type& out,
+            thread_pool* 
+        )
+        {
+            pyr(in, out);
+        }
+
+        template <
+            unsigned int N,
+            typename in_image_type,
+            typename out_image_type
+            >
+        typename enable_if_c<(N > 3)>::type pyramid_down_level (
+            const pyramid_down<N>& ,
+            const in_image_type& in,
+            out_image_type& out,
+            thread_pool* pool
+        )
+        {
+            // Same as pyramid_down<N>::operator() except that the resize can use the pool.
+            set_image_size(out, ((N-1)*num_rows(in))/N, ((N-1)*num_columns(in))/N);
+            resize_image(in, out, interpolate_bilinear(), pool);
+        }
+
+        template <
+            typename in_image_type,
+            typename pixel_type
+            >
+        void resample_image (
+            const in_image_type& in,
+            long rows,
+            long cols,
+            array2d<pixel_type>& out,
+            array2d<pixel_type>& temp1,
+            array2d<pixel_type>& temp2
+        )
+        {
+            // Halve big reductions first so the bilinear resize doesn't alias
+            out.set_size(rows, cols);
+            if (num_columns(in) >= 2*cols && num_rows(in) >= 2*rows)
+            {
+                pyramid_down<2> pyr2;
+                pyr2(in, temp1);
+                while (temp1.nc() >= 2*cols && temp1.nr() >= 2*rows)
+                {
+                    pyr2(temp1, temp2);
+                    swap(temp1, temp2);
+                }
+                resize_image(temp1, out);
+            }
+            else
+            {
+                resize_image(in, out);
+            }
+        }
+
+        template <
+            typename image_type,
+            typename feature_extractor_type
+            >
+        unsigned long add_fhog_tasks (
+            const image_type& img,
+            unsigned long level,
+            const feature_extractor_type& fe,
+            array<array2d<float> >& hog,
+            int cell_size,
+            int filter_rows_padding,
+            int filter_cols_padding,
+            long num_pieces,
+            std::vector<fhog_task>& tasks
+        )
+        /*!
+            ensures
+                - adds the tasks that extract the features of img, pyramid level level,
+                  into hog: num_pieces bands of rows when the level is big enough and fe
+                  can do bands, the whole level otherwise.
+                - returns the number of bands added.
+        !*/
+        {
+            fhog_task task = {level, true, 0, 0};
+            long rows = 0;
+            if (num_pieces > 1 && cell_size > 1)
+                rows = init_fhog_rows(fe, img, hog, cell_size, filter_rows_padding, filter_cols_padding);
+            if (rows == 0)
+            {
+                tasks.push_back(task);
+                return 0;
+            }
+            const long num_bands = std::max(1L, std::min(num_pieces, rows/min_fhog_band_rows));
+            task.whole = false;
+            for (long b = 0; b < num_bands; ++b)
+            {
+                task.first_row = rows*b/num_bands;
+                task.last_row = rows*(b+1)/num_bands;
+                tasks.push_back(task);
+            }
+            // a level too short to cut is one band of all its rows
+            return num_bands > 1 ? num_bands : 0;
+        }
+
+        template <
+            typename image_type,
+            typename feature_extractor_type
+            >
+        void reserve_fhog_task (
+            const fhog_task& task,
+            const image_type& img,
+            const feature_extractor_type& fe,
+            int cell_size,
+            fhog_workspace& ws,
+            unsigned long num_slots
+        )
+        /*!
+            ensures
+                - makes the fhog_scratch of each of the first num_slots thread slots big
+                  enough for task.  Which thread gets which task changes from call to
+                  call, so every slot has to fit every task for a frame size seen before
+                  not to allocate again.
+        !*/
+        {
+            if (!uses_fhog_scratch(fe) || cell_size == 1)
+                return;
+            // a whole level has fewer than this many feature rows
+            const long rows = task.whole ? num_rows(img)/cell_size + 1 : task.last_row - task.first_row;
+            ws.reserve_fhog_scratch(num_slots);
+            for (unsigned long s = 0; s < num_slots; ++s)
+                ws.get_fhog_scratch(s)->reserve(num_columns(img), rows, cell_size);
+        }
+
+        template <
+            typename image_type,
+            typename feature_extractor_type
+            >
+        void run_fhog_task (
+            const fhog_task& task,
+            const image_type& img,
+            const feature_extractor_type& fe,
+            array<array2d<float> >& hog,
+            int cell_size,
+            int filter_rows_padding,
+            int filter_cols_padding,
+            fhog_scratch* scratch
+        )
+        {
+            if (task.whole)
+                extract_fhog_image(fe, img, hog, cell_size, filter_rows_padding,
+                    filter_cols_padding, scratch);
+            else
+                extract_fhog_rows(fe, img, hog, cell_size, filter_rows_padding,
+                    filter_cols_padding, task.first_row, task.last_row, scratch);
+        }
+
+        template <
+            typename image_type,
             typename pixel_type,
-            typename feature_extractor_type,
-            typename image_type
-            >		
-		struct param_for_fill_in_feats
-		{
-			param_for_fill_in_feats(){}
-
-			feature_extractor_type* fe;
-			array<array2d<pixel_type>>* image_pyr;
-            array<array<array2d<float> > >* feats; 
-            int cell_size;
-            int filter_rows_padding;
-            int filter_cols_padding;
-			pthread_mutex_t mutex;
-			int feats_idx;
-		};
+            typename feature_extractor_type
+            >
+        void extract_fhog_levels (
+            const image_type& img,
+            bool in_place,
+            const array<array2d<pixel_type> >& image_pyr,
+            const feature_extractor_type& fe,
+            array<array<array2d<float> > >& feats,
+            int cell_size,
+            int filter_rows_padding,
+            int filter_cols_padding,
+            thread_pool* pool,
+            fhog_workspace& ws,
+            fhog_thread_stats& stats
+        )
+        /*!
+            ensures
+                - extracts feats[i] from image_pyr[i], or from img when in_place and
+                  i == 0.
+        !*/
+        {
+            // Level 0 holds about a third of the pixels, so with one task per level one
+            // thread does most of the work while the others wait.  Levels bigger than
+            // half a thread's share are cut into bands of feature rows instead.  The
+            // tasks go out biggest first since the levels only get smaller.
+            const long num_threads = pool ? pool->num_threads_in_pool() : 0;
+            double total_size = 0;
+            for (unsigned long i = 0; i < image_pyr.size(); ++i)
+                total_size += (i == 0 && in_place) ? num_rows(img)*num_columns(img) : image_pyr[i].size();
+            const double band_size = total_size/std::max(2*num_threads, 1L);
+
+            std::vector<fhog_task>& tasks = ws.tasks;
+            tasks.clear();
+            for (unsigned long i = 0; i < image_pyr.size(); ++i)
+            {
+                const double size = (i == 0 && in_place) ? num_rows(img)*num_columns(img) : image_pyr[i].size();
+                const long num_pieces = num_threads > 1 ? (long)std::ceil(size/band_size) : 1;
+                if (i == 0 && in_place)
+                    stats.num_bands += add_fhog_tasks(img, i, fe, feats[i], cell_size,
+                        filter_rows_padding, filter_cols_padding, num_pieces, tasks);
+                else
+                    stats.num_bands += add_fhog_tasks(image_pyr[i], i, fe, feats[i], cell_size,
+                        filter_rows_padding, filter_cols_padding, num_pieces, tasks);
+            }
+            stats.num_tasks += tasks.size();
+            for (unsigned long i = 0; i < tasks.size(); ++i)
+            {
+                if (tasks[i].level == 0 && in_place)
+                    reserve_fhog_task(tasks[i], img, fe, cell_size, ws, num_threads+1);
+                else
+                    reserve_fhog_task(tasks[i], image_pyr[tasks[i].level], fe, cell_size, ws, num_threads+1);
+            }
 
-		template <
-            typename pixel_type,
-            typename feature_extractor_type,
-            typename image_type
-            >
-        void* fill_in_feats (
-			void* ptr
-        ) 
-		{
-			param_for_fill_in_feats<pixel_type, feature_extractor_type, image_type>* p = (param_for_fill_in_feats<pixel_type, feature_extractor_type, image_type>*)ptr;
-			unsigned long i;
-			long long total_thread_time = 0;
-			while(1)
-			{
-				pthread_mutex_lock(&p->mutex);
-				i = p->feats_idx;
-				p->feats_idx++;
-				pthread_mutex_unlock(&p->mutex);
-				if(i < (*p->feats).size() )
-				{
-					//long long t0 =rcurrentTimeInMilliseconds();
-					(*p->fe)((*p->image_pyr)[i], (*p->feats)[i], p->cell_size,p->filter_rows_padding,p->filter_cols_padding);
-					//long long t1 = currentTimeInMilliseconds();
-					//r/total_thread_time += (t1-t0);
-				}
-				else
-				{
-					//std::cout << " total_thread_time = " << total_thread_time <<" tid = " << pthread_self() << std::endl;
-					//LOGD("total_thread_time = %lld tid = %ld",total_thread_time,pthread_self());
-					break;
-				}
-			}
-			return NULL;
-		}
-		
-		template <
+            fhog_task_timer& timer = ws.timer;
+            timer.restart(num_threads+1);
+            ws.reserve_fhog_scratch(num_threads+1);
+            run_tasks_on_pool(pool, tasks.size(), [&](long i) {
+                timer.time([&](unsigned long slot) {
+                    const fhog_task& task = tasks[i];
+                    if (task.level == 0 && in_place)
+                        run_fhog_task(task, img, fe, feats[0], cell_size, filter_rows_padding,
+                            filter_cols_padding, ws.get_fhog_scratch(slot));
+                    else
+                        run_fhog_task(task, image_pyr[task.level], fe, feats[task.level], cell_size,
+                            filter_rows_padding, filter_cols_padding, ws.get_fhog_scratch(slot));
+                });
+            });
+            timer.finish(stats, num_threads);
+        }
+
+        template <
             typename pyramid_type,
             typename image_type,
+            typename pixel_type,
             typename feature_extractor_type
             >
-        void create_fhog_pyramid (
+        void stream_fhog_level (
+            const pyramid_type& pyr,
             const image_type& img,
+            unsigned long level,
+            bool make_next,
+            array2d<pixel_type>& next,
             const feature_extractor_type& fe,
-            array<array<array2d<float> > >& feats,
+            array<array2d<float> >& hog,
             int cell_size,
             int filter_rows_padding,
             int filter_cols_padding,
+            thread_pool* pool,
+            fhog_workspace& ws,
+            fhog_thread_stats& stats
+        )
+        /*!
+            ensures
+                - extracts hog from img, pyramid level level, cut into a band per thread
+                  when it's big enough.  If make_next, the next level is made from img
+                  into #next at the same time, as one more task.
+        !*/
+        {
+            const long num_threads = pool ? pool->num_threads_in_pool() : 0;
+            std::vector<fhog_task>& tasks = ws.tasks;
+            tasks.clear();
+            stats.num_bands += add_fhog_tasks(img, level, fe, hog, cell_size,
+                filter_rows_padding, filter_cols_padding, num_threads, tasks);
+            stats.num_tasks += tasks.size();
+            for (unsigned long i = 0; i < tasks.size(); ++i)
+                reserve_fhog_task(tasks[i], img, fe, cell_size, ws, num_threads+1);
+
+            const long first = make_next ? 1 : 0;
+            run_tasks_on_pool(pool, tasks.size() + first, [&](long i) {
+                ws.timer.time([&](unsigned long slot) {
+                    // The next level goes first, its bands come after
+                    if (i < first)
+                        pyramid_down_level(pyr, img, next, 0);
+                    else
+                        run_fhog_task(tasks[i-first], img, fe, hog, cell_size,
+                            filter_rows_padding, filter_cols_padding, ws.get_fhog_scratch(slot));
+                });
+            });
+        }
+
+        template <
+            typename pyramid_type
+            >
+        unsigned long num_fhog_pyramid_levels (
+            const pyramid_type& pyr,
+            rectangle rect,
             unsigned long min_pyramid_layer_width,
             unsigned long min_pyramid_layer_height,
             unsigned long max_pyramid_levels
         )
         {
             unsigned long levels = 0;
-            rectangle rect = get_rect(img);
-            // figure out how many pyramid levels we should be using based on the image size
-            pyramid_type pyr;
             do
             {
                 rect = pyr.rect_down(rect);
                 ++levels;
             } while (rect.width() >= min_pyramid_layer_width && rect.height() >= min_pyramid_layer_height &&
                 levels < max_pyramid_levels);
+            return levels;
+        }
+
+		template <
+            typename pyramid_type,
+            typename image_type,
+            typename feature_extractor_type
+            >
+        void create_fhog_pyramid (
+            const image_type& img,
+            const feature_extractor_type& fe,
+            array<array<array2d<float> > >& feats,
+            int cell_size,
+            int filter_rows_padding,
+            int filter_cols_padding,
+            unsigned long min_pyramid_layer_width,
+            unsigned long min_pyramid_layer_height,
+            unsigned long max_pyramid_levels,
+            thread_pool* pool,
+            unsigned long first_level = 0,
+            unsigned long last_level = ULONG_MAX,
+            bool stream = false,
+            fhog_thread_stats* stats = 0,
+            fhog_workspace* workspace = 0
+        )
+        /*!
+            ensures
+                - The pixel levels and the other temporaries are kept in *workspace, if
+                  given, for the next call.
+        !*/
+        {
+            // figure out how many pyramid levels we should be using based on the image size
+            pyramid_type pyr;
+            unsigned long levels = num_fhog_pyramid_levels(pyr, get_rect(img),
+                min_pyramid_layer_width, min_pyramid_layer_height, max_pyramid_levels);
+            // and which of them the caller wants
+            first_level = std::min(first_level, levels-1);
+            levels = std::min(levels, last_level+1) - first_level;
 
             if (feats.max_size() < levels)
                 feats.set_max_size(levels);
             feats.set_size(levels);
-			//std::cout << "feats.size() = " << feats.size() << std::endl;
-#if 1
 			typedef typename image_traits<image_type>::pixel_type pixel_type;
-			//long long t0 = currentTimeInMilliseconds();
-
-			array<array2d<pixel_type>> image_pyr;
-			image_pyr.set_max_size(levels);
-			image_pyr.set_size(levels);
-			assign_image(image_pyr[0],img);
-			
-			for(int i=0;i<image_pyr.size()-1;i++)
+			const long num_threads = pool ? pool->num_threads_in_pool() : 0;
+			fhog_thread_stats local_stats;
+			fhog_thread_stats& st = stats ? *stats : local_stats;
+			st.reset();
+			st.num_levels = levels;
+			std::unique_ptr<fhog_workspace> local_workspace;
+			if (workspace == 0)
+			{
+				local_workspace.reset(new fhog_workspace());
+				workspace = local_workspace.get();
+			}
+			fhog_workspace& ws = *workspace;
+			fhog_pixel_buffers<pixel_type>& buffers = ws.pixels<pixel_type>();
+
+			// Level 0 is img itself, read in place.  When the planner skips it, img is
+			// scaled straight to the first level wanted and the bigger ones are never
+			// built.
+			const drectangle first = pyr.rect_down(drectangle(0,0,num_columns(img),num_rows(img)), first_level);
+			const long first_rows = (long)(first.bottom()+0.5);
+			const long first_cols = (long)(first.right()+0.5);
+			if (stream)
+			{
+				// Each level is made, handed to the extractor and dropped, so only two
+				// levels are held at once and each is still in cache for its features.
+				ws.timer.restart(num_threads+1);
+				ws.reserve_fhog_scratch(num_threads+1);
+				// The buffers take turns by pointer rather than by swap(), so buffers.cur
+				// always gets the biggest level and buffers.next the second biggest,
+				// whatever the number of levels.  Otherwise their grow-only memory would
+				// trade places from frame to frame and one of them could still grow.
+				array2d<pixel_type>* cur = &buffers.cur;
+				array2d<pixel_type>* next = &buffers.next;
+				unsigned long l = 0;
+				if (first_level == 0)
+				{
+					stream_fhog_level(pyr, img, 0, levels > 1, *cur, fe, feats[0], cell_size,
+						filter_rows_padding, filter_cols_padding, pool, ws, st);
+					st.pyramid_bytes = cur->size()*sizeof(pixel_type);
+					l = 1;
+				}
+				else
+				{
+					resample_image(img, first_rows, first_cols, *cur, buffers.temp1, buffers.temp2);
+				}
+				for (; l < levels; ++l)
+				{
+					stream_fhog_level(pyr, *cur, l, l+1 < levels, *next, fe, feats[l], cell_size,
+						filter_rows_padding, filter_cols_padding, pool, ws, st);
+					st.pyramid_bytes = std::max<unsigned long>(st.pyramid_bytes,
+						(cur->size() + next->size())*sizeof(pixel_type));
+					std::swap(cur, next);
+				}
+				ws.timer.finish(st, num_threads);
+			}
+			else
 			{
-				pyr(image_pyr[i], image_pyr[i+1]);
+				// image_pyr[0] isn't used when level 0 is img
+				array<array2d<pixel_type> >& image_pyr = buffers.get_levels(levels);
+				if (first_level != 0)
+					resample_image(img, first_rows, first_cols, image_pyr[0], buffers.temp1, buffers.temp2);
+				for (unsigned long i = 0; i+1 < levels; ++i)
+				{
+					if (i == 0 && first_level == 0)
+						pyramid_down_level(pyr, img, image_pyr[1], pool);
+					else
+						pyramid_down_level(pyr, image_pyr[i], image_pyr[i+1], pool);
+					st.pyramid_bytes += image_pyr[i+1].size()*sizeof(pixel_type);
+				}
+				if (first_level != 0)
+					st.pyramid_bytes += image_pyr[0].size()*sizeof(pixel_type);
+
+				extract_fhog_levels(img, first_level == 0, image_pyr, fe, feats, cell_size,
+					filter_rows_padding, filter_cols_padding, pool, ws, st);
 			}
-			//long long t1 = currentTimeInMilliseconds();
+			// the feature images keep their memory for the next, maybe smaller, frame
+			for (unsigned long l = 0; l < feats.max_size(); ++l)
+				set_grow_only(*(feats.begin()+l));
 
-			//impl::total_pyr_time = (t1-t0);
 			// build our feature pyramid
 			DLIB_ASSERT(feats[0].size() == fe.get_num_planes(), 
 				"Invalid feature extractor used with dlib::scan_fhog_pyramid.  The output does not have the \n"
 				"indicated number of planes.");
-
-			//t0 = currentTimeInMilliseconds();
-			param_for_fill_in_feats<pixel_type, feature_extractor_type,image_type> param;
-			param.cell_size = cell_size;
-			param.fe = (feature_extractor_type*)&fe;
-			param.feats = &feats;
-			param.filter_cols_padding = filter_cols_padding;
-			param.filter_rows_padding = filter_rows_padding;
-			param.image_pyr = &image_pyr;
-			param.mutex = PTHREAD_MUTEX_INITIALIZER;
-			param.feats_idx = 0;
-			//fill_in_feats<pixel_type, feature_extractor_type>((void*)&param);
-			int num_of_thread = 3;
-			pthread_t fill_in_fe_thread[num_of_thread];
-			for(int i=0;i<num_of_thread;i++)
-			{
-				pthread_create(&fill_in_fe_thread[i], NULL, &fill_in_feats<pixel_type, feature_extractor_type, image_type>, (void*)&param);
-			}
-			for(int i=0;i<num_of_thread;i++)
-			{	
-				pthread_join(fill_in_fe_thread[i], NULL);
-			}
-			//t1 = currentTimeInMilliseconds();
-			//impl::total_fe_time = (t1-t0);	
-#else
-            // build our feature pyramid
-            long long t0 = currentTimeInMilliseconds();
-            fe(img, feats[0], cell_size,filter_rows_padding,filter_cols_padding);
-			long long t1 = currentTimeInMilliseconds();
-			impl::total_fe_time += (t1-t0);
-            DLIB_ASSERT(feats[0].size() == fe.get_num_planes(), 
-                "Invalid feature extractor used with dlib::scan_fhog_pyramid.  The output does not have the \n"
-                "indicated number of planes.");
-
-            if (feats.size() > 1)
-            {
-                typedef typename image_traits<image_type>::pixel_type pixel_type;
-                array2d<pixel_type> temp1, temp2;
-				long long t0 = currentTimeInMilliseconds();
-                pyr(img, temp1);
-				long long t1 = currentTimeInMilliseconds();
-				impl::total_pyr_time += (t1-t0);
-                fe(temp1, feats[1], cell_size,filter_rows_padding,filter_cols_padding);
-				long long t2 = currentTimeInMilliseconds();
-				impl::total_fe_time += (t2-t1);
-                swap(temp1,temp2);
-
-                for (unsigned long i = 2; i < feats.size(); ++i)
-                {
-                    long long t0 = currentTimeInMilliseconds();
-					pyr(temp2, temp1);
-					long long t1 = currentTimeInMilliseconds();
-					impl::total_pyr_time += (t1-t0);
-                    t0 = currentTimeInMilliseconds();
-					fe(temp1, feats[i], cell_size,filter_rows_padding,filter_cols_padding);
-					t1 = currentTimeInMilliseconds();
-					impl::total_fe_time += (t1-t0);
-                    swap(temp1,temp2);
-                }
-            }
-#endif			
-			//std::cout << " total_pyr_time = " << impl::total_pyr_time << std::endl;
-			//std::cout << " total_fe_time = " << impl::total_fe_time << std::endl;
-			//LOGD("total_pyr_time = %lld total_fe_time = %lld",impl::total_pyr_time,impl::total_fe_time);
         }
     }
 
@@ -755,10 +2044,211 @@ namespace dlib
     {
         unsigned long width, height;
         compute_fhog_window_size(width,height);
-		//std::cout << "width= " << width << "height = " << height << std::endl;
+        unsigned long first_level, num_levels;
+        get_scan_plan(get_rect(img), first_level, num_levels);
+        region.clear();
+        cascade_stats.reset();
+        // Record which levels were built whenever a plan can drop some, so
+        // get_feature_vector() can find them
+        if (min_box_size_ != 0 || max_box_size_ != 0)
+        {
+            for (unsigned long l = 0; l < num_levels; ++l)
+            {
+                region.levels.push_back(first_level + l);
+                region.offsets.push_back(point(0,0));
+            }
+        }
         impl::create_fhog_pyramid<Pyramid_type>(img, fe, feats, cell_size, height,
             width, min_pyramid_layer_width, min_pyramid_layer_height,
-            max_pyramid_levels);
+            max_pyramid_levels, pool, first_level, first_level + num_levels - 1, stream_pyramid_,
+            &thread_stats, &workspace);
+        quantize_features();
+        note_workspace_use();
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename Pyramid_type,
+        typename feature_extractor_type
+        >
+    void scan_fhog_pyramid<Pyramid_type,feature_extractor_type>::
+    get_scan_plan (
+        const rectangle& img_rect,
+        unsigned long& first_level,
+        unsigned long& num_levels
+    ) const
+    {
+        pyramid_type pyr;
+        const unsigned long levels = impl::num_fhog_pyramid_levels(pyr, img_rect,
+            min_pyramid_layer_width, min_pyramid_layer_height, max_pyramid_levels);
+        first_level = 0;
+        num_levels = levels;
+        if (min_box_size_ == 0 && max_box_size_ == 0)
+            return;
+
+        unsigned long width, height;
+        compute_fhog_window_size(width,height);
+        const drectangle box = fe.feats_to_image(centered_rect(point(0,0),
+            width-2*padding, height-2*padding), cell_size, height, width);
+        // How much bigger a box gets from one level to the next
+        const double step = pyr.rect_up(box).width()/box.width();
+        unsigned long last_level = 0;
+        bool found = false;
+        for (unsigned long l = 0; l < levels; ++l)
+        {
+            const double size = pyr.rect_up(box, l).width();
+            if (size*step < min_box_size_)
+                continue;
+            if (max_box_size_ != 0 && size > max_box_size_*step)
+                break;
+            if (!found)
+                first_level = l;
+            last_level = l;
+            found = true;
+        }
+        if (!found)
+        {
+            // Everything is too small or too big, use the nearest end
+            first_level = last_level = min_box_size_ != 0 &&
+                pyr.rect_up(box, levels-1).width()*step < min_box_size_ ? levels-1 : 0;
+        }
+        num_levels = last_level - first_level + 1;
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename Pyramid_type,
+        typename feature_extractor_type
+        >
+    template <
+        typename image_type
+        >
+    void scan_fhog_pyramid<Pyramid_type,feature_extractor_type>::
+    load_region (
+        const image_type& img,
+        const rectangle& search_rect,
+        unsigned long min_box_size,
+        unsigned long max_box_size
+    )
+    {
+        DLIB_ASSERT(min_box_size <= max_box_size,
+            "\t void scan_fhog_pyramid::load_region()"
+            << "\n\t min_box_size: " << min_box_size
+            << "\n\t max_box_size: " << max_box_size
+            << "\n\t this: " << this
+            );
+
+        typedef typename image_traits<image_type>::pixel_type pixel_type;
+        unsigned long width, height;
+        compute_fhog_window_size(width,height);
+        pyramid_type pyr;
+
+        // The size of a detection box at each level, in img pixels
+        const rectangle box = fe.feats_to_image(centered_rect(point(0,0),
+            width-2*padding, height-2*padding), cell_size, height, width);
+        const unsigned long levels = impl::num_fhog_pyramid_levels(pyr, get_rect(img),
+            min_pyramid_layer_width, min_pyramid_layer_height, max_pyramid_levels);
+        const double target = std::sqrt((double)std::max(1ul,min_box_size)*std::max(1ul,max_box_size));
+        std::vector<std::pair<double, unsigned long> >& candidates = workspace.candidates;
+        candidates.clear();
+        for (unsigned long l = 0; l < levels; ++l)
+        {
+            const double size = pyr.rect_up(drectangle(box), l).width();
+            const double miss = std::abs(std::log(size/target));
+            // levels in the range come first, then the nearest
+            const bool in_range = size >= min_box_size && size <= max_box_size;
+            candidates.push_back(std::make_pair(in_range ? miss : miss + 1000, l));
+        }
+        std::sort(candidates.begin(), candidates.end());
+        unsigned long num_used = 1;
+        while (num_used < candidates.size() && num_used < MAX_REGION_LEVELS &&
+               candidates[num_used].first < 1000)
+            ++num_used;
+
+        region.clear();
+        cascade_stats.reset();
+        region.search_rect = search_rect.intersect(get_rect(img));
+        if (feats.max_size() < num_used)
+            feats.set_max_size(num_used);
+        feats.set_size(num_used);
+        impl::fhog_pixel_buffers<pixel_type>& buffers = workspace.pixels<pixel_type>();
+        array<array2d<pixel_type> >& chips = buffers.get_levels(num_used);
+        bool empty[MAX_REGION_LEVELS];
+        for (unsigned long i = 0; i < num_used; ++i)
+        {
+            const unsigned long l = candidates[i].second;
+            region.levels.push_back(l);
+
+            // The search area at this level, padded so every box centered in it is
+            // covered, and the part of img it came from
+            const rectangle level_rect = pyr.rect_down(drectangle(get_rect(img)), l);
+            const long pad = std::max(box.width(), box.height())/2 + cell_size;
+            rectangle level_area = grow_rect(rectangle(pyr.rect_down(
+                drectangle(region.search_rect), l)), pad).intersect(level_rect);
+            // Start on the cell grid of the whole level so the cells see the same
+            // pixels as after load()
+            level_area.left() -= level_area.left()%cell_size;
+            level_area.top() -= level_area.top()%cell_size;
+            const rectangle src_area = rectangle(pyr.rect_up(drectangle(level_area),
+                l)).intersect(get_rect(img));
+            region.offsets.push_back(level_area.tl_corner());
+            empty[i] = region.search_rect.is_empty() || level_area.is_empty() || src_area.is_empty();
+            if (empty[i])
+                continue;
+
+            impl::resample_image(sub_image(img, src_area), level_area.height(),
+                level_area.width(), chips[i], buffers.temp1, buffers.temp2);
+        }
+
+        // one task per level, as in load()
+        workspace.reserve_fhog_scratch(num_used);
+        run_tasks_on_pool(pool, num_used, [&](long i) {
+            if (empty[i])
+                feats[i].clear();
+            else
+                impl::extract_fhog_image(fe, chips[i], feats[i], cell_size, height, width,
+                    workspace.get_fhog_scratch(i));
+        });
+        for (unsigned long l = 0; l < feats.max_size(); ++l)
+            impl::set_grow_only(*(feats.begin()+l));
+        quantize_features();
+        note_workspace_use();
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename Pyramid_type,
+        typename feature_extractor_type
+        >
+    void scan_fhog_pyramid<Pyramid_type,feature_extractor_type>::
+    quantize_features (
+    )
+    {
+        fixed_loaded = fixed_point_;
+        if (!fixed_point_)
+            return;
+
+        if (fixed_feats.max_size() < feats.size())
+            fixed_feats.set_max_size(feats.size());
+        fixed_feats.set_size(feats.size());
+        fixed_scales.resize(feats.size());
+        // one task per level, the planes of a level are still in cache from their
+        // extraction on small frames
+        run_tasks_on_pool(pool, feats.size(), [&](long l) {
+            array<array2d<int16> >& planes = fixed_feats[l];
+            if (planes.max_size() < feats[l].size())
+            {
+                planes.set_max_size(feats[l].size());
+                impl::set_grow_only(planes);
+            }
+            planes.set_size(feats[l].size());
+            fixed_scales[l].resize(feats[l].size());
+            for (unsigned long j = 0; j < feats[l].size(); ++j)
+                fixed_scales[l][j] = quantize_plane(feats[l][j], planes[j]);
+        });
     }
 
 // ----------------------------------------------------------------------------------------
@@ -884,6 +2374,39 @@ namespace dlib
             return a.first < b.first;
         }
 
+        inline void suppress_level_detections (
+            const test_box_overlap& tester,
+            const unsigned long begin,
+            std::vector<std::pair<double, rectangle> >& dets,
+            box_overlap_grid& kept
+        )
+        /*!
+            ensures
+                - runs a greedy non-max suppression over the detections from
+                  dets[begin] on, all from one pyramid level, and keeps the ones that
+                  survive, strongest first.
+        !*/
+        {
+            std::sort(dets.rbegin(), dets.rend() - begin, compare_pair_rect);
+            rectangle area;
+            double width = 0;
+            for (unsigned long i = begin; i < dets.size(); ++i)
+            {
+                area += dets[i].second;
+                width += dets[i].second.width();
+            }
+            kept.reset(area, (long)(width/(dets.size() - begin)));
+            unsigned long num = begin;
+            for (unsigned long i = begin; i < dets.size(); ++i)
+            {
+                if (kept.overlaps_any(tester, dets[i].second))
+                    continue;
+                kept.add(dets[i].second);
+                dets[num++] = dets[i];
+            }
+            dets.resize(num);
+        }
+
         template <
             typename pyramid_type,
             typename feature_extractor_type,
@@ -900,18 +2423,46 @@ namespace dlib
             const int filter_rows_padding,
             const int filter_cols_padding,
             std::vector<std::pair<double, rectangle> >& dets,
-            bool clear = true
+            bool clear = true,
+            const fhog_region* region = 0,
+            array2d<float>* saliency_buffer = 0,
+            array2d<float>* filter_scratch = 0,
+            bool fused_filters = false,
+            std::vector<unsigned long>* stage_windows = 0,
+            std::vector<unsigned long>* level_ends = 0,
+            const array<array<array2d<int16> > >* fixed_feats = 0,
+            const std::vector<std::vector<float> >* fixed_scales = 0,
+            array2d<int16>* fixed_scratch = 0
         ) 
         {
             if(clear) dets.clear();
-
-            array2d<float> saliency_image;
+            if (region && region->levels.empty())
+                region = 0;
+
+            array2d<float> local_saliency;
+            array2d<float>& saliency_image = saliency_buffer ? *saliency_buffer : local_saliency;
+            array2d<float> local_scratch;
+            array2d<float>& scratch = filter_scratch ? *filter_scratch : local_scratch;
+            // the cascade is used when the caller wants its stage counts
+            const bool cascade = stage_windows && w.has_cascade();
+            const bool fixed = fixed_feats && !cascade && w.uses_separable_filters();
             pyramid_type pyr;
+            if (level_ends)
+                level_ends->resize(feats.size());
 
             // for all pyramid levels
             for (unsigned long l = 0; l < feats.size(); ++l)
             {
-				const rectangle area = apply_filters_to_fhog(w, feats[l], saliency_image);
+                if (level_ends)
+                    (*level_ends)[l] = dets.size();
+                if (feats[l].size() == 0 || feats[l][0].size() == 0)
+                    continue;
+				const rectangle area = cascade ?
+                    apply_fhog_cascade(w, feats[l], thresh, saliency_image, scratch, *stage_windows) :
+                    fixed ?
+                    fixed_filter_bank_separable((*fixed_feats)[l], (*fixed_scales)[l], w.fixed_filters,
+                        saliency_image, *fixed_scratch) :
+                    apply_filters_to_fhog(w, feats[l], saliency_image, &scratch, fused_filters);
 
 				// now search the saliency image for any detections
                 for (long r = area.top(); r <= area.bottom(); ++r)
@@ -923,13 +2474,26 @@ namespace dlib
                         {
                             rectangle rect = fe.feats_to_image(centered_rect(point(c,r+feats[l][0].offset()),det_box_width,det_box_height), 
                                 cell_size, filter_rows_padding, filter_cols_padding);
-                            rect = pyr.rect_up(rect, l);
+                            if (region)
+                            {
+                                rect = pyr.rect_up(translate_rect(rect, region->offsets[l]), region->levels[l]);
+                                if (!region->search_rect.is_empty() &&
+                                    !region->search_rect.contains(center(rect)))
+                                    continue;
+                            }
+                            else
+                            {
+                                rect = pyr.rect_up(rect, l);
+                            }
                             dets.push_back(std::make_pair(saliency_image[r][c], rect));
                         }
                     }
                 }
+                if (level_ends)
+                    (*level_ends)[l] = dets.size();
             }
-            std::sort(dets.rbegin(), dets.rend(), compare_pair_rect);
+            if (!level_ends)
+                std::sort(dets.rbegin(), dets.rend(), compare_pair_rect);
         }
 
         inline bool overlaps_any_box (
@@ -947,44 +2511,6 @@ namespace dlib
             }
             return false;
         }
-
-		template <
-            typename fhog_filterbank,
-            typename feature_extractor_type
-            >
-		struct param_for_detect
-		{
-			param_for_detect(){}
-
-            array<array<array2d<float> > >* feats;
-            const feature_extractor_type* fe;
-            const fhog_filterbank* w;
-            double thresh;
-            unsigned long det_box_height;
-            unsigned long det_box_width;
-            int cell_size;
-            int filter_rows_padding;
-            int filter_cols_padding;
-            std::vector<std::pair<double, rectangle> >* dets;
-		};		
-
-		template <
-            typename fhog_filterbank,
-            typename feature_extractor_type,
-            typename pyramid_type
-            >
-		void* detect_from_fhog_pyramid_wrapper (
-			void* ptr
-		)
-		{
-			//long long t0 = currentTimeInMilliseconds();
-			param_for_detect<fhog_filterbank, feature_extractor_type>* p = (param_for_detect<fhog_filterbank, feature_extractor_type>*)ptr;
-			impl::detect_from_fhog_pyramid<pyramid_type>(*(p->feats), *(p->fe), *(p->w), p->thresh,
-							p->det_box_height, p->det_box_width, p->cell_size, p->filter_rows_padding, p->filter_cols_padding, *(p->dets));
-			//long long t1 = currentTimeInMilliseconds();
-			//std::cout << "single thread finished time = " << t1-t0 << std::endl;				
-			return NULL;			
-		}		
     }
 
 // ----------------------------------------------------------------------------------------
@@ -1014,74 +2540,147 @@ namespace dlib
         unsigned long width, height;
         compute_fhog_window_size(width,height);
 
-		const int num_of_threads = 3;
-		//long long t0 = currentTimeInMilliseconds();
-        array<array<array2d<float> >> feats_dp[num_of_threads];
-		std::vector<std::pair<double, rectangle> > dets_dp[num_of_threads];
+		// The feature rows are always cut into the same bands, whatever the size of the
+		// pool, so the detections don't depend on how many threads run the bands.  Each
+		// band works in its own buffers from the workspace.
+		const int num_of_threads = impl::num_detect_bands;
+		array<array<array2d<float> > >* feats_dp = workspace.feats_dp;
+		std::vector<std::pair<double, rectangle> >* dets_dp = workspace.dets_dp;
+		const bool fixed = fixed_point_ && fixed_loaded;
+		array<array<array2d<int16> > >* fixed_feats_dp = workspace.fixed_feats_dp;
 		for(int h=0;h<num_of_threads;h++)
 		{
-			feats_dp[h].set_max_size(feats.size());
-			feats_dp[h].set_size(feats.size());
-			for(int i=0;i<feats_dp[h].size();i++)
+			impl::shadow_detect_band(feats, h, num_of_threads, height, feats_dp[h]);
+			if (fixed)
+				impl::shadow_detect_band(fixed_feats, h, num_of_threads, height, fixed_feats_dp[h]);
+		}
+		dets.clear();
+		run_tasks_on_pool(pool, num_of_threads, [&](long h) {
+			impl::detect_from_fhog_pyramid<pyramid_type>(feats_dp[h], fe, w, thresh,
+				height-2*padding, width-2*padding, cell_size, height, width, dets_dp[h],
+				true, &region, &workspace.saliency[h], &workspace.filter_scratch[h], fused_filters_,
+				cascade_scoring_ ? &workspace.stage_windows[h] : 0,
+				level_suppression_ ? &workspace.level_ends[h] : 0,
+				fixed ? &fixed_feats_dp[h] : 0, &fixed_scales, &workspace.fixed_scratch[h]);
+		});
+		if (level_suppression_)
+		{
+			// The candidates of a level are merged over the bands before they are
+			// suppressed, so the faces don't depend on where the bands are cut.
+			for (unsigned long l = 0; l < feats.size(); ++l)
 			{
-				feats_dp[h][i].set_max_size(feats[i].size());
-				feats_dp[h][i].set_size(feats[i].size());
-				for(int j=0;j<feats_dp[h][i].size();j++)
+				const unsigned long level_begin = dets.size();
+				for(int h=0;h<num_of_threads;h++)
 				{
-					feats_dp[h][i][j].set_private_member(feats[i][j]);
-					//std::cout << " h = " << h << " i = " << i << " j = " << j << "ret = " << feats_dp[h][i][j].config_by_tid(h,num_of_threads,height) << std::endl;
-					feats_dp[h][i][j].config_by_tid(h,num_of_threads,height);
-					//if (feats_dp[h][i][j].config_by_tid(h,num_of_threads,height) == -1)
-					//if(j == 0)
-					//{
-					//	std::cout << " h = " << h << " i = " << i << " nr = " << feats_dp[h][i][j].nr() << " ori nr = " << feats[i][j].nr() << std::endl;
-					//}
+					const std::vector<unsigned long>& ends = workspace.level_ends[h];
+					dets.insert(dets.end(), dets_dp[h].begin() + (l == 0 ? 0 : ends[l-1]),
+						dets_dp[h].begin() + ends[l]);
 				}
+				if (dets.size() > level_begin + 1)
+					impl::suppress_level_detections(level_tester_, level_begin, dets, workspace.level_grid);
 			}
 		}
-		//long long t1 = currentTimeInMilliseconds();
-		//std::cout << "build feats time = " << t1-t0 << std::endl;
-		pthread_t detect_thread[num_of_threads];
-		impl::param_for_detect<fhog_filterbank, feature_extractor_type> param[num_of_threads];
-		for(int i=0;i<num_of_threads;i++)
-		{
-			param[i].feats = &feats_dp[i];
-			param[i].fe = &fe;
-			param[i].w = &w;
-			param[i].thresh = thresh;
-			param[i].det_box_height = height-2*padding;
-			param[i].det_box_width = width-2*padding;
-			param[i].cell_size = cell_size;
-			param[i].filter_rows_padding = height;
-			param[i].filter_cols_padding = width;
-			param[i].dets = &dets_dp[i];
-			pthread_create(&detect_thread[i], NULL, &impl::detect_from_fhog_pyramid_wrapper<fhog_filterbank, feature_extractor_type,pyramid_type>, (void*)&param[i]);
-		}
-		//long long t2 = currentTimeInMilliseconds();
-		//std::cout << "create threads time = " << t2-t1 << std::endl;		
-		for(int i=0;i<num_of_threads;i++)
-		{	
-			pthread_join(detect_thread[i], NULL);
-		}
-		//long long t3 = currentTimeInMilliseconds();
-		//std::cout << "wait for threads are finished time = " << t3-t2 << std::endl;		
-#if 0			
-		for(int h=0;h<num_of_threads;h++)
-		{
-			impl::detect_from_fhog_pyramid<pyramid_type>(feats_dp[h], fe, w, thresh,
-           		height-2*padding, width-2*padding, cell_size, height, width, dets_dp[h]);
-		}
-#endif
 		for(int h=0;h<num_of_threads;h++)
 		{
+			if (level_suppression_)
+				dets_dp[h].clear();
 			while(!dets_dp[h].empty())
 			{
 				dets.push_back(dets_dp[h].back());
 				dets_dp[h].pop_back();
 			}
+			std::vector<unsigned long>& windows = workspace.stage_windows[h];
+			if (cascade_stats.windows.size() < windows.size())
+				cascade_stats.windows.resize(windows.size(), 0);
+			for (unsigned long s = 0; s < windows.size(); ++s)
+			{
+				cascade_stats.windows[s] += windows[s];
+				windows[s] = 0;
+			}
 		}
-		//long long t4 = currentTimeInMilliseconds();
-		//std::cout << "build dets time = " << t4-t3 << std::endl;			
+		// strongest first, as if the bands were scanned as one
+		std::sort(dets.rbegin(), dets.rend(), impl::compare_pair_rect);
+		note_workspace_use();
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename Pyramid_type,
+        typename feature_extractor_type
+        >
+    void scan_fhog_pyramid<Pyramid_type,feature_extractor_type>::
+    update_cascade_bounds (
+        const fhog_filterbank& w,
+        const double thresh,
+        fhog_cascade& cascade
+    ) const
+    {
+        // make sure requires clause is not broken
+        DLIB_ASSERT(is_loaded_with_image() && w.uses_separable_filters() &&
+                    cascade.bounds.size() + 1 == cascade.stage_sizes.size(),
+            "\t void scan_fhog_pyramid::update_cascade_bounds()"
+            << "\n\t Invalid inputs were given to this function "
+            << "\n\t is_loaded_with_image():    " << is_loaded_with_image()
+            << "\n\t w.uses_separable_filters(): " << w.uses_separable_filters()
+            << "\n\t cascade.bounds.size():      " << cascade.bounds.size()
+            << "\n\t cascade.stage_sizes.size(): " << cascade.stage_sizes.size()
+            << "\n\t this: " << this
+            );
+
+        // the separable filters of each stage
+        const unsigned long num_stages = cascade.stage_sizes.size();
+        std::vector<std::vector<std::vector<matrix<float,0,1> > > > row_filters(num_stages), col_filters(num_stages);
+        std::vector<bool> has_filters(num_stages, false);
+        unsigned long k = 0;
+        for (unsigned long s = 0; s < num_stages; ++s)
+        {
+            row_filters[s].resize(w.row_filters.size());
+            col_filters[s].resize(w.row_filters.size());
+            for (const unsigned long end = w.cascade_stage_end(cascade.stage_sizes, s, k); k < end; ++k)
+            {
+                const unsigned long i = w.ranked[k].first;
+                row_filters[s][i].push_back(w.row_filters[i][w.ranked[k].second]);
+                col_filters[s][i].push_back(w.col_filters[i][w.ranked[k].second]);
+                has_filters[s] = true;
+            }
+        }
+
+        std::vector<array2d<float> > stage_scores(num_stages);
+        array2d<float> scratch;
+        for (unsigned long l = 0; l < feats.size(); ++l)
+        {
+            if (feats[l].size() == 0 || feats[l][0].size() == 0)
+                continue;
+            rectangle area;
+            for (unsigned long s = 0; s < num_stages; ++s)
+            {
+                if (has_filters[s])
+                    area = float_filter_bank_separable(feats[l], row_filters[s], col_filters[s], stage_scores[s], scratch);
+                else
+                    stage_scores[s].clear();
+            }
+
+            for (long r = area.top(); r <= area.bottom(); ++r)
+            {
+                for (long c = area.left(); c <= area.right(); ++c)
+                {
+                    double score = 0;
+                    for (unsigned long s = 0; s < num_stages; ++s)
+                        score += stage_scores[s].size() != 0 ? stage_scores[s][r][c] : 0;
+                    if (score < thresh)
+                        continue;
+
+                    ++cascade.num_positives;
+                    double left = score;
+                    for (unsigned long s = 0; s+1 < num_stages; ++s)
+                    {
+                        left -= stage_scores[s].size() != 0 ? stage_scores[s][r][c] : 0;
+                        cascade.bounds[s] = std::max(cascade.bounds[s], left);
+                    }
+                }
+            }
+        }
     }
 
 // ----------------------------------------------------------------------------------------
@@ -1176,13 +2775,15 @@ namespace dlib
         // make sure requires clause is not broken
         DLIB_ASSERT(is_loaded_with_image() &&
                     psi.size() >= get_num_dimensions() &&
-                    obj.num_parts() == 0,
+                    obj.num_parts() == 0 &&
+                    region.search_rect.is_empty(),
             "\t void scan_fhog_pyramid::get_feature_vector()"
             << "\n\t Invalid inputs were given to this function "
             << "\n\t is_loaded_with_image(): " << is_loaded_with_image()
             << "\n\t psi.size():             " << psi.size()
             << "\n\t get_num_dimensions():   " << get_num_dimensions()
             << "\n\t obj.num_parts():                            " << obj.num_parts()
+            << "\n\t loaded by load_region(): " << !region.search_rect.is_empty()
             << "\n\t this: " << this
             );
 
@@ -1191,7 +2792,21 @@ namespace dlib
         rectangle mapped_rect;
         unsigned long best_level;
         rectangle fhog_rect;
-        get_mapped_rect_and_metadata(feats.size(), obj.get_rect(), mapped_rect, fhog_rect, best_level);
+        // After a planned load() feats[i] is pyramid level region.levels[i], so map
+        // against the whole pyramid and then look for the level that was built.
+        const bool planned = region.levels.size() != 0;
+        get_mapped_rect_and_metadata(planned ? max_pyramid_levels : feats.size(),
+            obj.get_rect(), mapped_rect, fhog_rect, best_level);
+        if (planned)
+        {
+            const std::vector<unsigned long>::const_iterator built = std::find(
+                region.levels.begin(), region.levels.end(), best_level);
+            if (built == region.levels.end())
+                return;
+            best_level = built - region.levels.begin();
+        }
+        if (best_level >= feats.size())
+            return;
 
 
         long i = 0;
@@ -1442,6 +3057,87 @@ namespace dlib
 
     };
 
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename Pyramid_type,
+        typename feature_extractor_type,
+        typename image_array_type
+        >
+    std::vector<fhog_cascade> calibrate_fhog_cascades (
+        const object_detector<scan_fhog_pyramid<Pyramid_type,feature_extractor_type> >& detector,
+        const image_array_type& images,
+        const std::vector<unsigned long>& stage_sizes,
+        const double adjust_threshold = 0
+    )
+    /*!
+        requires
+            - stage_sizes.size() > 1 and stage_sizes[0] > 0
+            - image_array_type is a dlib::array or std::vector of images load() takes
+        ensures
+            - returns a cascade with the given stages for each detector of detector.
+              Each one's bounds cover every window of images that the detector scores
+              at its threshold plus adjust_threshold or more.  A negative
+              adjust_threshold leaves some margin for images that aren't like these.
+            - The scanner's box size range isn't used, every pyramid level is looked
+              at.
+    !*/
+    {
+        DLIB_ASSERT(stage_sizes.size() > 1 && stage_sizes[0] > 0,
+            "\t std::vector<fhog_cascade> calibrate_fhog_cascades()"
+            << "\n\t Invalid inputs were given to this function "
+            << "\n\t stage_sizes.size(): " << stage_sizes.size()
+            );
+
+        scan_fhog_pyramid<Pyramid_type,feature_extractor_type> scanner;
+        scanner.copy_configuration(detector.get_scanner());
+
+        std::vector<fhog_cascade> cascades(detector.num_detectors());
+        for (unsigned long d = 0; d < cascades.size(); ++d)
+        {
+            cascades[d].stage_sizes = stage_sizes;
+            cascades[d].bounds.assign(stage_sizes.size()-1, -std::numeric_limits<double>::infinity());
+        }
+
+        for (unsigned long i = 0; i < images.size(); ++i)
+        {
+            scanner.load(images[i]);
+            for (unsigned long d = 0; d < cascades.size(); ++d)
+            {
+                const double thresh = detector.get_w(d)(scanner.get_num_dimensions()) + adjust_threshold;
+                scanner.update_cascade_bounds(detector.get_processed_w(d).get_detect_argument(), thresh, cascades[d]);
+            }
+        }
+        return cascades;
+    }
+
+    template <
+        typename Pyramid_type,
+        typename feature_extractor_type
+        >
+    void set_fhog_cascades (
+        object_detector<scan_fhog_pyramid<Pyramid_type,feature_extractor_type> >& detector,
+        const std::vector<fhog_cascade>& cascades
+    )
+    /*!
+        requires
+            - cascades.size() == detector.num_detectors()
+        ensures
+            - Gives each filter bank of detector its cascade.  They are used once
+              detector.get_scanner().set_cascade_scoring(true) is called.
+    !*/
+    {
+        DLIB_ASSERT(cascades.size() == detector.num_detectors(),
+            "\t void set_fhog_cascades()"
+            << "\n\t Invalid inputs were given to this function "
+            << "\n\t cascades.size():          " << cascades.size()
+            << "\n\t detector.num_detectors(): " << detector.num_detectors()
+            );
+
+        for (unsigned long d = 0; d < cascades.size(); ++d)
+            detector.get_processed_w(d).fb.set_cascade(cascades[d]);
+    }
+
 // ----------------------------------------------------------------------------------------
 // ----------------------------------------------------------------------------------------
 
@@ -0,0 +1,768 @@
+// License: Boost Software License   See LICENSE.txt for the full license.
+#ifndef DLIB_SEPARABLE_FILTER_BANk_Hh_
+#define DLIB_SEPARABLE_FILTER_BANk_Hh_
+
+#include "../matrix.h"
+#include "../array2d.h"
+#include "../geometry.h"
+#include "../simd.h"
+#include "../uintn.h"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#if !defined(DLIB_HAVE_SSE2) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#include <arm_neon.h>
+#define DLIB_FILTER_BANK_NEON
+#endif
+
+namespace dlib
+{
+
+// ----------------------------------------------------------------------------------------
+
+    namespace impl
+    {
+#ifdef DLIB_FILTER_BANK_NEON
+        // dlib's simd8f is plain scalar code on ARM, so the filter bank keeps eight
+        // lanes in two NEON registers.  The products are rounded before they are
+        // added, the same as simd8f does it.
+        class filter_lanes
+        {
+        public:
+            inline filter_lanes() {}
+            inline filter_lanes(float f) : lo(vdupq_n_f32(f)), hi(lo) {}
+            inline filter_lanes(const float32x4_t& lo_, const float32x4_t& hi_) : lo(lo_), hi(hi_) {}
+
+            inline void load(const float* ptr) { lo = vld1q_f32(ptr); hi = vld1q_f32(ptr+4); }
+            inline void store(float* ptr) const { vst1q_f32(ptr, lo); vst1q_f32(ptr+4, hi); }
+
+            inline filter_lanes operator* (float f) const
+            { return filter_lanes(vmulq_n_f32(lo, f), vmulq_n_f32(hi, f)); }
+            inline filter_lanes operator+ (const filter_lanes& rhs) const
+            { return filter_lanes(vaddq_f32(lo, rhs.lo), vaddq_f32(hi, rhs.hi)); }
+            inline filter_lanes& operator+= (const filter_lanes& rhs)
+            { lo = vaddq_f32(lo, rhs.lo); hi = vaddq_f32(hi, rhs.hi); return *this; }
+
+        private:
+            float32x4_t lo, hi;
+        };
+#else
+        typedef simd8f filter_lanes;
+#endif
+
+        inline void filter_bank_column (
+            const float* in,
+            long stride,
+            const matrix<float,0,1>& col_filter,
+            long c,
+            float* out,
+            bool add_to
+        )
+        {
+            float temp = 0;
+            for (long m = 0; m < col_filter.size(); ++m)
+                temp += in[m*stride+c]*col_filter(m);
+
+            if (add_to)
+                out[c] += temp;
+            else
+                out[c] = temp;
+        }
+
+        inline void filter_bank_columns (
+            const float* in,
+            long stride,
+            const matrix<float,0,1>& col_filter,
+            long first_col,
+            long last_col,
+            float* out,
+            float* out2,
+            bool add_to
+        )
+        /*!
+            ensures
+                - Applies col_filter to the rows of in starting at in, for the columns
+                  [first_col, last_col), and stores or adds the result to out.  If out2
+                  != 0 does the same for the rows starting one row below into out2.
+                  The two rows share the loads of the rows they both cover, while
+                  each pixel is summed in the same order as in
+                  float_spatially_filter_image_separable().
+        !*/
+        {
+            const long size = col_filter.size();
+            long c = first_col;
+            if (out2)
+            {
+                for (; c < last_col-7; c+=8)
+                {
+                    filter_lanes p, p2, p3, p4;
+                    filter_lanes temp = 0, temp2 = 0, temp3 = 0;
+                    filter_lanes btemp = 0, btemp2 = 0, btemp3 = 0;
+                    const float* row = in+c;
+                    long m = 0;
+                    p.load(row);
+                    for (; m < size-2; m+=3)
+                    {
+                        p2.load(row+(m+1)*stride);
+                        p3.load(row+(m+2)*stride);
+                        p4.load(row+(m+3)*stride);
+                        const float f = col_filter(m);
+                        const float f2 = col_filter(m+1);
+                        const float f3 = col_filter(m+2);
+                        temp += p*f;
+                        temp2 += p2*f2;
+                        temp3 += p3*f3;
+                        btemp += p2*f;
+                        btemp2 += p3*f2;
+                        btemp3 += p4*f3;
+                        p = p4;
+                    }
+                    for (; m < size; ++m)
+                    {
+                        p2.load(row+(m+1)*stride);
+                        temp += p*col_filter(m);
+                        btemp += p2*col_filter(m);
+                        p = p2;
+                    }
+                    temp += temp2+temp3;
+                    btemp += btemp2+btemp3;
+
+                    if (add_to)
+                    {
+                        p.load(out+c);
+                        temp += p;
+                        p.load(out2+c);
+                        btemp += p;
+                    }
+                    temp.store(out+c);
+                    btemp.store(out2+c);
+                }
+                for (; c < last_col; ++c)
+                {
+                    filter_bank_column(in, stride, col_filter, c, out, add_to);
+                    filter_bank_column(in+stride, stride, col_filter, c, out2, add_to);
+                }
+                return;
+            }
+
+            for (; c < last_col-7; c+=8)
+            {
+                filter_lanes p, p2, p3, temp = 0, temp2 = 0, temp3 = 0;
+                const float* row = in+c;
+                long m = 0;
+                for (; m < size-2; m+=3)
+                {
+                    p.load(row+m*stride);
+                    p2.load(row+(m+1)*stride);
+                    p3.load(row+(m+2)*stride);
+                    temp += p*col_filter(m);
+                    temp2 += p2*col_filter(m+1);
+                    temp3 += p3*col_filter(m+2);
+                }
+                for (; m < size; ++m)
+                {
+                    p.load(row+m*stride);
+                    temp += p*col_filter(m);
+                }
+                temp += temp2+temp3;
+
+                if (add_to)
+                {
+                    p.load(out+c);
+                    temp += p;
+                }
+                temp.store(out+c);
+            }
+            for (; c < last_col; ++c)
+                filter_bank_column(in, stride, col_filter, c, out, add_to);
+        }
+
+        inline long filter_bank_block_rows (
+            long nc,
+            long col_filter_size
+        )
+        {
+            // The rows of one block, in and out, should fit in about 128KB so they stay
+            // in a phone's L2 while every filter of every plane goes over them.  Each
+            // block row-filters col_filter_size-1 input rows again, so blocks aren't
+            // made smaller than that.
+            const long floats = 32*1024;
+            return std::max(1L, (floats/std::max(nc,1L) - (col_filter_size-1))/2);
+        }
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    template <
+        typename image_array_type
+        >
+    rectangle float_filter_bank_separable (
+        const image_array_type& planes,
+        const std::vector<std::vector<matrix<float,0,1> > >& row_filters,
+        const std::vector<std::vector<matrix<float,0,1> > >& col_filters,
+        array2d<float>& out_img,
+        array2d<float>& scratch,
+        long block_rows = 0
+    )
+    /*!
+        requires
+            - planes.size() == row_filters.size() == col_filters.size()
+            - all the images in planes have the same size
+            - row_filters[i].size() == col_filters[i].size() for all i
+            - there is at least one filter pair and all row filters have the same
+              size, as do all col filters.
+            - is_same_object(out_img, scratch) == false
+        ensures
+            - Does the same as this loop, but in one pass over the output:
+                bool add_to = false;
+                for (unsigned long i = 0; i < planes.size(); ++i)
+                    for (unsigned long j = 0; j < row_filters[i].size(); ++j)
+                    {
+                        float_spatially_filter_image_separable(planes[i], out_img,
+                            row_filters[i][j], col_filters[i][j], scratch, add_to);
+                        add_to = true;
+                    }
+              The output rows are cut into blocks of block_rows rows (0 means a size
+              picked so a block and the input rows under it stay in cache) and every
+              filter of every plane is applied to a block before the next one is
+              started, so out_img is written once instead of once per filter.  Each
+              output pixel is summed in the same order as the loop above, so on x86,
+              where both use simd8f, the results are bit-identical.
+            - returns the area of out_img that was filtered.  The rest is set to 0.
+    !*/
+    {
+        DLIB_ASSERT(planes.size() == row_filters.size() && row_filters.size() == col_filters.size(),
+            "\trectangle float_filter_bank_separable()"
+            << "\n\t Invalid inputs were given to this function."
+            << "\n\t planes.size():      " << planes.size()
+            << "\n\t row_filters.size(): " << row_filters.size()
+            << "\n\t col_filters.size(): " << col_filters.size()
+        );
+        DLIB_ASSERT(is_same_object(out_img, scratch) == false,
+            "\trectangle float_filter_bank_separable()"
+            << "\n\tYou must give two different image objects"
+        );
+
+        // find the first filter, it sets the sizes of them all
+        unsigned long first_plane = 0;
+        while (first_plane < row_filters.size() && row_filters[first_plane].size() == 0)
+            ++first_plane;
+        DLIB_ASSERT(first_plane < row_filters.size(),
+            "\trectangle float_filter_bank_separable()"
+            << "\n\t There must be at least one filter."
+        );
+
+        const long nr = planes[first_plane].nr();
+        const long nc = planes[first_plane].nc();
+        if (nr == 0 || nc == 0)
+        {
+            out_img.clear();
+            return rectangle();
+        }
+        out_img.set_size(nr, nc);
+
+        const long row_size = row_filters[first_plane][0].size();
+        const long col_size = col_filters[first_plane][0].size();
+        const long first_row = col_size/2;
+        const long first_col = row_size/2;
+        const long last_row = nr - ((col_size-1)/2);
+        const long last_col = nc - ((row_size-1)/2);
+
+        const rectangle non_border = rectangle(first_col, first_row, last_col-1, last_row-1);
+        zero_border_pixels(out_img, non_border);
+        if (last_row <= first_row)
+            return non_border;
+
+        if (block_rows <= 0)
+            block_rows = impl::filter_bank_block_rows(nc, col_size);
+        block_rows = std::min(block_rows, last_row-first_row);
+        scratch.set_size(block_rows+col_size-1, nc);
+
+        for (long r0 = first_row; r0 < last_row; r0 += block_rows)
+        {
+            const long r1 = std::min(r0+block_rows, last_row);
+            // the input rows under the block
+            const long in_r0 = r0-first_row;
+            const long in_rows = r1-r0+col_size-1;
+
+            bool add_to = false;
+            for (unsigned long i = first_plane; i < row_filters.size(); ++i)
+            {
+                DLIB_ASSERT(row_filters[i].size() == col_filters[i].size() &&
+                            (row_filters[i].size() == 0 ||
+                             (planes[i].nr() == nr && planes[i].nc() == nc)),
+                    "\trectangle float_filter_bank_separable()"
+                    << "\n\t Invalid inputs were given to this function."
+                    << "\n\t i: " << i
+                );
+                for (unsigned long j = 0; j < row_filters[i].size(); ++j)
+                {
+                    const matrix<float,0,1>& row_filter = row_filters[i][j];
+                    const matrix<float,0,1>& col_filter = col_filters[i][j];
+                    DLIB_ASSERT(row_filter.size() == row_size && col_filter.size() == col_size,
+                        "\trectangle float_filter_bank_separable()"
+                        << "\n\t All the filters must have the same size."
+                        << "\n\t i: " << i << " j: " << j
+                    );
+
+                    // apply the row filter to the input rows of the block
+                    for (long rr = 0; rr < in_rows; ++rr)
+                    {
+                        const float* in = &planes[i][in_r0+rr][0];
+                        float* sc = &scratch[rr][0];
+                        long c = first_col;
+                        for (; c < last_col-7; c+=8)
+                        {
+                            impl::filter_lanes p, p2, p3, temp = 0, temp2 = 0, temp3 = 0;
+                            long n = 0;
+                            for (; n < row_size-2; n+=3)
+                            {
+                                p.load(in+c-first_col+n);
+                                p2.load(in+c-first_col+n+1);
+                                p3.load(in+c-first_col+n+2);
+                                temp += p*row_filter(n);
+                                temp2 += p2*row_filter(n+1);
+                                temp3 += p3*row_filter(n+2);
+                            }
+                            for (; n < row_size; ++n)
+                            {
+                                p.load(in+c-first_col+n);
+                                temp += p*row_filter(n);
+                            }
+                            temp += temp2 + temp3;
+                            temp.store(sc+c);
+                        }
+                        for (; c < last_col; ++c)
+                        {
+                            float temp = 0;
+                            for (long n = 0; n < row_size; ++n)
+                                temp += in[c-first_col+n]*row_filter(n);
+                            sc[c] = temp;
+                        }
+                    }
+
+                    // apply the column filter and add it to the block, two rows at once
+                    for (long r = r0; r < r1; r+=2)
+                    {
+                        impl::filter_bank_columns(&scratch[r-r0][0], nc, col_filter, first_col, last_col,
+                                                  &out_img[r][0], r+1 < r1 ? &out_img[r+1][0] : 0, add_to);
+                    }
+                    add_to = true;
+                }
+            }
+        }
+        return non_border;
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    struct fixed_separable_filter
+    {
+        /*!
+            WHAT THIS OBJECT REPRESENTS
+                A separable filter with its taps rounded to int16, for
+                fixed_filter_bank_separable().  The absolute values of the row taps add
+                up to less than 2^15, and so do those of the col taps, so a sum of int16
+                pixels times the taps always fits in an int32.  col*trans(row)*scale/2^15
+                is about the float filter.
+        !*/
+        std::vector<int16> row;
+        std::vector<int16> col;
+        float scale;
+    };
+
+    namespace impl
+    {
+        inline float quantize_taps (
+            const matrix<float,0,1>& taps,
+            std::vector<int16>& out
+        )
+        {
+            double sum = 0;
+            for (long n = 0; n < taps.size(); ++n)
+                sum += std::abs(taps(n));
+            out.assign(taps.size(), 0);
+            if (sum == 0)
+                return 0;
+            // leave room for every tap to round up by a half
+            const double scale = sum/(32768 - taps.size());
+            for (long n = 0; n < taps.size(); ++n)
+                out[n] = (int16)std::floor(taps(n)/scale + 0.5);
+            return (float)scale;
+        }
+
+        // columns summed at once by the portable fixed point loops, which the
+        // compiler can vectorize
+        const long fixed_chunk = 64;
+
+#ifdef DLIB_HAVE_SSE2
+        template <int N>
+        struct fixed_lanes_sse { __m128i acc[2*N]; };
+
+        template <int N>
+        inline fixed_lanes_sse<N> fixed_madd_sse (
+            const int16* in,
+            long step,
+            const std::vector<int16>& taps
+        )
+        {
+            // _mm_madd_epi16 multiplies two neighbouring pixels by two taps and adds
+            // them, so the taps go in pairs and an odd last one is paired with 0.
+            // Tap n is applied to the 8*N pixels at in+n*step.
+            __m128i acc[2*N];
+            for (int k = 0; k < 2*N; ++k)
+                acc[k] = _mm_setzero_si128();
+            const long size = taps.size();
+            const int16* t = &taps[0];
+            long n = 0;
+            for (; n < size-1; n+=2)
+            {
+                const __m128i pair = _mm_set1_epi32((t[n]&0xffff) | ((int32)t[n+1]<<16));
+                const int16* p = in+n*step;
+                for (int k = 0; k < N; ++k)
+                {
+                    const __m128i a = _mm_loadu_si128((const __m128i*)(p+8*k));
+                    const __m128i b = _mm_loadu_si128((const __m128i*)(p+step+8*k));
+                    acc[2*k] = _mm_add_epi32(acc[2*k], _mm_madd_epi16(_mm_unpacklo_epi16(a, b), pair));
+                    acc[2*k+1] = _mm_add_epi32(acc[2*k+1], _mm_madd_epi16(_mm_unpackhi_epi16(a, b), pair));
+                }
+            }
+            if (n < size)
+            {
+                const __m128i pair = _mm_set1_epi32(t[n]&0xffff);
+                const int16* p = in+n*step;
+                for (int k = 0; k < N; ++k)
+                {
+                    const __m128i a = _mm_loadu_si128((const __m128i*)(p+8*k));
+                    acc[2*k] = _mm_add_epi32(acc[2*k], _mm_madd_epi16(_mm_unpacklo_epi16(a, a), pair));
+                    acc[2*k+1] = _mm_add_epi32(acc[2*k+1], _mm_madd_epi16(_mm_unpackhi_epi16(a, a), pair));
+                }
+            }
+            fixed_lanes_sse<N> lanes;
+            for (int k = 0; k < 2*N; ++k)
+                lanes.acc[k] = acc[k];
+            return lanes;
+        }
+
+        template <int N>
+        inline void fixed_round_sse (
+            const __m128i* acc,
+            int16* out
+        )
+        {
+            const __m128i half = _mm_set1_epi32(1<<14);
+            for (int k = 0; k < N; ++k)
+            {
+                const __m128i lo = _mm_srai_epi32(_mm_add_epi32(acc[2*k], half), 15);
+                const __m128i hi = _mm_srai_epi32(_mm_add_epi32(acc[2*k+1], half), 15);
+                _mm_storeu_si128((__m128i*)(out+8*k), _mm_packs_epi32(lo, hi));
+            }
+        }
+
+        template <int N>
+        inline void fixed_scale_sse (
+            const __m128i* acc,
+            float scale,
+            float* out,
+            bool add_to
+        )
+        {
+            const __m128 s = _mm_set1_ps(scale);
+            for (int k = 0; k < 2*N; ++k)
+            {
+                __m128 v = _mm_mul_ps(_mm_cvtepi32_ps(acc[k]), s);
+                if (add_to)
+                    v = _mm_add_ps(v, _mm_loadu_ps(out+4*k));
+                _mm_storeu_ps(out+4*k, v);
+            }
+        }
+#endif
+
+        inline void fixed_filter_row (
+            const int16* in,
+            const std::vector<int16>& taps,
+            long first_col,
+            long last_col,
+            int16* out
+        )
+        /*!
+            ensures
+                - out[c] is the sum of in[c-first_col+n]*taps[n], over 2^15 and rounded,
+                  for c in [first_col, last_col)
+        !*/
+        {
+            const long size = taps.size();
+            long c = first_col;
+#if defined(DLIB_HAVE_SSE2)
+            for (; c < last_col-15; c+=16)
+                fixed_round_sse<2>(fixed_madd_sse<2>(in+c-first_col, 1, taps).acc, out+c);
+            for (; c < last_col-7; c+=8)
+                fixed_round_sse<1>(fixed_madd_sse<1>(in+c-first_col, 1, taps).acc, out+c);
+#elif defined(DLIB_FILTER_BANK_NEON)
+            for (; c < last_col-7; c+=8)
+            {
+                const int16* p = in+c-first_col;
+                int32x4_t lo = vdupq_n_s32(0), hi = lo;
+                for (long n = 0; n < size; ++n)
+                {
+                    lo = vmlal_n_s16(lo, vld1_s16(p+n), taps[n]);
+                    hi = vmlal_n_s16(hi, vld1_s16(p+n+4), taps[n]);
+                }
+                vst1_s16(out+c, vrshrn_n_s32(lo, 15));
+                vst1_s16(out+c+4, vrshrn_n_s32(hi, 15));
+            }
+#endif
+            int32 acc[fixed_chunk];
+            for (; c < last_col; c += fixed_chunk)
+            {
+                const long len = std::min(fixed_chunk, last_col-c);
+                const int16* p = in+c-first_col;
+                for (long k = 0; k < len; ++k)
+                    acc[k] = 0;
+                for (long n = 0; n < size; ++n)
+                {
+                    const int32 t = taps[n];
+                    for (long k = 0; k < len; ++k)
+                        acc[k] += p[n+k]*t;
+                }
+                for (long k = 0; k < len; ++k)
+                    out[c+k] = (int16)((acc[k] + (1<<14)) >> 15);
+            }
+        }
+
+        inline void fixed_filter_columns (
+            const int16* in,
+            long stride,
+            const std::vector<int16>& taps,
+            long first_col,
+            long last_col,
+            float scale,
+            float* out,
+            bool add_to
+        )
+        /*!
+            ensures
+                - Stores or adds to out[c] the sum of in[m*stride+c]*taps[m] times scale,
+                  for c in [first_col, last_col)
+        !*/
+        {
+            const long size = taps.size();
+            long c = first_col;
+#if defined(DLIB_HAVE_SSE2)
+            for (; c < last_col-15; c+=16)
+                fixed_scale_sse<2>(fixed_madd_sse<2>(in+c, stride, taps).acc, scale, out+c, add_to);
+            for (; c < last_col-7; c+=8)
+                fixed_scale_sse<1>(fixed_madd_sse<1>(in+c, stride, taps).acc, scale, out+c, add_to);
+#elif defined(DLIB_FILTER_BANK_NEON)
+            for (; c < last_col-7; c+=8)
+            {
+                int32x4_t lo = vdupq_n_s32(0), hi = lo;
+                for (long m = 0; m < size; ++m)
+                {
+                    const int16* p = in+m*stride+c;
+                    lo = vmlal_n_s16(lo, vld1_s16(p), taps[m]);
+                    hi = vmlal_n_s16(hi, vld1_s16(p+4), taps[m]);
+                }
+                float32x4_t out_lo = add_to ? vld1q_f32(out+c) : vdupq_n_f32(0);
+                float32x4_t out_hi = add_to ? vld1q_f32(out+c+4) : vdupq_n_f32(0);
+                vst1q_f32(out+c, vmlaq_n_f32(out_lo, vcvtq_f32_s32(lo), scale));
+                vst1q_f32(out+c+4, vmlaq_n_f32(out_hi, vcvtq_f32_s32(hi), scale));
+            }
+#endif
+            int32 acc[fixed_chunk];
+            for (; c < last_col; c += fixed_chunk)
+            {
+                const long len = std::min(fixed_chunk, last_col-c);
+                for (long k = 0; k < len; ++k)
+                    acc[k] = 0;
+                for (long m = 0; m < size; ++m)
+                {
+                    const int16* p = in+m*stride+c;
+                    const int32 t = taps[m];
+                    for (long k = 0; k < len; ++k)
+                        acc[k] += p[k]*t;
+                }
+                if (add_to)
+                {
+                    for (long k = 0; k < len; ++k)
+                        out[c+k] += acc[k]*scale;
+                }
+                else
+                {
+                    for (long k = 0; k < len; ++k)
+                        out[c+k] = acc[k]*scale;
+                }
+            }
+        }
+    }
+
+// ----------------------------------------------------------------------------------------
+
+    inline void quantize_separable_filter (
+        const matrix<float,0,1>& row_filter,
+        const matrix<float,0,1>& col_filter,
+        fixed_separable_filter& out
+    )
+    /*!
+        ensures
+            - #out is row_filter and col_filter with their taps rounded to int16, each
+              with its own scale.
+    !*/
+    {
+        const float row_scale = impl::quantize_taps(row_filter, out.row);
+        const float col_scale = impl::quantize_taps(col_filter, out.col);
+        out.scale = row_scale*col_scale*32768;
+    }
+
+    inline float quantize_plane (
+        const array2d<float>& plane,
+        array2d<int16>& out
+    )
+    /*!
+        ensures
+            - #out has the size of plane and holds its pixels over the returned scale,
+              rounded to the nearest integer.  The scale takes the biggest absolute
+              pixel to 32767, and is 0 when every pixel is 0.
+    !*/
+    {
+        out.set_size(plane.nr(), plane.nc());
+        float max_abs = 0;
+        for (long r = 0; r < plane.nr(); ++r)
+        {
+            const float* in = &plane[r][0];
+            for (long c = 0; c < plane.nc(); ++c)
+                max_abs = std::max(max_abs, std::abs(in[c]));
+        }
+        const float inv = max_abs != 0 ? 32767/max_abs : 0;
+        for (long r = 0; r < plane.nr(); ++r)
+        {
+            const float* in = &plane[r][0];
+            int16* q = &out[r][0];
+            for (long c = 0; c < plane.nc(); ++c)
+            {
+                const float v = in[c]*inv;
+                q[c] = (int16)(v < 0 ? -(int32)(0.5f - v) : (int32)(v + 0.5f));
+            }
+        }
+        return max_abs/32767;
+    }
+
+    template <
+        typename image_array_type
+        >
+    rectangle fixed_filter_bank_separable (
+        const image_array_type& planes,
+        const std::vector<float>& plane_scales,
+        const std::vector<std::vector<fixed_separable_filter> >& filters,
+        array2d<float>& out_img,
+        array2d<int16>& scratch,
+        long block_rows = 0
+    )
+    /*!
+        requires
+            - planes.size() == plane_scales.size() == filters.size()
+            - planes holds array2d<int16> images of the same size, made by
+              quantize_plane() with the scales in plane_scales.
+            - there is at least one filter and all row filters have the same size,
+              as do all col filters.
+        ensures
+            - Does what float_filter_bank_separable() does with the float planes and
+              filters these were made from, in integers: each row filter is summed
+              into int32 and rounded back to int16, each col filter is summed into
+              int32, and only that sum is scaled to float and added to out_img.  The
+              planes and the rows between the two passes take half the memory of
+              floats.  With 15 bits for the biggest pixel of each plane and about 15
+              bits for each filter, out_img is within a few 1e-4 of the float result,
+              relative to its biggest value.
+            - returns the area of out_img that was filtered.  The rest is set to 0.
+    !*/
+    {
+        DLIB_ASSERT(planes.size() == plane_scales.size() && planes.size() == filters.size(),
+            "\trectangle fixed_filter_bank_separable()"
+            << "\n\t Invalid inputs were given to this function."
+            << "\n\t planes.size():       " << planes.size()
+            << "\n\t plane_scales.size(): " << plane_scales.size()
+            << "\n\t filters.size():      " << filters.size()
+        );
+
+        // find the first filter, it sets the sizes of them all
+        unsigned long first_plane = 0;
+        while (first_plane < filters.size() && filters[first_plane].size() == 0)
+            ++first_plane;
+        DLIB_ASSERT(first_plane < filters.size(),
+            "\trectangle fixed_filter_bank_separable()"
+            << "\n\t There must be at least one filter."
+        );
+
+        const long nr = planes[first_plane].nr();
+        const long nc = planes[first_plane].nc();
+        if (nr == 0 || nc == 0)
+        {
+            out_img.clear();
+            return rectangle();
+        }
+        out_img.set_size(nr, nc);
+
+        const long row_size = filters[first_plane][0].row.size();
+        const long col_size = filters[first_plane][0].col.size();
+        const long first_row = col_size/2;
+        const long first_col = row_size/2;
+        const long last_row = nr - ((col_size-1)/2);
+        const long last_col = nc - ((row_size-1)/2);
+
+        const rectangle non_border = rectangle(first_col, first_row, last_col-1, last_row-1);
+        zero_border_pixels(out_img, non_border);
+        if (last_row <= first_row)
+            return non_border;
+
+        if (block_rows <= 0)
+            block_rows = impl::filter_bank_block_rows(nc, col_size);
+        block_rows = std::min(block_rows, last_row-first_row);
+        scratch.set_size(block_rows+col_size-1, nc);
+
+        for (long r0 = first_row; r0 < last_row; r0 += block_rows)
+        {
+            const long r1 = std::min(r0+block_rows, last_row);
+            // the input rows under the block
+            const long in_r0 = r0-first_row;
+            const long in_rows = r1-r0+col_size-1;
+
+            bool add_to = false;
+            for (unsigned long i = first_plane; i < filters.size(); ++i)
+            {
+                DLIB_ASSERT(filters[i].size() == 0 || (planes[i].nr() == nr && planes[i].nc() == nc),
+                    "\trectangle fixed_filter_bank_separable()"
+                    << "\n\t Invalid inputs were given to this function."
+                    << "\n\t i: " << i
+                );
+                for (unsigned long j = 0; j < filters[i].size(); ++j)
+                {
+                    const fixed_separable_filter& filter = filters[i][j];
+                    DLIB_ASSERT((long)filter.row.size() == row_size && (long)filter.col.size() == col_size,
+                        "\trectangle fixed_filter_bank_separable()"
+                        << "\n\t All the filters must have the same size."
+                        << "\n\t i: " << i << " j: " << j
+                    );
+
+                    for (long rr = 0; rr < in_rows; ++rr)
+                        impl::fixed_filter_row(&planes[i][in_r0+rr][0], filter.row, first_col, last_col, &scratch[rr][0]);
+
+                    const float scale = plane_scales[i]*filter.scale;
+                    for (long r = r0; r < r1; ++r)
+                    {
+                        impl::fixed_filter_columns(&scratch[r-r0][0], nc, filter.col, first_col, last_col,
+                                                   scale, &out_img[r][0], add_to);
+                    }
+                    add_to = true;
+                }
+            }
+        }
+        return non_border;
+    }
+
+// ----------------------------------------------------------------------------------------
+
+}
+
+#endif // DLIB_SEPARABLE_FILTER_BANk_Hh_